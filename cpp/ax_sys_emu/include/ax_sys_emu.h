@@ -0,0 +1,54 @@
+/**
+ * @file ax_sys_emu.h
+ * @brief Controls of the host-side AX_SYS/AX_POOL emulation (libax_sys.so
+ *        built with -DLLM630_HOST_EMULATION=ON).
+ *
+ * The emulation implements the CMM and POOL entry points of ax_sys_api.h
+ * and ax_pool_api.h on top of memfd-backed memory so libax_sys_cpp, its
+ * tests and benchmarks run on a development host. It is configured through
+ * the environment, read on first use:
+ *
+ * - AX_EMU_PARTITIONS: comma separated partition table,
+ *   "name[@phys]:size" with K/M/G suffixes. Partitions without an address
+ *   are placed back to back from AX_EMU_PHYS_BASE.
+ *   Default "anonymous:1G".
+ * - AX_EMU_PHYS_BASE: first fake physical address (default 0x100000000).
+ * - AX_EMU_LATENCY_NS: injected busy-wait per call, "name=ns" pairs where
+ *   name is the SDK function name (e.g. "AX_SYS_Mmap=3000") or "*" for
+ *   every entry point.
+ *
+ * Cached mappings are not coherent with non-cached ones, as on the board:
+ * writes through a cached mapping reach memory on AX_SYS_MflushCache, and
+ * AX_SYS_MinvalidateCache drops them so memory is re-read. The driver's
+ * /proc/ax_proc/mem_cmm_info is generated on fopen() of that path.
+ *
+ * The functions below are only exported by the emulation; production code
+ * must not call them.
+ */
+#pragma once
+
+#include "ax_base_type.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set the injected latency of one entry point.
+ * @param name SDK function name, or NULL / "*" for all entry points.
+ * @return 0 on success, -1 if @p name is not an emulated entry point.
+ */
+AX_S32 AX_EMU_SetCallLatency(const AX_CHAR *name, AX_U64 ns);
+
+/**
+ * @brief Number of calls made to @p name since start (or last reset).
+ * @param name SDK function name, or NULL / "*" for the sum over all.
+ */
+AX_U64 AX_EMU_GetCallCount(const AX_CHAR *name);
+
+/** @brief Reset every call counter to zero. */
+AX_VOID AX_EMU_ResetCallCounts(AX_VOID);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,396 @@
+// AX_POOL_* entry points of the host emulation (see ax_sys_emu.h).
+//
+// Each pool is one CMM block holding BlkCnt blocks followed by BlkCnt
+// metadata areas, both rounded up to pages. Common pools come from the
+// floorplan on AX_POOL_Init and are mapped right away; private pools are
+// mapped on AX_POOL_MmapPool. A block handle is (pool id << 16) | (index +
+// 1), so AX_INVALID_BLOCKID (0) is never produced.
+
+#include <ax_pool_api.h>
+#include <ax_sys_api.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <mutex>
+#include <vector>
+
+#include "emu_backend.hpp"
+
+using axemu::Backend;
+
+namespace {
+
+constexpr AX_U64 kPage = 4096;
+constexpr AX_U32 kMaxBlocksPerPool = 0xFFFF;
+
+struct Pool {
+  bool alive;
+  bool common;
+  AX_POOL_CONFIG_T cfg;
+  AX_U64 phys;
+  AX_U64 blk_stride;
+  AX_U64 meta_stride;
+  AX_U64 meta_offset;
+  AX_U64 total;
+  AX_U8* vir;
+  std::vector<AX_S32> refs;
+};
+
+struct PoolState {
+  std::mutex mu;
+  AX_POOL_FLOORPLAN_T plan;
+  bool inited = false;
+  std::vector<Pool> pools;  // index = pool id
+};
+
+PoolState& State() {
+  static PoolState* s = new PoolState();
+  return *s;
+}
+
+AX_U64 RoundUp(AX_U64 v) { return (v + kPage - 1) / kPage * kPage; }
+
+AX_BLK MakeHandle(size_t pool, size_t index) {
+  return static_cast<AX_BLK>((pool << 16) | (index + 1));
+}
+
+// Caller holds State().mu. Returns nullptr for stale or malformed handles.
+Pool* Lookup(AX_BLK blk, size_t* index) {
+  PoolState& s = State();
+  const size_t pool = blk >> 16;
+  const AX_U32 low = blk & 0xFFFF;
+  if (low == 0 || pool >= s.pools.size() || !s.pools[pool].alive) {
+    return nullptr;
+  }
+  Pool& p = s.pools[pool];
+  if (low > p.refs.size()) return nullptr;
+  *index = low - 1;
+  return &p;
+}
+
+// Caller holds State().mu.
+bool MapPool(Pool* p) {
+  if (p->vir) return true;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  const bool cached = p->cfg.CacheMode == AX_POOL_CACHE_MODE_CACHED;
+  void* v = be.Map(p->phys, p->total, cached, false);
+  if (!v) return false;
+  p->vir = static_cast<AX_U8*>(v);
+  be.SetBlockVir(p->phys, v);
+  return true;
+}
+
+// Caller holds State().mu.
+void UnmapPool(Pool* p) {
+  if (!p->vir) return;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  be.Unmap(p->vir);
+  p->vir = nullptr;
+}
+
+// Caller holds State().mu. Returns the new pool id or AX_INVALID_POOLID.
+AX_POOL CreateLocked(const AX_POOL_CONFIG_T& cfg, bool common) {
+  if (cfg.BlkSize == 0 || cfg.BlkCnt == 0 || cfg.BlkCnt > kMaxBlocksPerPool) {
+    return AX_INVALID_POOLID;
+  }
+  PoolState& s = State();
+  if (s.pools.size() >= 0xFFFF) return AX_INVALID_POOLID;
+  Pool p;
+  p.alive = true;
+  p.common = common;
+  p.cfg = cfg;
+  p.blk_stride = RoundUp(cfg.BlkSize);
+  p.meta_stride = RoundUp(cfg.MetaSize);
+  p.meta_offset = p.blk_stride * cfg.BlkCnt;
+  p.total = p.meta_offset + p.meta_stride * cfg.BlkCnt;
+  p.vir = nullptr;
+  p.refs.assign(cfg.BlkCnt, 0);
+  if (p.total > 0xFFFFFFFFull) return AX_INVALID_POOLID;
+
+  const size_t id = s.pools.size();
+  char name[AX_MAX_POOL_NAME_LEN + 16];
+  if (cfg.PoolName[0]) {
+    snprintf(name, sizeof(name), "%.*s", AX_MAX_POOL_NAME_LEN,
+             reinterpret_cast<const char*>(cfg.PoolName));
+  } else {
+    snprintf(name, sizeof(name), "%s_pool_%zu", common ? "common" : "user",
+             id);
+  }
+  char partition[AX_MAX_PARTITION_NAME_LEN + 1];
+  snprintf(partition, sizeof(partition), "%.*s", AX_MAX_PARTITION_NAME_LEN,
+           reinterpret_cast<const char*>(cfg.PartitionName));
+  {
+    Backend& be = Backend::Get();
+    std::lock_guard<std::mutex> lk(be.mu);
+    const bool cached = cfg.CacheMode == AX_POOL_CACHE_MODE_CACHED;
+    uint64_t phys = 0;
+    if (be.Alloc(p.total, kPage, partition, cached, name, &phys, nullptr) !=
+        0) {
+      return AX_INVALID_POOLID;
+    }
+    p.phys = phys;
+  }
+  s.pools.push_back(p);
+  return static_cast<AX_POOL>(id);
+}
+
+// Caller holds State().mu.
+AX_S32 DestroyLocked(Pool* p) {
+  for (AX_S32 r : p->refs) {
+    if (r > 0) return axemu::kErrNotPermitted;
+  }
+  UnmapPool(p);
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  be.Free(p->phys);
+  p->alive = false;
+  return 0;
+}
+
+}  // namespace
+
+extern "C" {
+
+AX_S32 AX_POOL_SetConfig(const AX_POOL_FLOORPLAN_T* pPoolFloorPlan) {
+  axemu::Enter(axemu::kPoolSetConfig);
+  if (!pPoolFloorPlan) return axemu::kErrNullPtr;
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  if (s.inited) return axemu::kErrNotPermitted;
+  s.plan = *pPoolFloorPlan;
+  return 0;
+}
+
+AX_S32 AX_POOL_GetConfig(AX_POOL_FLOORPLAN_T* pPoolFloorPlan) {
+  axemu::Enter(axemu::kPoolGetConfig);
+  if (!pPoolFloorPlan) return axemu::kErrNullPtr;
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  *pPoolFloorPlan = s.plan;
+  return 0;
+}
+
+AX_S32 AX_POOL_Init(AX_VOID) {
+  axemu::Enter(axemu::kPoolInit);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  if (s.inited) return axemu::kErrNotPermitted;
+  const size_t first = s.pools.size();
+  for (const AX_POOL_CONFIG_T& cfg : s.plan.CommPool) {
+    if (cfg.BlkSize == 0 || cfg.BlkCnt == 0) continue;
+    const AX_POOL id = CreateLocked(cfg, true);
+    if (id == AX_INVALID_POOLID || !MapPool(&s.pools[id])) {
+      for (size_t i = first; i < s.pools.size(); ++i) {
+        if (s.pools[i].alive) DestroyLocked(&s.pools[i]);
+      }
+      return axemu::kErrNoMem;
+    }
+  }
+  s.inited = true;
+  return 0;
+}
+
+AX_S32 AX_POOL_Exit(AX_VOID) {
+  axemu::Enter(axemu::kPoolExit);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  for (const Pool& p : s.pools) {
+    if (!p.alive) continue;
+    for (AX_S32 r : p.refs) {
+      if (r > 0) return axemu::kErrNotPermitted;
+    }
+  }
+  for (Pool& p : s.pools) {
+    if (p.alive) DestroyLocked(&p);
+  }
+  s.pools.clear();
+  s.inited = false;
+  return 0;
+}
+
+AX_POOL AX_POOL_CreatePool(AX_POOL_CONFIG_T* pPoolConfig) {
+  axemu::Enter(axemu::kPoolCreatePool);
+  if (!pPoolConfig) return AX_INVALID_POOLID;
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  return CreateLocked(*pPoolConfig, false);
+}
+
+AX_S32 AX_POOL_DestroyPool(AX_POOL PoolId) {
+  axemu::Enter(axemu::kPoolDestroyPool);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  if (PoolId >= s.pools.size() || !s.pools[PoolId].alive ||
+      s.pools[PoolId].common) {
+    return axemu::kErrIllegalParam;
+  }
+  return DestroyLocked(&s.pools[PoolId]);
+}
+
+AX_BLK AX_POOL_GetBlock(AX_POOL PoolId, AX_U64 BlkSize,
+                        const AX_S8* pPartitionName) {
+  axemu::Enter(axemu::kPoolGetBlock);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  const char* part = reinterpret_cast<const char*>(pPartitionName);
+  // Best fit over the candidate pools: smallest block size that has a
+  // free block.
+  size_t best = s.pools.size();
+  size_t best_index = 0;
+  for (size_t id = 0; id < s.pools.size(); ++id) {
+    const Pool& p = s.pools[id];
+    if (!p.alive || p.cfg.BlkSize < BlkSize) continue;
+    if (PoolId == AX_INVALID_POOLID) {
+      if (!p.common) continue;
+      if (part && *part &&
+          strncmp(part, reinterpret_cast<const char*>(p.cfg.PartitionName),
+                  AX_MAX_PARTITION_NAME_LEN) != 0) {
+        continue;
+      }
+    } else if (id != PoolId) {
+      continue;
+    }
+    if (best < s.pools.size() &&
+        s.pools[best].cfg.BlkSize <= p.cfg.BlkSize) {
+      continue;
+    }
+    for (size_t i = 0; i < p.refs.size(); ++i) {
+      if (p.refs[i] == 0) {
+        best = id;
+        best_index = i;
+        break;
+      }
+    }
+  }
+  if (best == s.pools.size()) return AX_INVALID_BLOCKID;
+  s.pools[best].refs[best_index] = 1;
+  return MakeHandle(best, best_index);
+}
+
+AX_S32 AX_POOL_ReleaseBlock(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolReleaseBlock);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  Pool* p = Lookup(BlockId, &i);
+  if (!p || p->refs[i] <= 0) return axemu::kErrIllegalParam;
+  --p->refs[i];
+  return 0;
+}
+
+AX_S32 AX_POOL_IncreaseRefCnt(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolIncreaseRefCnt);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  Pool* p = Lookup(BlockId, &i);
+  if (!p || p->refs[i] <= 0) return axemu::kErrIllegalParam;
+  ++p->refs[i];
+  return 0;
+}
+
+AX_S32 AX_POOL_DecreaseRefCnt(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolDecreaseRefCnt);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  Pool* p = Lookup(BlockId, &i);
+  if (!p || p->refs[i] <= 0) return axemu::kErrIllegalParam;
+  --p->refs[i];
+  return 0;
+}
+
+AX_BLK AX_POOL_PhysAddr2Handle(AX_U64 PhysAddr) {
+  axemu::Enter(axemu::kPoolPhysAddr2Handle);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  for (size_t id = 0; id < s.pools.size(); ++id) {
+    const Pool& p = s.pools[id];
+    if (!p.alive || PhysAddr < p.phys || PhysAddr - p.phys >= p.meta_offset) {
+      continue;
+    }
+    return MakeHandle(id, (PhysAddr - p.phys) / p.blk_stride);
+  }
+  return AX_INVALID_BLOCKID;
+}
+
+AX_U64 AX_POOL_Handle2PhysAddr(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolHandle2PhysAddr);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  const Pool* p = Lookup(BlockId, &i);
+  return p ? p->phys + i * p->blk_stride : 0;
+}
+
+AX_U64 AX_POOL_Handle2MetaPhysAddr(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolHandle2MetaPhysAddr);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  const Pool* p = Lookup(BlockId, &i);
+  if (!p || p->meta_stride == 0) return 0;
+  return p->phys + p->meta_offset + i * p->meta_stride;
+}
+
+AX_POOL AX_POOL_Handle2PoolId(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolHandle2PoolId);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  return Lookup(BlockId, &i) ? BlockId >> 16 : AX_INVALID_POOLID;
+}
+
+AX_U64 AX_POOL_Handle2BlkSize(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolHandle2BlkSize);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  const Pool* p = Lookup(BlockId, &i);
+  return p ? p->cfg.BlkSize : 0;
+}
+
+AX_S32 AX_POOL_MmapPool(AX_POOL PoolId) {
+  axemu::Enter(axemu::kPoolMmapPool);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  if (PoolId >= s.pools.size() || !s.pools[PoolId].alive) {
+    return axemu::kErrIllegalParam;
+  }
+  return MapPool(&s.pools[PoolId]) ? 0 : axemu::kErrNoMem;
+}
+
+AX_S32 AX_POOL_MunmapPool(AX_POOL PoolId) {
+  axemu::Enter(axemu::kPoolMunmapPool);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  if (PoolId >= s.pools.size() || !s.pools[PoolId].alive) {
+    return axemu::kErrIllegalParam;
+  }
+  UnmapPool(&s.pools[PoolId]);
+  return 0;
+}
+
+AX_VOID* AX_POOL_GetBlockVirAddr(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolGetBlockVirAddr);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  const Pool* p = Lookup(BlockId, &i);
+  if (!p || !p->vir) return nullptr;
+  return p->vir + i * p->blk_stride;
+}
+
+AX_VOID* AX_POOL_GetMetaVirAddr(AX_BLK BlockId) {
+  axemu::Enter(axemu::kPoolGetMetaVirAddr);
+  PoolState& s = State();
+  std::lock_guard<std::mutex> lk(s.mu);
+  size_t i = 0;
+  const Pool* p = Lookup(BlockId, &i);
+  if (!p || !p->vir || p->meta_stride == 0) return nullptr;
+  return p->vir + p->meta_offset + i * p->meta_stride;
+}
+
+}  // extern "C"
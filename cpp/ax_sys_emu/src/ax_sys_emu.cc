@@ -0,0 +1,227 @@
+// AX_SYS_* CMM entry points of the host emulation (see ax_sys_emu.h).
+
+#include <ax_sys_api.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <mutex>
+
+#include "ax_sys_emu.h"
+#include "emu_backend.hpp"
+
+using axemu::Backend;
+using axemu::Call;
+
+namespace {
+
+const char* Str(const AX_S8* s) { return reinterpret_cast<const char*>(s); }
+
+AX_S32 Alloc(Call c, AX_U64* phyaddr, AX_VOID** pviraddr, AX_U32 size,
+             AX_U32 align, const AX_S8* token, bool cached) {
+  axemu::Enter(c);
+  if (!phyaddr || !pviraddr) return axemu::kErrNullPtr;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  uint64_t phys = 0;
+  const int ret =
+      be.Alloc(size, align, nullptr, cached, Str(token), &phys, pviraddr);
+  if (ret == 0) *phyaddr = phys;
+  return ret;
+}
+
+AX_VOID* Map(Call c, AX_U64 phyaddr, AX_U32 size, bool cached, bool fast) {
+  axemu::Enter(c);
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  return be.Map(phyaddr, size, cached, fast);
+}
+
+void FillPartitions(const Backend& be, AX_CMM_PARTITION_INFO_T* out) {
+  memset(out, 0, sizeof(*out));
+  const auto& parts = be.Partitions();
+  for (size_t i = 0; i < parts.size() && i < AX_MAX_PARTITION_COUNT; ++i) {
+    AX_PARTITION_INFO_T& pi = out->PartitionInfo[out->PartitionCnt++];
+    pi.PhysAddr = parts[i].phys;
+    pi.SizeKB = static_cast<AX_U32>(parts[i].size >> 10);
+    snprintf(reinterpret_cast<char*>(pi.Name), sizeof(pi.Name), "%s",
+             parts[i].name.c_str());
+  }
+}
+
+}  // namespace
+
+extern "C" {
+
+AX_S32 AX_SYS_Init(AX_VOID) {
+  axemu::Enter(axemu::kSysInit);
+  return 0;
+}
+
+AX_S32 AX_SYS_Deinit(AX_VOID) {
+  axemu::Enter(axemu::kSysDeinit);
+  return 0;
+}
+
+AX_S32 AX_SYS_MemAlloc(AX_U64* phyaddr, AX_VOID** pviraddr, AX_U32 size,
+                       AX_U32 align, const AX_S8* token) {
+  return Alloc(axemu::kSysMemAlloc, phyaddr, pviraddr, size, align, token,
+               false);
+}
+
+AX_S32 AX_SYS_MemAllocCached(AX_U64* phyaddr, AX_VOID** pviraddr,
+                             AX_U32 size, AX_U32 align, const AX_S8* token) {
+  return Alloc(axemu::kSysMemAllocCached, phyaddr, pviraddr, size, align,
+               token, true);
+}
+
+AX_S32 AX_SYS_MemFree(AX_U64 phyaddr, AX_VOID* pviraddr) {
+  (void)pviraddr;
+  axemu::Enter(axemu::kSysMemFree);
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  return be.Free(phyaddr);
+}
+
+AX_VOID* AX_SYS_Mmap(AX_U64 phyaddr, AX_U32 size) {
+  return Map(axemu::kSysMmap, phyaddr, size, false, false);
+}
+
+AX_VOID* AX_SYS_MmapCache(AX_U64 phyaddr, AX_U32 size) {
+  return Map(axemu::kSysMmapCache, phyaddr, size, true, false);
+}
+
+AX_VOID* AX_SYS_MmapFast(AX_U64 phyaddr, AX_U32 size) {
+  return Map(axemu::kSysMmapFast, phyaddr, size, false, true);
+}
+
+AX_VOID* AX_SYS_MmapCacheFast(AX_U64 phyaddr, AX_U32 size) {
+  return Map(axemu::kSysMmapCacheFast, phyaddr, size, true, true);
+}
+
+AX_S32 AX_SYS_Munmap(AX_VOID* pviraddr, AX_U32 size) {
+  (void)size;
+  axemu::Enter(axemu::kSysMunmap);
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  return be.Unmap(pviraddr);
+}
+
+AX_S32 AX_SYS_MflushCache(AX_U64 phyaddr, AX_VOID* pviraddr, AX_U32 size) {
+  (void)phyaddr;
+  axemu::Enter(axemu::kSysMflushCache);
+  if (!pviraddr) return axemu::kErrNullPtr;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  return be.Flush(pviraddr, size);
+}
+
+AX_S32 AX_SYS_MinvalidateCache(AX_U64 phyaddr, AX_VOID* pviraddr,
+                               AX_U32 size) {
+  (void)phyaddr;
+  axemu::Enter(axemu::kSysMinvalidateCache);
+  if (!pviraddr) return axemu::kErrNullPtr;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  return be.Invalidate(pviraddr, size);
+}
+
+AX_S32 AX_SYS_MemGetBlockInfoByPhy(AX_U64 phyaddr, AX_S32* pmemType,
+                                   AX_VOID** pviraddr, AX_U32* pblockSize) {
+  axemu::Enter(axemu::kSysMemGetBlockInfoByPhy);
+  if (!pmemType || !pviraddr || !pblockSize) return axemu::kErrNullPtr;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  const axemu::Block* b = be.FindBlock(phyaddr);
+  if (!b) return axemu::kErrUnexist;
+  *pmemType = b->cached ? 1 : 0;
+  *pviraddr =
+      b->vir ? static_cast<AX_U8*>(b->vir) + (phyaddr - b->phys) : nullptr;
+  *pblockSize = static_cast<AX_U32>(b->size);
+  return 0;
+}
+
+AX_S32 AX_SYS_MemGetBlockInfoByVirt(AX_VOID* pviraddr, AX_U64* phyaddr,
+                                    AX_S32* pmemType) {
+  axemu::Enter(axemu::kSysMemGetBlockInfoByVirt);
+  if (!phyaddr || !pmemType) return axemu::kErrNullPtr;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  const axemu::Mapping* m = be.FindMapping(pviraddr);
+  if (!m) return axemu::kErrUnexist;
+  *phyaddr = m->phys +
+             static_cast<AX_U64>(static_cast<AX_U8*>(pviraddr) - m->user);
+  *pmemType = m->cached ? 1 : 0;
+  return 0;
+}
+
+AX_S32 AX_SYS_MemGetPartitionInfo(AX_CMM_PARTITION_INFO_T* pCmmPartitionInfo) {
+  axemu::Enter(axemu::kSysMemGetPartitionInfo);
+  if (!pCmmPartitionInfo) return axemu::kErrNullPtr;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  FillPartitions(be, pCmmPartitionInfo);
+  return 0;
+}
+
+AX_S32 AX_SYS_MemQueryStatus(AX_CMM_STATUS_T* pCmmStatus) {
+  axemu::Enter(axemu::kSysMemQueryStatus);
+  if (!pCmmStatus) return axemu::kErrNullPtr;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  memset(pCmmStatus, 0, sizeof(*pCmmStatus));
+  AX_U64 total = 0;
+  AX_U64 remain = 0;
+  for (size_t i = 0; i < be.Partitions().size(); ++i) {
+    total += be.Partitions()[i].size;
+    remain += be.FreeBytes(i);
+  }
+  pCmmStatus->TotalSize = static_cast<AX_U32>(total >> 10);
+  pCmmStatus->RemainSize = static_cast<AX_U32>(remain >> 10);
+  pCmmStatus->BlockCnt = static_cast<AX_U32>(be.BlockCount());
+  FillPartitions(be, &pCmmStatus->Partition);
+  return 0;
+}
+
+AX_S32 AX_SYS_MemGetMaxFreeRegionInfo(const AX_S8* pPartitionName,
+                                      AX_U64* pPhyAddr, AX_U32* pSize) {
+  axemu::Enter(axemu::kSysMemGetMaxFreeRegionInfo);
+  if (!pPhyAddr || !pSize) return axemu::kErrNullPtr;
+  Backend& be = Backend::Get();
+  std::lock_guard<std::mutex> lk(be.mu);
+  const int pi = be.FindPartition(Str(pPartitionName));
+  if (pi < 0) return axemu::kErrIllegalParam;
+  uint64_t phys = 0;
+  const uint64_t size = be.MaxFreeRegion(static_cast<size_t>(pi), &phys);
+  *pPhyAddr = phys;
+  *pSize = size > 0xFFFFFFFFull ? 0xFFFFFFFFu : static_cast<AX_U32>(size);
+  return 0;
+}
+
+AX_S32 AX_EMU_SetCallLatency(const AX_CHAR* name, AX_U64 ns) {
+  const bool all = !name || strcmp(name, "*") == 0;
+  AX_S32 ret = -1;
+  for (int i = 0; i < axemu::kCallCount; ++i) {
+    const Call c = static_cast<Call>(i);
+    if (all || strcmp(name, axemu::CallName(c)) == 0) {
+      axemu::SetLatency(c, ns);
+      ret = 0;
+    }
+  }
+  return ret;
+}
+
+AX_U64 AX_EMU_GetCallCount(const AX_CHAR* name) {
+  const bool all = !name || strcmp(name, "*") == 0;
+  AX_U64 n = 0;
+  for (int i = 0; i < axemu::kCallCount; ++i) {
+    const Call c = static_cast<Call>(i);
+    if (all || strcmp(name, axemu::CallName(c)) == 0) {
+      n += axemu::CallCount(c);
+    }
+  }
+  return n;
+}
+
+AX_VOID AX_EMU_ResetCallCounts(AX_VOID) { axemu::ResetCallCounts(); }
+
+}  // extern "C"
@@ -0,0 +1,522 @@
+#include "emu_backend.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+
+namespace axemu {
+
+namespace {
+
+constexpr uint64_t kPage = 4096;
+constexpr uint64_t kDefaultPhysBase = 0x100000000ULL;
+constexpr const char* kDefaultPartitions = "anonymous:1G";
+
+const char* const kCallNames[kCallCount] = {
+    "AX_SYS_Init",
+    "AX_SYS_Deinit",
+    "AX_SYS_MemAlloc",
+    "AX_SYS_MemAllocCached",
+    "AX_SYS_MemFree",
+    "AX_SYS_Mmap",
+    "AX_SYS_MmapCache",
+    "AX_SYS_MmapFast",
+    "AX_SYS_MmapCacheFast",
+    "AX_SYS_Munmap",
+    "AX_SYS_MflushCache",
+    "AX_SYS_MinvalidateCache",
+    "AX_SYS_MemGetBlockInfoByPhy",
+    "AX_SYS_MemGetBlockInfoByVirt",
+    "AX_SYS_MemGetPartitionInfo",
+    "AX_SYS_MemQueryStatus",
+    "AX_SYS_MemGetMaxFreeRegionInfo",
+    "AX_POOL_SetConfig",
+    "AX_POOL_GetConfig",
+    "AX_POOL_Init",
+    "AX_POOL_Exit",
+    "AX_POOL_CreatePool",
+    "AX_POOL_DestroyPool",
+    "AX_POOL_GetBlock",
+    "AX_POOL_ReleaseBlock",
+    "AX_POOL_PhysAddr2Handle",
+    "AX_POOL_Handle2PhysAddr",
+    "AX_POOL_Handle2MetaPhysAddr",
+    "AX_POOL_Handle2PoolId",
+    "AX_POOL_Handle2BlkSize",
+    "AX_POOL_MmapPool",
+    "AX_POOL_MunmapPool",
+    "AX_POOL_GetBlockVirAddr",
+    "AX_POOL_GetMetaVirAddr",
+    "AX_POOL_IncreaseRefCnt",
+    "AX_POOL_DecreaseRefCnt",
+};
+
+std::atomic<uint64_t> g_latency_ns[kCallCount];
+std::atomic<uint64_t> g_calls[kCallCount];
+
+uint64_t RoundUp(uint64_t v, uint64_t a) { return (v + a - 1) / a * a; }
+
+// Replaces [off, off + len) of a cached mapping with clean pages that
+// share the backing file again. False if the kernel refused.
+bool RemapClean(uint8_t* base, size_t off, size_t len, int fd,
+                uint64_t file_off) {
+  void* p = mmap(base + off, len, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED, fd,
+                 static_cast<off_t>(file_off + off));
+  return p != MAP_FAILED;
+}
+
+// "512M", "64K", "1G", "0x1000" or plain bytes; 0 on parse error.
+uint64_t ParseSize(const std::string& s) {
+  char* end = nullptr;
+  uint64_t v = strtoull(s.c_str(), &end, 0);
+  if (end == s.c_str()) return 0;
+  switch (*end) {
+    case 'k':
+    case 'K':
+      return v << 10;
+    case 'm':
+    case 'M':
+      return v << 20;
+    case 'g':
+    case 'G':
+      return v << 30;
+    case '\0':
+      return v;
+    default:
+      return 0;
+  }
+}
+
+std::vector<std::string> Split(const std::string& s, char sep) {
+  std::vector<std::string> out;
+  size_t start = 0;
+  while (start <= s.size()) {
+    size_t pos = s.find(sep, start);
+    if (pos == std::string::npos) pos = s.size();
+    if (pos > start) out.push_back(s.substr(start, pos - start));
+    start = pos + 1;
+  }
+  return out;
+}
+
+// Applies "*" entries first, so that a named call keeps its own value
+// wherever it appears in the list.
+void ParseLatency(const char* spec) {
+  const std::vector<std::string> items = Split(spec, ',');
+  for (bool wildcard : {true, false}) {
+    for (const std::string& item : items) {
+      const size_t eq = item.find('=');
+      if (eq == std::string::npos) continue;
+      const std::string name = item.substr(0, eq);
+      if ((name == "*") != wildcard) continue;
+      const uint64_t ns = strtoull(item.c_str() + eq + 1, nullptr, 0);
+      bool matched = false;
+      for (int i = 0; i < kCallCount; ++i) {
+        if (wildcard || name == kCallNames[i]) {
+          g_latency_ns[i].store(ns, std::memory_order_relaxed);
+          matched = true;
+        }
+      }
+      if (!matched) {
+        fprintf(stderr, "[ax_sys_emu] AX_EMU_LATENCY_NS: unknown call %s\n",
+                name.c_str());
+      }
+    }
+  }
+}
+
+}  // namespace
+
+const char* CallName(Call c) { return kCallNames[c]; }
+
+void Enter(Call c) {
+  Backend::Get();  // applies AX_EMU_LATENCY_NS before the first call
+  g_calls[c].fetch_add(1, std::memory_order_relaxed);
+  const uint64_t ns = g_latency_ns[c].load(std::memory_order_relaxed);
+  if (ns == 0) return;
+  // Busy-wait: a driver ioctl costs CPU time on the calling thread.
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+}
+
+void SetLatency(Call c, uint64_t ns) {
+  g_latency_ns[c].store(ns, std::memory_order_relaxed);
+}
+
+uint64_t CallCount(Call c) {
+  return g_calls[c].load(std::memory_order_relaxed);
+}
+
+void ResetCallCounts() {
+  for (auto& n : g_calls) n.store(0, std::memory_order_relaxed);
+}
+
+Backend& Backend::Get() {
+  static Backend* backend = new Backend();  // never destroyed
+  return *backend;
+}
+
+Backend::Backend() {
+  const char* base_env = getenv("AX_EMU_PHYS_BASE");
+  uint64_t next = base_env ? ParseSize(base_env) : kDefaultPhysBase;
+  if (next == 0) next = kDefaultPhysBase;
+  next = RoundUp(next, kPage);
+
+  const char* table = getenv("AX_EMU_PARTITIONS");
+  if (!table || !*table) table = kDefaultPartitions;
+  for (const std::string& item : Split(table, ',')) {
+    const size_t colon = item.rfind(':');
+    if (colon == std::string::npos) continue;
+    std::string name = item.substr(0, colon);
+    uint64_t phys = next;
+    const size_t at = name.find('@');
+    if (at != std::string::npos) {
+      phys = RoundUp(ParseSize(name.substr(at + 1)), kPage);
+      name.resize(at);
+    }
+    const uint64_t size = RoundUp(ParseSize(item.substr(colon + 1)), kPage);
+    if (name.empty() || size == 0 || phys == 0) {
+      fprintf(stderr, "[ax_sys_emu] AX_EMU_PARTITIONS: bad entry %s\n",
+              item.c_str());
+      continue;
+    }
+    Partition p;
+    p.name = name;
+    p.phys = phys;
+    p.size = size;
+    p.fd = memfd_create(("ax_cmm_" + name).c_str(), MFD_CLOEXEC);
+    if (p.fd < 0 || ftruncate(p.fd, static_cast<off_t>(size)) != 0) {
+      fprintf(stderr, "[ax_sys_emu] memfd for %s: %s\n", name.c_str(),
+              strerror(errno));
+      if (p.fd >= 0) close(p.fd);
+      continue;
+    }
+    p.free_list[0] = size;
+    partitions_.push_back(p);
+    next = std::max(next, phys + size);
+  }
+
+  const char* lat = getenv("AX_EMU_LATENCY_NS");
+  if (lat) ParseLatency(lat);
+}
+
+int Backend::FindPartition(uint64_t phys, uint64_t size) const {
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    const Partition& p = partitions_[i];
+    if (phys >= p.phys && phys - p.phys <= p.size &&
+        size <= p.size - (phys - p.phys)) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+int Backend::FindPartition(const char* name) const {
+  const std::string want = (name && *name) ? name : "anonymous";
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    if (partitions_[i].name == want) return static_cast<int>(i);
+  }
+  return -1;
+}
+
+int Backend::Alloc(uint64_t size, uint64_t align, const char* partition,
+                   bool cached, const char* name, uint64_t* phys, void** vir) {
+  if (size == 0 || size > 0xFFFFFFFFull) return kErrIllegalParam;
+  if (align == 0) align = kPage;
+  if ((align & (align - 1)) != 0) return kErrIllegalParam;
+  align = std::max(align, kPage);
+  const int pi = FindPartition(partition);
+  if (pi < 0) return kErrIllegalParam;
+  Partition& p = partitions_[static_cast<size_t>(pi)];
+
+  const uint64_t length = RoundUp(size, kPage);
+  for (auto it = p.free_list.begin(); it != p.free_list.end(); ++it) {
+    const uint64_t start = RoundUp(p.phys + it->first, align) - p.phys;
+    const uint64_t end = it->first + it->second;
+    if (start > end || end - start < length) continue;
+    void* mapped = nullptr;
+    if (vir) {
+      mapped = Map(p.phys + start, size, cached, false);
+      if (!mapped) return kErrNoMem;
+    }
+    // Split [it->first, end) into head, allocation and tail.
+    const uint64_t head = start - it->first;
+    const uint64_t tail = end - start - length;
+    p.free_list.erase(it);
+    if (head > 0) p.free_list[start - head] = head;
+    if (tail > 0) p.free_list[start + length] = tail;
+
+    Block b;
+    b.phys = p.phys + start;
+    b.size = size;
+    b.partition = static_cast<size_t>(pi);
+    b.cached = cached;
+    b.name = name ? name : "";
+    b.vir = mapped;
+    blocks_[b.phys] = b;
+    *phys = b.phys;
+    if (vir) *vir = mapped;
+    return 0;
+  }
+  return kErrNoMem;
+}
+
+int Backend::Free(uint64_t phys) {
+  auto it = blocks_.find(phys);
+  if (it == blocks_.end()) return kErrIllegalParam;
+  const Block b = it->second;
+  blocks_.erase(it);
+  if (b.vir) {
+    auto m = mappings_.find(reinterpret_cast<uintptr_t>(b.vir));
+    if (m != mappings_.end()) {
+      munmap(m->second.base, m->second.span);
+      mappings_.erase(m);
+    }
+  }
+
+  Partition& p = partitions_[b.partition];
+  uint64_t start = b.phys - p.phys;
+  uint64_t length = RoundUp(b.size, kPage);
+  // Give the pages back to the host; contents read as zero afterwards.
+  fallocate(p.fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+            static_cast<off_t>(start), static_cast<off_t>(length));
+  auto next = p.free_list.lower_bound(start);
+  if (next != p.free_list.end() && next->first == start + length) {
+    length += next->second;
+    next = p.free_list.erase(next);
+  }
+  if (next != p.free_list.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == start) {
+      start = prev->first;
+      length += prev->second;
+      p.free_list.erase(prev);
+    }
+  }
+  p.free_list[start] = length;
+  return 0;
+}
+
+void* Backend::Map(uint64_t phys, size_t size, bool cached, bool fast) {
+  if (size == 0) return nullptr;
+  const int pi = FindPartition(phys, size);
+  if (pi < 0) return nullptr;
+  const auto key = std::make_tuple(phys, size, cached);
+  if (fast) {
+    auto f = fast_index_.find(key);
+    if (f != fast_index_.end()) {
+      ++mappings_[f->second].refs;
+      return reinterpret_cast<void*>(f->second);
+    }
+  }
+
+  const Partition& p = partitions_[static_cast<size_t>(pi)];
+  const uint64_t offset = phys - p.phys;
+  const uint64_t delta = offset % kPage;
+  Mapping m;
+  m.span = RoundUp(size + delta, kPage);
+  m.file_off = offset - delta;
+  // A private file mapping reads through to memory until a page is
+  // written; the written copy then stays local until flushed, which is
+  // the visibility a write-back cache gives the other mappings.
+  void* base = mmap(nullptr, m.span, PROT_READ | PROT_WRITE,
+                    cached ? MAP_PRIVATE : MAP_SHARED, p.fd,
+                    static_cast<off_t>(m.file_off));
+  if (base == MAP_FAILED) return nullptr;
+  m.base = static_cast<uint8_t*>(base);
+  m.phys = phys;
+  m.size = size;
+  m.cached = cached;
+  m.fd = p.fd;
+  m.refs = 1;
+  m.fast = fast;
+  m.user = m.base + delta;
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(m.user);
+  mappings_[addr] = m;
+  if (fast) fast_index_[key] = addr;
+  return m.user;
+}
+
+int Backend::Unmap(void* vir) {
+  auto it = mappings_.find(reinterpret_cast<uintptr_t>(vir));
+  if (it == mappings_.end()) return kErrIllegalParam;
+  Mapping& m = it->second;
+  if (--m.refs > 0) return 0;
+  if (m.fast) fast_index_.erase(std::make_tuple(m.phys, m.size, m.cached));
+  for (auto& b : blocks_) {
+    if (b.second.vir == vir) b.second.vir = nullptr;
+  }
+  munmap(m.base, m.span);
+  mappings_.erase(it);
+  return 0;
+}
+
+const Mapping* Backend::FindMapping(const void* vir) const {
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(vir);
+  auto it = mappings_.upper_bound(addr);
+  if (it == mappings_.begin()) return nullptr;
+  --it;
+  if (addr - it->first >= it->second.size) return nullptr;
+  return &it->second;
+}
+
+void Backend::SetBlockVir(uint64_t phys, void* vir) {
+  auto it = blocks_.find(phys);
+  if (it != blocks_.end()) it->second.vir = vir;
+}
+
+const Block* Backend::FindBlock(uint64_t phys) const {
+  auto it = blocks_.upper_bound(phys);
+  if (it == blocks_.begin()) return nullptr;
+  --it;
+  if (phys - it->first >= it->second.size) return nullptr;
+  return &it->second;
+}
+
+int Backend::Flush(void* vir, size_t size) {
+  const Mapping* m = FindMapping(vir);
+  if (!m) return kErrIllegalParam;
+  if (!m->cached) return 0;
+  uint8_t* begin = static_cast<uint8_t*>(vir);
+  const size_t user_off = static_cast<size_t>(begin - m->base);
+  const size_t len = std::min(size, m->span - user_off);
+  size_t done = 0;
+  while (done < len) {
+    const ssize_t n = pwrite(m->fd, begin + done, len - done,
+                             static_cast<off_t>(m->file_off + user_off + done));
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return kErrIllegalParam;
+    }
+    done += static_cast<size_t>(n);
+  }
+  // Written-back pages become clean again (shared with memory).
+  const size_t first = RoundUp(user_off, kPage);
+  const size_t last = (user_off + len) / kPage * kPage;
+  if (last > first &&
+      !RemapClean(m->base, first, last - first, m->fd, m->file_off)) {
+    return kErrNoMem;
+  }
+  return 0;
+}
+
+int Backend::Invalidate(void* vir, size_t size) {
+  const Mapping* m = FindMapping(vir);
+  if (!m) return kErrIllegalParam;
+  if (!m->cached) return 0;
+  uint8_t* begin = static_cast<uint8_t*>(vir);
+  const size_t user_off = static_cast<size_t>(begin - m->base);
+  const size_t end = user_off + std::min(size, m->span - user_off);
+  const size_t first = std::min(RoundUp(user_off, kPage), end);
+  const size_t last = std::max(end / kPage * kPage, first);
+  // Whole pages: drop the local copy. Partial pages: re-read the range.
+  if (last > first &&
+      !RemapClean(m->base, first, last - first, m->fd, m->file_off)) {
+    return kErrNoMem;
+  }
+  if (first > user_off) {
+    if (pread(m->fd, m->base + user_off, first - user_off,
+              static_cast<off_t>(m->file_off + user_off)) < 0) {
+      return kErrIllegalParam;
+    }
+  }
+  if (end > last) {
+    if (pread(m->fd, m->base + last, end - last,
+              static_cast<off_t>(m->file_off + last)) < 0) {
+      return kErrIllegalParam;
+    }
+  }
+  return 0;
+}
+
+uint64_t Backend::FreeBytes(size_t partition) const {
+  uint64_t total = 0;
+  for (const auto& f : partitions_[partition].free_list) total += f.second;
+  return total;
+}
+
+uint64_t Backend::MaxFreeRegion(size_t partition, uint64_t* phys) const {
+  const Partition& p = partitions_[partition];
+  uint64_t best = 0;
+  *phys = 0;
+  for (const auto& f : p.free_list) {
+    if (f.second > best) {
+      best = f.second;
+      *phys = p.phys + f.first;
+    }
+  }
+  return best;
+}
+
+std::string Backend::CmmInfo() const {
+  std::string out;
+  char line[512];
+  out += "--------------------SDK VERSION-------------------\n";
+  out += "[Axera version]: ax_cmm host emulation\n";
+  uint64_t total = 0;
+  uint64_t used = 0;
+  for (size_t i = 0; i < partitions_.size(); ++i) {
+    const Partition& p = partitions_[i];
+    size_t count = 0;
+    uint64_t bytes = 0;
+    for (const auto& b : blocks_) {
+      if (b.second.partition != i) continue;
+      ++count;
+      bytes += RoundUp(b.second.size, kPage);
+    }
+    snprintf(line, sizeof(line),
+             "+---PARTITION: Phys(0x%" PRIX64 ", 0x%" PRIX64
+             "), Size=%" PRIu64 "KB(%" PRIu64 "MB),    NAME=\"%s\"\n",
+             p.phys, p.phys + p.size - 1, p.size >> 10, p.size >> 20,
+             p.name.c_str());
+    out += line;
+    snprintf(line, sizeof(line),
+             " nBlock(Max=%zu, Cur=%zu, New=0, Free=0)  nbytes(Max=%" PRIu64
+             "B(%" PRIu64 "KB,%" PRIu64 "MB), Cur=%" PRIu64 "B(%" PRIu64
+             "KB,%" PRIu64 "MB))\n",
+             count, count, bytes, bytes >> 10, bytes >> 20, bytes,
+             bytes >> 10, bytes >> 20);
+    out += line;
+    for (const auto& b : blocks_) {
+      if (b.second.partition != i) continue;
+      const uint64_t len = RoundUp(b.second.size, kPage);
+      snprintf(line, sizeof(line),
+               "   |-Block: phys(0x%" PRIX64 ", 0x%" PRIX64
+               "), cache =%s, length=%" PRIu64 "KB(%" PRIu64
+               "MB),    name=\"%s\"\n",
+               b.first, b.first + len - 1,
+               b.second.cached ? "cacheable" : "non-cacheable", len >> 10,
+               len >> 20, b.second.name.c_str());
+      out += line;
+    }
+    out += "\n";
+    total += p.size;
+    used += bytes;
+  }
+  const uint64_t remain = total - used;
+  snprintf(line, sizeof(line),
+           "---CMM_USE_INFO:\n total size=%" PRIu64 "KB(%" PRIu64
+           "MB),used=%" PRIu64 "KB(%" PRIu64 "MB + %" PRIu64
+           "KB),remain=%" PRIu64 "KB(%" PRIu64 "MB + %" PRIu64
+           "KB),partition_number=%zu,block_number=%zu\n",
+           total >> 10, total >> 20, used >> 10, used >> 20,
+           (used >> 10) & 1023, remain >> 10, remain >> 20,
+           (remain >> 10) & 1023, partitions_.size(), blocks_.size());
+  out += line;
+  return out;
+}
+
+}  // namespace axemu
@@ -0,0 +1,154 @@
+/**
+ * @file emu_backend.hpp
+ * @brief Internal state of the AX_SYS/AX_POOL emulation: fake physical
+ *        address space, CMM allocator, mapping table and call latency.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace axemu {
+
+// Non-zero status codes returned by the emulated entry points.
+constexpr int kErrIllegalParam = static_cast<int>(0x800B000A);
+constexpr int kErrNullPtr = static_cast<int>(0x800B000B);
+constexpr int kErrNoMem = static_cast<int>(0x800B0018);
+constexpr int kErrNotPermitted = static_cast<int>(0x800B0009);
+constexpr int kErrUnexist = static_cast<int>(0x800B0005);
+
+enum Call {
+  kSysInit,
+  kSysDeinit,
+  kSysMemAlloc,
+  kSysMemAllocCached,
+  kSysMemFree,
+  kSysMmap,
+  kSysMmapCache,
+  kSysMmapFast,
+  kSysMmapCacheFast,
+  kSysMunmap,
+  kSysMflushCache,
+  kSysMinvalidateCache,
+  kSysMemGetBlockInfoByPhy,
+  kSysMemGetBlockInfoByVirt,
+  kSysMemGetPartitionInfo,
+  kSysMemQueryStatus,
+  kSysMemGetMaxFreeRegionInfo,
+  kPoolSetConfig,
+  kPoolGetConfig,
+  kPoolInit,
+  kPoolExit,
+  kPoolCreatePool,
+  kPoolDestroyPool,
+  kPoolGetBlock,
+  kPoolReleaseBlock,
+  kPoolPhysAddr2Handle,
+  kPoolHandle2PhysAddr,
+  kPoolHandle2MetaPhysAddr,
+  kPoolHandle2PoolId,
+  kPoolHandle2BlkSize,
+  kPoolMmapPool,
+  kPoolMunmapPool,
+  kPoolGetBlockVirAddr,
+  kPoolGetMetaVirAddr,
+  kPoolIncreaseRefCnt,
+  kPoolDecreaseRefCnt,
+  kCallCount
+};
+
+/** @brief SDK name of @p c, e.g. "AX_SYS_Mmap". */
+const char* CallName(Call c);
+/** @brief Count the call and spin for its configured latency. */
+void Enter(Call c);
+void SetLatency(Call c, uint64_t ns);
+uint64_t CallCount(Call c);
+void ResetCallCounts();
+
+struct Partition {
+  std::string name;
+  uint64_t phys;
+  uint64_t size;
+  int fd;  // memfd holding the partition; file offset = phys - this->phys
+  std::map<uint64_t, uint64_t> free_list;  // offset -> length
+};
+
+struct Block {
+  uint64_t phys;
+  uint64_t size;
+  size_t partition;
+  bool cached;
+  std::string name;
+  void* vir;  // mapping made at allocation time (nullptr for pools)
+};
+
+struct Mapping {
+  uint8_t* base;  // page-aligned start of the mmap()ed span
+  size_t span;
+  uint8_t* user;  // pointer handed out, base + (phys % page)
+  uint64_t phys;  // physical address of user
+  size_t size;
+  bool cached;
+  int fd;
+  uint64_t file_off;  // file offset of base
+  int refs;           // > 1 only for shared *Fast mappings
+  bool fast;
+};
+
+/**
+ * @brief Process-wide emulated CMM. All members must be used with mu held
+ *        unless noted.
+ */
+class Backend {
+ public:
+  /** @brief Singleton, configured from the environment on first use. */
+  static Backend& Get();
+
+  std::mutex mu;
+
+  int Alloc(uint64_t size, uint64_t align, const char* partition, bool cached,
+            const char* name, uint64_t* phys, void** vir);
+  int Free(uint64_t phys);
+
+  /** @brief Map [phys, phys + size); returns nullptr on error. */
+  void* Map(uint64_t phys, size_t size, bool cached, bool fast);
+  int Unmap(void* vir);
+
+  int Flush(void* vir, size_t size);
+  int Invalidate(void* vir, size_t size);
+
+  /** @brief Block containing @p phys, or nullptr. */
+  const Block* FindBlock(uint64_t phys) const;
+  /** @brief Record the address MemGetBlockInfoByPhy reports for a block. */
+  void SetBlockVir(uint64_t phys, void* vir);
+  /** @brief Mapping containing @p vir, or nullptr. */
+  const Mapping* FindMapping(const void* vir) const;
+  /** @brief Partition containing [phys, phys + size), or -1. */
+  int FindPartition(uint64_t phys, uint64_t size) const;
+  int FindPartition(const char* name) const;
+
+  const std::vector<Partition>& Partitions() const { return partitions_; }
+  uint64_t FreeBytes(size_t partition) const;
+  uint64_t MaxFreeRegion(size_t partition, uint64_t* phys) const;
+  size_t BlockCount() const { return blocks_.size(); }
+
+  /** @brief Text in the format of /proc/ax_proc/mem_cmm_info. */
+  std::string CmmInfo() const;
+
+ private:
+  Backend();
+
+  std::vector<Partition> partitions_;
+  std::map<uint64_t, Block> blocks_;       // by phys
+  std::map<uintptr_t, Mapping> mappings_;  // by user pointer
+  // *Fast mappings are shared: (phys, size, cached) -> user pointer.
+  std::map<std::tuple<uint64_t, size_t, bool>, uintptr_t> fast_index_;
+};
+
+}  // namespace axemu
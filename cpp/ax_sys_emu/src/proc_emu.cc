@@ -0,0 +1,64 @@
+// /proc/ax_proc/mem_cmm_info of the host emulation.
+//
+// The CMM driver publishes its block list in procfs, and tests and tools
+// read it with fopen(). The emulation has no driver, so fopen() is
+// interposed: that one path yields a snapshot of the emulated CMM, every
+// other path goes to the C library.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <mutex>
+#include <string>
+
+#include "emu_backend.hpp"
+
+namespace {
+
+constexpr const char* kCmmInfoPath = "/proc/ax_proc/mem_cmm_info";
+
+using FopenFn = FILE* (*)(const char*, const char*);
+
+FILE* OpenCmmInfo() {
+  std::string text;
+  {
+    axemu::Backend& be = axemu::Backend::Get();
+    std::lock_guard<std::mutex> lk(be.mu);
+    text = be.CmmInfo();
+  }
+  // fmemopen() with a null buffer owns its storage and frees it on fclose.
+  FILE* f = fmemopen(nullptr, text.size() + 1, "w+");
+  if (!f) return nullptr;
+  fwrite(text.data(), 1, text.size(), f);
+  rewind(f);
+  return f;
+}
+
+FILE* Forward(const char* symbol, const char* path, const char* mode) {
+  static FopenFn next_fopen =
+      reinterpret_cast<FopenFn>(dlsym(RTLD_NEXT, "fopen"));
+  static FopenFn next_fopen64 =
+      reinterpret_cast<FopenFn>(dlsym(RTLD_NEXT, "fopen64"));
+  FopenFn fn = strcmp(symbol, "fopen64") == 0 ? next_fopen64 : next_fopen;
+  return fn ? fn(path, mode) : nullptr;
+}
+
+}  // namespace
+
+extern "C" {
+
+FILE* fopen(const char* path, const char* mode) {
+  if (path && strcmp(path, kCmmInfoPath) == 0) return OpenCmmInfo();
+  return Forward("fopen", path, mode);
+}
+
+FILE* fopen64(const char* path, const char* mode) {
+  if (path && strcmp(path, kCmmInfoPath) == 0) return OpenCmmInfo();
+  return Forward("fopen64", path, mode);
+}
+
+}  // extern "C"
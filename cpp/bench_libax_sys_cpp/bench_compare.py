@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Compare two bench_libax_sys_cpp JSON results and flag regressions.
+
+Usage:
+  bench_libax_sys_cpp --benchmark_repetitions=5 \\
+      --benchmark_out=base.json --benchmark_out_format=json
+  (change the wrapper, rebuild, write new.json the same way)
+  bench_compare.py base.json new.json [--metric p50_ns] [--threshold 5]
+
+A benchmark regresses when the metric grows by more than --threshold
+percent. With repetitions the median aggregate is compared, and the
+threshold is widened to twice the larger coefficient of variation so
+run-to-run noise is not reported. Exit status is 1 if any benchmark
+regressed, 0 otherwise.
+"""
+
+import argparse
+import json
+import statistics
+import sys
+
+
+def load(path, metric):
+    """Returns {name: (value, cv)} for one results file."""
+    with open(path) as f:
+        doc = json.load(f)
+    runs = {}
+    medians = {}
+    cvs = {}
+    for b in doc.get("benchmarks", []):
+        if b.get("error_occurred"):
+            continue
+        name = b.get("run_name", b["name"])
+        value = b.get(metric)
+        if value is None:
+            continue
+        if b.get("run_type") == "aggregate":
+            agg = b.get("aggregate_name")
+            if agg == "median":
+                medians[name] = float(value)
+            elif agg == "cv":
+                cvs[name] = float(value)
+        else:
+            runs.setdefault(name, []).append(float(value))
+    out = {}
+    for name, values in runs.items():
+        value = medians.get(name, statistics.median(values))
+        cv = cvs.get(name)
+        if cv is None and len(values) > 1:
+            cv = statistics.stdev(values) / statistics.mean(values)
+        out[name] = (value, cv or 0.0)
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("baseline")
+    ap.add_argument("contender")
+    ap.add_argument("--metric", default="real_time",
+                    help="real_time (default), p50_ns, p90_ns, p99_ns or "
+                         "max_ns")
+    ap.add_argument("--threshold", type=float, default=5.0,
+                    help="regression threshold in percent (default 5)")
+    args = ap.parse_args()
+
+    base = load(args.baseline, args.metric)
+    new = load(args.contender, args.metric)
+    regressions = 0
+    width = max((len(n) for n in base), default=10)
+    print("%-*s %12s %12s %8s %8s" %
+          (width, "benchmark", "baseline", "contender", "delta", "limit"))
+    for name in sorted(base):
+        if name not in new:
+            print("%-*s %12.1f %12s" % (width, name, base[name][0], "missing"))
+            continue
+        old_v, old_cv = base[name]
+        new_v, new_cv = new[name]
+        delta = (new_v - old_v) / old_v * 100.0 if old_v else 0.0
+        limit = max(args.threshold, 200.0 * max(old_cv, new_cv))
+        flag = ""
+        if delta > limit:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif delta < -limit:
+            flag = "  improved"
+        print("%-*s %12.1f %12.1f %+7.1f%% %7.1f%%%s" %
+              (width, name, old_v, new_v, delta, limit, flag))
+    for name in sorted(set(new) - set(base)):
+        print("%-*s %12s %12.1f" % (width, name, "new", new[name][0]))
+
+    if regressions:
+        print("%d benchmark(s) regressed beyond the noise threshold" %
+              regressions, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
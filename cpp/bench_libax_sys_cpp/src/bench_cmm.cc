@@ -0,0 +1,221 @@
+// CmmBuffer/CmmView benchmarks. Every case runs over 4 KiB .. 32 MiB; the
+// first argument selects the cache mode (0 = non-cached, 1 = cached).
+#include <benchmark/benchmark.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#include "axsys/sys.hpp"
+#include "latency.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::CmmView;
+
+constexpr int64_t kMinSize = 4 << 10;
+constexpr int64_t kMaxSize = 32 << 20;
+
+CacheMode ModeArg(int64_t v) {
+  return v != 0 ? CacheMode::kCached : CacheMode::kNonCached;
+}
+
+const char* ModeName(CacheMode mode) {
+  return mode == CacheMode::kCached ? "cached" : "noncached";
+}
+
+void ModeAndSize(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"cached", "bytes"});
+  for (int64_t mode = 0; mode <= 1; ++mode) {
+    for (int64_t size = kMinSize; size <= kMaxSize; size *= 8) {
+      b->Args({mode, size});
+    }
+    b->Args({mode, kMaxSize});
+  }
+}
+
+void SizeOnly(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"bytes"});
+  for (int64_t size = kMinSize; size <= kMaxSize; size *= 8) b->Arg(size);
+  b->Arg(kMaxSize);
+}
+
+/** Allocates @p buf or marks the benchmark failed. */
+bool Allocate(benchmark::State& state, CmmBuffer* buf, CmmView* view,
+              size_t size, CacheMode mode) {
+  auto r = buf->Allocate(size, mode, "bench");
+  if (!r) {
+    state.SkipWithError(r.Message().c_str());
+    return false;
+  }
+  *view = r.MoveValue();
+  return true;
+}
+
+// Allocate + base view unmap + Free, i.e. one full buffer lifetime.
+void BM_AllocateFree(benchmark::State& state) {
+  const CacheMode mode = ModeArg(state.range(0));
+  const size_t size = static_cast<size_t>(state.range(1));
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    CmmBuffer buf;
+    auto r = buf.Allocate(size, mode, "bench");
+    if (!r) {
+      state.SkipWithError(r.Message().c_str());
+      break;
+    }
+    r.Value().Reset();
+    auto f = buf.Free();
+    const Clock::time_point t1 = Clock::now();
+    if (!f) {
+      state.SkipWithError(f.Message().c_str());
+      break;
+    }
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetLabel(ModeName(mode));
+}
+BENCHMARK(BM_AllocateFree)->Apply(ModeAndSize)->UseManualTime();
+
+template <bool kFast>
+void BM_Map(benchmark::State& state) {
+  const CacheMode mode = ModeArg(state.range(0));
+  const size_t size = static_cast<size_t>(state.range(1));
+  CmmBuffer buf;
+  CmmView base;
+  if (!Allocate(state, &buf, &base, size, mode)) return;
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    auto v =
+        kFast ? buf.MapViewFast(0, size, mode) : buf.MapView(0, size, mode);
+    const Clock::time_point t1 = Clock::now();
+    if (!v) {
+      state.SkipWithError(v.Message().c_str());
+      break;
+    }
+    lat.Add(state, t0, t1);
+    v.Value().Reset();
+  }
+  lat.Report(state);
+  state.SetLabel(ModeName(mode));
+}
+BENCHMARK_TEMPLATE(BM_Map, false)
+    ->Name("BM_MapView")
+    ->Apply(ModeAndSize)
+    ->UseManualTime();
+BENCHMARK_TEMPLATE(BM_Map, true)
+    ->Name("BM_MapViewFast")
+    ->Apply(ModeAndSize)
+    ->UseManualTime();
+
+// Unmap cost of a MapView() view; the mapping itself is not timed.
+void BM_Reset(benchmark::State& state) {
+  const CacheMode mode = ModeArg(state.range(0));
+  const size_t size = static_cast<size_t>(state.range(1));
+  CmmBuffer buf;
+  CmmView base;
+  if (!Allocate(state, &buf, &base, size, mode)) return;
+  LatencySamples lat;
+  for (auto _ : state) {
+    auto v = buf.MapView(0, size, mode);
+    if (!v) {
+      state.SkipWithError(v.Message().c_str());
+      break;
+    }
+    const Clock::time_point t0 = Clock::now();
+    v.Value().Reset();
+    lat.Add(state, t0, Clock::now());
+  }
+  lat.Report(state);
+  state.SetLabel(ModeName(mode));
+}
+BENCHMARK(BM_Reset)->Apply(ModeAndSize)->UseManualTime();
+
+// Flush of a fully dirtied cached view (the CPU-writes-then-device-reads
+// path). Dirtying is not timed.
+void BM_Flush(benchmark::State& state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  CmmBuffer buf;
+  CmmView view;
+  if (!Allocate(state, &buf, &view, size, CacheMode::kCached)) return;
+  LatencySamples lat;
+  uint8_t fill = 0;
+  for (auto _ : state) {
+    memset(view.Data(), ++fill, size);
+    const Clock::time_point t0 = Clock::now();
+    auto r = view.Flush();
+    const Clock::time_point t1 = Clock::now();
+    if (!r) {
+      state.SkipWithError(r.Message().c_str());
+      break;
+    }
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Flush)->Apply(SizeOnly)->UseManualTime();
+
+// Invalidate of a cached view before the CPU reads device output.
+void BM_Invalidate(benchmark::State& state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  CmmBuffer buf;
+  CmmView view;
+  if (!Allocate(state, &buf, &view, size, CacheMode::kCached)) return;
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    auto r = view.Invalidate();
+    const Clock::time_point t1 = Clock::now();
+    if (!r) {
+      state.SkipWithError(r.Message().c_str());
+      break;
+    }
+    lat.Add(state, t0, t1);
+    benchmark::DoNotOptimize(*static_cast<volatile uint8_t*>(view.Data()));
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Invalidate)->Apply(SizeOnly)->UseManualTime();
+
+// memcpy between two CMM buffers for every source/destination cache-mode
+// pair. Cache maintenance is not included; see BM_Flush/BM_Invalidate.
+void BM_Copy(benchmark::State& state) {
+  const CacheMode src_mode = ModeArg(state.range(0));
+  const CacheMode dst_mode = ModeArg(state.range(1));
+  const size_t size = static_cast<size_t>(state.range(2));
+  CmmBuffer src_buf;
+  CmmBuffer dst_buf;
+  CmmView src;
+  CmmView dst;
+  if (!Allocate(state, &src_buf, &src, size, src_mode) ||
+      !Allocate(state, &dst_buf, &dst, size, dst_mode)) {
+    return;
+  }
+  memset(src.Data(), 0x5a, size);
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    memcpy(dst.Data(), src.Data(), size);
+    benchmark::ClobberMemory();
+    lat.Add(state, t0, Clock::now());
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(2));
+  state.SetLabel(std::string(ModeName(src_mode)) + "->" + ModeName(dst_mode));
+}
+BENCHMARK(BM_Copy)
+    ->ArgNames({"src_cached", "dst_cached", "bytes"})
+    ->ArgsProduct({{0, 1}, {0, 1}, {kMinSize, 256 << 10, 2 << 20, kMaxSize}})
+    ->UseManualTime();
+
+}  // namespace
@@ -0,0 +1,136 @@
+// Building an NPU input of `floats` values per frame: the usual way fills a
+// std::vector on the heap and copies it into a reused CmmBuffer, the CMM
+// way appends straight into a reserved CmmVector. Both flush the result.
+// A second pair creates 64 small containers of 256 bytes: one
+// CmmBuffer::Allocate() each against CmmAllocator over one CmmArena.
+#include <benchmark/benchmark.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "axsys/cmm_allocator.hpp"
+#include "latency.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+
+constexpr int kContainers = 64;
+constexpr size_t kSmallBytes = 256;
+
+void InputSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"floats"});
+  for (int64_t n : {3 * 224 * 224, 3 * 640 * 640}) b->Arg(n);
+}
+
+float Normalize(size_t i) {
+  return static_cast<float>(i & 0xff) * (1.0f / 255.0f) - 0.5f;
+}
+
+void BM_VectorThenCopy(benchmark::State& state) {
+  const size_t n = static_cast<size_t>(state.range(0));
+  axsys::CmmBuffer buf;
+  auto v = buf.Allocate(n * sizeof(float), axsys::CacheMode::kCached,
+                        "bench_alloc");
+  if (!v) {
+    state.SkipWithError(v.Message().c_str());
+    return;
+  }
+  axsys::CmmView view = v.MoveValue();
+  std::vector<float> host;
+  host.reserve(n);
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    host.clear();
+    for (size_t i = 0; i < n; ++i) host.push_back(Normalize(i));
+    memcpy(view.Data(), host.data(), n * sizeof(float));
+    (void)view.Flush(0, n * sizeof(float));
+    benchmark::DoNotOptimize(view.Data());
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0) *
+                          static_cast<int64_t>(sizeof(float)));
+  view.Reset();
+  (void)buf.Free();
+}
+BENCHMARK(BM_VectorThenCopy)->Apply(InputSizes)->UseManualTime();
+
+void BM_CmmVectorDirect(benchmark::State& state) {
+  const size_t n = static_cast<size_t>(state.range(0));
+  axsys::CmmArena arena;
+  axsys::CmmVector<float> input(&arena);
+  try {
+    input.reserve(n);
+  } catch (const std::bad_alloc&) {
+    state.SkipWithError("CMM exhausted");
+    return;
+  }
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    input.clear();
+    for (size_t i = 0; i < n; ++i) input.push_back(Normalize(i));
+    (void)input.Flush();
+    benchmark::DoNotOptimize(input.data());
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0) *
+                          static_cast<int64_t>(sizeof(float)));
+}
+BENCHMARK(BM_CmmVectorDirect)->Apply(InputSizes)->UseManualTime();
+
+void BM_SmallBuffersEach(benchmark::State& state) {
+  std::vector<axsys::CmmBuffer> bufs(kContainers);
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    for (auto& b : bufs) {
+      auto v =
+          b.Allocate(kSmallBytes, axsys::CacheMode::kCached, "bench_small");
+      if (!v) {
+        state.SkipWithError(v.Message().c_str());
+        return;
+      }
+      memset(v.Value().Data(), 0x46, kSmallBytes);
+    }
+    for (auto& b : bufs) (void)b.Free();
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations() * kContainers);
+}
+BENCHMARK(BM_SmallBuffersEach)->UseManualTime();
+
+void BM_SmallArenaContainers(benchmark::State& state) {
+  axsys::CmmArena arena;
+  axsys::CmmAllocator<uint8_t> alloc(&arena);
+  using Bytes = std::vector<uint8_t, axsys::CmmAllocator<uint8_t>>;
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    {
+      std::vector<Bytes> containers;
+      containers.reserve(kContainers);
+      for (int i = 0; i < kContainers; ++i) {
+        containers.emplace_back(kSmallBytes, uint8_t{0x46}, alloc);
+      }
+      benchmark::DoNotOptimize(containers.data());
+    }
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations() * kContainers);
+}
+BENCHMARK(BM_SmallArenaContainers)->UseManualTime();
+
+}  // namespace
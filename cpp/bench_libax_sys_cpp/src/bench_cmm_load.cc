@@ -0,0 +1,122 @@
+// LoadFileToCmm() against the usual read() into the heap + memcpy into
+// CMM, for files of 1 MiB to 1 GiB. The first argument selects the cache
+// mode of the destination. The file is dropped from the page cache before
+// each iteration where the filesystem allows it, so both include the disk
+// read; sizes the CMM cannot hold are skipped.
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "axsys/cmm_load.hpp"
+#include "axsys/sys.hpp"
+#include "latency.hpp"
+#include "temp_file.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+
+void ModeAndFileSize(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"cached", "bytes"});
+  for (int64_t mode = 0; mode <= 1; ++mode) {
+    for (int64_t mib = 1; mib <= 1024; mib *= 16) b->Args({mode, mib << 20});
+    b->Args({mode, int64_t{1024} << 20});
+  }
+}
+
+CacheMode ModeArg(int64_t v) {
+  return v != 0 ? CacheMode::kCached : CacheMode::kNonCached;
+}
+
+void DropPageCache(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return;
+  (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// Baseline: read() the whole file into a heap buffer, then allocate CMM,
+// memcpy and flush. The heap buffer is allocated once, outside the timing.
+void BM_ReadMemcpy(benchmark::State& state) {
+  const CacheMode mode = ModeArg(state.range(0));
+  const size_t size = static_cast<size_t>(state.range(1));
+  const std::string path = axbench::MakeTempFile("load", size);
+  if (path.empty()) {
+    state.SkipWithError("cannot write the file");
+    return;
+  }
+  std::vector<uint8_t> heap(size);
+  LatencySamples lat;
+  for (auto _ : state) {
+    DropPageCache(path);
+    const Clock::time_point t0 = Clock::now();
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    size_t done = 0;
+    while (fd >= 0 && done < size) {
+      const ssize_t n = read(fd, heap.data() + done, size - done);
+      if (n <= 0) break;
+      done += static_cast<size_t>(n);
+    }
+    if (fd >= 0) close(fd);
+    if (done != size) {
+      state.SkipWithError("read failed");
+      break;
+    }
+    CmmBuffer buf;
+    auto r = buf.Allocate(size, mode, "bench");
+    if (!r) {
+      state.SkipWithError(r.Message().c_str());
+      break;
+    }
+    memcpy(r.Value().Data(), heap.data(), size);
+    if (mode == CacheMode::kCached) (void)r.Value().Flush();
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+    r.Value().Reset();
+    (void)buf.Free();
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(1));
+  unlink(path.c_str());
+}
+BENCHMARK(BM_ReadMemcpy)->Apply(ModeAndFileSize)->UseManualTime();
+
+// LoadFileToCmm() with default options: overlapped read and copy/flush.
+void BM_LoadFileToCmm(benchmark::State& state) {
+  const CacheMode mode = ModeArg(state.range(0));
+  const size_t size = static_cast<size_t>(state.range(1));
+  const std::string path = axbench::MakeTempFile("load", size);
+  if (path.empty()) {
+    state.SkipWithError("cannot write the file");
+    return;
+  }
+  axsys::CmmLoadOptions opt;
+  opt.token = "bench";
+  LatencySamples lat;
+  for (auto _ : state) {
+    DropPageCache(path);
+    const Clock::time_point t0 = Clock::now();
+    auto r = axsys::LoadFileToCmm(path.c_str(), mode, opt);
+    const Clock::time_point t1 = Clock::now();
+    if (!r) {
+      state.SkipWithError(r.Message().c_str());
+      break;
+    }
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(1));
+  unlink(path.c_str());
+}
+BENCHMARK(BM_LoadFileToCmm)->Apply(ModeAndFileSize)->UseManualTime();
+
+}  // namespace
@@ -0,0 +1,94 @@
+// Filling one cached 8 or 32 MiB view from 1 to 8 threads. The hand-split
+// way cuts the view at size * t / threads, joins, then flushes the whole
+// view from the calling thread; ParallelFor() cuts at cache lines and
+// each worker flushes its own slice right after filling it.
+#include <benchmark/benchmark.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "axsys/cmm_parallel.hpp"
+#include "latency.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+
+void ThreadsAndSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"threads", "mib"});
+  b->ArgsProduct({{1, 2, 4, 8}, {8, 32}});
+}
+
+void Fill(uint8_t* p, size_t size, size_t offset) {
+  memset(p, static_cast<int>(offset & 0xff), size);
+}
+
+void BM_FillHandSplitFlushAll(benchmark::State& state) {
+  const unsigned threads = static_cast<unsigned>(state.range(0));
+  const size_t size = static_cast<size_t>(state.range(1)) << 20;
+  axsys::CmmBuffer buf;
+  auto v = buf.Allocate(size, axsys::CacheMode::kCached, "bench_par");
+  if (!v) {
+    state.SkipWithError(v.Message().c_str());
+    return;
+  }
+  axsys::CmmView view = v.MoveValue();
+  uint8_t* data = static_cast<uint8_t*>(view.Data());
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+      const size_t begin = size * t / threads;
+      const size_t end = size * (t + 1) / threads;
+      workers.emplace_back(Fill, data + begin, end - begin, begin);
+    }
+    Fill(data, size / threads, 0);
+    for (auto& w : workers) w.join();
+    (void)view.Flush(0, size);
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size));
+  view.Reset();
+  (void)buf.Free();
+}
+BENCHMARK(BM_FillHandSplitFlushAll)->Apply(ThreadsAndSizes)->UseManualTime();
+
+void BM_FillParallelFor(benchmark::State& state) {
+  const size_t size = static_cast<size_t>(state.range(1)) << 20;
+  axsys::CmmBuffer buf;
+  auto v = buf.Allocate(size, axsys::CacheMode::kCached, "bench_par");
+  if (!v) {
+    state.SkipWithError(v.Message().c_str());
+    return;
+  }
+  axsys::CmmView view = v.MoveValue();
+  axsys::ParallelOptions opt;
+  opt.threads = static_cast<unsigned>(state.range(0));
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    auto r = axsys::ParallelFor(&view, [](const axsys::CmmSlice& s) {
+      Fill(s.data, s.size, s.offset);
+    }, opt);
+    const Clock::time_point t1 = Clock::now();
+    if (!r) {
+      state.SkipWithError(r.Message().c_str());
+      break;
+    }
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size));
+  view.Reset();
+  (void)buf.Free();
+}
+BENCHMARK(BM_FillParallelFor)->Apply(ThreadsAndSizes)->UseManualTime();
+
+}  // namespace
@@ -0,0 +1,118 @@
+// Streaming records through a 1 MiB ring: CmmRing (mirrored mapping, every
+// record is one span) against a plain ring that splits writes at the end
+// and copies wrapped records out before handing them on. Each iteration
+// writes and then sends (copies to a sink) 64 records; record sizes are
+// chosen so that records keep landing across the end of the buffer. The
+// memfd backing is used so that host and board measure the same thing.
+#include <benchmark/benchmark.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "axsys/cmm_ring.hpp"
+#include "latency.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+
+constexpr size_t kRing = 1 << 20;
+constexpr int kBatch = 64;
+
+void RecordSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"bytes"});
+  for (int64_t n : {1500, 16384 + 320, 65536 + 1024}) b->Arg(n);
+}
+
+/** Ring of plain memory that wraps: the baseline. */
+class WrapRing {
+ public:
+  explicit WrapRing(size_t capacity) : buf_(capacity) {}
+
+  bool Write(const uint8_t* src, size_t n) {
+    if (tail_ + n - head_ > buf_.size()) return false;
+    const size_t off = tail_ % buf_.size();
+    const size_t first = std::min(n, buf_.size() - off);
+    memcpy(buf_.data() + off, src, first);
+    memcpy(buf_.data(), src + first, n - first);
+    tail_ += n;
+    return true;
+  }
+
+  /** Record of @p n bytes in place, or copied to @p scratch if it wraps. */
+  const uint8_t* Read(size_t n, uint8_t* scratch) {
+    const size_t off = head_ % buf_.size();
+    const size_t first = std::min(n, buf_.size() - off);
+    head_ += n;
+    if (first == n) return buf_.data() + off;
+    memcpy(scratch, buf_.data() + off, first);
+    memcpy(scratch + first, buf_.data(), n - first);
+    return scratch;
+  }
+
+ private:
+  std::vector<uint8_t> buf_;
+  uint64_t head_ = 0;
+  uint64_t tail_ = 0;
+};
+
+void BM_RingCopyAtWrap(benchmark::State& state) {
+  const size_t n = static_cast<size_t>(state.range(0));
+  WrapRing ring(kRing);
+  std::vector<uint8_t> src(n, 0x45);
+  std::vector<uint8_t> scratch(n);
+  std::vector<uint8_t> sink(n);
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < kBatch; ++i) {
+      if (!ring.Write(src.data(), n)) break;
+      memcpy(sink.data(), ring.Read(n, scratch.data()), n);
+    }
+    benchmark::DoNotOptimize(sink.data());
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * kBatch * state.range(0));
+}
+BENCHMARK(BM_RingCopyAtWrap)->Apply(RecordSizes)->UseManualTime();
+
+void BM_RingMirrored(benchmark::State& state) {
+  const size_t n = static_cast<size_t>(state.range(0));
+  axsys::CmmRing ring;
+  axsys::CmmRingOptions opt;
+  opt.backing = axsys::CmmRingBacking::kMemfd;
+  auto r = ring.Create(kRing, opt);
+  if (!r) {
+    state.SkipWithError(r.Message().c_str());
+    return;
+  }
+  std::vector<uint8_t> src(n, 0x45);
+  std::vector<uint8_t> sink(n);
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < kBatch; ++i) {
+      void* w = ring.Reserve(n);
+      if (!w) break;
+      memcpy(w, src.data(), n);
+      ring.Commit(n);
+      size_t avail = 0;
+      memcpy(sink.data(), ring.Peek(&avail), n);
+      ring.Consume(n);
+    }
+    benchmark::DoNotOptimize(sink.data());
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * kBatch * state.range(0));
+}
+BENCHMARK(BM_RingMirrored)->Apply(RecordSizes)->UseManualTime();
+
+}  // namespace
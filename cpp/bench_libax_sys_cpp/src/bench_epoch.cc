@@ -0,0 +1,89 @@
+// Reader-side cost of reaching a shared buffer that its owner may swap
+// out: an EpochDomain section, a std::shared_ptr copy (atomic reference
+// count on a shared line) and a std::mutex, each around one load of the
+// published pointer. One sample times kReads reads; with threads:4 every
+// thread reads the same object while the others do the same.
+#include <benchmark/benchmark.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "axsys/epoch.hpp"
+#include "latency.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+
+constexpr int kReads = 1024;
+
+struct Payload {
+  uint64_t value = 49;
+};
+
+void BM_ReadEpochGuard(benchmark::State& state) {
+  static axsys::EpochDomain domain;
+  static Payload payload;
+  static std::atomic<const Payload*> current{&payload};
+  LatencySamples lat;
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < kReads; ++i) {
+      axsys::EpochGuard g = domain.Enter();
+      sum += current.load(std::memory_order_acquire)->value;
+    }
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  benchmark::DoNotOptimize(sum);
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations() * kReads);
+}
+BENCHMARK(BM_ReadEpochGuard)->Threads(1)->Threads(4)->UseManualTime();
+
+void BM_ReadSharedPtr(benchmark::State& state) {
+  static const std::shared_ptr<const Payload> current =
+      std::make_shared<Payload>();
+  LatencySamples lat;
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < kReads; ++i) {
+      std::shared_ptr<const Payload> p = std::atomic_load(&current);
+      sum += p->value;
+    }
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  benchmark::DoNotOptimize(sum);
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations() * kReads);
+}
+BENCHMARK(BM_ReadSharedPtr)->Threads(1)->Threads(4)->UseManualTime();
+
+void BM_ReadMutex(benchmark::State& state) {
+  static std::mutex mtx;
+  static Payload payload;
+  LatencySamples lat;
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < kReads; ++i) {
+      std::lock_guard<std::mutex> lk(mtx);
+      sum += payload.value;
+    }
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  benchmark::DoNotOptimize(sum);
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations() * kReads);
+}
+BENCHMARK(BM_ReadMutex)->Threads(1)->Threads(4)->UseManualTime();
+
+}  // namespace
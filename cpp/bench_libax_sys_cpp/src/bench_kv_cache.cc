@@ -0,0 +1,138 @@
+// Paged KV cache on the host: page allocation latency, and a decode
+// simulation of batched sequences that share a prompt and stop at random
+// lengths. The simulation reports the CMM the paged cache holds against
+// reserving every sequence at the maximum context length.
+#include <benchmark/benchmark.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "axsys/kv_cache.hpp"
+#include "axsys/sys.hpp"
+#include "latency.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+using axsys::KvCache;
+using axsys::KvCacheConfig;
+
+constexpr uint32_t kTokensPerPage = 16;
+constexpr size_t kBytesPerToken = 1024;  // scaled down from a real model
+constexpr uint32_t kMaxContext = 2048;
+
+KvCacheConfig BenchConfig(uint32_t pages) {
+  KvCacheConfig cfg;
+  cfg.num_pages = pages;
+  cfg.tokens_per_page = kTokensPerPage;
+  cfg.bytes_per_token = kBytesPerToken;
+  cfg.token = "bench";
+  return cfg;
+}
+
+// Take `pages` pages with AllocPage(), then return them: one iteration.
+void BM_KvPageAllocFree(benchmark::State& state) {
+  const size_t batch = static_cast<size_t>(state.range(0));
+  KvCache kv;
+  auto r = kv.Init(BenchConfig(1024));
+  if (!r) {
+    state.SkipWithError(r.Message().c_str());
+    return;
+  }
+  std::vector<uint32_t> pages(batch);
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    for (size_t i = 0; i < batch; ++i) pages[i] = kv.AllocPage();
+    for (size_t i = 0; i < batch; ++i) kv.ReleasePage(pages[i]);
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_KvPageAllocFree)->ArgName("pages")->Arg(1)->Arg(64)
+    ->UseManualTime();
+
+// Each iteration is one decode step: every live sequence appends a token.
+// A finished sequence is freed and replaced by a new fork of the prompt.
+// Counters: paged_mib (pages in use, at the peak), contiguous_mib (batch
+// x max context), occupancy and fragmentation at the peak.
+void BM_KvDecodeSim(benchmark::State& state) {
+  const uint32_t batch = static_cast<uint32_t>(state.range(0));
+  const uint32_t prompt_len = static_cast<uint32_t>(state.range(1));
+  const uint32_t pages = batch * (kMaxContext / kTokensPerPage) + 1;
+  KvCache kv;
+  auto r = kv.Init(BenchConfig(pages));
+  if (!r) {
+    state.SkipWithError(r.Message().c_str());
+    return;
+  }
+  auto prompt = kv.CreateSequence();
+  for (uint32_t i = 0; i < prompt_len && prompt; ++i) {
+    auto slot = kv.AppendToken(prompt.Value());
+    if (slot) memset(slot.Value(), 1, kBytesPerToken);
+  }
+  uint32_t x = 43;
+  auto next_stop = [&x, prompt_len] {
+    x = x * 1664525u + 1013904223u;
+    return prompt_len + 1 + (x >> 8) % (kMaxContext - prompt_len);
+  };
+  std::vector<uint32_t> seqs(batch);
+  std::vector<uint32_t> stops(batch);
+  for (uint32_t i = 0; i < batch; ++i) {
+    seqs[i] = kv.ForkSequence(prompt.Value()).Value();
+    stops[i] = next_stop();
+  }
+  LatencySamples lat;
+  axsys::KvCacheStats peak{};
+  uint32_t peak_used = 0;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    bool ok = true;
+    for (uint32_t i = 0; i < batch && ok; ++i) {
+      auto slot = kv.AppendToken(seqs[i]);
+      ok = static_cast<bool>(slot);
+      if (ok) memset(slot.Value(), 2, 64);  // touch the slot
+      if (ok && kv.Length(seqs[i]) >= stops[i]) {
+        (void)kv.FreeSequence(seqs[i]);
+        auto f = kv.ForkSequence(prompt.Value());
+        ok = static_cast<bool>(f);
+        if (ok) seqs[i] = f.Value();
+        stops[i] = next_stop();
+      }
+    }
+    const Clock::time_point t1 = Clock::now();
+    if (!ok) {
+      state.SkipWithError("decode step failed");
+      break;
+    }
+    lat.Add(state, t0, t1);
+    const axsys::KvCacheStats st = kv.Stats();
+    if (st.pages_total - st.pages_free > peak_used) {
+      peak_used = st.pages_total - st.pages_free;
+      peak = st;
+    }
+  }
+  lat.Report(state);
+  const double page_mib =
+      static_cast<double>(kTokensPerPage * kBytesPerToken) / 1048576.0;
+  state.counters["paged_mib"] = peak_used * page_mib;
+  state.counters["contiguous_mib"] =
+      static_cast<double>(size_t{batch} * kMaxContext * kBytesPerToken) /
+      1048576.0;
+  state.counters["occupancy"] = peak.occupancy;
+  state.counters["fragmentation"] = peak.fragmentation;
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_KvDecodeSim)
+    ->ArgNames({"batch", "prompt"})
+    ->Args({8, 512})
+    ->Args({32, 512})
+    ->Iterations(4096)
+    ->UseManualTime();
+
+}  // namespace
@@ -0,0 +1,17 @@
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+
+#include "axsys/sys.hpp"
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  axsys::System sys;
+  if (!sys.Ok()) {
+    fprintf(stderr, "AX_SYS_Init failed\n");
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,348 @@
+// NV12 camera frame to an RGB888 CHW i8 NPU input tensor. The usual way
+// runs scalar float code into heap buffers and copies the tensor into a
+// reused CmmBuffer; the CMM way runs Nv12ToRgb(), Letterbox() and
+// ToTensor() straight over ImageViews in CMM, on 1 or 4 threads. Both
+// flush the tensor. The remaining benchmarks time each kernel alone over
+// 1, 2 and 4 threads: colour conversion, Resize() (nearest and bilinear),
+// Letterbox(), CropImage() and ToTensor() (affine and LUT quantization).
+#include <benchmark/benchmark.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "axsys/preprocess.hpp"
+#include "latency.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+using axsys::CacheMode;
+using axsys::Image;
+using axsys::PixelFormat;
+
+constexpr uint32_t kSrcW = 1280;
+constexpr uint32_t kSrcH = 720;
+constexpr uint32_t kDst = 640;
+
+void Threads(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"threads"});
+  for (int64_t t : {1, 4}) b->Arg(t);
+}
+
+void SweptThreads(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"threads"});
+  for (int64_t t : {1, 2, 4}) b->Arg(t);
+}
+
+// First argument 0/1 selects between a kernel's two paths.
+void VariantThreads(benchmark::internal::Benchmark* b, const char* variant) {
+  b->ArgNames({variant, "threads"});
+  for (int64_t v : {0, 1}) {
+    for (int64_t t : {1, 2, 4}) b->Args({v, t});
+  }
+}
+
+void FilterThreads(benchmark::internal::Benchmark* b) {
+  VariantThreads(b, "bilinear");
+}
+
+void QuantThreads(benchmark::internal::Benchmark* b) {
+  VariantThreads(b, "lut");
+}
+
+// Allocates the NV12 source with a gradient and flushes it.
+bool MakeSource(Image* nv12, benchmark::State& state) {
+  auto r = nv12->Allocate(kSrcW, kSrcH, PixelFormat::kNv12,
+                          CacheMode::kCached, "bench_pre_src");
+  if (!r) {
+    state.SkipWithError(r.Message().c_str());
+    return false;
+  }
+  const axsys::ImageView v = nv12->View();
+  for (uint32_t p = 0; p < v.Planes(); ++p) {
+    for (uint32_t y = 0; y < v.PlaneRows(p); ++y) {
+      uint8_t* row = v.Row(p, y);
+      for (size_t x = 0; x < v.RowBytes(p); ++x) {
+        row[x] = static_cast<uint8_t>(x + y);
+      }
+    }
+  }
+  (void)v.FlushRows(0, v.Height());
+  return true;
+}
+
+// Allocates a packed RGB888 image with a gradient and flushes it.
+bool MakeRgb(Image* rgb, uint32_t width, uint32_t height, const char* token,
+             benchmark::State& state) {
+  auto r = rgb->Allocate(width, height, PixelFormat::kRgb888,
+                         CacheMode::kCached, token);
+  if (!r) {
+    state.SkipWithError(r.Message().c_str());
+    return false;
+  }
+  const axsys::ImageView v = rgb->View();
+  for (uint32_t y = 0; y < height; ++y) {
+    uint8_t* row = v.Row(0, y);
+    for (size_t x = 0; x < v.RowBytes(0); ++x) {
+      row[x] = static_cast<uint8_t>(x * 3 + y);
+    }
+  }
+  (void)v.FlushRows(0, height);
+  return true;
+}
+
+uint8_t ClampF(float v) {
+  return static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, v)));
+}
+
+void BM_PreprocessHeapThenCopy(benchmark::State& state) {
+  Image nv12;
+  if (!MakeSource(&nv12, state)) return;
+  const axsys::ImageView src = nv12.View();
+  const size_t tensor = size_t{kDst} * kDst * 3;
+  axsys::CmmBuffer buf;
+  auto v = buf.Allocate(tensor, CacheMode::kCached, "bench_pre_tensor");
+  if (!v) {
+    state.SkipWithError(v.Message().c_str());
+    return;
+  }
+  axsys::CmmView view = v.MoveValue();
+  std::vector<uint8_t> rgb(size_t{kSrcW} * kSrcH * 3);
+  std::vector<int8_t> host(tensor);
+  const float scale = static_cast<float>(kDst) / kSrcW;
+  const uint32_t content_h = static_cast<uint32_t>(kSrcH * scale);
+  const uint32_t top = (kDst - content_h) / 2;
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    for (uint32_t y = 0; y < kSrcH; ++y) {
+      const uint8_t* yr = src.Row(0, y);
+      const uint8_t* uv = src.Row(1, y / 2);
+      for (uint32_t x = 0; x < kSrcW; ++x) {
+        const float c = 1.164f * (static_cast<float>(yr[x]) - 16.0f);
+        const float d = static_cast<float>(uv[x & ~1u]) - 128.0f;
+        const float e = static_cast<float>(uv[x | 1u]) - 128.0f;
+        uint8_t* o = &rgb[(size_t{y} * kSrcW + x) * 3];
+        o[0] = ClampF(c + 1.596f * e);
+        o[1] = ClampF(c - 0.392f * d - 0.813f * e);
+        o[2] = ClampF(c + 2.017f * d);
+      }
+    }
+    for (uint32_t c = 0; c < 3; ++c) {
+      int8_t* plane = &host[size_t{c} * kDst * kDst];
+      for (uint32_t y = 0; y < kDst; ++y) {
+        int8_t* out = plane + size_t{y} * kDst;
+        if (y < top || y >= top + content_h) {
+          memset(out, 114 - 128, kDst);
+          continue;
+        }
+        const float fy = (static_cast<float>(y - top) + 0.5f) / scale - 0.5f;
+        const uint32_t sy = std::min(
+            kSrcH - 1, static_cast<uint32_t>(std::max(0.0f, roundf(fy))));
+        for (uint32_t x = 0; x < kDst; ++x) {
+          const float fx = (static_cast<float>(x) + 0.5f) / scale - 0.5f;
+          const uint32_t sx = std::min(
+              kSrcW - 1, static_cast<uint32_t>(std::max(0.0f, roundf(fx))));
+          const float px = rgb[(size_t{sy} * kSrcW + sx) * 3 + c];
+          out[x] = static_cast<int8_t>(lroundf(px) - 128);
+        }
+      }
+    }
+    memcpy(view.Data(), host.data(), tensor);
+    (void)view.Flush(0, tensor);
+    benchmark::DoNotOptimize(view.Data());
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations());
+  view.Reset();
+  (void)buf.Free();
+}
+BENCHMARK(BM_PreprocessHeapThenCopy)->UseManualTime();
+
+void BM_PreprocessCmm(benchmark::State& state) {
+  const unsigned threads = static_cast<unsigned>(state.range(0));
+  Image nv12, rgb, boxed;
+  if (!MakeSource(&nv12, state)) return;
+  auto r = rgb.Allocate(kSrcW, kSrcH, PixelFormat::kRgb888, CacheMode::kCached,
+                        "bench_pre_rgb");
+  if (r) {
+    r = boxed.Allocate(kDst, kDst, PixelFormat::kRgb888, CacheMode::kCached,
+                       "bench_pre_box");
+  }
+  if (!r) {
+    state.SkipWithError(r.Message().c_str());
+    return;
+  }
+  axsys::CmmBuffer buf;
+  auto v = buf.Allocate(size_t{kDst} * kDst * 3, CacheMode::kCached,
+                        "bench_pre_tensor");
+  if (!v) {
+    state.SkipWithError(v.Message().c_str());
+    return;
+  }
+  axsys::CmmView view = v.MoveValue();
+  const axsys::TensorView tensor{&view, 0, kDst, kDst, 3,
+                                 axsys::TensorLayout::kChw,
+                                 axsys::TensorType::kI8};
+  axsys::QuantParams q;
+  q.zero_point = -128;
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    (void)axsys::Nv12ToRgb(nv12.View(), rgb.View(), axsys::ChannelOrder::kRgb,
+                           threads);
+    (void)axsys::Letterbox(rgb.View(), boxed.View(),
+                           axsys::ResizeFilter::kNearest, 114, threads);
+    (void)axsys::ToTensor(boxed.View(), tensor, q, threads);
+    benchmark::DoNotOptimize(view.Data());
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(axsys::PreprocessKernelName());
+  view.Reset();
+  (void)buf.Free();
+}
+BENCHMARK(BM_PreprocessCmm)->Apply(Threads)->UseManualTime();
+
+void BM_Nv12ToRgb(benchmark::State& state) {
+  const unsigned threads = static_cast<unsigned>(state.range(0));
+  Image nv12, rgb;
+  if (!MakeSource(&nv12, state)) return;
+  auto r = rgb.Allocate(kSrcW, kSrcH, PixelFormat::kRgb888, CacheMode::kCached,
+                        "bench_pre_rgb");
+  if (!r) {
+    state.SkipWithError(r.Message().c_str());
+    return;
+  }
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    (void)axsys::Nv12ToRgb(nv12.View(), rgb.View(), axsys::ChannelOrder::kRgb,
+                           threads);
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(rgb.View().RowBytes(0)) *
+                          kSrcH);
+  state.SetLabel(axsys::PreprocessKernelName());
+}
+BENCHMARK(BM_Nv12ToRgb)->Apply(SweptThreads)->UseManualTime();
+
+// 1280x720 to 640x360 RGB888.
+void BM_Resize(benchmark::State& state) {
+  const axsys::ResizeFilter filter = state.range(0) != 0
+                                         ? axsys::ResizeFilter::kBilinear
+                                         : axsys::ResizeFilter::kNearest;
+  const unsigned threads = static_cast<unsigned>(state.range(1));
+  Image src, dst;
+  if (!MakeRgb(&src, kSrcW, kSrcH, "bench_pre_rgb", state)) return;
+  if (!MakeRgb(&dst, kSrcW / 2, kSrcH / 2, "bench_pre_small", state)) return;
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    (void)axsys::Resize(src.View(), dst.View(), filter, threads);
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(axsys::PreprocessKernelName());
+}
+BENCHMARK(BM_Resize)->Apply(FilterThreads)->UseManualTime();
+
+// 1280x720 RGB888 into a 640x640 letterbox (nearest, padding included).
+void BM_Letterbox(benchmark::State& state) {
+  const unsigned threads = static_cast<unsigned>(state.range(0));
+  Image src, dst;
+  if (!MakeRgb(&src, kSrcW, kSrcH, "bench_pre_rgb", state)) return;
+  if (!MakeRgb(&dst, kDst, kDst, "bench_pre_box", state)) return;
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    (void)axsys::Letterbox(src.View(), dst.View(),
+                           axsys::ResizeFilter::kNearest, 114, threads);
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(axsys::PreprocessKernelName());
+}
+BENCHMARK(BM_Letterbox)->Apply(SweptThreads)->UseManualTime();
+
+// The centred 640x640 region of a 1280x720 RGB888 image.
+void BM_CropImage(benchmark::State& state) {
+  const unsigned threads = static_cast<unsigned>(state.range(0));
+  Image src, dst;
+  if (!MakeRgb(&src, kSrcW, kSrcH, "bench_pre_rgb", state)) return;
+  if (!MakeRgb(&dst, kDst, kDst, "bench_pre_crop", state)) return;
+  const axsys::ImageRect rect{(kSrcW - kDst) / 2, (kSrcH - kDst) / 2, kDst,
+                              kDst};
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    (void)axsys::CropImage(src.View(), rect, dst.View(), threads);
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(dst.View().RowBytes(0)) * kDst);
+}
+BENCHMARK(BM_CropImage)->Apply(SweptThreads)->UseManualTime();
+
+// 640x640 RGB888 to a CHW i8 tensor. Variant 0 only shifts by the zero
+// point (affine path); variant 1 normalizes with mean and scale (LUT).
+void BM_ToTensor(benchmark::State& state) {
+  const bool lut = state.range(0) != 0;
+  const unsigned threads = static_cast<unsigned>(state.range(1));
+  Image src;
+  if (!MakeRgb(&src, kDst, kDst, "bench_pre_box", state)) return;
+  axsys::CmmBuffer buf;
+  auto v = buf.Allocate(size_t{kDst} * kDst * 3, CacheMode::kCached,
+                        "bench_pre_tensor");
+  if (!v) {
+    state.SkipWithError(v.Message().c_str());
+    return;
+  }
+  axsys::CmmView view = v.MoveValue();
+  const axsys::TensorView tensor{&view, 0, kDst, kDst, 3,
+                                 axsys::TensorLayout::kChw,
+                                 axsys::TensorType::kI8};
+  axsys::QuantParams q;
+  q.zero_point = -128;
+  if (lut) {
+    for (int c = 0; c < 3; ++c) {
+      q.mean[c] = 114.0f;
+      q.scale[c] = 0.5f;
+    }
+    q.zero_point = 0;
+  }
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    (void)axsys::ToTensor(src.View(), tensor, q, threads);
+    benchmark::DoNotOptimize(view.Data());
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(axsys::PreprocessKernelName());
+  view.Reset();
+  (void)buf.Free();
+}
+BENCHMARK(BM_ToTensor)->Apply(QuantThreads)->UseManualTime();
+
+}  // namespace
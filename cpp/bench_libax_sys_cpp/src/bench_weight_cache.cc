@@ -0,0 +1,131 @@
+// Model startup: reading a weight file into CMM (cold load) against
+// importing the same weights from a resident WeightCache (attach). Both
+// touch every page of the weights once; sizes are 1, 16 and 64 MiB.
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "axsys/sys.hpp"
+#include "axsys/weight_cache.hpp"
+#include "latency.hpp"
+#include "temp_file.hpp"
+
+namespace {
+
+using axbench::Clock;
+using axbench::LatencySamples;
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+
+constexpr size_t kPage = 4096;
+
+void WeightSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"bytes"});
+  for (int64_t mib : {1, 16, 64}) b->Arg(mib << 20);
+}
+
+uint64_t TouchPages(const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  uint64_t sum = 0;
+  for (size_t off = 0; off < size; off += kPage) sum += p[off];
+  return sum;
+}
+
+// Allocate + read() the file + flush + touch + free: startup without the
+// cache. The file is dropped from the page cache where the filesystem
+// allows it (not on tmpfs), so on the board this includes the flash read.
+void BM_WeightColdLoad(benchmark::State& state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  const std::string path = axbench::MakeTempFile("weights", size);
+  if (path.empty()) {
+    state.SkipWithError("cannot write weight file");
+    return;
+  }
+  LatencySamples lat;
+  for (auto _ : state) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      state.SkipWithError("open failed");
+      break;
+    }
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    const Clock::time_point t0 = Clock::now();
+    CmmBuffer buf;
+    auto r = buf.Allocate(size, CacheMode::kCached, "bench");
+    if (!r) {
+      close(fd);
+      state.SkipWithError(r.Message().c_str());
+      break;
+    }
+    uint8_t* p = static_cast<uint8_t*>(r.Value().Data());
+    size_t done = 0;
+    while (done < size) {
+      const ssize_t n = read(fd, p + done, size - done);
+      if (n <= 0) break;
+      done += static_cast<size_t>(n);
+    }
+    (void)r.Value().Flush();
+    benchmark::DoNotOptimize(TouchPages(p, size));
+    r.Value().Reset();
+    (void)buf.Free();
+    const Clock::time_point t1 = Clock::now();
+    close(fd);
+    if (done != size) {
+      state.SkipWithError("short read");
+      break;
+    }
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  unlink(path.c_str());
+}
+BENCHMARK(BM_WeightColdLoad)->Apply(WeightSizes)->UseManualTime();
+
+// Connect + Import + touch + release against a resident WeightCache: the
+// startup a client sees once the daemon holds the weights.
+void BM_WeightAttach(benchmark::State& state) {
+  const size_t size = static_cast<size_t>(state.range(0));
+  const std::string path = axbench::MakeTempFile("weights", size);
+  if (path.empty()) {
+    state.SkipWithError("cannot write weight file");
+    return;
+  }
+  const std::string sock =
+      "/tmp/axbench_weights_" + std::to_string(getpid()) + ".sock";
+  axsys::WeightCache cache;
+  auto key = cache.Load(path.c_str());
+  unlink(path.c_str());
+  if (!key || !cache.Listen(sock.c_str())) {
+    state.SkipWithError("cannot start the weight cache");
+    return;
+  }
+  LatencySamples lat;
+  for (auto _ : state) {
+    const Clock::time_point t0 = Clock::now();
+    axsys::CmmImporter importer;
+    if (!importer.Connect(sock.c_str())) {
+      state.SkipWithError("connect failed");
+      break;
+    }
+    auto w = importer.Import(key.Value().c_str());
+    if (!w) {
+      state.SkipWithError(w.Message().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(TouchPages(w.Value().View().Data(), size));
+    w.Value().Release();
+    const Clock::time_point t1 = Clock::now();
+    lat.Add(state, t0, t1);
+  }
+  lat.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  cache.Close();
+}
+BENCHMARK(BM_WeightAttach)->Apply(WeightSizes)->UseManualTime();
+
+}  // namespace
@@ -0,0 +1,54 @@
+/**
+ * @file latency.hpp
+ * @brief Per-iteration latency samples reported as benchmark counters.
+ *
+ * google-benchmark reports the mean time per iteration. AX_SYS calls have
+ * long tails (page faults, CMM allocator walks), so every benchmark here
+ * times each iteration itself and also reports p50/p90/p99/max.
+ */
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace axbench {
+
+using Clock = std::chrono::steady_clock;
+
+class LatencySamples {
+ public:
+  /** @brief Record one timed iteration and hand it to the manual timer. */
+  void Add(benchmark::State& state, Clock::time_point start,
+           Clock::time_point stop) {
+    const std::chrono::duration<double> d = stop - start;
+    state.SetIterationTime(d.count());
+    ns_.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start)
+            .count());
+  }
+
+  /** @brief Set p50_ns, p90_ns, p99_ns and max_ns on @p state. */
+  void Report(benchmark::State& state) {
+    if (ns_.empty()) return;
+    std::sort(ns_.begin(), ns_.end());
+    state.counters["p50_ns"] = Percentile(50);
+    state.counters["p90_ns"] = Percentile(90);
+    state.counters["p99_ns"] = Percentile(99);
+    state.counters["max_ns"] = static_cast<double>(ns_.back());
+  }
+
+ private:
+  double Percentile(size_t p) const {
+    const size_t i = (ns_.size() - 1) * p / 100;
+    return static_cast<double>(ns_[i]);
+  }
+
+  std::vector<int64_t> ns_;
+};
+
+}  // namespace axbench
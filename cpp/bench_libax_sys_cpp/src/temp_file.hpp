@@ -0,0 +1,42 @@
+/**
+ * @file temp_file.hpp
+ * @brief Scratch files for the file loading benchmarks.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace axbench {
+
+/**
+ * @brief Write @p size bytes of a pattern to a new file under /tmp.
+ * @return Its path, or an empty string on failure. The caller unlinks it.
+ */
+inline std::string MakeTempFile(const char* tag, size_t size) {
+  const std::string path = "/tmp/axbench_" + std::string(tag) + "_" +
+                           std::to_string(getpid()) + "_" +
+                           std::to_string(size) + ".bin";
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) return std::string();
+  std::vector<uint8_t> chunk(1 << 20);
+  for (size_t i = 0; i < chunk.size(); ++i) {
+    chunk[i] = static_cast<uint8_t>(i * 131 + size);
+  }
+  bool ok = true;
+  for (size_t done = 0; ok && done < size; done += chunk.size()) {
+    const size_t n = std::min(chunk.size(), size - done);
+    ok = fwrite(chunk.data(), 1, n, f) == n;
+  }
+  ok = fclose(f) == 0 && ok;
+  if (!ok) unlink(path.c_str());
+  return ok ? path : std::string();
+}
+
+}  // namespace axbench
@@ -0,0 +1,204 @@
+// Extracts frames from an axsys capture file (see axsys/capture_file.hpp)
+// into one file per frame, using several threads. With -u, RAW10 packed
+// payloads are unpacked to 16-bit samples on the way out.
+
+// C system headers
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// C++ headers
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// libax_sys_cpp
+#include "axsys/capture_file.hpp"
+#include "axsys/raw_pack.hpp"
+
+namespace {
+
+struct Options {
+  const char* input = nullptr;
+  const char* outdir = ".";
+  unsigned threads = 0;
+  size_t first = 0;
+  size_t count = SIZE_MAX;
+  bool list = false;
+  bool unpack = false;
+};
+
+bool WriteFile(const std::string& path, const void* data, size_t size) {
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "open %s: %s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    const ssize_t n = write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      fprintf(stderr, "write %s: %s\n", path.c_str(), strerror(errno));
+      close(fd);
+      return false;
+    }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return close(fd) == 0;
+}
+
+void PrintUsage(const char* argv0) {
+  fprintf(stderr,
+          "Usage: %s [-j threads] [-f first] [-n count] [-u] [-l] "
+          "input [outdir]\n"
+          "\n"
+          "Options:\n"
+          "  -j N  Worker threads (default: number of CPUs)\n"
+          "  -f N  First frame index to extract (default 0)\n"
+          "  -n N  Number of frames to extract (default all)\n"
+          "  -u    Unpack RAW10 packed payloads to 16-bit samples\n"
+          "  -l    List stream info and frames only\n",
+          argv0);
+}
+
+bool ParseOptions(int argc, char* argv[], Options* o) {
+  int c = 0;
+  while ((c = getopt(argc, argv, "j:f:n:ulh")) != -1) {
+    switch (c) {
+      case 'j':
+        o->threads = static_cast<unsigned>(strtoul(optarg, nullptr, 10));
+        break;
+      case 'f':
+        o->first = strtoull(optarg, nullptr, 10);
+        break;
+      case 'n':
+        o->count = strtoull(optarg, nullptr, 10);
+        break;
+      case 'u':
+        o->unpack = true;
+        break;
+      case 'l':
+        o->list = true;
+        break;
+      default:
+        return false;
+    }
+  }
+  if (optind >= argc) return false;
+  o->input = argv[optind];
+  if (optind + 1 < argc) o->outdir = argv[optind + 1];
+  if (o->threads == 0) {
+    o->threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options opt;
+  if (!ParseOptions(argc, argv, &opt)) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+
+  axsys::CaptureReader reader;
+  auto r = reader.Open(opt.input);
+  if (!r) {
+    fprintf(stderr, "%s: %s\n", opt.input, r.Message().c_str());
+    return -1;
+  }
+  const axsys::CaptureStreamInfo& si = reader.Info();
+  printf("%s: %ux%u stride %u format 0x%x %u bpp%s fps %.3f frames %zu%s\n",
+         opt.input, si.width, si.height, si.stride,
+         static_cast<unsigned>(si.format), si.bits_per_pixel,
+         si.packed ? " packed" : "", si.fps_x1000 / 1000.0,
+         reader.FrameCount(), reader.Indexed() ? "" : " (no index, scanned)");
+
+  if (opt.list) {
+    for (size_t i = 0; i < reader.FrameCount(); ++i) {
+      const axsys::CaptureReader::Frame f = reader.GetFrame(i).Value();
+      printf("  #%zu seq %" PRIu64 " pts %" PRIu64 " size %" PRIu64 "\n", i,
+             f.seq, f.pts, f.size);
+    }
+    return 0;
+  }
+
+  if (opt.unpack && (si.packed == 0 || si.bits_per_pixel != 10)) {
+    fprintf(stderr, "-u requires a RAW10 packed stream\n");
+    return -1;
+  }
+  if (opt.unpack && si.stride < axsys::Raw10RowBytes(si.width)) {
+    fprintf(stderr, "stride %u is shorter than a RAW10 row of %u pixels\n",
+            si.stride, si.width);
+    return -1;
+  }
+  const size_t end =
+      opt.first + std::min(opt.count, reader.FrameCount() > opt.first
+                                          ? reader.FrameCount() - opt.first
+                                          : 0);
+
+  std::atomic<size_t> next{opt.first};
+  std::atomic<uint64_t> bytes_out{0};
+  std::atomic<bool> failed{false};
+  auto worker = [&] {
+    std::vector<uint16_t> samples;
+    for (size_t i = next.fetch_add(1); i < end && !failed.load();
+         i = next.fetch_add(1)) {
+      const axsys::CaptureReader::Frame f = reader.GetFrame(i).Value();
+      char name[96];
+      snprintf(name, sizeof(name), "/frame_%06zu_seq%" PRIu64 ".%s", i, f.seq,
+               opt.unpack ? "raw16" : "raw");
+      const std::string path = std::string(opt.outdir) + name;
+      const void* data = f.data;
+      size_t size = f.size;
+      if (opt.unpack) {
+        if (f.size < static_cast<uint64_t>(si.stride) * si.height) {
+          fprintf(stderr, "frame %zu: payload shorter than %ux%u\n", i,
+                  si.stride, si.height);
+          failed.store(true);
+          return;
+        }
+        samples.resize(static_cast<size_t>(si.width) * si.height);
+        axsys::UnpackRaw10Rows(f.data, si.stride, samples.data(),
+                               si.width * sizeof(uint16_t), si.width,
+                               si.height);
+        data = samples.data();
+        size = samples.size() * sizeof(uint16_t);
+      }
+      if (!WriteFile(path, data, size)) {
+        failed.store(true);
+        return;
+      }
+      bytes_out.fetch_add(size);
+    }
+  };
+
+  const auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < opt.threads; ++t) threads.emplace_back(worker);
+  worker();
+  for (auto& t : threads) t.join();
+  const double sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+          .count();
+
+  if (failed.load()) return -1;
+  const size_t extracted = end > opt.first ? end - opt.first : 0;
+  printf("extracted %zu frames (%.1f MiB) to %s in %.3f s with %u threads "
+         "(%.2f GB/s)\n",
+         extracted, static_cast<double>(bytes_out.load()) / (1024.0 * 1024.0),
+         opt.outdir, sec, opt.threads,
+         sec > 0 ? static_cast<double>(bytes_out.load()) / sec / 1e9 : 0.0);
+  return 0;
+}
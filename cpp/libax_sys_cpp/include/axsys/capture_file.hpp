@@ -0,0 +1,127 @@
+/**
+ * @file capture_file.hpp
+ * @brief Self-describing container for captured frame streams.
+ *
+ * Layout (little-endian, every block 64-byte aligned):
+ * - Stream header (64 bytes): magic "AXSYSCAP", version, geometry and
+ *   pixel format of the stream.
+ * - Frame records: 64-byte record header (sequence number, PTS, payload
+ *   size) followed by the payload, padded to 64 bytes.
+ * - Index: one 32-byte entry per frame (payload offset, size, seq, PTS).
+ * - Trailer (32 bytes, end of file): magic "AXCAPEND" and index offset.
+ *
+ * The writer only appends, so it works on pipes (e.g. stdout). Per frame
+ * it issues a single writev() of header, payload and padding and keeps
+ * 32 bytes of index in memory; the index and trailer are written on
+ * Close(). The reader maps the whole file and resolves frame i in O(1)
+ * through the index. Files without a trailer (writer killed, stream cut)
+ * are still readable: the reader rebuilds the index by walking records.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::CaptureStreamInfo si{3840, 2160, 4800, fmt, 10, 1, 20000};
+ * axsys::CaptureWriter w;
+ * if (!w.Open(STDOUT_FILENO, si)) return;
+ * w.Append(data, size, seq, pts);  // per frame
+ * w.Close();
+ *
+ * axsys::CaptureReader r;
+ * if (!r.Open("capture.axcap")) return;
+ * auto f = r.GetFrame(r.FrameCount() - 1);
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief Geometry and format recorded in the stream header. */
+struct CaptureStreamInfo {
+  uint32_t width;           ///< Pixels per row
+  uint32_t height;          ///< Rows per frame
+  uint32_t stride;          ///< Bytes per row in the payload
+  int32_t format;           ///< Source pixel format (e.g. AX_IMG_FORMAT_E)
+  uint32_t bits_per_pixel;  ///< Significant bits per sample (e.g. 10)
+  uint32_t packed;          ///< 1 if samples are bit-packed (RAW10 packed)
+  uint32_t fps_x1000;       ///< Nominal frame rate * 1000, 0 if unknown
+};
+
+class CaptureWriter {
+ public:
+  CaptureWriter();
+  CaptureWriter(const CaptureWriter&) = delete;
+  CaptureWriter& operator=(const CaptureWriter&) = delete;
+  /** @brief Calls Close(); errors are logged, not reported. */
+  ~CaptureWriter();
+
+  /**
+   * @brief Start a stream on an already open descriptor (file or pipe).
+   * @note The descriptor is not closed by the writer.
+   */
+  Result<void> Open(int fd, const CaptureStreamInfo& info);
+  /** @brief Create or truncate @p path and start a stream in it. */
+  Result<void> Open(const char* path, const CaptureStreamInfo& info);
+
+  /**
+   * @brief Append one frame record.
+   * @return kNotInitialized when not open, kSystemCallFailed on I/O error.
+   */
+  Result<void> Append(const void* data, size_t size, uint64_t seq,
+                      uint64_t pts);
+
+  /** @brief Write index and trailer and finish the stream. Idempotent. */
+  Result<void> Close();
+
+  uint64_t FrameCount() const;
+  /** @brief Bytes written so far, including headers and padding. */
+  uint64_t BytesWritten() const;
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+class CaptureReader {
+ public:
+  struct Frame {
+    const uint8_t* data;  ///< Payload inside the read-only mapping
+    uint64_t size;
+    uint64_t seq;
+    uint64_t pts;
+  };
+
+  CaptureReader();
+  CaptureReader(const CaptureReader&) = delete;
+  CaptureReader& operator=(const CaptureReader&) = delete;
+  ~CaptureReader();
+
+  /**
+   * @brief Map @p path and load its index.
+   * @return kSystemCallFailed if the file cannot be opened or mapped,
+   *         kInvalidArgument if it is not a capture file.
+   */
+  Result<void> Open(const char* path);
+  /** @brief Unmap the file; Frame pointers become invalid. */
+  void Close();
+
+  const CaptureStreamInfo& Info() const;
+  size_t FrameCount() const;
+  /** @brief True when the trailing index was used (no record scan). */
+  bool Indexed() const;
+
+  /**
+   * @brief Frame @p index in file order. O(1); safe from many threads.
+   * @return kOutOfRange for a bad index, kNotInitialized when not open.
+   */
+  Result<Frame> GetFrame(size_t index) const;
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
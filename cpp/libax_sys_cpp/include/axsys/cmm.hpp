@@ -41,7 +41,8 @@
  * (void)buf.Free();
  * @endcode
  *
- * @warning Free()/DetachExternal() fail while views are still alive.
+ * @warning Free()/DetachExternal() fail while views are still alive;
+ *          Retire() defers the release instead (axsys/epoch.hpp).
  * @note MapView* size is limited to 4 GiB by underlying AX_SYS APIs.
  */
 #pragma once
@@ -58,7 +59,8 @@ namespace axsys {
 
 enum class CacheMode { kNonCached = 0, kCached = 1 };
 
-class CmmBuffer;  // fwd
+class CmmBuffer;    // fwd
+class EpochDomain;  // fwd, axsys/epoch.hpp
 
 /**
  * @brief A mapped view into a CMM allocation.
@@ -127,7 +129,7 @@ class CmmView {
 
   /** @name Diagnostics */
   ///@{
-  /** @brief Physical address at the beginning of the allocation. */
+  /** @brief Physical address of the first byte of this view. */
   uint64_t Phys() const;
   /** @brief Offset (bytes) of this view within its allocation. */
   size_t Offset() const;
@@ -160,6 +162,17 @@ class CmmBuffer {
    */
   Result<CmmView> Allocate(size_t size, CacheMode mode, const char* token);
 
+  /**
+   * @brief Allocate(), waiting in FIFO order while CMM or the CmmBudget
+   *        is exhausted (see cmm_budget.hpp).
+   * @param timeout_ms Maximum wait; negative waits forever, 0 is Allocate().
+   * @return kTimeout when nothing was freed in time; kInvalidArgument
+   *         when @p size exceeds the limit or the token's quota; other
+   *         errors of Allocate() are returned at once.
+   */
+  Result<CmmView> AllocateWait(size_t size, CacheMode mode, const char* token,
+                               int64_t timeout_ms);
+
   /**
    * @brief Free an owned allocation.
    * @return Result<void> error if not owned, not allocated, or views remain.
@@ -167,6 +180,16 @@ class CmmBuffer {
    */
   Result<void> Free();
 
+  /**
+   * @brief Hand the allocation to @p domain, which drops it once no
+   *        critical section can still see it; the block is freed (or
+   *        detached) with its last view. This buffer is left empty.
+   * @param view A view of this buffer that readers use, reset first.
+   * @return kInvalidArgument for a null domain, kNoAllocation.
+   * @sa EpochDomain::Retire()
+   */
+  Result<void> Retire(EpochDomain* domain, CmmView&& view = CmmView());
+
   /**
    * @brief Attach to an external (non-owned) physical range.
    * @param phys Physical address of the external range.
@@ -223,6 +246,14 @@ class CmmBuffer {
   };
   static bool MemQueryStatus(CmmStatus* out);
 
+  /**
+   * @brief Largest free region of a partition (default "anonymous").
+   * @param phys,size Start and length of the region.
+   * @return false if the partition is unknown or the query failed.
+   */
+  static bool MaxFreeRegion(const char* partition, uint64_t* phys,
+                            uint32_t* size);
+
  private:
   friend class CmmView;
   struct Impl;  // internal
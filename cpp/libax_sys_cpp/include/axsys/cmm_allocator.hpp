@@ -0,0 +1,255 @@
+/**
+ * @file cmm_allocator.hpp
+ * @brief CMM sub-allocator, STL allocator and a growable CMM vector.
+ *
+ * Preprocessing code that fills a std::vector on the heap and then copies
+ * it into a CmmBuffer pays for the copy on every frame. Building the data
+ * in CMM directly removes it, but one AX_SYS_MemAlloc per small container
+ * is far too slow. CmmArena carves blocks out of large CMM chunks:
+ *
+ * - Requests up to chunk_size / 4 are rounded up to a power of two (at
+ *   least 64 bytes) and served from per-size free lists, refilled from
+ *   the current chunk. Blocks are aligned to their size, up to 4 KiB.
+ * - Larger requests get their own CmmBuffer and are freed on release.
+ * - Phys() maps any pointer inside a block to its physical address.
+ *
+ * CmmAllocator<T> plugs an arena into standard containers. CmmVector<T>
+ * is a vector of trivially copyable elements that grows geometrically
+ * inside an arena and exposes Phys(), Flush() and Invalidate(); after
+ * reserve() it never reallocates until the reserved size is exceeded,
+ * and TryPushBack() never reallocates at all.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::CmmVector<float> input;      // CmmArena::Default(), cached
+ * input.reserve(3 * 224 * 224);       // once, outside the frame loop
+ * for (...) {
+ *   input.clear();
+ *   for (...) input.push_back(normalize(px));
+ *   (void)input.Flush();
+ *   npu_run(input.Phys(), input.size() * sizeof(float));
+ * }
+ * std::vector<int, axsys::CmmAllocator<int>> ids;  // also in CMM
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+struct CmmArenaOptions {
+  CacheMode mode = CacheMode::kCached;
+  size_t chunk_size = 1 << 20;  ///< Rounded up to 4 KiB
+  const char* token = "cmm_arena";
+};
+
+struct CmmArenaStats {
+  uint64_t chunks;          ///< Chunks allocated from CMM
+  uint64_t large_blocks;    ///< Live blocks with their own CmmBuffer
+  uint64_t mem_allocs;      ///< CmmBuffer::Allocate() calls so far
+  uint64_t bytes_reserved;  ///< CMM held: chunks + large blocks
+  uint64_t bytes_in_use;    ///< Rounded sizes of live blocks
+};
+
+/**
+ * @brief Thread-safe CMM sub-allocator. Chunks are kept until the arena
+ *        is destroyed; every block must be released before that.
+ */
+class CmmArena {
+ public:
+  explicit CmmArena(const CmmArenaOptions& options = CmmArenaOptions());
+  CmmArena(const CmmArena&) = delete;
+  CmmArena& operator=(const CmmArena&) = delete;
+  ~CmmArena();
+
+  /**
+   * @brief Block of at least @p size bytes aligned to @p alignment (a
+   *        power of two up to 4096); nullptr if CMM is exhausted.
+   */
+  void* Allocate(size_t size, size_t alignment = alignof(max_align_t));
+  /** @brief Return a block with the size and alignment it was taken with. */
+  void Deallocate(void* p, size_t size,
+                  size_t alignment = alignof(max_align_t));
+
+  /** @brief Physical address of @p p; 0 if it is not in the arena. */
+  uint64_t Phys(const void* p) const;
+  /** @brief Cache maintenance of [p, p+size) inside one block. */
+  Result<void> Flush(const void* p, size_t size) const;
+  Result<void> Invalidate(const void* p, size_t size) const;
+
+  CacheMode Mode() const;
+  CmmArenaStats Stats() const;
+
+  /** @brief Process-wide arena with default options. */
+  static CmmArena& Default();
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+/** @brief Standard allocator drawing from a CmmArena. */
+template <typename T>
+class CmmAllocator {
+ public:
+  using value_type = T;
+
+  CmmAllocator() noexcept : arena_(&CmmArena::Default()) {}
+  explicit CmmAllocator(CmmArena* arena) noexcept : arena_(arena) {}
+  template <typename U>
+  CmmAllocator(const CmmAllocator<U>& other) noexcept  // NOLINT
+      : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    if (n > SIZE_MAX / sizeof(T)) throw std::bad_alloc();
+    void* p = arena_->Allocate(n * sizeof(T), alignof(T));
+    if (!p) throw std::bad_alloc();
+    return static_cast<T*>(p);
+  }
+  void deallocate(T* p, size_t n) noexcept {
+    arena_->Deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  CmmArena* arena() const noexcept { return arena_; }
+
+ private:
+  CmmArena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const CmmAllocator<T>& a, const CmmAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+template <typename T, typename U>
+bool operator!=(const CmmAllocator<T>& a, const CmmAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
+/**
+ * @brief Contiguous, growable array of trivially copyable @p T in CMM.
+ *
+ * The std::vector subset uses std::vector names; growth doubles the
+ * capacity and throws std::bad_alloc when CMM is exhausted. Pointers and
+ * Phys() change only when the vector reallocates.
+ */
+template <typename T>
+class CmmVector {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "CmmVector elements must be trivially copyable");
+
+ public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  CmmVector() noexcept : alloc_() {}
+  explicit CmmVector(CmmArena* arena) noexcept : alloc_(arena) {}
+  CmmVector(const CmmVector&) = delete;
+  CmmVector& operator=(const CmmVector&) = delete;
+  CmmVector(CmmVector&& other) noexcept
+      : alloc_(other.alloc_),
+        data_(other.data_),
+        size_(other.size_),
+        capacity_(other.capacity_) {
+    other.data_ = nullptr;
+    other.size_ = other.capacity_ = 0;
+  }
+  CmmVector& operator=(CmmVector&& other) noexcept {
+    if (this != &other) {
+      Release();
+      alloc_ = other.alloc_;
+      data_ = other.data_;
+      size_ = other.size_;
+      capacity_ = other.capacity_;
+      other.data_ = nullptr;
+      other.size_ = other.capacity_ = 0;
+    }
+    return *this;
+  }
+  ~CmmVector() { Release(); }
+
+  T* data() noexcept { return data_; }
+  const T* data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+  size_t capacity() const noexcept { return capacity_; }
+  bool empty() const noexcept { return size_ == 0; }
+  T& operator[](size_t i) noexcept { return data_[i]; }
+  const T& operator[](size_t i) const noexcept { return data_[i]; }
+  iterator begin() noexcept { return data_; }
+  iterator end() noexcept { return data_ + size_; }
+  const_iterator begin() const noexcept { return data_; }
+  const_iterator end() const noexcept { return data_ + size_; }
+
+  /** @brief Allocate room for @p n elements now, if not there yet. */
+  void reserve(size_t n) {
+    if (n > capacity_) Reallocate(n);
+  }
+  void resize(size_t n) {
+    reserve(n);
+    if (n > size_) {
+      memset(static_cast<void*>(data_ + size_), 0, (n - size_) * sizeof(T));
+    }
+    size_ = n;
+  }
+  void clear() noexcept { size_ = 0; }
+  void push_back(const T& v) {
+    if (size_ == capacity_) {
+      const T copy = v;  // v may live in the old block
+      Reallocate(capacity_ ? 2 * capacity_ : 16);
+      data_[size_++] = copy;
+      return;
+    }
+    data_[size_++] = v;
+  }
+  void pop_back() noexcept { --size_; }
+
+  /** @brief push_back() without growth: false when the vector is full. */
+  bool TryPushBack(const T& v) noexcept {
+    if (size_ == capacity_) return false;
+    data_[size_++] = v;
+    return true;
+  }
+
+  /** @brief Physical address of data(); 0 while nothing is allocated. */
+  uint64_t Phys() const { return data_ ? alloc_.arena()->Phys(data_) : 0; }
+  /** @brief Flush/invalidate the first size() elements. */
+  Result<void> Flush() const {
+    if (!data_ || size_ == 0) return Result<void>::Ok();
+    return alloc_.arena()->Flush(data_, size_ * sizeof(T));
+  }
+  Result<void> Invalidate() const {
+    if (!data_ || size_ == 0) return Result<void>::Ok();
+    return alloc_.arena()->Invalidate(data_, size_ * sizeof(T));
+  }
+
+ private:
+  void Reallocate(size_t n) {
+    T* p = alloc_.allocate(n);
+    if (size_ > 0) memcpy(static_cast<void*>(p), data_, size_ * sizeof(T));
+    if (data_) alloc_.deallocate(data_, capacity_);
+    data_ = p;
+    capacity_ = n;
+  }
+  void Release() noexcept {
+    if (data_) alloc_.deallocate(data_, capacity_);
+    data_ = nullptr;
+    size_ = capacity_ = 0;
+  }
+
+  CmmAllocator<T> alloc_;
+  T* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+}  // namespace axsys
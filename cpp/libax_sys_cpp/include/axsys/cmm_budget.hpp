@@ -0,0 +1,118 @@
+/**
+ * @file cmm_budget.hpp
+ * @brief Process-wide CMM budget with per-token quotas.
+ *
+ * Every CmmBuffer::Allocate() charges its requested size to the process
+ * budget and to the quota of its token; the charge is returned when the
+ * block is freed (Free() or the last view going away). An allocation that
+ * would exceed either fails with kAllocationFailed before AX_SYS is
+ * called. Without a limit or quota nothing is refused, but the charges are
+ * still counted, with atomics only: the budget lock is taken only once a
+ * limit or quota is set (and on a token's first allocation).
+ *
+ * CmmBuffer::AllocateWait() blocks instead of failing: callers queue in
+ * FIFO order and the head of the queue retries each time a block is
+ * freed in this process (and every 10 ms, for memory freed by other
+ * processes), so stages no longer busy-retry when CMM or the budget is
+ * exhausted. A caller waiting for its own token's quota does not hold up
+ * callers of other tokens queued behind it, and a request larger than the
+ * limit or its quota fails at once with kInvalidArgument.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::CmmBudget::SetLimit(48u << 20);                  // 48 MiB
+ * axsys::CmmBudget::SetTokenQuota("npu_input", 16u << 20);
+ *
+ * axsys::CmmBuffer buf;
+ * auto v = buf.AllocateWait(4u << 20, axsys::CacheMode::kNonCached,
+ *                           "npu_input", 100);  // up to 100 ms
+ * if (!v && v.Code() == axsys::ErrorCode::kTimeout) { ... }
+ *
+ * auto s = axsys::CmmBudget::Stats();
+ * printf("p99 wait %" PRIu64 " ns\n", s.WaitPercentileNs(0.99));
+ * @endcode
+ *
+ * @note Charges are requested sizes; the driver rounds blocks up to 4 KiB.
+ * @note An allocation racing with the first SetLimit() or SetTokenQuota()
+ *       may be charged without being checked.
+ * @note Allocate() does not queue: it may take memory freed for the head
+ *       of the AllocateWait() queue.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "axsys/cmm_stats.hpp"
+
+namespace axsys {
+
+/** @brief Quota and charge of one token. */
+struct CmmTokenBudget {
+  std::string token;       ///< "" for nullptr
+  uint64_t quota_bytes;    ///< 0 = no quota
+  uint64_t charged_bytes;  ///< Live bytes charged to the token
+};
+
+/** @brief Budget state and AllocateWait() statistics. */
+struct CmmBudgetStats {
+  uint64_t limit_bytes;    ///< 0 = no limit
+  uint64_t charged_bytes;  ///< Live bytes charged to the process
+  uint32_t waiting;        ///< Callers queued in AllocateWait()
+  uint64_t waits;          ///< Completed AllocateWait() calls
+  uint64_t timeouts;       ///< Of those, calls that returned kTimeout
+  /** Time spent in AllocateWait(); bucket i counts [2^i, 2^(i+1)) ns. */
+  uint64_t wait_latency[kCmmLatencyBuckets];
+  std::vector<CmmTokenBudget> tokens;  ///< Tokens charged or given a quota
+
+  /**
+   * @brief Upper bound of the bucket holding quantile @p q (0..1).
+   * @return 0 when no wait was recorded.
+   */
+  uint64_t WaitPercentileNs(double q) const;
+
+  /** @brief Entry for @p token, or nullptr. */
+  const CmmTokenBudget* Find(const char* token) const;
+};
+
+/**
+ * @brief Process-wide CMM budget. All members are static.
+ */
+class CmmBudget {
+ public:
+  CmmBudget() = delete;
+
+  /**
+   * @brief Limit the bytes charged by all tokens together; 0 removes the
+   *        limit. Lowering it below the current charge only blocks new
+   *        allocations.
+   */
+  static void SetLimit(uint64_t bytes);
+
+  /** @brief Limit the bytes charged to @p token; 0 removes the quota. */
+  static void SetTokenQuota(const char* token, uint64_t bytes);
+
+  /** @brief Current limits, charges and wait statistics. */
+  static CmmBudgetStats Stats();
+};
+
+namespace detail {
+
+/**
+ * Charge @p bytes to the budget and @p c's quota. @p token names @p c.
+ * @return false (nothing charged) when the limit or quota would be
+ *         exceeded.
+ */
+bool ChargeCmmBudget(CmmTokenCounters* c, const char* token, uint64_t bytes);
+
+/**
+ * Return a charge. @p freed wakes AllocateWait() callers; pass false when
+ * undoing the charge of an allocation that failed.
+ */
+void ReleaseCmmBudget(CmmTokenCounters* c, uint64_t bytes, bool freed);
+
+}  // namespace detail
+
+}  // namespace axsys
@@ -0,0 +1,155 @@
+/**
+ * @file cmm_info.hpp
+ * @brief Structured model of /proc/ax_proc/mem_cmm_info and CMM
+ *        fragmentation analysis.
+ *
+ * The CMM driver lists every partition and every allocated block in
+ * /proc/ax_proc/mem_cmm_info:
+ *
+ * @code
+ * +---PARTITION: Phys(0x80000000, 0xBFFFFFFF), Size=1048576KB(1024MB),
+ *     NAME="anonymous"
+ *    |-Block: phys(0x80000000, 0x80003FFF), cache =non-cacheable,
+ *     length=16KB(0MB),    name="vin_raw"
+ * ---CMM_USE_INFO:
+ *  total size=1048576KB(1024MB),used=16KB(0MB + 16KB),remain=...,
+ *  partition_number=1,block_number=1
+ * @endcode
+ * (each entry is a single line in the file)
+ *
+ * CmmInfoParser turns that text into a CmmLayout: the blocks of each
+ * partition sorted by address, the free extents between them, the
+ * largest free extent, a histogram of free extent sizes and a
+ * fragmentation figure. MergeMaxFreeRegion() adds what
+ * AX_SYS_MemGetMaxFreeRegionInfo reports for each partition.
+ *
+ * The parser is fed in chunks (no need to hold the whole file) and keeps
+ * its buffers between runs, so polling a steady system at 10 Hz does not
+ * allocate after the first read.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::CmmInfoParser parser;
+ * if (parser.ReadProc() && parser.MergeMaxFreeRegion()) {
+ *   for (const auto& p : parser.Layout().partitions) {
+ *     printf("%s: free %" PRIu64 " KiB, largest %" PRIu64
+ *            " KiB, fragmentation %.2f\n", p.name, p.free_bytes >> 10,
+ *            p.largest_free >> 10, p.fragmentation);
+ *   }
+ * }
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief Default location of the CMM driver's block list. */
+constexpr const char* kCmmInfoPath = "/proc/ax_proc/mem_cmm_info";
+
+/**
+ * @brief Free extent histogram buckets. Bucket i counts extents of
+ *        [4 KiB << i, 4 KiB << (i + 1)); the first also takes smaller
+ *        ones and the last larger ones.
+ */
+constexpr size_t kCmmFreeBuckets = 20;
+
+/** @brief One allocated block. */
+struct CmmBlock {
+  uint64_t phys;
+  uint64_t size;
+  bool cached;
+  char name[32];  ///< Allocation token, truncated
+};
+
+/** @brief One partition with its blocks and derived free-space figures. */
+struct CmmPartitionLayout {
+  char name[32];
+  uint64_t phys;
+  uint64_t size;
+  std::vector<CmmBlock> blocks;  ///< Sorted by phys
+
+  uint64_t used_bytes;         ///< Sum of block sizes
+  uint64_t free_bytes;         ///< size - used_bytes
+  uint32_t free_extents;       ///< Gaps between blocks and partition ends
+  uint64_t largest_free;       ///< Largest gap
+  uint64_t largest_free_phys;  ///< Start of that gap
+  uint32_t free_histogram[kCmmFreeBuckets];
+  /** 1 - largest_free / free_bytes: 0 when all free space is one extent,
+   *  approaching 1 as it is scattered. 0 when nothing is free. */
+  double fragmentation;
+
+  /** Set by MergeMaxFreeRegion() from AX_SYS_MemGetMaxFreeRegionInfo. */
+  bool has_max_free_region;
+  uint64_t max_free_region_phys;
+  uint64_t max_free_region_size;
+};
+
+/** @brief Parsed mem_cmm_info. */
+struct CmmLayout {
+  std::vector<CmmPartitionLayout> partitions;
+
+  /** Totals from the CMM_USE_INFO line; has_totals is false without it. */
+  bool has_totals;
+  uint64_t total_kb;
+  uint64_t used_kb;
+  uint64_t remain_kb;
+  uint32_t partition_number;
+  uint32_t block_number;
+
+  /** @brief Partition named @p name, or nullptr. */
+  const CmmPartitionLayout* Find(const char* name) const;
+};
+
+/**
+ * @brief Incremental mem_cmm_info parser. Reuse one instance for polling.
+ *
+ * Lines it does not recognise (version banner, per-partition counters)
+ * are skipped; lines longer than 512 bytes are ignored.
+ */
+class CmmInfoParser {
+ public:
+  CmmInfoParser();
+
+  /** @brief Start a new document; the previous layout is discarded. */
+  void Begin();
+
+  /** @brief Parse @p len bytes; chunks may split lines anywhere. */
+  void Feed(const char* data, size_t len);
+
+  /**
+   * @brief Finish the document and compute the free-space figures.
+   * @return kInvalidArgument if no partition line was found.
+   */
+  Result<void> End();
+
+  /**
+   * @brief Begin(), read @p path in 4 KiB chunks, End().
+   * @return kSystemCallFailed if the file cannot be opened, else End().
+   */
+  Result<void> ReadProc(const char* path = kCmmInfoPath);
+
+  /**
+   * @brief Query AX_SYS_MemGetMaxFreeRegionInfo for every partition.
+   * @return kSystemCallFailed if any query fails (others are still set).
+   */
+  Result<void> MergeMaxFreeRegion();
+
+  const CmmLayout& Layout() const { return layout_; }
+
+ private:
+  void ParseLine(const char* line);
+  size_t partitions_used_;  // layout_.partitions beyond this are stale
+  CmmLayout layout_;
+  char line_[512];
+  size_t line_len_;
+  bool line_overflow_;
+};
+
+}  // namespace axsys
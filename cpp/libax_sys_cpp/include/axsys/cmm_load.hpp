@@ -0,0 +1,61 @@
+/**
+ * @file cmm_load.hpp
+ * @brief Streaming loader from a file into a new CMM buffer.
+ *
+ * LoadFileToCmm() reads the file in chunks on a helper thread while the
+ * calling thread finishes the previous chunk, so the disk read overlaps
+ * the copy, the cache flush and the checksum:
+ *
+ * - Cached destination: chunks are read straight into the buffer's
+ *   mapping; the caller flushes (and hashes) chunk n while chunk n + 1 is
+ *   read.
+ * - Non-cached destination, or direct_io: chunks are read into two cached
+ *   staging chunks on the heap and copied into the mapping, so the kernel
+ *   never writes through the uncached mapping and O_DIRECT gets aligned
+ *   buffers.
+ *
+ * The kernel is told the access is sequential and the chunk after next is
+ * prefetched with POSIX_FADV_WILLNEED.
+ *
+ * Usage example
+ * @code{.cpp}
+ * uint64_t sum = 0;
+ * axsys::CmmLoadOptions opt;
+ * opt.token = "model";
+ * opt.checksum = &sum;
+ * auto r = axsys::LoadFileToCmm("/opt/models/yolo.axmodel",
+ *                               axsys::CacheMode::kNonCached, opt);
+ * if (!r) { fprintf(stderr, "%s\n", r.Message().c_str()); return; }
+ * axsys::CmmBuffer model = r.MoveValue();  // ready for the NPU
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+struct CmmLoadOptions {
+  const char* token = "load";   ///< CMM token of the new buffer
+  size_t chunk_size = 4 << 20;  ///< Rounded up to 4 KiB
+  bool direct_io = false;       ///< O_DIRECT; buffered if unsupported
+  /** If set, receives the WeightHasher digest of the file contents. */
+  uint64_t* checksum = nullptr;
+};
+
+/**
+ * @brief Allocate a buffer of the file's size and fill it from @p path.
+ * @return The buffer with no views alive; kInvalidArgument for an empty
+ *         file or a chunk_size of 0, kSystemCallFailed for open/read
+ *         errors or a file that shrinks while loading, allocation and
+ *         flush errors from CmmBuffer.
+ */
+Result<CmmBuffer> LoadFileToCmm(const char* path, CacheMode mode,
+                                const CmmLoadOptions& options =
+                                    CmmLoadOptions());
+
+}  // namespace axsys
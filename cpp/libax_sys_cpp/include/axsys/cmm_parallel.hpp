@@ -0,0 +1,105 @@
+/**
+ * @file cmm_parallel.hpp
+ * @brief Fill one CmmView from several threads with aligned slices.
+ *
+ * Splitting a large cached view between worker threads by hand tends to
+ * put a partition boundary in the middle of a cache line, so two cores
+ * write the same line (false sharing) and both flush it, or to flush the
+ * whole view once more after the workers are done. ParallelFor() cuts
+ * the range at cache-line (or page) boundaries of the mapping, runs the
+ * kernel on every slice in parallel, and has each worker flush exactly
+ * its own slice right after filling it, while the data is still hot and
+ * in parallel with the other workers.
+ *
+ * The workers come from a process-wide pool started on first use, so a
+ * call costs a wake-up rather than a thread creation per slice.
+ * RunTasks() exposes the pool to other multi-threaded kernels.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::ParallelOptions opt;
+ * opt.threads = 4;
+ * auto r = axsys::ParallelFor(&view, [](const axsys::CmmSlice& s) {
+ *   FillTile(s.data, s.offset, s.size);
+ * }, opt);
+ * if (!r) fprintf(stderr, "%s\n", r.Message().c_str());
+ * @endcode
+ *
+ * @note Slices are contiguous byte ranges; a kernel filling rows derives
+ *       them from CmmSlice::offset. Only the range's first and last line
+ *       can be shared with bytes outside it.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+enum class SliceAlign { kCacheLine = 0, kPage = 1 };
+
+struct ParallelOptions {
+  unsigned threads = 0;  ///< Workers; 0 = std::thread::hardware_concurrency()
+  SliceAlign align = SliceAlign::kCacheLine;
+  size_t min_slice = 64 << 10;  ///< Fewer workers for smaller ranges
+  bool flush = true;            ///< Flush each slice (cached views only)
+};
+
+/** @brief One worker's part of the range. */
+struct CmmSlice {
+  uint8_t* data;  ///< First byte of the slice
+  size_t offset;  ///< Offset of @c data within the view
+  size_t size;
+  unsigned index;  ///< Worker index, 0 runs on the calling thread
+};
+
+using SliceKernel = std::function<void(const CmmSlice&)>;
+
+/**
+ * @brief Run task(i) for every i in [0, count): task 0 on the calling
+ *        thread, the others on the worker pool, which grows to count - 1
+ *        threads, at most hardware_concurrency(), and keeps them for
+ *        later calls. Tasks beyond the pool wait for a free worker.
+ *        Returns when all tasks are done.
+ * @note While waiting, the caller runs tasks of its own call that no
+ *       worker has picked up yet, so a task may call RunTasks() itself.
+ */
+void RunTasks(unsigned count, const std::function<void(unsigned)>& task);
+
+/**
+ * @brief Cut [offset, offset+size) of @p view into at most
+ *        options.threads slices whose inner boundaries lie on
+ *        options.align boundaries of the mapping. Empty slices are
+ *        dropped; an invalid range gives no slices.
+ */
+std::vector<CmmSlice> PartitionView(const CmmView& view, size_t offset,
+                                    size_t size,
+                                    const ParallelOptions& options =
+                                        ParallelOptions());
+
+/**
+ * @brief Run @p kernel on every slice of PartitionView() with RunTasks()
+ *        (slice 0 on the calling thread), each worker flushing its own
+ *        slice after the kernel returns.
+ * @param size Bytes from @p offset; SIZE_MAX means till end of view.
+ * @return kInvalidArgument for an unmapped view or empty kernel,
+ *         kOutOfRange for a range outside the view, the first flush
+ *         error of any worker.
+ * @note Blocks until every worker is done. Nothing else may use @p view
+ *       meanwhile.
+ */
+Result<void> ParallelFor(CmmView* view, size_t offset, size_t size,
+                         const SliceKernel& kernel,
+                         const ParallelOptions& options = ParallelOptions());
+
+/** @brief ParallelFor() over the whole view. */
+Result<void> ParallelFor(CmmView* view, const SliceKernel& kernel,
+                         const ParallelOptions& options = ParallelOptions());
+
+}  // namespace axsys
@@ -0,0 +1,118 @@
+/**
+ * @file cmm_ring.hpp
+ * @brief Byte ring buffer in CMM, mapped twice so no span ever wraps.
+ *
+ * A streaming consumer of a circular buffer (file writer, network sender)
+ * has to split every record that crosses the end of the buffer, or copy
+ * it out first. CmmRing maps the same memory twice at adjacent virtual
+ * addresses: byte `capacity + i` is byte `i`, so every span of up to
+ * `capacity` bytes starting anywhere in the first mapping is contiguous.
+ *
+ * Backing
+ * - kSysmap (board): a CmmBuffer supplies the physical range, which is
+ *   mapped twice through `/dev/ax_sysmap` with MAP_FIXED into one
+ *   reserved address range (O_SYNC for non-cached).
+ * - kMemfd (host stand-in): a memfd mapped the same way; Phys() is 0 and
+ *   Flush()/Invalidate() do nothing.
+ *
+ * Cursors: one producer thread calls Reserve()/Commit(), one consumer
+ * thread calls Peek()/Consume(). Both are wait-free (two cursors, each
+ * written by one side).
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::CmmRing ring;
+ * if (!ring.Create(4 << 20)) return;
+ * // producer
+ * if (void* p = ring.Reserve(len)) {
+ *   fill(p, len);
+ *   (void)ring.Flush(p, len);
+ *   ring.Commit(len);
+ * }
+ * // consumer
+ * size_t avail = 0;
+ * if (const void* p = ring.Peek(&avail)) {
+ *   send(p, avail);  // one span even across the end of the buffer
+ *   ring.Consume(avail);
+ * }
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+enum class CmmRingBacking { kSysmap = 0, kMemfd = 1 };
+
+struct CmmRingOptions {
+  CacheMode mode = CacheMode::kCached;
+  CmmRingBacking backing = CmmRingBacking::kSysmap;
+  const char* token = "ring";  ///< CmmBuffer token (kSysmap)
+  const char* device = "/dev/ax_sysmap";
+};
+
+class CmmRing {
+ public:
+  CmmRing();
+  CmmRing(const CmmRing&) = delete;
+  CmmRing& operator=(const CmmRing&) = delete;
+  ~CmmRing();
+
+  /**
+   * @brief Allocate and double-map @p capacity bytes (a multiple of the
+   *        page size).
+   * @return kInvalidArgument, kAlreadyInitialized, CmmBuffer::Allocate()
+   *         errors, kSystemCallFailed (open, memfd_create, mmap).
+   */
+  Result<void> Create(size_t capacity,
+                      const CmmRingOptions& options = CmmRingOptions());
+
+  /** @brief Unmap and free. Not thread-safe with the cursor calls. */
+  Result<void> Destroy();
+
+  size_t Capacity() const;
+  /** @brief Start of the first mapping; 2 * Capacity() bytes are mapped. */
+  void* Data() const;
+  /** @brief Physical address of @p p (either mapping); 0 for kMemfd. */
+  uint64_t PhysOf(const void* p) const;
+
+  /** @name Producer */
+  ///@{
+  /** @brief @p size contiguous bytes to fill, or nullptr if not free. */
+  void* Reserve(size_t size);
+  /** @brief Publish @p size bytes written at the last Reserve(). */
+  void Commit(size_t size);
+  size_t Writable() const;
+  ///@}
+
+  /** @name Consumer */
+  ///@{
+  /**
+   * @brief Every committed, unconsumed byte as one span.
+   * @param size Receives the span length; nullptr is returned when 0.
+   */
+  const void* Peek(size_t* size) const;
+  void Consume(size_t size);
+  size_t Readable() const;
+  ///@}
+
+  /**
+   * @brief Flush/invalidate the record at [p, p+size) in either mapping,
+   *        e.g. before a device reads it or after a device wrote it.
+   * @return kOutOfRange if the span is not inside the ring; Ok without
+   *         work for kMemfd and non-cached rings.
+   */
+  Result<void> Flush(const void* p, size_t size) const;
+  Result<void> Invalidate(const void* p, size_t size) const;
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
@@ -0,0 +1,120 @@
+/**
+ * @file cmm_sg.hpp
+ * @brief Scatter-gather CMM buffers built from several contiguous blocks.
+ *
+ * After hours of uptime one AX_SYS_MemAlloc of tens of MiB can fail while
+ * MemQueryStatus still reports plenty of free CMM: no free extent is long
+ * enough. CmmSgBuffer::Allocate() first asks for one block like
+ * CmmBuffer::Allocate(); when that fails it builds the buffer from
+ * smaller blocks, starting at the largest free region and halving down to
+ * `min_segment`. Consumers that can DMA from a segment list (phys, virt,
+ * size) use Segments(); everything else goes through the segment-aware
+ * copy, flush and invalidate helpers, which take offsets into the logical
+ * buffer.
+ *
+ * Counters() reports how often the fallback was needed.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::CmmSgBuffer sg;
+ * if (!sg.Allocate(48 << 20, axsys::CacheMode::kCached, "frames")) return;
+ * (void)sg.CopyIn(0, src, 48 << 20);
+ * (void)sg.Flush();
+ * for (const axsys::CmmSegment& s : sg) dma_add(s.phys, s.size);
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief One physically contiguous piece of a CmmSgBuffer. */
+struct CmmSegment {
+  uint64_t phys;
+  void* virt;
+  size_t size;
+  size_t offset;  ///< Offset of the segment in the logical buffer
+};
+
+struct CmmSgOptions {
+  size_t min_segment = 1 << 20;  ///< Smallest block tried; 4 KiB aligned
+  size_t max_segments = 64;
+  bool contiguous_first = true;  ///< Try one block before splitting
+};
+
+/** @brief Process-wide CmmSgBuffer::Allocate() outcomes. */
+struct CmmSgCounters {
+  uint64_t allocations;  ///< Successful Allocate() calls
+  uint64_t contiguous;   ///< ... that got one block
+  uint64_t fallbacks;    ///< ... that needed several blocks
+  uint64_t segments;     ///< Blocks taken by the fallbacks
+  uint64_t failures;     ///< Allocate() calls that failed
+};
+
+/**
+ * @brief A logical CMM buffer made of one or more contiguous segments.
+ *
+ * Each segment is an owned CmmBuffer mapped once in the requested mode.
+ * Not thread-safe for Allocate()/Free().
+ */
+class CmmSgBuffer {
+ public:
+  using const_iterator = std::vector<CmmSegment>::const_iterator;
+
+  CmmSgBuffer();
+  CmmSgBuffer(const CmmSgBuffer&) = delete;
+  CmmSgBuffer& operator=(const CmmSgBuffer&) = delete;
+  ~CmmSgBuffer();
+
+  /**
+   * @brief Allocate @p size bytes, in one block when possible.
+   * @return kInvalidArgument for size 0 or a bad option,
+   *         kAlreadyInitialized, kAllocationFailed when no split down to
+   *         min_segment within max_segments fits.
+   */
+  Result<void> Allocate(size_t size, CacheMode mode, const char* token,
+                        const CmmSgOptions& options = CmmSgOptions());
+
+  /** @brief Free every segment. */
+  Result<void> Free();
+
+  size_t Size() const;
+  bool Contiguous() const;  ///< True for exactly one segment
+  const std::vector<CmmSegment>& Segments() const;
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  /**
+   * @brief Pieces of [offset, offset + size) in segment order, each with
+   *        the phys/virt of its first byte (e.g. for a DMA descriptor).
+   * @return kOutOfRange if the range exceeds Size().
+   */
+  Result<std::vector<CmmSegment>> Ranges(size_t offset, size_t size) const;
+
+  /** @name Segment-aware copies; kOutOfRange past Size(). */
+  ///@{
+  Result<void> CopyIn(size_t offset, const void* src, size_t size);
+  Result<void> CopyOut(size_t offset, void* dst, size_t size) const;
+  Result<void> CopyFrom(size_t offset, const CmmSgBuffer& src,
+                        size_t src_offset, size_t size);
+  ///@}
+
+  /** @brief Flush/invalidate [offset, offset+size), clamped to Size(). */
+  Result<void> Flush(size_t offset = 0, size_t size = SIZE_MAX) const;
+  Result<void> Invalidate(size_t offset = 0, size_t size = SIZE_MAX) const;
+
+  static CmmSgCounters Counters();
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
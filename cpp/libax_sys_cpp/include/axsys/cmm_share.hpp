@@ -0,0 +1,193 @@
+/**
+ * @file cmm_share.hpp
+ * @brief Zero-copy sharing of CMM buffers between processes over a unix
+ *        domain socket.
+ *
+ * An owner process hands CmmBuffer objects to a CmmExporter under a name.
+ * Other processes connect a CmmImporter to the exporter's socket and
+ * import a name: they receive the buffer's descriptor (physical address,
+ * size, cache mode, generation), attach it with AttachExternal() and map
+ * it. No pixel data crosses the socket.
+ *
+ * The exporter counts the importers of every buffer. A buffer that is
+ * retired (or replaced by publishing the same name again) is freed only
+ * once every importer has released it; an importer that exits or crashes
+ * releases everything it held when the kernel closes its socket.
+ *
+ * Usage example
+ * @code{.cpp}
+ * // Capture process
+ * axsys::CmmExporter exporter;
+ * exporter.Listen("/tmp/capture.sock");
+ * axsys::CmmBuffer frame;
+ * frame.Allocate(size, axsys::CacheMode::kNonCached, "frame");
+ * ...fill...
+ * exporter.Publish("frame0", std::move(frame), axsys::CacheMode::kNonCached);
+ *
+ * // Inference process
+ * axsys::CmmImporter importer;
+ * importer.Connect("/tmp/capture.sock");
+ * auto r = importer.Import("frame0");
+ * if (r) Infer(r.Value().View().Data(), r.Value().Descriptor().size);
+ * // released when r goes out of scope
+ * @endcode
+ *
+ * @note Both processes must map the same physical memory: on the board
+ *       through the CMM driver, under host emulation only across fork().
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief What an importer learns about a shared buffer. */
+struct CmmDescriptor {
+  uint64_t phys;
+  uint64_t size;
+  CacheMode mode;
+  uint32_t generation;  ///< Increments each time a name is published
+};
+
+/** @brief State of one publication, see CmmExporter::Query(). */
+struct CmmPublicationInfo {
+  CmmDescriptor desc;
+  uint32_t importers;       ///< Imports not yet released
+  uint64_t imports;         ///< Imports since publication
+  uint64_t last_import_ns;  ///< CLOCK_MONOTONIC of the last import, or 0
+};
+
+/**
+ * @brief Owner side: publishes buffers and defers their free until every
+ *        importer has released them.
+ *
+ * A background thread serves the socket. All methods are thread-safe.
+ */
+class CmmExporter {
+ public:
+  CmmExporter();
+  CmmExporter(const CmmExporter&) = delete;
+  CmmExporter& operator=(const CmmExporter&) = delete;
+  /**
+   * @brief Close(). Buffers still imported outlive the exporter: its
+   *        server thread keeps handling their releases, frees them and
+   *        exits after the last one.
+   */
+  ~CmmExporter();
+
+  /**
+   * @brief Bind a SOCK_SEQPACKET socket at @p path and start serving.
+   *        A stale socket file at @p path is replaced.
+   * @return kAlreadyInitialized if listening, kInvalidArgument for a path
+   *         longer than sun_path, kSystemCallFailed on socket errors.
+   */
+  Result<void> Listen(const char* path);
+
+  /**
+   * @brief Share @p buffer under @p name, taking ownership. A buffer
+   *        already published under @p name is retired.
+   * @param mode Cache mode importers map with.
+   * @return Generation of the new publication; kInvalidArgument for an
+   *         empty buffer or a name of 32 bytes or more.
+   */
+  Result<uint32_t> Publish(const char* name, CmmBuffer&& buffer,
+                           CacheMode mode);
+
+  /**
+   * @brief Withdraw @p name. The buffer is destroyed now if nobody
+   *        imported it, else when the last importer releases it.
+   * @return kInvalidArgument if @p name is not published.
+   */
+  Result<void> Retire(const char* name);
+
+  /** @brief Importers holding the current publication of @p name. */
+  uint32_t Importers(const char* name) const;
+
+  /** @brief Current publication of @p name; false if not published. */
+  bool Query(const char* name, CmmPublicationInfo* out) const;
+
+  /** @brief Retired buffers still waiting for importers to release. */
+  size_t PendingFrees() const;
+
+  /**
+   * @brief Retire every buffer, destroy the ones nobody imported and,
+   *        once none is left, stop serving and disconnect importers.
+   * @return kReferencesRemain while buffers are still imported: they stay
+   *         mapped, are freed as importers release them, and Publish()
+   *         returns kClosed until a later Close() succeeds.
+   */
+  Result<void> Close();
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+class CmmImporter;
+
+/**
+ * @brief An imported buffer, mapped for the lifetime of this object.
+ *        Move-only; destruction calls Release().
+ */
+class CmmImportedBuffer {
+ public:
+  CmmImportedBuffer();
+  CmmImportedBuffer(CmmImportedBuffer&& other) noexcept;
+  CmmImportedBuffer& operator=(CmmImportedBuffer&& other) noexcept;
+  CmmImportedBuffer(const CmmImportedBuffer&) = delete;
+  CmmImportedBuffer& operator=(const CmmImportedBuffer&) = delete;
+  ~CmmImportedBuffer();
+
+  const CmmDescriptor& Descriptor() const;
+  /** @brief Mapping of the whole buffer in the descriptor's mode. */
+  CmmView& View();
+
+  explicit operator bool() const;
+
+  /** @brief Unmap, detach and tell the owner. Safe to call repeatedly. */
+  void Release();
+
+ private:
+  friend class CmmImporter;
+  struct Impl;
+  Impl* impl_;
+};
+
+/**
+ * @brief Importer side: one connection to a CmmExporter.
+ *
+ * The connection stays open while any buffer imported through it is
+ * alive, even after the CmmImporter itself is destroyed.
+ */
+class CmmImporter {
+ public:
+  CmmImporter();
+  CmmImporter(const CmmImporter&) = delete;
+  CmmImporter& operator=(const CmmImporter&) = delete;
+  ~CmmImporter();
+
+  /**
+   * @brief Connect to the exporter listening at @p path.
+   * @return kAlreadyInitialized if connected, kSystemCallFailed if the
+   *         connection is refused.
+   */
+  Result<void> Connect(const char* path);
+
+  /**
+   * @brief Import the current publication of @p name.
+   * @return kNotInitialized before Connect(), kInvalidArgument if the
+   *         name is not published, kClosed if the exporter went away,
+   *         map errors from CmmBuffer.
+   */
+  Result<CmmImportedBuffer> Import(const char* name);
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
@@ -0,0 +1,132 @@
+/**
+ * @file cmm_stats.hpp
+ * @brief In-process CMM accounting per allocation token.
+ *
+ * Every CmmBuffer::Allocate() is accounted to its `token` string: number
+ * of allocations, frees and failures, live bytes and blocks, the peak of
+ * live bytes, and a log2 histogram of AX_SYS_MemAlloc latency. Tokens
+ * are interned once; the counters are sharded across cache lines and a
+ * thread always updates the same shard, so allocating threads do not
+ * contend with each other or with Snapshot().
+ *
+ * This answers "which component holds the CMM" without parsing
+ * /proc/ax_proc/mem_cmm_info, but only for allocations made through this
+ * library in this process.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::CmmStats::StartPeriodicDump(5000, stderr);  // every 5 s
+ * ...
+ * auto snap = axsys::CmmStats::Snapshot();
+ * if (const auto* t = snap.Find("npu_input")) {
+ *   printf("npu_input: %" PRIu64 " live bytes, p99 alloc %" PRIu64 " ns\n",
+ *          t->live_bytes, t->LatencyPercentileNs(0.99));
+ * }
+ * @endcode
+ *
+ * @note Memory attached with AttachExternal() is not accounted.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief Histogram buckets; bucket i counts [2^i, 2^(i+1)) ns. */
+constexpr size_t kCmmLatencyBuckets = 32;
+
+/** @brief Counters of one allocation token. */
+struct CmmTokenStats {
+  std::string token;     ///< Token passed to Allocate() ("" for nullptr)
+  uint64_t allocs;       ///< Successful allocations
+  uint64_t frees;        ///< Blocks returned with AX_SYS_MemFree
+  uint64_t failures;     ///< Failed allocations
+  uint64_t live_bytes;   ///< Allocated and not yet freed
+  uint64_t live_blocks;  ///< allocs - frees
+  uint64_t peak_bytes;   ///< High-water mark of live_bytes
+  double alloc_rate_hz;  ///< allocs per second since the token first appeared
+  uint64_t alloc_latency[kCmmLatencyBuckets];  ///< AX_SYS_MemAlloc time
+
+  /**
+   * @brief Upper bound of the bucket holding quantile @p q (0..1).
+   * @return 0 when no allocation was recorded.
+   */
+  uint64_t LatencyPercentileNs(double q) const;
+};
+
+/** @brief Counters of every token seen so far. */
+struct CmmStatsSnapshot {
+  uint64_t time_ns;  ///< CLOCK_MONOTONIC time of the snapshot
+  std::vector<CmmTokenStats> tokens;
+
+  /** @brief Entry for @p token, or nullptr. */
+  const CmmTokenStats* Find(const char* token) const;
+};
+
+/**
+ * @brief Access to the per-token CMM accounting. All members are static.
+ */
+class CmmStats {
+ public:
+  CmmStats() = delete;
+
+  /**
+   * @brief Current counters, tokens in order of first use.
+   * @note Counters are read without stopping writers; an allocation in
+   *       flight may be counted in one field and not yet in another.
+   */
+  static CmmStatsSnapshot Snapshot();
+
+  /**
+   * @brief Print one line per token to @p out: live bytes and blocks,
+   *        peak, allocs, frees, failures, rate and p50/p99 latency.
+   */
+  static void Dump(FILE* out);
+
+  /**
+   * @brief Print Dump() output every @p interval_ms from a background
+   *        thread; the rate column then covers the last interval.
+   * @return kInvalidArgument for a zero interval or null stream,
+   *         kAlreadyInitialized if a periodic dump is running.
+   */
+  static Result<void> StartPeriodicDump(uint32_t interval_ms, FILE* out);
+
+  /** @brief Stop and join the periodic dump thread, if any. */
+  static void StopPeriodicDump();
+};
+
+namespace detail {
+
+/** Interned token; never freed. Used by CmmBuffer. */
+struct CmmTokenCounters;
+
+CmmTokenCounters* InternCmmToken(const char* token);
+void RecordCmmAllocate(CmmTokenCounters* c, uint64_t bytes, bool ok,
+                       uint64_t latency_ns);
+void RecordCmmFree(CmmTokenCounters* c, uint64_t bytes);
+
+/** Budget charge of a token, updated without a lock by cmm_budget.cc. */
+struct CmmTokenCharge {
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<bool> listed{false};  ///< Known to CmmBudget::Stats()
+};
+
+/** @p c's budget charge; lives as long as @p c. */
+CmmTokenCharge* TokenCharge(CmmTokenCounters* c);
+
+/** Bucket of @p ns in a kCmmLatencyBuckets log2 histogram. */
+size_t Log2HistogramBucket(uint64_t ns);
+/** Quantile @p q of such a histogram (upper bound of its bucket). */
+uint64_t Log2HistogramPercentile(const uint64_t* buckets, double q);
+
+}  // namespace detail
+
+}  // namespace axsys
@@ -0,0 +1,145 @@
+/**
+ * @file epoch.hpp
+ * @brief Epoch-based reclamation of buffers shared between threads.
+ *
+ * Pipeline threads often read a CMM buffer that its owner wants to swap
+ * out and recycle. CmmBuffer::Free() refuses while views remain, and a
+ * reference count on every read costs an atomic read-modify-write on a
+ * shared cache line. An EpochDomain lets readers enter a critical section
+ * with one store and one fence on a line of their own; the owner unlinks
+ * the object, retires it, and the domain releases it in batches once
+ * every thread inside a critical section has moved past the epoch it was
+ * retired in.
+ *
+ * - Readers: `auto g = domain.Enter();` then load the published pointer
+ *   and use it until @c g goes out of scope. Sections nest.
+ * - Owners: publish the replacement, then Retire() the old object (a
+ *   callback, a CmmView or a CmmBuffer; see also CmmBuffer::Retire()).
+ *   Retire() calls Reclaim() every EpochOptions::batch retirements.
+ * - A retired CmmBuffer whose views are still alive elsewhere is dropped
+ *   like any other object; the block is freed with its last view.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::EpochDomain domain;
+ * std::atomic<axsys::CmmView*> current{...};
+ * // reader thread
+ * {
+ *   axsys::EpochGuard g = domain.Enter();
+ *   const axsys::CmmView* v = current.load(std::memory_order_acquire);
+ *   consume(v->Data(), v->Size());
+ * }
+ * // owner thread
+ * axsys::CmmView* old = current.exchange(next, std::memory_order_acq_rel);
+ * domain.Retire([old] { delete old; });
+ * (void)old_buffer.Retire(&domain);  // freed after the readers are done
+ * @endcode
+ *
+ * @note Retired objects run their release on whichever thread calls
+ *       Reclaim(), never inside Enter().
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+namespace detail {
+struct EpochRecord;  // per-thread announcement, internal
+}  // namespace detail
+
+struct EpochOptions {
+  /** Retire() calls Reclaim() once this many objects wait (0 = never). */
+  size_t batch = 64;
+};
+
+struct EpochStats {
+  uint64_t epoch;      ///< Current global epoch
+  uint64_t retired;    ///< Objects handed to Retire()
+  uint64_t reclaimed;  ///< Objects released
+  size_t pending;      ///< Retired, not yet released
+  size_t threads;      ///< Threads registered with the domain
+};
+
+/**
+ * @brief A critical section of one thread in an EpochDomain.
+ *
+ * Move-only; leaves the section when destroyed or on Exit(). Must be
+ * destroyed on the thread that created it.
+ */
+class EpochGuard {
+ public:
+  EpochGuard();
+  EpochGuard(EpochGuard&& other) noexcept;
+  EpochGuard& operator=(EpochGuard&& other) noexcept;
+  EpochGuard(const EpochGuard&) = delete;
+  EpochGuard& operator=(const EpochGuard&) = delete;
+  ~EpochGuard();
+
+  /** @brief True until Exit(). */
+  explicit operator bool() const;
+  /** @brief Leave the section early. Safe to call multiple times. */
+  void Exit();
+
+ private:
+  friend class EpochDomain;
+  explicit EpochGuard(detail::EpochRecord* record);
+  detail::EpochRecord* record_;
+};
+
+class EpochDomain {
+ public:
+  explicit EpochDomain(const EpochOptions& options = EpochOptions());
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+  /**
+   * @brief Release every pending object. No thread may be inside a
+   *        section.
+   */
+  ~EpochDomain();
+
+  /**
+   * @brief Enter a critical section. The first call on a thread registers
+   *        it (one mutex); later calls touch only the thread's own record.
+   */
+  EpochGuard Enter();
+
+  /** @brief Call @p release once no section can still see the object. */
+  void Retire(std::function<void()> release);
+  /** @brief Reset @p view once no section can still see it. */
+  void Retire(CmmView&& view);
+  /**
+   * @brief Drop @p buffer once no section can still see it; the block is
+   *        freed (or detached) then, or with its last view still alive.
+   */
+  void Retire(CmmBuffer&& buffer);
+
+  /**
+   * @brief Advance the epoch if every section has caught up, then release
+   *        the objects no section can see.
+   * @return Number of objects released.
+   */
+  size_t Reclaim();
+
+  /**
+   * @brief Reclaim() until nothing is pending.
+   * @param timeout_ms Maximum wait; negative waits forever.
+   * @return kInvalidArgument when called inside a section of this domain
+   *         (it would wait for itself), kTimeout.
+   */
+  Result<void> Drain(int64_t timeout_ms = -1);
+
+  EpochStats Stats() const;
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
@@ -22,6 +22,8 @@ enum class ErrorCode {
   kOutOfRange = 2,
   kNotInitialized = 3,
   kAlreadyInitialized = 4,
+  kTimeout = 5,
+  kClosed = 6,
 
   // Memory errors (100-199)
   kAllocationFailed = 100,
@@ -62,6 +64,10 @@ inline const char* ErrorCodeToString(ErrorCode code) {
       return "Not initialized";
     case ErrorCode::kAlreadyInitialized:
       return "Already initialized";
+    case ErrorCode::kTimeout:
+      return "Timed out";
+    case ErrorCode::kClosed:
+      return "Closed";
     case ErrorCode::kAllocationFailed:
       return "Memory allocation failed";
     case ErrorCode::kMemoryTooLarge:
@@ -0,0 +1,109 @@
+/**
+ * @file flight_recorder.hpp
+ * @brief Always-on history of the most recent CMM operations.
+ *
+ * libax_sys_cpp records every allocate, map, unmap, flush, invalidate and
+ * free it performs into one process-wide ring of kEntries slots. Unlike
+ * axsys/trace.hpp this cannot be switched off: a slot is claimed with one
+ * atomic increment and filled with plain stores, so the cost stays at a
+ * few nanoseconds per operation and the history is there when something
+ * goes wrong in production.
+ *
+ * Dump() formats the ring with write(2) only and may be called from a
+ * signal handler. InstallCrashHandler() does exactly that on SIGSEGV,
+ * SIGBUS and SIGABRT before handing the signal to the previous handler.
+ * The CmmBuffer deleter also dumps to stderr when AX_SYS_MemFree fails.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::System sys;
+ * axsys::flight::InstallCrashHandler();
+ * // ... on a crash the last CMM operations are printed to stderr ...
+ * axsys::flight::Dump(STDERR_FILENO);  // or at any time
+ * @endcode
+ *
+ * Sample output line
+ * @code
+ *   #1042 -1830us tid 2211 flush      phys 0x100020000 virt 0x7f3a2c1000
+ *         size 0x10000 cached ret 0
+ * @endcode
+ * (printed on a single line)
+ *
+ * @note Timestamps come from CNTVCT_EL0 on aarch64 and from
+ *       CLOCK_MONOTONIC_COARSE elsewhere (host builds), where they are
+ *       only accurate to a few milliseconds; `seq` gives the exact order.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+namespace flight {
+
+/** @brief Recorded CMM operation kinds. */
+enum class Op : uint8_t {
+  kAllocate,
+  kMap,
+  kUnmap,
+  kFlush,
+  kInvalidate,
+  kFree,
+};
+
+/** @brief Lower-case name used by Dump(), e.g. "invalidate". */
+const char* OpName(Op op);
+
+/** @brief Operations kept before the oldest are overwritten. */
+constexpr uint32_t kEntries = 256;
+
+struct Entry {
+  uint64_t seq;      ///< Process-wide operation number, from 0
+  uint64_t time_ns;  ///< CLOCK_MONOTONIC-based time of the operation
+  uint64_t phys;     ///< Physical address (0 if unknown)
+  uint64_t virt;     ///< Virtual address (0 if none)
+  uint64_t size;     ///< Bytes covered
+  uint32_t tid;      ///< Kernel thread id
+  int32_t ret;       ///< SDK return code; -1 for a failed map
+  Op op;
+  CacheMode mode;
+};
+
+/**
+ * @brief Append one operation. Lock-free and async-signal-safe.
+ *
+ * Called by libax_sys_cpp itself; applications may record their own
+ * CMM calls the same way.
+ */
+void Record(Op op, uint64_t phys, const void* virt, uint64_t size,
+            CacheMode mode, int32_t ret);
+
+/** @brief Entries still in the ring, oldest first. */
+std::vector<Entry> Snapshot();
+
+/**
+ * @brief Write the ring as text to @p fd, oldest first.
+ *
+ * Async-signal-safe: no allocation, locking or stdio. Entries being
+ * written concurrently are skipped. Ages are relative to the call.
+ */
+void Dump(int fd);
+
+/**
+ * @brief Dump to stderr on SIGSEGV, SIGBUS and SIGABRT.
+ *
+ * After dumping, the previously installed disposition is restored and
+ * the signal raised again, so core dumps and other handlers still run.
+ * Installing twice is a no-op.
+ * @return kSystemCallFailed if sigaction() fails.
+ * @note Faults caused by stack overflow are not reported; no alternate
+ *       signal stack is set up.
+ */
+Result<void> InstallCrashHandler();
+
+}  // namespace flight
+}  // namespace axsys
@@ -0,0 +1,82 @@
+/**
+ * @file frame_map_cache.hpp
+ * @brief Persistent virtual mappings for recycled frame buffers.
+ *
+ * Video frames handed out by AX_VIN/AX_POOL always come from a small,
+ * fixed set of pool blocks. Mapping each frame with AX_SYS_Mmap and
+ * unmapping it again costs two syscalls and page-table churn per frame.
+ * FrameMapCache maps every block once, keyed by physical address, and
+ * turns later lookups of the same block into an O(1) hash lookup.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::FrameMapCache cache(axsys::CacheMode::kNonCached);
+ * // per frame:
+ * auto r = cache.Map(vf.u64PhyAddr[0], frame_bytes);
+ * if (!r) { fprintf(stderr, "%s\n", r.Message().c_str()); return; }
+ * fwrite(r.Value(), 1, frame_bytes, out);
+ * // when the pipe is reconfigured or stopped:
+ * cache.Invalidate();
+ * @endcode
+ *
+ * @warning Pointers returned by Map() are valid until Invalidate() or
+ *          destruction. Invalidate the cache before the pool backing the
+ *          frames is destroyed (e.g. before AX_VIN_DestroyPipe).
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+class FrameMapCache {
+ public:
+  /** @brief Counters describing cache effectiveness. */
+  struct Stats {
+    uint64_t map_calls;      ///< AX_SYS_Mmap* calls issued by the cache
+    uint64_t unmap_calls;    ///< AX_SYS_Munmap calls issued by the cache
+    uint64_t hits;           ///< Map() served from an existing mapping
+    uint64_t misses;         ///< Map() that had to create a mapping
+    uint64_t invalidations;  ///< Invalidate() calls incl. capacity resets
+    size_t entries;          ///< Mappings currently held
+  };
+
+  /**
+   * @param mode Cache mode used for every mapping held by the cache.
+   * @param capacity Maximum number of distinct blocks kept mapped. When a
+   *        new block would exceed it, all mappings are dropped first, as a
+   *        pool layout change is the only way to get there.
+   */
+  explicit FrameMapCache(CacheMode mode = CacheMode::kNonCached,
+                         size_t capacity = 16);
+  FrameMapCache(const FrameMapCache&) = delete;
+  FrameMapCache& operator=(const FrameMapCache&) = delete;
+  ~FrameMapCache();
+
+  /**
+   * @brief Return a virtual address for [phys, phys+size).
+   * @param phys Physical start address of the frame (block base).
+   * @param size Bytes that must be accessible from the returned pointer.
+   * @return Result<void*> mapped pointer on success.
+   * @note In kCached mode the requested range is invalidated before
+   *       returning, since frame contents are written by hardware.
+   */
+  Result<void*> Map(uint64_t phys, size_t size);
+
+  /** @brief Unmap every cached block (e.g. on pipe reconfiguration). */
+  void Invalidate();
+
+  /** @brief Snapshot of the counters. Thread-safe. */
+  Stats GetStats() const;
+
+  CacheMode Mode() const;
+
+ private:
+  struct Impl;  // internal
+  Impl* impl_;
+};
+
+}  // namespace axsys
@@ -0,0 +1,391 @@
+/**
+ * @file frame_queue.hpp
+ * @brief Bounded lock-free queues for handing frames between threads.
+ *
+ * FrameQueue<T> is a fixed-capacity ring buffer that moves elements
+ * (frame handles, CmmView, ...) from producer to consumer threads. All
+ * storage is allocated in the constructor; push/pop never allocate.
+ *
+ * Variants
+ * - FrameQueue<T, QueueKind::kSpsc>: one producer thread, one consumer
+ *   thread. Wait-free TryPush/TryPop using two cursors.
+ * - FrameQueue<T, QueueKind::kMpmc> (default): any number of producers
+ *   and consumers. Lock-free, per-slot sequence numbers.
+ *
+ * Both variants offer non-blocking TryPush/TryPop and blocking
+ * Push/Pop with a timeout. Blocking waits sleep on a futex and cost
+ * nothing while nobody waits: producers and consumers only touch the
+ * futex word when the other side has announced a waiter.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::FrameQueue<axsys::CmmView, axsys::QueueKind::kSpsc> q(8);
+ * // capture thread
+ * if (!q.TryPush(std::move(view))) { ++dropped; }
+ * // processing thread
+ * axsys::CmmView v;
+ * auto r = q.Pop(&v, 100);  // wait up to 100 ms
+ * if (r.Code() == axsys::ErrorCode::kClosed) return;
+ * @endcode
+ *
+ * @note Capacity is rounded up to a power of two.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "axsys/error.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief Cache line size of the target (Cortex-A53) and typical hosts. */
+constexpr size_t kCacheLineSize = 64;
+
+enum class QueueKind { kSpsc = 0, kMpmc = 1 };
+
+namespace detail {
+
+/**
+ * @brief Sleep while *word == expected (FUTEX_WAIT_PRIVATE).
+ * @param timeout_ms Relative timeout; negative waits forever.
+ * Spurious wakeups are possible; callers re-check their condition.
+ */
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+               int64_t timeout_ms);
+/** @brief Wake up to @p count waiters on @p word (FUTEX_WAKE_PRIVATE). */
+void FutexWake(std::atomic<uint32_t>* word, int count);
+
+/**
+ * @brief Futex-backed event count.
+ *
+ * Waiters register, take a key and re-check their condition before
+ * sleeping; notifiers bump the key only when a waiter is registered, so
+ * the uncontended fast path is one fence and one relaxed load.
+ */
+class EventCount {
+ public:
+  EventCount() : epoch_(0), waiters_(0) {}
+
+  uint32_t PrepareWait() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_seq_cst);
+  }
+  void CancelWait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+  void Wait(uint32_t key, int64_t timeout_ms) {
+    FutexWait(&epoch_, key, timeout_ms);
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  void Notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) != 0) {
+      epoch_.fetch_add(1, std::memory_order_seq_cst);
+      FutexWake(&epoch_, INT32_MAX);
+    }
+  }
+
+ private:
+  std::atomic<uint32_t> epoch_;
+  std::atomic<uint32_t> waiters_;
+};
+
+inline size_t RoundUpPow2(size_t v) {
+  size_t p = 2;
+  while (p < v) p <<= 1;
+  return p;
+}
+
+/** Uninitialized, suitably aligned storage for one T. */
+template <typename T>
+struct SlotStorage {
+  alignas(T) unsigned char bytes[sizeof(T)];
+  T* Ptr() { return std::launder(reinterpret_cast<T*>(bytes)); }
+};
+
+/**
+ * Blocking Push/Pop and Close() shared by both queue variants. Derived
+ * provides TryPushImpl/TryPopImpl.
+ */
+template <typename Derived, typename T>
+class BlockingQueueBase {
+ public:
+  /**
+   * @brief Move @p value in; fails without touching it when full.
+   * @return false if the queue is full or closed.
+   */
+  bool TryPush(T&& value) {
+    if (closed_.load(std::memory_order_acquire)) return false;
+    if (!Self()->TryPushImpl(value)) return false;
+    not_empty_.Notify();
+    return true;
+  }
+
+  /** @brief Move the oldest element into @p out. */
+  bool TryPop(T* out) {
+    if (!Self()->TryPopImpl(out)) return false;
+    not_full_.Notify();
+    return true;
+  }
+
+  /**
+   * @brief Push, sleeping while the queue is full.
+   * @param timeout_ms Maximum wait; negative waits forever, 0 never waits.
+   * @return kTimeout when still full at the deadline, kClosed after Close().
+   */
+  Result<void> Push(T&& value, int64_t timeout_ms = -1) {
+    return Blocking(&not_full_, timeout_ms,
+                    [&] { return TryPush(std::move(value)); });
+  }
+
+  /**
+   * @brief Pop, sleeping while the queue is empty.
+   * @return kTimeout when still empty at the deadline, kClosed once the
+   *         queue is closed and drained.
+   */
+  Result<void> Pop(T* out, int64_t timeout_ms = -1) {
+    return Blocking(&not_empty_, timeout_ms, [&] { return TryPop(out); });
+  }
+
+  /**
+   * @brief Reject further pushes and wake every waiter. Elements already
+   *        queued can still be popped.
+   */
+  void Close() {
+    closed_.store(true, std::memory_order_release);
+    not_empty_.Notify();
+    not_full_.Notify();
+  }
+
+  bool Closed() const { return closed_.load(std::memory_order_acquire); }
+
+ protected:
+  BlockingQueueBase() : closed_(false) {}
+
+ private:
+  Derived* Self() { return static_cast<Derived*>(this); }
+
+  template <typename Op>
+  Result<void> Blocking(EventCount* ev, int64_t timeout_ms, Op op) {
+    using Clock = std::chrono::steady_clock;
+    const int64_t budget_ms = timeout_ms < 0 ? 0 : timeout_ms;
+    const Clock::time_point deadline =
+        Clock::now() + std::chrono::milliseconds(budget_ms);
+    for (;;) {
+      if (op()) return Result<void>::Ok();
+      if (closed_.load(std::memory_order_acquire)) break;
+      int64_t remain_ms = -1;
+      if (timeout_ms >= 0) {
+        remain_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - Clock::now())
+                        .count();
+        if (remain_ms <= 0) return Result<void>::Error(ErrorCode::kTimeout);
+      }
+      const uint32_t key = ev->PrepareWait();
+      if (op()) {
+        ev->CancelWait();
+        return Result<void>::Ok();
+      }
+      if (closed_.load(std::memory_order_acquire)) {
+        ev->CancelWait();
+        break;
+      }
+      ev->Wait(key, remain_ms);
+    }
+    // Closed: a pop may still drain what is left.
+    if (op()) return Result<void>::Ok();
+    return Result<void>::Error(ErrorCode::kClosed);
+  }
+
+  alignas(kCacheLineSize) EventCount not_empty_;
+  alignas(kCacheLineSize) EventCount not_full_;
+  std::atomic<bool> closed_;
+};
+
+}  // namespace detail
+
+/**
+ * @brief Bounded MPMC queue (Vyukov-style per-slot sequence numbers).
+ * @tparam T Move-constructible element type.
+ */
+template <typename T, QueueKind K = QueueKind::kMpmc>
+class FrameQueue
+    : public detail::BlockingQueueBase<FrameQueue<T, K>, T> {
+  static_assert(K == QueueKind::kMpmc, "unsupported QueueKind");
+  static_assert(std::is_nothrow_move_constructible<T>::value,
+                "FrameQueue elements must be nothrow move-constructible");
+
+ public:
+  /** @param capacity Minimum number of slots (rounded up to 2^n). */
+  explicit FrameQueue(size_t capacity)
+      : mask_(detail::RoundUpPow2(capacity) - 1),
+        cells_(new Cell[mask_ + 1]),
+        enqueue_pos_(0),
+        dequeue_pos_(0) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+  FrameQueue(const FrameQueue&) = delete;
+  FrameQueue& operator=(const FrameQueue&) = delete;
+  ~FrameQueue() {
+    const size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+    for (size_t pos = dequeue_pos_.load(std::memory_order_relaxed); pos != end;
+         ++pos) {
+      Cell& c = cells_[pos & mask_];
+      if (c.seq.load(std::memory_order_relaxed) == pos + 1) {
+        c.storage.Ptr()->~T();
+      }
+    }
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+  /** @brief Approximate number of queued elements. */
+  size_t SizeApprox() const {
+    const size_t e = enqueue_pos_.load(std::memory_order_relaxed);
+    const size_t d = dequeue_pos_.load(std::memory_order_relaxed);
+    return e >= d ? e - d : 0;
+  }
+
+ private:
+  friend class detail::BlockingQueueBase<FrameQueue<T, K>, T>;
+
+  struct alignas(kCacheLineSize) Cell {
+    std::atomic<size_t> seq;
+    detail::SlotStorage<T> storage;
+  };
+
+  bool TryPushImpl(T& value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (cell->storage.bytes) T(std::move(value));
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPopImpl(T* out) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* p = cell->storage.Ptr();
+    *out = std::move(*p);
+    p->~T();
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos_;
+  alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos_;
+};
+
+/**
+ * @brief Bounded SPSC specialization: exactly one producer thread and one
+ *        consumer thread. Each side caches the other's cursor to avoid
+ *        touching the shared cache line on every operation.
+ */
+template <typename T>
+class FrameQueue<T, QueueKind::kSpsc>
+    : public detail::BlockingQueueBase<FrameQueue<T, QueueKind::kSpsc>, T> {
+  static_assert(std::is_nothrow_move_constructible<T>::value,
+                "FrameQueue elements must be nothrow move-constructible");
+
+ public:
+  explicit FrameQueue(size_t capacity)
+      : mask_(detail::RoundUpPow2(capacity) - 1),
+        slots_(new detail::SlotStorage<T>[mask_ + 1]),
+        head_(0),
+        tail_cache_(0),
+        tail_(0),
+        head_cache_(0) {}
+  FrameQueue(const FrameQueue&) = delete;
+  FrameQueue& operator=(const FrameQueue&) = delete;
+  ~FrameQueue() {
+    size_t h = head_.load(std::memory_order_relaxed);
+    const size_t t = tail_.load(std::memory_order_relaxed);
+    for (; h != t; ++h) slots_[h & mask_].Ptr()->~T();
+  }
+
+  size_t Capacity() const { return mask_ + 1; }
+  size_t SizeApprox() const {
+    return tail_.load(std::memory_order_relaxed) -
+           head_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class detail::BlockingQueueBase<FrameQueue<T, QueueKind::kSpsc>, T>;
+
+  bool TryPushImpl(T& value) {
+    const size_t t = tail_.load(std::memory_order_relaxed);
+    if (t - head_cache_ > mask_) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (t - head_cache_ > mask_) return false;  // full
+    }
+    new (slots_[t & mask_].bytes) T(std::move(value));
+    tail_.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPopImpl(T* out) {
+    const size_t h = head_.load(std::memory_order_relaxed);
+    if (h == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (h == tail_cache_) return false;  // empty
+    }
+    T* p = slots_[h & mask_].Ptr();
+    *out = std::move(*p);
+    p->~T();
+    head_.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<detail::SlotStorage<T>[]> slots_;
+  // Consumer-owned line.
+  alignas(kCacheLineSize) std::atomic<size_t> head_;
+  size_t tail_cache_;
+  // Producer-owned line.
+  alignas(kCacheLineSize) std::atomic<size_t> tail_;
+  size_t head_cache_;
+};
+
+}  // namespace axsys
@@ -0,0 +1,44 @@
+/**
+ * @file frame_source.hpp
+ * @brief Abstract producer of RawFrame handles.
+ *
+ * A capture loop written against FrameSource runs unchanged on a live
+ * sensor (VinFrameSource in axsys/vin_raw_frame.hpp) and on a recorded
+ * stream (ReplayFrameSource in axsys/replay_frame_source.hpp).
+ *
+ * Usage example
+ * @code{.cpp}
+ * void Run(axsys::FrameSource* src) {
+ *   for (;;) {
+ *     auto r = src->Next(1000);
+ *     if (r.Code() == axsys::ErrorCode::kTimeout) continue;
+ *     if (!r) break;  // kClosed at end of stream, or an error
+ *     axsys::RawFrame frame = r.MoveValue();
+ *     Process(&frame);
+ *   }
+ * }
+ * @endcode
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "axsys/raw_frame.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+class FrameSource {
+ public:
+  virtual ~FrameSource() = default;
+
+  /**
+   * @brief Wait for the next frame.
+   * @param timeout_ms Milliseconds to wait; -1 waits indefinitely.
+   * @return kTimeout when no frame became ready in time, kClosed when the
+   *         source has no more frames, source-specific errors otherwise.
+   */
+  virtual Result<RawFrame> Next(int32_t timeout_ms) = 0;
+};
+
+}  // namespace axsys
@@ -0,0 +1,193 @@
+/**
+ * @file image_view.hpp
+ * @brief Stride-aware 2D views of CMM images with row-granular cache
+ *        maintenance.
+ *
+ * CmmView is a flat byte range: image code computes row offsets by hand
+ * and flushes the whole buffer even when it touched a few rows of an ROI.
+ * ImageView describes width, height, format and, per plane, where pixel
+ * (0, 0) is and how far apart rows are. It is a small copyable value that
+ * refers to CmmViews it does not own.
+ *
+ * - Crop() narrows the view without mapping anything.
+ * - FlushRows()/FlushRect() and the Invalidate counterparts touch only the
+ *   rows (and, for a narrow rectangle, only the columns) covered. Rows are
+ *   merged into one call whenever the gap between them lies in cache
+ *   lines that are maintained anyway, so a full-width band is one call and
+ *   a narrow ROI is one call per row.
+ * - Spans() returns the ranges those calls would cover.
+ *
+ * Image owns one CMM block holding every plane, each plane starting on
+ * `plane_align` and each row on `stride_align`.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::Image img;
+ * if (!img.Allocate(1920, 1080, axsys::PixelFormat::kNv12,
+ *                   axsys::CacheMode::kCached, "nv12")) return;
+ * axsys::ImageView roi = img.View().Crop({640, 360, 320, 240}).MoveValue();
+ * for (uint32_t y = 0; y < roi.Height(); ++y) Fill(roi.Row(0, y), ...);
+ * (void)roi.FlushRect({0, 0, roi.Width(), roi.Height()});  // ROI only
+ * npu_run(img.View().Phys(0), img.View().Phys(1));
+ *
+ * // Captured RAW frame: wrap the plane the frame already maps.
+ * axsys::CmmView* plane = frame.Plane(0).Value();
+ * axsys::ImagePlane p{plane, 0, info.planes[0].stride};
+ * auto raw = axsys::ImageView::Wrap(info.width, info.height,
+ *                                   axsys::PixelFormat::kRaw16, &p, 1);
+ * @endcode
+ *
+ * @warning A view is valid only while the CmmViews it refers to are
+ *          mapped (e.g. while the Image or the RawFrame is alive).
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+enum class PixelFormat {
+  kGray8 = 0,
+  kRaw10Packed = 1,  ///< 4 pixels in 5 bytes (MIPI RAW10)
+  kRaw16 = 2,
+  kNv12 = 3,  ///< YUV420SP: Y plane, then interleaved UV at half height
+  kNv21 = 4,  ///< YUV420SP with VU order
+  kRgb888 = 5,
+};
+
+/** @brief Planes used by @p format (1 or 2). */
+uint32_t PlaneCount(PixelFormat format);
+
+struct ImageRect {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+/** @brief Where one plane lives: a mapping and its row layout. */
+struct ImagePlane {
+  CmmView* view;  ///< Mapping holding the plane; not owned
+  size_t offset;  ///< Offset of pixel (0, 0) within @c view
+  size_t stride;  ///< Bytes from one row to the next
+};
+
+/** @brief One cache maintenance range, relative to the plane's view. */
+struct ImageSpan {
+  size_t offset;
+  size_t size;
+};
+
+class ImageView {
+ public:
+  static constexpr uint32_t kMaxPlanes = 2;
+
+  /** @brief Empty view; operator bool is false. */
+  ImageView();
+
+  /**
+   * @brief View over planes mapped elsewhere (e.g. RawFrame::Plane()).
+   * @param planes PlaneCount(format) entries.
+   * @return kInvalidArgument for a zero size, a wrong plane count, a null
+   *         view or a stride shorter than a row; kOutOfRange if the last
+   *         row of a plane ends past its view.
+   */
+  static Result<ImageView> Wrap(uint32_t width, uint32_t height,
+                                PixelFormat format, const ImagePlane* planes,
+                                uint32_t plane_count);
+
+  explicit operator bool() const { return width_ != 0; }
+  uint32_t Width() const { return width_; }
+  uint32_t Height() const { return height_; }
+  PixelFormat Format() const { return format_; }
+  uint32_t Planes() const { return PlaneCount(format_); }
+  /** @brief Plane layout; offset already includes the crop origin. */
+  const ImagePlane& Plane(uint32_t plane) const { return planes_[plane]; }
+  size_t Stride(uint32_t plane) const { return planes_[plane].stride; }
+  /** @brief Rows in @p plane (half the height for NV12 chroma). */
+  uint32_t PlaneRows(uint32_t plane) const;
+  /** @brief Bytes of pixel data in one row of @p plane. */
+  size_t RowBytes(uint32_t plane) const;
+  /** @brief First byte of row @p y of @p plane. */
+  uint8_t* Row(uint32_t plane, uint32_t y) const;
+  /** @brief Physical address of pixel (0, 0) of @p plane. */
+  uint64_t Phys(uint32_t plane) const;
+
+  /**
+   * @brief Sub-image sharing the same mappings.
+   * @return kOutOfRange if @p rect leaves the image or is empty;
+   *         kInvalidArgument if x/y do not start on a whole byte or chroma
+   *         sample (RAW10 x % 4, NV12 x and y even).
+   */
+  Result<ImageView> Crop(const ImageRect& rect) const;
+
+  /**
+   * @brief Ranges covering @p rect in @p plane, merged across gaps that
+   *        fall inside cache lines touched anyway. Empty if @p rect is
+   *        empty or leaves the image.
+   */
+  std::vector<ImageSpan> Spans(uint32_t plane, const ImageRect& rect) const;
+
+  /**
+   * @brief Flush/invalidate rows [y, y+rows) or @p rect of every plane.
+   * @return kOutOfRange if the area leaves the image; CmmView errors.
+   *         Planes mapped non-cached are skipped.
+   */
+  Result<void> FlushRows(uint32_t y, uint32_t rows) const;
+  Result<void> InvalidateRows(uint32_t y, uint32_t rows) const;
+  Result<void> FlushRect(const ImageRect& rect) const;
+  Result<void> InvalidateRect(const ImageRect& rect) const;
+
+ private:
+  Result<void> Maintain(const ImageRect& rect, bool flush) const;
+
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  PixelFormat format_ = PixelFormat::kGray8;
+  ImagePlane planes_[kMaxPlanes] = {};
+};
+
+struct ImageLayoutOptions {
+  size_t stride_align = 64;   ///< Row alignment (power of two)
+  size_t plane_align = 4096;  ///< Plane start alignment (power of two)
+};
+
+/** @brief One CMM block holding every plane of an image. */
+class Image {
+ public:
+  Image();
+  Image(Image&& other) noexcept;
+  Image& operator=(Image&& other) noexcept;
+  Image(const Image&) = delete;
+  Image& operator=(const Image&) = delete;
+  ~Image();
+
+  /**
+   * @brief Allocate and map all planes as one block.
+   * @return kInvalidArgument (zero size, bad alignment),
+   *         kAlreadyInitialized, CmmBuffer::Allocate() errors.
+   */
+  Result<void> Allocate(uint32_t width, uint32_t height, PixelFormat format,
+                        CacheMode mode, const char* token,
+                        const ImageLayoutOptions& options = {});
+  Result<void> Free();
+
+  /** @brief View of the whole image; empty before Allocate(). */
+  ImageView View() const;
+  /** @brief Bytes of the CMM block (all planes and padding). */
+  size_t Size() const;
+  /** @brief Physical address of the block (plane 0). */
+  uint64_t Phys() const;
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
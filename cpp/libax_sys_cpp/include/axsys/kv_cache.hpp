@@ -0,0 +1,142 @@
+/**
+ * @file kv_cache.hpp
+ * @brief Paged KV cache for LLM decoding on one CMM reservation.
+ *
+ * Reserving every sequence's KV cache at the maximum context length
+ * wastes most of the CMM, and growing a contiguous buffer means copying.
+ * KvCache allocates one CMM block up front and splits it into fixed-size
+ * pages of `tokens_per_page` token slots. Each sequence owns a page table
+ * that grows one page at a time; PageTable() gives the accelerator the
+ * physical address of every page in order.
+ *
+ * - AllocPage()/ReleasePage() are O(1) and lock-free (a tagged Treiber
+ *   stack of page indices); pages are reference counted.
+ * - ForkSequence() shares the parent's pages (e.g. a common prompt). A
+ *   shared, partially filled last page is copied on the next
+ *   AppendToken() of either sequence (copy-on-write); full pages stay
+ *   shared.
+ * - Sequence operations take one mutex; they run once per decoded token.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::KvCacheConfig cfg;
+ * cfg.num_pages = 1024;
+ * cfg.tokens_per_page = 16;
+ * cfg.bytes_per_token = 2 * layers * heads * head_dim * sizeof(uint16_t);
+ * axsys::KvCache kv;
+ * if (!kv.Init(cfg)) return;
+ * auto prompt = kv.CreateSequence();
+ * for (...) memcpy(kv.AppendToken(prompt.Value()).Value(), k_v, size);
+ * auto beam = kv.ForkSequence(prompt.Value());  // shares the prompt
+ * auto table = kv.PageTable(beam.Value());      // phys per page
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief Returned by KvCache::AllocPage() when every page is in use. */
+constexpr uint32_t kNoKvPage = UINT32_MAX;
+
+struct KvCacheConfig {
+  uint32_t num_pages = 0;
+  uint32_t tokens_per_page = 16;
+  size_t bytes_per_token = 0;
+  CacheMode mode = CacheMode::kNonCached;
+  const char* token = "kv";  ///< CmmStats token of the reservation
+};
+
+struct KvCacheStats {
+  uint32_t pages_total;
+  uint32_t pages_free;
+  uint32_t pages_shared;    ///< Pages referenced more than once
+  uint32_t sequences;
+  uint64_t tokens;          ///< Sum of sequence lengths
+  uint64_t logical_pages;   ///< Sum of page table lengths
+  double occupancy;         ///< Pages in use / pages_total
+  double fragmentation;     ///< Empty token slots / slots, over used pages
+};
+
+/**
+ * @brief Fixed-size KV pages in one CMM block with per-sequence tables.
+ *
+ * Pages start on 64-byte boundaries. Page functions are thread-safe and
+ * ignore out-of-range indices; Init()/Close() are not thread-safe.
+ */
+class KvCache {
+ public:
+  KvCache();
+  KvCache(const KvCache&) = delete;
+  KvCache& operator=(const KvCache&) = delete;
+  ~KvCache();
+
+  /**
+   * @brief Reserve @p config.num_pages pages.
+   * @return kInvalidArgument for a zero count or size, kMemoryTooLarge,
+   *         kAlreadyInitialized, CmmBuffer::Allocate() errors.
+   */
+  Result<void> Init(const KvCacheConfig& config);
+
+  /** @brief Drop every sequence and free the reservation. */
+  Result<void> Close();
+
+  /** @brief Take a free page with one reference; kNoKvPage if none. */
+  uint32_t AllocPage();
+  void RetainPage(uint32_t page);
+  /** @brief Drop one reference; the last one returns the page. */
+  void ReleasePage(uint32_t page);
+  uint32_t PageRefs(uint32_t page) const;
+
+  void* PageData(uint32_t page) const;
+  uint64_t PagePhys(uint32_t page) const;
+  /** @brief Flush a page written through a cached reservation. */
+  Result<void> FlushPage(uint32_t page) const;
+  size_t PageBytes() const;
+  uint32_t TokensPerPage() const;
+
+  /** @brief New empty sequence. kNotInitialized before Init(). */
+  Result<uint32_t> CreateSequence();
+  /**
+   * @brief New sequence sharing every page of @p parent.
+   * @return kOutOfRange for an unknown sequence.
+   */
+  Result<uint32_t> ForkSequence(uint32_t parent);
+  /**
+   * @brief Slot of @p seq's next token (bytes_per_token bytes).
+   *
+   * Takes a page when the last one is full and copies the last page when
+   * it is shared.
+   * @return kOutOfRange for an unknown sequence, kAllocationFailed when
+   *         no page is free.
+   */
+  Result<void*> AppendToken(uint32_t seq);
+  /** @brief Token @p pos of @p seq; nullptr if out of range. */
+  const void* TokenData(uint32_t seq, uint32_t pos) const;
+  /** @brief Release the pages of @p seq. kOutOfRange if unknown. */
+  Result<void> FreeSequence(uint32_t seq);
+  /** @brief Tokens in @p seq; 0 if unknown. */
+  uint32_t Length(uint32_t seq) const;
+  /** @brief Physical address of each page of @p seq. kOutOfRange. */
+  Result<std::vector<uint64_t>> PageTable(uint32_t seq) const;
+
+  /**
+   * @brief Occupancy and fragmentation. A page's fill is the largest
+   *        number of tokens any sequence keeps in it; pages taken with
+   *        AllocPage() outside a sequence count as empty.
+   */
+  KvCacheStats Stats() const;
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
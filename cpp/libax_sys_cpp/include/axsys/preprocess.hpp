@@ -0,0 +1,137 @@
+/**
+ * @file preprocess.hpp
+ * @brief NPU input preprocessing kernels that write straight into CMM.
+ *
+ * Converting a camera frame into the NPU's input tensor with scalar code
+ * into heap memory, then copying the result into CMM, costs a full pass
+ * over the tensor plus the copy. The kernels here read from and write to
+ * ImageViews (axsys/image_view.hpp) and TensorViews in CMM directly:
+ *
+ * - Nv12ToRgb(): NV12/NV21 to packed RGB or BGR (BT.601 limited range).
+ * - Resize(), Letterbox(): nearest or bilinear scaling of Gray8/RGB888,
+ *   letterboxing keeps the aspect ratio and pads the border.
+ * - CropImage(): copy a rectangle of any format into another image.
+ * - ToTensor(): HWC or CHW layout, u8 or i8 output, per-channel
+ *   `round((x - mean) * scale) + zero_point` with saturation.
+ *
+ * Each kernel splits the destination rows across @p threads threads,
+ * invalidates the source area it reads when that is mapped cached (so
+ * CPU writes to a source must be flushed first, as every kernel here
+ * does), and flushes only the destination rows (or rectangle) it wrote.
+ *
+ * Implementation: NEON on aarch64 for the colour conversion, the vertical
+ * bilinear pass and the layout change with a per-channel offset (which
+ * covers plain u8 and `x - 128` i8 inputs); portable scalar code
+ * otherwise. All paths produce identical output. Other mean/scale values
+ * go through exact per-channel lookup tables.
+ *
+ * Usage example
+ * @code{.cpp}
+ * // NV12 1920x1080 from VIN -> 640x640 letterboxed RGB -> CHW i8 tensor.
+ * axsys::Image rgb, boxed;
+ * rgb.Allocate(1920, 1080, axsys::PixelFormat::kRgb888, kCached, "rgb");
+ * boxed.Allocate(640, 640, axsys::PixelFormat::kRgb888, kCached, "box");
+ * axsys::Nv12ToRgb(nv12, rgb.View(), axsys::ChannelOrder::kRgb, 4);
+ * auto info = axsys::Letterbox(rgb.View(), boxed.View(),
+ *                              axsys::ResizeFilter::kBilinear, 114, 4);
+ * axsys::TensorView t{&input_view, 0, 640, 640, 3,
+ *                     axsys::TensorLayout::kChw, axsys::TensorType::kI8};
+ * axsys::QuantParams q;
+ * q.zero_point = -128;  // u8 -> i8
+ * axsys::ToTensor(boxed.View(), t, q, 4);
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "axsys/cmm.hpp"
+#include "axsys/image_view.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+enum class ChannelOrder { kRgb = 0, kBgr = 1 };
+enum class ResizeFilter { kNearest = 0, kBilinear = 1 };
+enum class TensorLayout { kHwc = 0, kChw = 1 };
+enum class TensorType { kU8 = 0, kI8 = 1 };
+
+/** @brief Dense 8-bit NPU input tensor inside a CMM mapping. */
+struct TensorView {
+  CmmView* view;  ///< Mapping holding the tensor; not owned
+  size_t offset;  ///< Offset of the first element within @c view
+  uint32_t width;
+  uint32_t height;
+  uint32_t channels;  ///< 1 or 3
+  TensorLayout layout;
+  TensorType type;
+};
+
+/** @brief Bytes occupied by @p t (width * height * channels). */
+inline size_t TensorBytes(const TensorView& t) {
+  return static_cast<size_t>(t.width) * t.height * t.channels;
+}
+
+/** @brief Per-channel `round((x - mean) * scale) + zero_point`. */
+struct QuantParams {
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+  float scale[3] = {1.0f, 1.0f, 1.0f};
+  int32_t zero_point = 0;
+};
+
+/** @brief Where Letterbox() put the scaled image inside the destination. */
+struct LetterboxInfo {
+  float scale;        ///< Destination pixels per source pixel
+  ImageRect content;  ///< Scaled image; the rest is padding
+};
+
+/**
+ * @brief Convert NV12/NV21 to packed RGB888 (or BGR with @p order).
+ * @return kInvalidArgument unless @p src is kNv12/kNv21 and @p dst is a
+ *         kRgb888 view of the same size; cache maintenance errors.
+ */
+Result<void> Nv12ToRgb(const ImageView& src, const ImageView& dst,
+                       ChannelOrder order = ChannelOrder::kRgb,
+                       unsigned threads = 1);
+
+/**
+ * @brief Scale @p src to the size of @p dst (pixel centres aligned).
+ * @return kInvalidArgument unless both are kGray8 or both kRgb888.
+ * @note Pass src.Crop(rect) to scale a region; pass dst.Crop(rect) to
+ *       write into a region, which is then the only part flushed.
+ */
+Result<void> Resize(const ImageView& src, const ImageView& dst,
+                    ResizeFilter filter = ResizeFilter::kBilinear,
+                    unsigned threads = 1);
+
+/**
+ * @brief Scale @p src into @p dst keeping the aspect ratio, centred, and
+ *        fill the border with @p pad.
+ * @return Scale and placement, to map detections back; Resize() errors.
+ */
+Result<LetterboxInfo> Letterbox(const ImageView& src, const ImageView& dst,
+                                ResizeFilter filter = ResizeFilter::kBilinear,
+                                uint8_t pad = 114, unsigned threads = 1);
+
+/**
+ * @brief Copy @p rect of @p src into @p dst, every plane.
+ * @return kInvalidArgument unless the formats match and @p dst is
+ *         rect-sized; ImageView::Crop() errors for @p rect.
+ */
+Result<void> CropImage(const ImageView& src, const ImageRect& rect,
+                       const ImageView& dst, unsigned threads = 1);
+
+/**
+ * @brief Quantize @p src (kGray8 or kRgb888) into @p dst.
+ * @return kInvalidArgument for a size or channel mismatch, an unmapped
+ *         view or a tensor past the end of its view.
+ */
+Result<void> ToTensor(const ImageView& src, const TensorView& dst,
+                      const QuantParams& q = QuantParams(),
+                      unsigned threads = 1);
+
+/** @brief Name of the kernels in use: "neon" or "scalar". */
+const char* PreprocessKernelName();
+
+}  // namespace axsys
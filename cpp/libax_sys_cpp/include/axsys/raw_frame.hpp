@@ -0,0 +1,149 @@
+/**
+ * @file raw_frame.hpp
+ * @brief Owning handle for a captured frame that returns it to its pool.
+ *
+ * A frame obtained from AX_VIN_GetRawFrame (or any other pool-backed
+ * source) pins one block of a small private pool until it is released.
+ * Forgetting a release on an error path starves the pool and stalls the
+ * pipe. RawFrame owns such a frame: it is move-only, can be handed to
+ * another thread (e.g. through FrameQueue), and runs its release action
+ * exactly once when destroyed or explicitly released.
+ *
+ * Plane memory is exposed as CmmView on demand. Nothing is mapped until
+ * Plane() is called, so frames that are only counted or forwarded by
+ * physical address cost no AX_SYS_Mmap.
+ *
+ * PoolGauge tracks how many frames are currently held against the pool
+ * depth, so pool starvation shows up as a number instead of a stall.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::PoolGauge gauge(4);  // VIN private pool depth
+ * // see axsys/vin_raw_frame.hpp for the AX_VIN adapter
+ * auto r = axsys::GetVinRawFrame(pipe, node, hdr, 1000, &gauge);
+ * if (!r) return;
+ * axsys::RawFrame frame = r.MoveValue();
+ * auto plane = frame.Plane(0);
+ * if (plane) Consume(plane.Value()->Data(), plane.Value()->Size());
+ * // frame released here, on every path
+ * @endcode
+ *
+ * @warning Release frames before the pool behind them is destroyed
+ *          (e.g. before AX_VIN_DestroyPipe).
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/**
+ * @brief Occupancy counters for a pool of fixed depth.
+ *
+ * All members are lock-free; OnAcquire/OnRelease are called by RawFrame
+ * and Read() may be polled from a monitoring thread.
+ */
+class PoolGauge {
+ public:
+  struct Snapshot {
+    uint32_t capacity;   ///< Pool depth passed to the constructor
+    uint32_t held;       ///< Frames currently outstanding
+    uint32_t peak;       ///< Highest value of held so far
+    uint64_t acquired;   ///< Total frames handed out
+    uint64_t released;   ///< Total frames returned
+    uint64_t exhausted;  ///< Acquisitions that left no free block
+  };
+
+  explicit PoolGauge(uint32_t capacity);
+  PoolGauge(const PoolGauge&) = delete;
+  PoolGauge& operator=(const PoolGauge&) = delete;
+
+  void OnAcquire();
+  void OnRelease();
+  Snapshot Read() const;
+
+ private:
+  const uint32_t capacity_;
+  std::atomic<uint32_t> held_;
+  std::atomic<uint32_t> peak_;
+  std::atomic<uint64_t> acquired_;
+  std::atomic<uint64_t> released_;
+  std::atomic<uint64_t> exhausted_;
+};
+
+class RawFrame {
+ public:
+  static constexpr uint32_t kMaxPlanes = 3;
+
+  struct PlaneInfo {
+    uint64_t phys;    ///< Physical address of the plane
+    uint32_t stride;  ///< Bytes per row (sources convert pixel strides)
+    uint32_t size;    ///< Bytes to map for this plane
+  };
+
+  /** @brief Source-independent description of the frame. */
+  struct Info {
+    uint32_t width;
+    uint32_t height;
+    int32_t format;  ///< Source pixel format (e.g. AX_IMG_FORMAT_E)
+    uint64_t pts;
+    uint64_t seq;
+    uint32_t plane_count;
+    PlaneInfo planes[kMaxPlanes];
+  };
+
+  /** @brief Returns the frame to its source. Called exactly once. */
+  using Releaser = std::function<void()>;
+
+  /** @brief Empty handle; Release() is a no-op. */
+  RawFrame();
+  /**
+   * @param info Frame description; plane_count must be <= kMaxPlanes.
+   * @param release Action returning the frame to its pool.
+   * @param gauge Optional occupancy gauge; must outlive the frame.
+   * @param mode Cache mode used when planes are mapped.
+   */
+  RawFrame(const Info& info, Releaser release, PoolGauge* gauge = nullptr,
+           CacheMode mode = CacheMode::kNonCached);
+  RawFrame(RawFrame&& other) noexcept;
+  RawFrame& operator=(RawFrame&& other) noexcept;
+  RawFrame(const RawFrame&) = delete;
+  RawFrame& operator=(const RawFrame&) = delete;
+  /** @brief Releases the frame if still held. */
+  ~RawFrame();
+
+  /** @brief True while the frame is held. */
+  explicit operator bool() const;
+
+  /** @brief Frame description. Must only be called on a held frame. */
+  const Info& GetInfo() const;
+
+  /**
+   * @brief Zero-copy view of one plane, mapped on first access.
+   * @return Pointer to a view owned by the frame; valid until Release().
+   *         kOutOfRange for a bad index, kNoAllocation on an empty handle,
+   *         mapping errors from CmmBuffer otherwise.
+   * @note Not thread-safe; call from the thread currently owning the frame.
+   */
+  Result<CmmView*> Plane(uint32_t index);
+
+  /**
+   * @brief Unmap planes and return the frame to its pool now.
+   *
+   * Safe to call from any thread that owns the handle, and more than
+   * once; only the first call releases.
+   */
+  void Release();
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
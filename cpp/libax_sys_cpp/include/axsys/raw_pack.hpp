@@ -0,0 +1,88 @@
+/**
+ * @file raw_pack.hpp
+ * @brief RAW10 packed <-> 16-bit sample conversion kernels.
+ *
+ * VIN delivers AX_FORMAT_BAYER_RAW_10BPP_PACKED frames: every four
+ * pixels occupy five bytes, packed LSB first (pixel 0 in bits 0-9 of the
+ * 40-bit little-endian group, pixel 1 in bits 10-19, ...). Tools further
+ * down the line want one uint16_t per pixel. The kernels here convert
+ * between the two layouts row by row, honour independent source and
+ * destination strides, and can split the rows across threads.
+ *
+ * Implementation is chosen at build/run time: NEON on aarch64, SSSE3 on
+ * x86 CPUs that support it, portable scalar code otherwise. All paths
+ * produce identical output.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::RawGeometry g;
+ * g.width = 3840; g.height = 2160;
+ * g.packed_stride = 3840 * 10 / 8;
+ * g.unpacked_stride = 3840 * 2;
+ * auto r = axsys::UnpackRaw10(&raw10_view, &raw16_view, g, 4);
+ * if (!r) fprintf(stderr, "%s\n", r.Message().c_str());
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief Frame geometry for the RAW10 kernels. Strides are in bytes. */
+struct RawGeometry {
+  uint32_t width;          ///< Pixels per row
+  uint32_t height;         ///< Rows
+  size_t packed_stride;    ///< RAW10 row pitch, >= ceil(width * 10 / 8)
+  size_t unpacked_stride;  ///< RAW16 row pitch, >= width * 2, even
+};
+
+/** @brief Bytes used by one packed RAW10 row of @p width pixels. */
+inline size_t Raw10RowBytes(uint32_t width) {
+  return (static_cast<size_t>(width) * 10 + 7) / 8;
+}
+
+/**
+ * @brief Unpack RAW10 rows into 16-bit samples (values 0..1023).
+ *
+ * Reads ceil(width * 10 / 8) bytes of each source row and writes width
+ * samples to each destination row. Padding bytes are left untouched.
+ */
+void UnpackRaw10Rows(const uint8_t* src, size_t src_stride, uint16_t* dst,
+                     size_t dst_stride, uint32_t width, uint32_t rows);
+
+/**
+ * @brief Pack 16-bit samples into RAW10 rows.
+ *
+ * Only the low 10 bits of each sample are used. Writes exactly
+ * ceil(width * 10 / 8) bytes per destination row.
+ */
+void PackRaw10Rows(const uint16_t* src, size_t src_stride, uint8_t* dst,
+                   size_t dst_stride, uint32_t width, uint32_t rows);
+
+/**
+ * @brief Unpack a RAW10 view into a RAW16 view.
+ * @param src Packed frame. Invalidated first when mapped kCached.
+ * @param dst Unpacked frame. Written rows are flushed when kCached.
+ * @param threads Number of threads the rows are split across (>= 1).
+ * @return kInvalidArgument for bad geometry or views too small for it,
+ *         cache maintenance errors otherwise.
+ */
+Result<void> UnpackRaw10(CmmView* src, CmmView* dst, const RawGeometry& g,
+                         unsigned threads = 1);
+
+/**
+ * @brief Pack a RAW16 view into a RAW10 view.
+ * @sa UnpackRaw10 (same cache handling with roles swapped).
+ */
+Result<void> PackRaw10(CmmView* src, CmmView* dst, const RawGeometry& g,
+                       unsigned threads = 1);
+
+/** @brief Name of the kernel in use: "neon", "ssse3" or "scalar". */
+const char* Raw10KernelName();
+
+}  // namespace axsys
@@ -0,0 +1,101 @@
+/**
+ * @file replay_frame_source.hpp
+ * @brief FrameSource that replays a recorded capture file.
+ *
+ * Frames come from a capture container (axsys/capture_file.hpp) mapped
+ * read-only. Like a VIN pipe, the source owns a fixed number of CMM
+ * blocks: each delivered frame is copied into a free block and pins it
+ * until the RawFrame is released. When every block is held, Next() waits
+ * (and reports kTimeout), exactly as AX_VIN_GetRawFrame does when the
+ * consumer sits on the private pool.
+ *
+ * Pacing
+ * - fps_x1000 == 0: frames are delivered as fast as blocks free up.
+ * - fps_x1000 > 0: frame k is due at start + k / fps. With drop_late, a
+ *   consumer that falls a period or more behind skips to the newest
+ *   due frame, the way a free-running sensor overwrites frames nobody
+ *   picked up; skipped frames show as sequence gaps and in Stats.
+ *
+ * Looped replays keep seq and PTS increasing: each pass adds the span of
+ * the recording to the recorded values.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::ReplayFrameSource::Options opt;
+ * opt.fps_x1000 = axsys::ReplayFrameSource::kRecordedRate;
+ * axsys::PoolGauge gauge(opt.depth);
+ * axsys::ReplayFrameSource src;
+ * if (!src.Open("capture.axcap", opt, &gauge)) return;
+ * auto r = src.Next(1000);  // RawFrame backed by a CMM block
+ * @endcode
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "axsys/capture_file.hpp"
+#include "axsys/cmm.hpp"
+#include "axsys/frame_source.hpp"
+#include "axsys/raw_frame.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+class ReplayFrameSource : public FrameSource {
+ public:
+  /** @brief fps_x1000 value that selects the rate stored in the file. */
+  static constexpr uint32_t kRecordedRate = UINT32_MAX;
+
+  struct Options {
+    uint32_t depth = 4;       ///< CMM blocks, as the VIN pool block count
+    uint32_t fps_x1000 = 0;   ///< Frame rate * 1000; 0 = unpaced
+    bool loop = false;        ///< Restart at the first frame after the last
+    bool drop_late = true;    ///< Skip frames a paced consumer missed
+    CacheMode mode = CacheMode::kNonCached;  ///< Passed to RawFrame
+  };
+
+  struct Stats {
+    uint64_t delivered;  ///< Frames returned by Next()
+    uint64_t dropped;    ///< Frames skipped by drop_late
+    uint64_t passes;     ///< Completed passes over the file
+  };
+
+  ReplayFrameSource();
+  ReplayFrameSource(const ReplayFrameSource&) = delete;
+  ReplayFrameSource& operator=(const ReplayFrameSource&) = delete;
+  ~ReplayFrameSource() override;
+
+  /**
+   * @brief Map @p path and allocate the block pool.
+   * @param gauge Optional occupancy gauge; must outlive every frame.
+   * @return Errors from CaptureReader::Open or CmmBuffer::Allocate;
+   *         kInvalidArgument for an empty stream or depth 0.
+   */
+  Result<void> Open(const char* path, const Options& options,
+                    PoolGauge* gauge = nullptr);
+
+  /**
+   * @brief Stop replaying and unmap the file.
+   * @note Frames still held stay valid; their blocks are freed when the
+   *       last one is released.
+   */
+  void Close();
+
+  /** @brief Stream header of the open file. */
+  const CaptureStreamInfo& StreamInfo() const;
+  size_t FrameCount() const;
+  Stats GetStats() const;
+
+  /**
+   * @brief Next frame in file order (see Pacing).
+   * @return kClosed after the last frame unless looping, kNotInitialized
+   *         when not open, kTimeout as described in FrameSource.
+   */
+  Result<RawFrame> Next(int32_t timeout_ms) override;
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
@@ -0,0 +1,121 @@
+/**
+ * @file tensor_arena.hpp
+ * @brief Static memory planning of inference tensors into one CMM block.
+ *
+ * Allocating every intermediate tensor of a network as its own CmmBuffer
+ * costs the sum of all tensor sizes, although most tensors are dead long
+ * before the last ones are born. PlanTensorArena() takes each tensor's
+ * size, alignment and the first and last step that use it, and assigns
+ * offsets inside one arena so that tensors whose lifetimes overlap never
+ * share bytes. TensorArena allocates the arena and hands out each
+ * tensor's mapping and physical address.
+ *
+ * Two strategies share one placement rule (the smallest gap between
+ * already placed, lifetime-overlapping tensors that fits, else the end):
+ * - kGreedyBySize places the largest tensors first.
+ * - kBestFit places tensors in order of first use, as they are produced.
+ *
+ * Usage example
+ * @code{.cpp}
+ * std::vector<axsys::TensorSpec> t = {
+ *     {"conv1", 1 << 20, 64, 0, 1}, {"conv2", 1 << 20, 64, 1, 2},
+ *     {"fc", 4096, 64, 2, 3}};
+ * axsys::TensorArena arena;
+ * if (!arena.Allocate(t, axsys::ArenaStrategy::kGreedyBySize,
+ *                     axsys::CacheMode::kNonCached, "arena")) return;
+ * printf("arena %" PRIu64 " bytes, naive %" PRIu64 "\n",
+ *        arena.Plan().arena_size, arena.Plan().naive_size);
+ * npu_input_phys = arena.Phys(0);
+ * @endcode
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "axsys/cmm.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/** @brief One tensor to place. Steps are inclusive. */
+struct TensorSpec {
+  std::string name;
+  uint64_t size;
+  uint64_t alignment;  ///< Power of two up to 4096; 0 means 1
+  uint32_t first_use;
+  uint32_t last_use;
+};
+
+enum class ArenaStrategy { kGreedyBySize = 0, kBestFit = 1 };
+
+struct ArenaPlan {
+  std::vector<uint64_t> offsets;  ///< Per tensor, in input order
+  uint64_t arena_size;   ///< Planned peak: bytes the arena needs
+  uint64_t naive_size;   ///< One buffer per tensor: sizes summed
+  uint64_t lower_bound;  ///< Largest sum of sizes live at one step
+};
+
+/**
+ * @brief Compute offsets for @p tensors.
+ * @return kInvalidArgument for a size of 0, last_use < first_use, or an
+ *         alignment that is not a power of two or exceeds 4096.
+ */
+Result<ArenaPlan> PlanTensorArena(const std::vector<TensorSpec>& tensors,
+                                  ArenaStrategy strategy);
+
+/**
+ * @brief True if every offset is aligned, every tensor fits in the arena
+ *        and no two tensors with overlapping lifetimes overlap in memory.
+ */
+bool CheckTensorArena(const std::vector<TensorSpec>& tensors,
+                      const ArenaPlan& plan);
+
+/**
+ * @brief One CMM allocation holding a planned set of tensors.
+ *
+ * The arena is mapped once; Data() and Phys() are plain arithmetic on
+ * that mapping. Not thread-safe for Allocate()/Free().
+ */
+class TensorArena {
+ public:
+  TensorArena();
+  TensorArena(const TensorArena&) = delete;
+  TensorArena& operator=(const TensorArena&) = delete;
+  ~TensorArena();
+
+  /**
+   * @brief Plan @p tensors and allocate the arena.
+   * @return Errors from PlanTensorArena() and CmmBuffer::Allocate();
+   *         kAlreadyInitialized if allocated.
+   */
+  Result<void> Allocate(const std::vector<TensorSpec>& tensors,
+                        ArenaStrategy strategy, CacheMode mode,
+                        const char* token);
+
+  const ArenaPlan& Plan() const;
+  size_t Count() const;
+
+  /** @brief Tensor @p i in the arena mapping; nullptr if out of range. */
+  void* Data(size_t i) const;
+  /** @brief Physical address of tensor @p i; 0 if out of range. */
+  uint64_t Phys(size_t i) const;
+
+  /**
+   * @brief Separate mapping of tensor @p i in @p mode.
+   * @return kOutOfRange for a bad index, MapView() errors.
+   */
+  Result<CmmView> View(size_t i, CacheMode mode) const;
+
+  /** @brief Unmap and free the arena. Views from View() must be gone. */
+  Result<void> Free();
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
@@ -0,0 +1,204 @@
+/**
+ * @file trace.hpp
+ * @brief Per-call latency tracing of AX_SYS (and AX_VIN) entry points.
+ *
+ * Every AX_SYS call made by libax_sys_cpp is wrapped in AXSYS_TRACED().
+ * While tracing is enabled each call appends one event (start, duration,
+ * bytes involved, return code) to a ring buffer owned by the calling
+ * thread; no lock is taken and nothing is formatted on the hot path.
+ * Timestamps come from the CPU counter (CNTVCT_EL0 on aarch64, TSC on
+ * x86-64) and are converted to wall time only on export.
+ *
+ * Switches
+ * - Runtime: SetEnabled(); off by default. A disabled trace point costs
+ *   one relaxed atomic load.
+ * - Compile time: configure with -DLLM630_AXSYS_TRACE=OFF, which defines
+ *   AXSYS_TRACE=0 for the library and its users. Trace points then expand
+ *   to the bare call and the functions below are no-ops.
+ *
+ * ExportChromeJson() writes the Trace Event Format read by
+ * chrome://tracing and ui.perfetto.dev: one complete ("X") event per call,
+ * one track per thread, with `bytes` and `ret` as arguments.
+ *
+ * Usage example
+ * @code{.cpp}
+ * axsys::trace::SetEnabled(true);
+ * RunPipelineForAWhile();
+ * axsys::trace::SetEnabled(false);
+ * axsys::trace::ExportChromeJson("/tmp/axsys_trace.json");
+ * @endcode
+ *
+ * @note Each thread keeps its most recent kRingEvents events; older ones
+ *       are overwritten. Rings of exited threads are kept until Clear().
+ */
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+#include <vector>
+
+#include "axsys/result.hpp"
+
+#ifndef AXSYS_TRACE
+#define AXSYS_TRACE 1
+#endif
+
+#if AXSYS_TRACE && defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace axsys {
+namespace trace {
+
+/** @brief Traced entry points. */
+enum class Call : uint16_t {
+  kSysInit,
+  kSysDeinit,
+  kMemAlloc,
+  kMemAllocCached,
+  kMemFree,
+  kMmap,
+  kMmapCache,
+  kMmapFast,
+  kMmapCacheFast,
+  kMunmap,
+  kMflushCache,
+  kMinvalidateCache,
+  kMemGetBlockInfoByVirt,
+  kMemGetBlockInfoByPhy,
+  kMemGetPartitionInfo,
+  kMemQueryStatus,
+  kMemGetMaxFreeRegionInfo,
+  kVinGetRawFrame,
+  kVinReleaseRawFrame,
+  kCount
+};
+
+/** @brief SDK function name, e.g. "AX_SYS_MflushCache". */
+const char* CallName(Call call);
+
+/** @brief Events kept per thread before the oldest are overwritten. */
+constexpr uint32_t kRingEvents = 4096;
+
+struct Event {
+  uint64_t start_ns;     ///< CLOCK_MONOTONIC time of the call
+  uint64_t duration_ns;  ///< Time spent inside the call
+  uint64_t bytes;        ///< Size argument (0 when the call has none)
+  int32_t ret;           ///< Return code; -1 for a null pointer result
+  uint32_t tid;          ///< Kernel thread id of the caller
+  Call call;
+};
+
+/** @brief Start or stop recording. No-op when compiled out. */
+void SetEnabled(bool on);
+bool IsEnabled();
+/**
+ * @brief Drop recorded events and the rings of exited threads.
+ * @note Call while tracing is disabled.
+ */
+void Clear();
+
+/** @brief Recorded events of all threads, ordered by start time. */
+std::vector<Event> Snapshot();
+
+/**
+ * @brief Write the recorded events as Chrome trace JSON.
+ * @return kSystemCallFailed if @p path cannot be written.
+ * @note Safe while other threads trace; events overwritten during the
+ *       export are skipped.
+ */
+Result<void> ExportChromeJson(const char* path);
+
+namespace detail {
+
+#if AXSYS_TRACE
+extern std::atomic<bool> g_enabled;
+
+/** Raw counter; converted to nanoseconds on export. */
+inline uint64_t Ticks() {
+#if defined(__aarch64__)
+  uint64_t v;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+  return v;
+#elif defined(__x86_64__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+         static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+void Record(Call call, uint64_t start, uint64_t stop, uint64_t bytes,
+            int32_t ret);
+#endif
+
+inline int32_t ResultCode(int32_t ret) { return ret; }
+inline int32_t ResultCode(const void* ret) { return ret ? 0 : -1; }
+
+}  // namespace detail
+
+/**
+ * @brief Records the enclosing scope as one event of @p call.
+ *
+ * Applications can wrap their own SDK calls the same way libax_sys_cpp
+ * does (see GetVinRawFrame in axsys/vin_raw_frame.hpp).
+ */
+class Scope {
+ public:
+#if AXSYS_TRACE
+  Scope(Call call, uint64_t bytes)
+      : start_(0), bytes_(bytes), ret_(0), call_(call), active_(false) {
+    if (detail::g_enabled.load(std::memory_order_relaxed)) {
+      active_ = true;
+      start_ = detail::Ticks();
+    }
+  }
+  ~Scope() {
+    if (active_) detail::Record(call_, start_, detail::Ticks(), bytes_, ret_);
+  }
+  void SetResult(int32_t ret) { ret_ = ret; }
+#else
+  Scope(Call, uint64_t) {}
+  void SetResult(int32_t) {}
+#endif
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+#if AXSYS_TRACE
+ private:
+  uint64_t start_;
+  uint64_t bytes_;
+  int32_t ret_;
+  Call call_;
+  bool active_;
+#endif
+};
+
+namespace detail {
+template <typename F>
+auto Traced(Call call, uint64_t bytes, F&& f) -> decltype(f()) {
+  Scope scope(call, bytes);
+  auto ret = f();
+  scope.SetResult(ResultCode(ret));
+  return ret;
+}
+}  // namespace detail
+
+}  // namespace trace
+}  // namespace axsys
+
+/**
+ * @brief Evaluate @p expr (an AX call) as trace event Call::@p call.
+ * @param bytes Size argument of the call, recorded with the event.
+ */
+#if AXSYS_TRACE
+#define AXSYS_TRACED(call, bytes, expr)                               \
+  ::axsys::trace::detail::Traced(::axsys::trace::Call::call, (bytes), \
+                                 [&]() { return (expr); })
+#else
+#define AXSYS_TRACED(call, bytes, expr) (static_cast<void>(bytes), (expr))
+#endif
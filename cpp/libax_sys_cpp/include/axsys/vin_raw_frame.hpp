@@ -0,0 +1,163 @@
+/**
+ * @file vin_raw_frame.hpp
+ * @brief AX_VIN adapter producing axsys::RawFrame handles.
+ *
+ * Header-only so libax_sys_cpp itself does not depend on the VIN
+ * libraries; include it from applications that already link them and
+ * have the MSP include directory on their path.
+ *
+ * The returned frame owns a copy of the AX_IMG_INFO_T and calls
+ * AX_VIN_ReleaseRawFrame with the same pipe/node/HDR index when it is
+ * destroyed, from whichever thread destroys it.
+ *
+ * VinFrameSource exposes the same call as a FrameSource, so capture loops
+ * can be exercised on recorded data (axsys/replay_frame_source.hpp).
+ */
+#pragma once
+
+#include <ax_vin_api.h>
+#include <ax_vin_error_code.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+
+#include "axsys/frame_source.hpp"
+#include "axsys/raw_frame.hpp"
+#include "axsys/trace.hpp"
+
+namespace axsys {
+
+/**
+ * @brief Bits per pixel of a RAW Bayer format, 0 for formats this helper
+ *        does not know.
+ */
+inline uint32_t VinRawBitsPerPixel(AX_IMG_FORMAT_E format) {
+  switch (format) {
+    case AX_FORMAT_BAYER_RAW_8BPP:
+      return 8;
+    case AX_FORMAT_BAYER_RAW_10BPP_PACKED:
+      return 10;
+    case AX_FORMAT_BAYER_RAW_12BPP_PACKED:
+      return 12;
+    case AX_FORMAT_BAYER_RAW_16BPP:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Bytes per row of a RAW Bayer frame. VIN reports u32PicStride in
+ *        pixels; formats this helper does not know are taken as one byte
+ *        per pixel.
+ */
+inline uint32_t VinRawRowBytes(const AX_VIDEO_FRAME_T& vf) {
+  const uint32_t bits = VinRawBitsPerPixel(vf.enImgFormat);
+  if (bits == 0) return vf.u32PicStride[0];
+  return static_cast<uint32_t>(
+      (static_cast<uint64_t>(vf.u32PicStride[0]) * bits + 7) / 8);
+}
+
+/**
+ * @brief Bytes occupied by one plane of a RAW Bayer frame.
+ * @return VinRawRowBytes() * height, or fallback for formats this helper
+ *         does not know.
+ */
+inline uint32_t VinRawPlaneBytes(const AX_VIDEO_FRAME_T& vf,
+                                 uint32_t fallback) {
+  if (VinRawBitsPerPixel(vf.enImgFormat) == 0) return fallback;
+  return static_cast<uint32_t>(static_cast<uint64_t>(VinRawRowBytes(vf)) *
+                               static_cast<uint64_t>(vf.u32Height));
+}
+
+/**
+ * @brief RawFrame::Info of a VIN frame; the plane stride is in bytes.
+ * @note Only plane 0 is described; RAW Bayer frames are single-plane.
+ */
+inline RawFrame::Info VinRawFrameInfo(const AX_VIDEO_FRAME_T& vf) {
+  RawFrame::Info info{};
+  info.width = vf.u32Width;
+  info.height = vf.u32Height;
+  info.format = static_cast<int32_t>(vf.enImgFormat);
+  info.pts = vf.u64PTS;
+  info.seq = vf.u64SeqNum;
+  info.plane_count = 1;
+  info.planes[0].phys = vf.u64PhyAddr[0];
+  info.planes[0].stride = VinRawRowBytes(vf);
+  info.planes[0].size = VinRawPlaneBytes(vf, vf.u32FrameSize);
+  return info;
+}
+
+/**
+ * @brief AX_VIN_GetRawFrame wrapped in a RawFrame.
+ * @param timeout_ms Passed through to AX_VIN_GetRawFrame.
+ * @param gauge Optional occupancy gauge for the VIN private pool.
+ * @param mode Cache mode used when the plane is mapped.
+ * @return kTimeout when no frame was ready (AX_ERR_VIN_RES_EMPTY),
+ *         kSystemCallFailed for other VIN errors.
+ * @note The frame is described by VinRawFrameInfo().
+ */
+inline Result<RawFrame> GetVinRawFrame(AX_U8 pipe,
+                                       AX_VIN_PIPE_DUMP_NODE_E node,
+                                       AX_SNS_HDR_FRAME_E hdr,
+                                       AX_S32 timeout_ms,
+                                       PoolGauge* gauge = nullptr,
+                                       CacheMode mode = CacheMode::kNonCached) {
+  std::shared_ptr<AX_IMG_INFO_T> img = std::make_shared<AX_IMG_INFO_T>();
+  AX_S32 ret;
+  {
+    trace::Scope scope(trace::Call::kVinGetRawFrame, 0);
+    ret = AX_VIN_GetRawFrame(pipe, node, hdr, img.get(), timeout_ms);
+    scope.SetResult(ret);
+  }
+  if (ret != 0) {
+    const ErrorCode code = ret == AX_ERR_VIN_RES_EMPTY
+                               ? ErrorCode::kTimeout
+                               : ErrorCode::kSystemCallFailed;
+    return Result<RawFrame>::Error(code, [ret] {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "AX_VIN_GetRawFrame failed: 0x%x",
+               static_cast<unsigned>(ret));
+      return std::string(buf);
+    });
+  }
+
+  const RawFrame::Info info = VinRawFrameInfo(img->tFrameInfo.stVFrame);
+
+  auto release = [pipe, node, hdr, img] {
+    trace::Scope scope(trace::Call::kVinReleaseRawFrame, 0);
+    AX_S32 r = AX_VIN_ReleaseRawFrame(pipe, node, hdr, img.get());
+    scope.SetResult(r);
+    if (r != 0) {
+      fprintf(stderr, "AX_VIN_ReleaseRawFrame failed: 0x%x (seq %" PRIu64 ")\n",
+              static_cast<unsigned>(r),
+              static_cast<uint64_t>(img->tFrameInfo.stVFrame.u64SeqNum));
+    }
+  };
+  return Result<RawFrame>::Ok(RawFrame(info, release, gauge, mode));
+}
+
+/** @brief FrameSource over one VIN pipe dump node (see GetVinRawFrame). */
+class VinFrameSource : public FrameSource {
+ public:
+  VinFrameSource(AX_U8 pipe, AX_VIN_PIPE_DUMP_NODE_E node,
+                 AX_SNS_HDR_FRAME_E hdr, PoolGauge* gauge = nullptr,
+                 CacheMode mode = CacheMode::kNonCached)
+      : pipe_(pipe), node_(node), hdr_(hdr), gauge_(gauge), mode_(mode) {}
+
+  /** @note VIN never reports kClosed; errors are as for GetVinRawFrame. */
+  Result<RawFrame> Next(int32_t timeout_ms) override {
+    return GetVinRawFrame(pipe_, node_, hdr_, timeout_ms, gauge_, mode_);
+  }
+
+ private:
+  AX_U8 pipe_;
+  AX_VIN_PIPE_DUMP_NODE_E node_;
+  AX_SNS_HDR_FRAME_E hdr_;
+  PoolGauge* gauge_;
+  CacheMode mode_;
+};
+
+}  // namespace axsys
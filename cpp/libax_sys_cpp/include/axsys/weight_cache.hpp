@@ -0,0 +1,146 @@
+/**
+ * @file weight_cache.hpp
+ * @brief Resident model-weight cache: weight files loaded into CMM once and
+ *        attached by content hash from other processes.
+ *
+ * Loading a large model means reading hundreds of MiB from flash into CMM
+ * before the first token. WeightCache keeps that copy resident in a
+ * long-lived process (see weight_cache_daemon) and shares it through a
+ * CmmExporter: every blob is published under a key derived from the hash
+ * of its contents, so two paths holding the same weights share one
+ * buffer. A client computes or stores the key, imports it with
+ * CmmImporter and maps the blob without copying; the import is
+ * reference-counted and released when the client drops it or exits.
+ *
+ * Blobs stay resident until CMM runs short: EvictUnderPressure() retires
+ * the least recently imported blobs nobody holds until the free CMM
+ * reported by AX_SYS_MemQueryStatus is back above a threshold.
+ *
+ * Usage example
+ * @code{.cpp}
+ * // Daemon
+ * axsys::WeightCache cache;
+ * cache.Listen("/tmp/axsys_weights.sock");
+ * auto key = cache.Load("/opt/models/qwen.axmodel");  // prints "w3f1c..."
+ * for (;;) { cache.EvictUnderPressure(64 << 20); sleep(1); }
+ *
+ * // LLM process
+ * axsys::CmmImporter importer;
+ * importer.Connect("/tmp/axsys_weights.sock");
+ * auto w = importer.Import(key);  // no copy
+ * if (w) Run(w.Value().View().Data(), w.Value().Descriptor().size);
+ * // kInvalidArgument: not resident (evicted); load the file yourself
+ * @endcode
+ *
+ * @note Imported blobs are read-only by convention. AX_SYS maps CMM
+ *       read-write, so a client that writes through the mapping corrupts
+ *       the weights of every other client.
+ * @note HashWeights() guards against loading the wrong file, not against
+ *       an attacker; it is not a cryptographic hash.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "axsys/cmm_share.hpp"
+#include "axsys/result.hpp"
+
+namespace axsys {
+
+/**
+ * @brief Incremental 64-bit hash of weight data. Feeding the same bytes in
+ *        any chunking gives the same digest.
+ */
+class WeightHasher {
+ public:
+  WeightHasher();
+  void Update(const void* data, size_t size);
+  uint64_t Digest() const;
+
+ private:
+  void Stripe(const uint8_t* p);
+
+  uint64_t lane_[4];
+  uint8_t tail_[32];
+  size_t tail_size_;
+  uint64_t total_;
+};
+
+/** @brief WeightHasher digest of @p size bytes at @p data. */
+uint64_t HashWeights(const void* data, size_t size);
+
+/** @brief Publication key of a digest: "w" and 16 hex digits. */
+std::string WeightKey(uint64_t digest);
+
+/**
+ * @brief Key of the contents of the file at @p path.
+ * @return kInvalidArgument for an empty file, kSystemCallFailed if the
+ *         file cannot be read.
+ */
+Result<std::string> WeightKeyOfFile(const char* path);
+
+/** @brief One resident blob, see WeightCache::Blobs(). */
+struct WeightBlob {
+  std::string key;
+  std::string path;      ///< File first loaded under this key
+  uint64_t size;
+  uint32_t importers;    ///< Imports not yet released
+  uint64_t imports;      ///< Imports since the blob was loaded
+  uint64_t last_use_ns;  ///< CLOCK_MONOTONIC of the last load or import
+};
+
+/**
+ * @brief Owner of the resident weight blobs. All methods are
+ *        thread-safe.
+ */
+class WeightCache {
+ public:
+  WeightCache();
+  WeightCache(const WeightCache&) = delete;
+  WeightCache& operator=(const WeightCache&) = delete;
+  /** @brief Close(). */
+  ~WeightCache();
+
+  /** @brief Serve imports at @p path, see CmmExporter::Listen(). */
+  Result<void> Listen(const char* path);
+
+  /**
+   * @brief Load @p file into a cached CMM buffer (token "weights") with
+   *        LoadFileToCmm() and publish it under its key, computed from
+   *        the same read. A path already loaded with unchanged size and
+   *        mtime is not read again; a file the size of a resident blob is
+   *        hashed first, so resident contents allocate no CMM. Either way
+   *        only the blob's last use is refreshed.
+   * @return The key; kInvalidArgument for an empty file,
+   *         kSystemCallFailed for read errors, allocation errors.
+   */
+  Result<std::string> Load(const char* file);
+
+  /**
+   * @brief Retire least recently used blobs without importers while the
+   *        free CMM is below @p min_free_bytes.
+   * @param max_evictions Upper bound on blobs retired by this call.
+   * @return Blobs retired; 0 if the CMM status cannot be queried.
+   */
+  size_t EvictUnderPressure(uint64_t min_free_bytes,
+                            size_t max_evictions = SIZE_MAX);
+
+  /** @brief Resident blobs in load order. */
+  std::vector<WeightBlob> Blobs() const;
+
+  /**
+   * @brief Stop serving and free every blob; blobs still imported are
+   *        freed once released, see CmmExporter::Close().
+   */
+  void Close();
+
+ private:
+  struct Impl;
+  Impl* impl_;
+};
+
+}  // namespace axsys
@@ -0,0 +1,412 @@
+#include "axsys/capture_file.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace axsys {
+
+namespace {
+
+constexpr char kFileMagic[8] = {'A', 'X', 'S', 'Y', 'S', 'C', 'A', 'P'};
+constexpr char kTrailerMagic[8] = {'A', 'X', 'C', 'A', 'P', 'E', 'N', 'D'};
+constexpr uint32_t kRecordMagic = 0x304d5246;  // "FRM0"
+constexpr uint32_t kIndexMagic = 0x30584449;   // "IDX0"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kAlign = 64;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_bytes;
+  uint32_t width;
+  uint32_t height;
+  uint32_t stride;
+  int32_t format;
+  uint32_t bits_per_pixel;
+  uint32_t packed;
+  uint32_t fps_x1000;
+  uint8_t reserved[20];
+};
+static_assert(sizeof(FileHeader) == 64, "FileHeader layout");
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t header_bytes;
+  uint64_t seq;
+  uint64_t pts;
+  uint64_t payload_bytes;
+  uint8_t reserved[32];
+};
+static_assert(sizeof(RecordHeader) == 64, "RecordHeader layout");
+
+struct IndexHeader {
+  uint32_t magic;
+  uint32_t entry_bytes;
+  uint64_t count;
+};
+static_assert(sizeof(IndexHeader) == 16, "IndexHeader layout");
+
+struct IndexEntry {
+  uint64_t offset;  // payload offset from the start of the file
+  uint64_t size;
+  uint64_t seq;
+  uint64_t pts;
+};
+static_assert(sizeof(IndexEntry) == 32, "IndexEntry layout");
+
+struct Trailer {
+  char magic[8];
+  uint64_t index_offset;
+  uint64_t frame_count;
+  uint64_t reserved;
+};
+static_assert(sizeof(Trailer) == 32, "Trailer layout");
+
+const uint8_t kZeros[kAlign] = {};
+
+size_t PadTo(uint64_t n) { return (kAlign - n % kAlign) % kAlign; }
+
+Result<void> Errno(const char* what) {
+  const int err = errno;
+  return Result<void>::Error(ErrorCode::kSystemCallFailed, [what, err] {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "%s: %s", what, strerror(err));
+    return std::string(buf);
+  });
+}
+
+// writev() until everything is out; pipes may accept partial writes.
+Result<void> WriteAll(int fd, struct iovec* iov, int count) {
+  while (count > 0) {
+    const ssize_t n = writev(fd, iov, count);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return Errno("CaptureWriter writev");
+    }
+    size_t left = static_cast<size_t>(n);
+    while (count > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> BadFile(const char* what) {
+  return Result<void>::Error(ErrorCode::kInvalidArgument, [what] {
+    return std::string("CaptureReader: ") + what;
+  });
+}
+
+}  // namespace
+
+struct CaptureWriter::Impl {
+  int fd = -1;
+  bool owns_fd = false;
+  uint64_t offset = 0;
+  std::vector<IndexEntry> index;
+};
+
+CaptureWriter::CaptureWriter() : impl_(new Impl()) {}
+
+CaptureWriter::~CaptureWriter() {
+  auto r = Close();
+  if (!r) fprintf(stderr, "%s\n", r.Message().c_str());
+  delete impl_;
+}
+
+Result<void> CaptureWriter::Open(int fd, const CaptureStreamInfo& info) {
+  if (impl_->fd >= 0) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("CaptureWriter already open");
+    });
+  }
+  if (fd < 0) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("CaptureWriter::Open requires a valid fd");
+    });
+  }
+  FileHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, kFileMagic, sizeof(h.magic));
+  h.version = kVersion;
+  h.header_bytes = sizeof(FileHeader);
+  h.width = info.width;
+  h.height = info.height;
+  h.stride = info.stride;
+  h.format = info.format;
+  h.bits_per_pixel = info.bits_per_pixel;
+  h.packed = info.packed;
+  h.fps_x1000 = info.fps_x1000;
+  struct iovec iov = {&h, sizeof(h)};
+  auto r = WriteAll(fd, &iov, 1);
+  if (!r) return r;
+  impl_->fd = fd;
+  impl_->offset = sizeof(h);
+  impl_->index.clear();
+  impl_->index.reserve(1024);
+  return Result<void>::Ok();
+}
+
+Result<void> CaptureWriter::Open(const char* path,
+                                 const CaptureStreamInfo& info) {
+  if (!path) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("CaptureWriter::Open requires a path");
+    });
+  }
+  const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return Errno("CaptureWriter open");
+  auto r = Open(fd, info);
+  if (!r) {
+    close(fd);
+    return r;
+  }
+  impl_->owns_fd = true;
+  return r;
+}
+
+Result<void> CaptureWriter::Append(const void* data, size_t size,
+                                   uint64_t seq, uint64_t pts) {
+  if (impl_->fd < 0) {
+    return Result<void>::Error(ErrorCode::kNotInitialized, [] {
+      return std::string("CaptureWriter not open");
+    });
+  }
+  if (!data && size != 0) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("CaptureWriter::Append requires data");
+    });
+  }
+  RecordHeader rh;
+  memset(&rh, 0, sizeof(rh));
+  rh.magic = kRecordMagic;
+  rh.header_bytes = sizeof(RecordHeader);
+  rh.seq = seq;
+  rh.pts = pts;
+  rh.payload_bytes = size;
+  struct iovec iov[3] = {
+      {&rh, sizeof(rh)},
+      {const_cast<void*>(data), size},
+      {const_cast<uint8_t*>(kZeros), PadTo(size)},
+  };
+  auto r = WriteAll(impl_->fd, iov, 3);
+  if (!r) return r;
+  const uint64_t payload = impl_->offset + sizeof(rh);
+  impl_->index.push_back(IndexEntry{payload, size, seq, pts});
+  impl_->offset = payload + size + PadTo(size);
+  return Result<void>::Ok();
+}
+
+Result<void> CaptureWriter::Close() {
+  if (impl_->fd < 0) return Result<void>::Ok();
+  IndexHeader ih;
+  ih.magic = kIndexMagic;
+  ih.entry_bytes = sizeof(IndexEntry);
+  ih.count = impl_->index.size();
+  Trailer t;
+  memset(&t, 0, sizeof(t));
+  memcpy(t.magic, kTrailerMagic, sizeof(t.magic));
+  t.index_offset = impl_->offset;
+  t.frame_count = ih.count;
+  const size_t index_bytes = impl_->index.size() * sizeof(IndexEntry);
+  const size_t pad = PadTo(sizeof(ih) + index_bytes + sizeof(t));
+  struct iovec iov[4] = {
+      {&ih, sizeof(ih)},
+      {impl_->index.data(), index_bytes},
+      {const_cast<uint8_t*>(kZeros), pad},
+      {&t, sizeof(t)},
+  };
+  auto r = WriteAll(impl_->fd, iov, 4);
+  if (r) impl_->offset += sizeof(ih) + index_bytes + pad + sizeof(t);
+  if (impl_->owns_fd && close(impl_->fd) != 0 && r) {
+    r = Errno("CaptureWriter close");
+  }
+  impl_->fd = -1;
+  impl_->owns_fd = false;
+  return r;
+}
+
+uint64_t CaptureWriter::FrameCount() const { return impl_->index.size(); }
+
+uint64_t CaptureWriter::BytesWritten() const { return impl_->offset; }
+
+struct CaptureReader::Impl {
+  const uint8_t* base = nullptr;
+  size_t size = 0;
+  CaptureStreamInfo info{};
+  bool indexed = false;
+  // Points into the mapping when the trailer index is present, otherwise
+  // at `scanned`.
+  const IndexEntry* entries = nullptr;
+  size_t count = 0;
+  std::vector<IndexEntry> scanned;
+
+  bool LoadTrailerIndex() {
+    if (size < sizeof(FileHeader) + sizeof(IndexHeader) + sizeof(Trailer)) {
+      return false;
+    }
+    Trailer t;
+    memcpy(&t, base + size - sizeof(t), sizeof(t));
+    if (memcmp(t.magic, kTrailerMagic, sizeof(t.magic)) != 0) return false;
+    if (t.index_offset < sizeof(FileHeader) ||
+        t.index_offset > size - sizeof(Trailer) - sizeof(IndexHeader) ||
+        t.index_offset % kAlign != 0) {
+      return false;
+    }
+    IndexHeader ih;
+    memcpy(&ih, base + t.index_offset, sizeof(ih));
+    const uint64_t room =
+        (size - sizeof(Trailer) - t.index_offset - sizeof(ih)) /
+        sizeof(IndexEntry);
+    if (ih.magic != kIndexMagic || ih.entry_bytes != sizeof(IndexEntry) ||
+        ih.count != t.frame_count || ih.count > room) {
+      return false;
+    }
+    const IndexEntry* e =
+        reinterpret_cast<const IndexEntry*>(base + t.index_offset + sizeof(ih));
+    for (uint64_t i = 0; i < ih.count; ++i) {
+      if (e[i].offset > t.index_offset ||
+          e[i].size > t.index_offset - e[i].offset) {
+        return false;
+      }
+    }
+    entries = e;
+    count = ih.count;
+    return true;
+  }
+
+  // Walk records from the stream header until something else shows up.
+  void ScanRecords() {
+    scanned.clear();
+    uint64_t off = sizeof(FileHeader);
+    while (off + sizeof(RecordHeader) <= size) {
+      RecordHeader rh;
+      memcpy(&rh, base + off, sizeof(rh));
+      if (rh.magic != kRecordMagic || rh.header_bytes != sizeof(rh)) break;
+      const uint64_t payload = off + sizeof(rh);
+      if (rh.payload_bytes > size - payload) break;  // truncated frame
+      scanned.push_back(IndexEntry{payload, rh.payload_bytes, rh.seq, rh.pts});
+      off = payload + rh.payload_bytes + PadTo(rh.payload_bytes);
+    }
+    entries = scanned.data();
+    count = scanned.size();
+  }
+};
+
+CaptureReader::CaptureReader() : impl_(new Impl()) {}
+
+CaptureReader::~CaptureReader() {
+  Close();
+  delete impl_;
+}
+
+Result<void> CaptureReader::Open(const char* path) {
+  Close();
+  if (!path) return BadFile("no path");
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return Errno("CaptureReader open");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    auto r = Errno("CaptureReader fstat");
+    close(fd);
+    return r;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  if (size < sizeof(FileHeader)) {
+    close(fd);
+    return BadFile("file shorter than the stream header");
+  }
+  void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    auto r = Errno("CaptureReader mmap");
+    close(fd);
+    return r;
+  }
+  close(fd);
+  impl_->base = static_cast<const uint8_t*>(p);
+  impl_->size = size;
+
+  FileHeader h;
+  memcpy(&h, impl_->base, sizeof(h));
+  if (memcmp(h.magic, kFileMagic, sizeof(h.magic)) != 0 ||
+      h.header_bytes != sizeof(FileHeader)) {
+    Close();
+    return BadFile("bad stream header");
+  }
+  if (h.version != kVersion) {
+    Close();
+    return BadFile("unsupported version");
+  }
+  impl_->info.width = h.width;
+  impl_->info.height = h.height;
+  impl_->info.stride = h.stride;
+  impl_->info.format = h.format;
+  impl_->info.bits_per_pixel = h.bits_per_pixel;
+  impl_->info.packed = h.packed;
+  impl_->info.fps_x1000 = h.fps_x1000;
+
+  impl_->indexed = impl_->LoadTrailerIndex();
+  if (!impl_->indexed) impl_->ScanRecords();
+  return Result<void>::Ok();
+}
+
+void CaptureReader::Close() {
+  if (impl_->base) {
+    munmap(const_cast<uint8_t*>(impl_->base), impl_->size);
+  }
+  impl_->base = nullptr;
+  impl_->size = 0;
+  impl_->info = CaptureStreamInfo{};
+  impl_->indexed = false;
+  impl_->entries = nullptr;
+  impl_->count = 0;
+  impl_->scanned.clear();
+}
+
+const CaptureStreamInfo& CaptureReader::Info() const { return impl_->info; }
+
+size_t CaptureReader::FrameCount() const { return impl_->count; }
+
+bool CaptureReader::Indexed() const { return impl_->indexed; }
+
+Result<CaptureReader::Frame> CaptureReader::GetFrame(size_t index) const {
+  if (!impl_->base) {
+    return Result<Frame>::Error(ErrorCode::kNotInitialized, [] {
+      return std::string("CaptureReader not open");
+    });
+  }
+  if (index >= impl_->count) {
+    const size_t count = impl_->count;
+    return Result<Frame>::Error(ErrorCode::kOutOfRange, [index, count] {
+      char buf[96];
+      snprintf(buf, sizeof(buf), "frame %zu out of range (%zu frames)", index,
+               count);
+      return std::string(buf);
+    });
+  }
+  const IndexEntry& e = impl_->entries[index];
+  Frame f;
+  f.data = impl_->base + e.offset;
+  f.size = e.size;
+  f.seq = e.seq;
+  f.pts = e.pts;
+  return Result<Frame>::Ok(f);
+}
+
+}  // namespace axsys
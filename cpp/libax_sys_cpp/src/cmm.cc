@@ -4,13 +4,21 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "axsys/cmm_budget.hpp"
+#include "axsys/cmm_stats.hpp"
+#include "axsys/epoch.hpp"
+#include "axsys/flight_recorder.hpp"
+#include "axsys/trace.hpp"
+
 namespace axsys {
 
 namespace {
@@ -29,30 +37,35 @@ struct Allocation {
   std::vector<ViewEntry> views;
   bool owned;
   void* base_vir;
+  detail::CmmTokenCounters* stats;  // owned allocations only
   Allocation()
       : phy(0),
         size(0),
         mode(CacheMode::kNonCached),
         owned(false),
-        base_vir(nullptr) {}
+        base_vir(nullptr),
+        stats(nullptr) {}
 };
 
 static void* DoMmap(AX_U64 phys, size_t size, CacheMode mode) {
   if (size > 0xFFFFFFFFu) return nullptr;
   AX_U32 sz = static_cast<AX_U32>(size);
-  if (mode == CacheMode::kCached) {
-    return AX_SYS_MmapCache(phys, sz);
-  }
-  return AX_SYS_Mmap(phys, sz);
+  void* v = mode == CacheMode::kCached
+                ? AXSYS_TRACED(kMmapCache, sz, AX_SYS_MmapCache(phys, sz))
+                : AXSYS_TRACED(kMmap, sz, AX_SYS_Mmap(phys, sz));
+  flight::Record(flight::Op::kMap, phys, v, sz, mode, v ? 0 : -1);
+  return v;
 }
 
 static void* DoMmapFast(AX_U64 phys, size_t size, CacheMode mode) {
   if (size > 0xFFFFFFFFu) return nullptr;
   AX_U32 sz = static_cast<AX_U32>(size);
-  if (mode == CacheMode::kCached) {
-    return AX_SYS_MmapCacheFast(phys, sz);
-  }
-  return AX_SYS_MmapFast(phys, sz);
+  void* v =
+      mode == CacheMode::kCached
+          ? AXSYS_TRACED(kMmapCacheFast, sz, AX_SYS_MmapCacheFast(phys, sz))
+          : AXSYS_TRACED(kMmapFast, sz, AX_SYS_MmapFast(phys, sz));
+  flight::Record(flight::Op::kMap, phys, v, sz, mode, v ? 0 : -1);
+  return v;
 }
 }  // namespace
 
@@ -113,7 +126,14 @@ void CmmView::Reset() {
 
   if (local_impl->data) {
     if (local_impl->size <= 0xFFFFFFFFu) {
-      AX_SYS_Munmap(local_impl->data, static_cast<AX_U32>(local_impl->size));
+      const AX_S32 ret = AXSYS_TRACED(
+          kMunmap, local_impl->size,
+          AX_SYS_Munmap(local_impl->data,
+                        static_cast<AX_U32>(local_impl->size)));
+      flight::Record(
+          flight::Op::kUnmap,
+          local_impl->alloc ? local_impl->alloc->phy + local_impl->offset : 0,
+          local_impl->data, local_impl->size, local_impl->mode, ret);
     }
     if (local_impl->alloc) {
       std::lock_guard<std::mutex> lk(local_impl->alloc->mtx);
@@ -160,7 +180,11 @@ Result<void> CmmView::Flush(size_t offset, size_t size) {
   while (remain > 0) {
     AX_U32 chunk =
         remain > 0xFFFFFFFFu ? 0xFFFFFFFFu : static_cast<AX_U32>(remain);
-    AX_S32 ret = AX_SYS_MflushCache(phys, reinterpret_cast<void*>(v), chunk);
+    AX_S32 ret = AXSYS_TRACED(
+        kMflushCache, chunk,
+        AX_SYS_MflushCache(phys, reinterpret_cast<void*>(v), chunk));
+    flight::Record(flight::Op::kFlush, phys, reinterpret_cast<void*>(v), chunk,
+                   impl_->mode, ret);
     if (ret != 0) {
       return Result<void>::Error(ErrorCode::kFlushFailed, [] {
         return std::string("AX_SYS_MflushCache failed");
@@ -202,8 +226,11 @@ Result<void> CmmView::Invalidate(size_t offset, size_t size) {
   while (remain > 0) {
     AX_U32 chunk =
         remain > 0xFFFFFFFFu ? 0xFFFFFFFFu : static_cast<AX_U32>(remain);
-    AX_S32 ret =
-        AX_SYS_MinvalidateCache(phys, reinterpret_cast<void*>(v), chunk);
+    AX_S32 ret = AXSYS_TRACED(
+        kMinvalidateCache, chunk,
+        AX_SYS_MinvalidateCache(phys, reinterpret_cast<void*>(v), chunk));
+    flight::Record(flight::Op::kInvalidate, phys, reinterpret_cast<void*>(v),
+                   chunk, impl_->mode, ret);
     if (ret != 0) {
       return Result<void>::Error(ErrorCode::kInvalidateFailed, [] {
         return std::string("AX_SYS_MinvalidateCache failed");
@@ -251,7 +278,8 @@ Result<CmmView> CmmView::MapView(size_t offset, size_t size,
     a.views.push_back(e);
   } catch (...) {
     if (size <= 0xFFFFFFFFu) {
-      AX_SYS_Munmap(v, static_cast<AX_U32>(size));
+      AXSYS_TRACED(kMunmap, size,
+                   AX_SYS_Munmap(v, static_cast<AX_U32>(size)));
     }
     throw;
   }
@@ -293,7 +321,8 @@ Result<CmmView> CmmView::MapViewFast(size_t offset, size_t size,
     a.views.push_back(e);
   } catch (...) {
     if (size <= 0xFFFFFFFFu) {
-      AX_SYS_Munmap(v, static_cast<AX_U32>(size));
+      AXSYS_TRACED(kMunmap, size,
+                   AX_SYS_Munmap(v, static_cast<AX_U32>(size)));
     }
     throw;
   }
@@ -337,7 +366,9 @@ void CmmView::Dump(uintptr_t offset) const {
       reinterpret_cast<uintptr_t>(impl_->data) + offset);
   AX_U64 phys = 0;
   AX_S32 cache_type = 0;
-  if (AX_SYS_MemGetBlockInfoByVirt(virt, &phys, &cache_type) == 0) {
+  if (AXSYS_TRACED(kMemGetBlockInfoByVirt, 0,
+                   AX_SYS_MemGetBlockInfoByVirt(virt, &phys, &cache_type)) ==
+      0) {
     printf("  ByVirt: v=%p -> phy=0x%" PRIx64 ", cacheType=%d\n", virt,
            static_cast<uint64_t>(phys), cache_type);
   } else {
@@ -389,14 +420,36 @@ Result<CmmView> CmmBuffer::Allocate(size_t size, CacheMode mode,
     void* vir = nullptr;
     AX_S32 ret = 0;
     const AX_U32 sz = static_cast<AX_U32>(size);
+    detail::CmmTokenCounters* stats = detail::InternCmmToken(token);
+    if (!detail::ChargeCmmBudget(stats, token, size)) {
+      detail::RecordCmmAllocate(stats, size, false, 0);
+      return Result<CmmView>::Error(ErrorCode::kAllocationFailed, [size] {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "CMM budget exceeded: 0x%zx", size);
+        return std::string(buf);
+      });
+    }
+    const auto t0 = std::chrono::steady_clock::now();
     if (mode == CacheMode::kCached) {
-      ret = AX_SYS_MemAllocCached(&phy, &vir, sz, 0x1000,
-                                  reinterpret_cast<const AX_S8*>(token));
+      ret = AXSYS_TRACED(
+          kMemAllocCached, sz,
+          AX_SYS_MemAllocCached(&phy, &vir, sz, 0x1000,
+                                reinterpret_cast<const AX_S8*>(token)));
     } else {
-      ret = AX_SYS_MemAlloc(&phy, &vir, sz, 0x1000,
-                            reinterpret_cast<const AX_S8*>(token));
+      ret = AXSYS_TRACED(
+          kMemAlloc, sz,
+          AX_SYS_MemAlloc(&phy, &vir, sz, 0x1000,
+                          reinterpret_cast<const AX_S8*>(token)));
     }
+    const auto t1 = std::chrono::steady_clock::now();
+    detail::RecordCmmAllocate(
+        stats, size, ret == 0,
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+                .count()));
+    flight::Record(flight::Op::kAllocate, phy, vir, size, mode, ret);
     if (ret != 0) {
+      detail::ReleaseCmmBudget(stats, size, false);
       return Result<CmmView>::Error(ErrorCode::kAllocationFailed, [] {
         return std::string("AX_SYS_MemAlloc failed");
       });
@@ -408,6 +461,7 @@ Result<CmmView> CmmBuffer::Allocate(size_t size, CacheMode mode,
     a->mode = mode;
     a->owned = true;
     a->base_vir = vir;
+    a->stats = stats;
 
     // Transfer ownership to shared_ptr with custom deleter
     // If this throws, unique_ptr will clean up (but won't call AX_SYS_MemFree)
@@ -417,20 +471,33 @@ Result<CmmView> CmmBuffer::Allocate(size_t size, CacheMode mode,
           std::shared_ptr<Allocation>(a.release(), [](Allocation* p) {
             if (!p) return;
             if (p->owned && p->phy != 0) {
-              AX_S32 r = AX_SYS_MemFree(p->phy, p->base_vir);
-              if (r != 0) {
+              AX_S32 r = AXSYS_TRACED(kMemFree, p->size,
+                                      AX_SYS_MemFree(p->phy, p->base_vir));
+              flight::Record(flight::Op::kFree, p->phy, p->base_vir, p->size,
+                             p->mode, r);
+              if (r == 0) {
+                detail::RecordCmmFree(p->stats, p->size);
+                detail::ReleaseCmmBudget(p->stats, p->size, true);
+              } else {
                 printf(
                     "[CmmBuffer::Deleter] AX_SYS_MemFree failed: 0x%X "
                     "(phy=0x%" PRIx64 ")\n",
                     static_cast<unsigned int>(r),
                     static_cast<uint64_t>(p->phy));
+                fflush(stdout);
+                flight::Dump(STDERR_FILENO);
               }
             }
             delete p;
           });
     } catch (...) {
       // shared_ptr construction failed, need to free the allocation
-      AX_SYS_MemFree(phy, vir);
+      const AX_S32 r = AXSYS_TRACED(kMemFree, size, AX_SYS_MemFree(phy, vir));
+      flight::Record(flight::Op::kFree, phy, vir, size, mode, r);
+      if (r == 0) {
+        detail::RecordCmmFree(stats, size);
+        detail::ReleaseCmmBudget(stats, size, true);
+      }
       throw;
     }
   }
@@ -468,6 +535,29 @@ Result<void> CmmBuffer::Free() {
   return Result<void>::Ok();
 }
 
+Result<void> CmmBuffer::Retire(EpochDomain* domain, CmmView&& view) {
+  if (!domain) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("No epoch domain to retire into");
+    });
+  }
+  auto none = [] {
+    return Result<void>::Error(ErrorCode::kNoAllocation, [] {
+      return std::string("No allocation to retire");
+    });
+  };
+  if (!impl_) return none();
+  CmmBuffer retired;
+  {
+    std::lock_guard<std::mutex> lk(impl_->alloc_mtx);
+    if (!impl_->alloc) return none();
+    retired.impl_->alloc = std::move(impl_->alloc);
+  }
+  if (view) domain->Retire(std::move(view));
+  domain->Retire(std::move(retired));
+  return Result<void>::Ok();
+}
+
 Result<void> CmmBuffer::AttachExternal(uint64_t phys, size_t size) {
   if (!impl_) {
     impl_ = new Impl();
@@ -574,7 +664,8 @@ Result<CmmView> CmmBuffer::MapView(size_t offset, size_t size,
   } catch (...) {
     // Clean up the mmap on exception
     if (size <= 0xFFFFFFFFu) {
-      AX_SYS_Munmap(v, static_cast<AX_U32>(size));
+      AXSYS_TRACED(kMunmap, size,
+                   AX_SYS_Munmap(v, static_cast<AX_U32>(size)));
     }
     throw;
   }
@@ -640,7 +731,8 @@ Result<CmmView> CmmBuffer::MapViewFast(size_t offset, size_t size,
   } catch (...) {
     // Clean up the mmap on exception
     if (size <= 0xFFFFFFFFu) {
-      AX_SYS_Munmap(v, static_cast<AX_U32>(size));
+      AXSYS_TRACED(kMunmap, size,
+                   AX_SYS_Munmap(v, static_cast<AX_U32>(size)));
     }
     throw;
   }
@@ -687,7 +779,9 @@ void CmmBuffer::Dump(uintptr_t offset) const {
   void* vir_out = nullptr;
   AX_U32 blk_sz = 0;
   AX_U64 phy_q = a.phy + static_cast<AX_U64>(offset);
-  AX_S32 r = AX_SYS_MemGetBlockInfoByPhy(phy_q, &cache_type, &vir_out, &blk_sz);
+  AX_S32 r = AXSYS_TRACED(
+      kMemGetBlockInfoByPhy, 0,
+      AX_SYS_MemGetBlockInfoByPhy(phy_q, &cache_type, &vir_out, &blk_sz));
   if (r == 0) {
     printf("  ByPhy:  phy=0x%" PRIx64 " -> virt=%p, cacheType=%d, blkSz=0x%x\n",
            static_cast<uint64_t>(phy_q), vir_out, cache_type, blk_sz);
@@ -721,8 +815,9 @@ bool CmmBuffer::Verify() const {
   AX_U32 blk_size = 0;
   if (a.owned) {
     // Check phys for owned buffers
-    if (AX_SYS_MemGetBlockInfoByPhy(a.phy, &mem_type, &vir_out, &blk_size) !=
-        0) {
+    if (AXSYS_TRACED(kMemGetBlockInfoByPhy, 0,
+                     AX_SYS_MemGetBlockInfoByPhy(a.phy, &mem_type, &vir_out,
+                                                 &blk_size)) != 0) {
       return false;
     }
     if (blk_size != a.size) {
@@ -731,7 +826,8 @@ bool CmmBuffer::Verify() const {
   }
   // Partition range check
   AX_CMM_PARTITION_INFO_T part;
-  if (AX_SYS_MemGetPartitionInfo(&part) == 0) {
+  if (AXSYS_TRACED(kMemGetPartitionInfo, 0,
+                   AX_SYS_MemGetPartitionInfo(&part)) == 0) {
     bool in_range = false;
     for (AX_U32 i = 0; i < part.PartitionCnt; ++i) {
       AX_U64 base = part.PartitionInfo[i].PhysAddr;
@@ -749,7 +845,9 @@ bool CmmBuffer::Verify() const {
   for (size_t i = 0; i < a.views.size(); ++i) {
     const ViewEntry& e = a.views[i];
     AX_U64 phys2 = 0;
-    if (AX_SYS_MemGetBlockInfoByVirt(e.addr, &phys2, &mem_type) != 0) {
+    if (AXSYS_TRACED(kMemGetBlockInfoByVirt, 0,
+                     AX_SYS_MemGetBlockInfoByVirt(e.addr, &phys2,
+                                                  &mem_type)) != 0) {
       return false;
     }
     if (phys2 < a.phy) return false;
@@ -763,7 +861,10 @@ bool CmmBuffer::Verify() const {
 std::vector<CmmBuffer::PartitionInfo> CmmBuffer::QueryPartitions() {
   std::vector<PartitionInfo> v;
   AX_CMM_PARTITION_INFO_T part;
-  if (AX_SYS_MemGetPartitionInfo(&part) != 0) return v;
+  if (AXSYS_TRACED(kMemGetPartitionInfo, 0,
+                   AX_SYS_MemGetPartitionInfo(&part)) != 0) {
+    return v;
+  }
   v.reserve(part.PartitionCnt);
   for (AX_U32 i = 0; i < part.PartitionCnt; ++i) {
     PartitionInfo pi;
@@ -790,7 +891,9 @@ bool CmmBuffer::FindAnonymous(PartitionInfo* out) {
 bool CmmBuffer::MemQueryStatus(CmmStatus* out) {
   if (!out) return false;
   AX_CMM_STATUS_T st;
-  if (AX_SYS_MemQueryStatus(&st) != 0) return false;
+  if (AXSYS_TRACED(kMemQueryStatus, 0, AX_SYS_MemQueryStatus(&st)) != 0) {
+    return false;
+  }
   out->total_size = st.TotalSize;
   out->remain_size = st.RemainSize;
   out->block_count = st.BlockCnt;
@@ -805,4 +908,20 @@ bool CmmBuffer::MemQueryStatus(CmmStatus* out) {
   return true;
 }
 
+bool CmmBuffer::MaxFreeRegion(const char* partition, uint64_t* phys,
+                              uint32_t* size) {
+  if (!phys || !size) return false;
+  const char* name = partition ? partition : "anonymous";
+  AX_U64 p = 0;
+  AX_U32 sz = 0;
+  if (AXSYS_TRACED(kMemGetMaxFreeRegionInfo, 0,
+                   AX_SYS_MemGetMaxFreeRegionInfo(
+                       reinterpret_cast<const AX_S8*>(name), &p, &sz)) != 0) {
+    return false;
+  }
+  *phys = p;
+  *size = sz;
+  return true;
+}
+
 }  // namespace axsys
@@ -0,0 +1,212 @@
+#include "axsys/cmm_allocator.hpp"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace axsys {
+
+namespace {
+
+constexpr size_t kPage = 4096;
+constexpr size_t kMinBlock = 64;
+
+size_t RoundUpPow2(size_t v) {
+  size_t p = kMinBlock;
+  while (p < v) p <<= 1;
+  return p;
+}
+
+}  // namespace
+
+struct CmmArena::Impl {
+  struct Region {
+    CmmBuffer buffer;
+    CmmView view;
+    uint8_t* base = nullptr;
+    size_t size = 0;
+    uint64_t phys = 0;
+    bool large = false;
+  };
+
+  CmmArenaOptions options;
+  size_t chunk_size = 0;
+  size_t max_small = 0;  // largest size class served from chunks
+
+  mutable std::mutex mu;
+  std::map<uintptr_t, std::unique_ptr<Region>> regions;  // by base address
+  std::vector<void*> free_heads;  // per size class, linked through blocks
+  Region* current = nullptr;
+  size_t bump = 0;
+  CmmArenaStats stats{};
+
+  size_t ClassIndex(size_t block) const {
+    size_t i = 0;
+    for (size_t b = kMinBlock; b < block; b <<= 1) ++i;
+    return i;
+  }
+
+  Region* NewRegion(size_t size, bool large) {
+    std::unique_ptr<Region> r(new Region());
+    ++stats.mem_allocs;
+    auto v = r->buffer.Allocate(size, options.mode, options.token);
+    if (!v) return nullptr;
+    r->view = v.MoveValue();
+    r->base = static_cast<uint8_t*>(r->view.Data());
+    r->size = size;
+    r->phys = r->buffer.Phys();
+    r->large = large;
+    stats.bytes_reserved += size;
+    Region* raw = r.get();
+    regions[reinterpret_cast<uintptr_t>(raw->base)] = std::move(r);
+    return raw;
+  }
+
+  /** Region holding [p, p+size), or nullptr. Caller holds mu. */
+  Region* Find(const void* p, size_t size) const {
+    const uintptr_t a = reinterpret_cast<uintptr_t>(p);
+    auto it = regions.upper_bound(a);
+    if (it == regions.begin()) return nullptr;
+    --it;
+    Region* r = it->second.get();
+    const uintptr_t off = a - it->first;
+    if (off >= r->size || size > r->size - off) return nullptr;
+    return r;
+  }
+
+  void* Carve(size_t block) {
+    const size_t align = std::min(block, kPage);
+    size_t off = (bump + align - 1) & ~(align - 1);
+    if (!current || off + block > current->size) {
+      Region* r = NewRegion(chunk_size, false);
+      if (!r) return nullptr;
+      ++stats.chunks;
+      current = r;
+      off = 0;
+    }
+    bump = off + block;
+    return current->base + off;
+  }
+};
+
+CmmArena::CmmArena(const CmmArenaOptions& options) : impl_(new Impl()) {
+  impl_->options = options;
+  impl_->chunk_size = (std::max(options.chunk_size, kPage) + kPage - 1) &
+                      ~(kPage - 1);
+  impl_->max_small = kMinBlock;
+  while (impl_->max_small * 2 <= impl_->chunk_size / 4) {
+    impl_->max_small <<= 1;
+  }
+  impl_->free_heads.assign(impl_->ClassIndex(impl_->max_small) + 1, nullptr);
+}
+
+CmmArena::~CmmArena() {
+  for (auto& entry : impl_->regions) {
+    entry.second->view.Reset();
+    (void)entry.second->buffer.Free();
+  }
+  delete impl_;
+}
+
+void* CmmArena::Allocate(size_t size, size_t alignment) {
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0 ||
+      alignment > kPage) {
+    return nullptr;
+  }
+  const size_t need = std::max(size, alignment);
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  if (need > impl_->max_small) {
+    const size_t bytes = (need + kPage - 1) & ~(kPage - 1);
+    Impl::Region* r = impl_->NewRegion(bytes, true);
+    if (!r) return nullptr;
+    ++impl_->stats.large_blocks;
+    impl_->stats.bytes_in_use += bytes;
+    return r->base;
+  }
+  const size_t block = RoundUpPow2(need);
+  void*& head = impl_->free_heads[impl_->ClassIndex(block)];
+  void* p = head;
+  if (p) {
+    memcpy(&head, p, sizeof(void*));  // next link stored in the block
+  } else {
+    p = impl_->Carve(block);
+    if (!p) return nullptr;
+  }
+  impl_->stats.bytes_in_use += block;
+  return p;
+}
+
+void CmmArena::Deallocate(void* p, size_t size, size_t alignment) {
+  if (!p) return;
+  const size_t need = std::max(size, alignment);
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  if (need > impl_->max_small) {
+    auto it = impl_->regions.find(reinterpret_cast<uintptr_t>(p));
+    if (it == impl_->regions.end() || !it->second->large) return;
+    Impl::Region& r = *it->second;
+    impl_->stats.bytes_in_use -= r.size;
+    impl_->stats.bytes_reserved -= r.size;
+    --impl_->stats.large_blocks;
+    r.view.Reset();
+    (void)r.buffer.Free();
+    impl_->regions.erase(it);
+    return;
+  }
+  const size_t block = RoundUpPow2(need);
+  void*& head = impl_->free_heads[impl_->ClassIndex(block)];
+  memcpy(p, &head, sizeof(void*));
+  head = p;
+  impl_->stats.bytes_in_use -= block;
+}
+
+uint64_t CmmArena::Phys(const void* p) const {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  const Impl::Region* r = impl_->Find(p, 0);
+  if (!r) return 0;
+  return r->phys + static_cast<uint64_t>(static_cast<const uint8_t*>(p) -
+                                         r->base);
+}
+
+Result<void> CmmArena::Flush(const void* p, size_t size) const {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  Impl::Region* r = impl_->Find(p, size);
+  if (!r) {
+    return Result<void>::Error(ErrorCode::kOutOfRange, [] {
+      return std::string("Range is not inside one CmmArena block");
+    });
+  }
+  const size_t off =
+      static_cast<size_t>(static_cast<const uint8_t*>(p) - r->base);
+  return r->view.Flush(off, size);
+}
+
+Result<void> CmmArena::Invalidate(const void* p, size_t size) const {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  Impl::Region* r = impl_->Find(p, size);
+  if (!r) {
+    return Result<void>::Error(ErrorCode::kOutOfRange, [] {
+      return std::string("Range is not inside one CmmArena block");
+    });
+  }
+  const size_t off =
+      static_cast<size_t>(static_cast<const uint8_t*>(p) - r->base);
+  return r->view.Invalidate(off, size);
+}
+
+CacheMode CmmArena::Mode() const { return impl_->options.mode; }
+
+CmmArenaStats CmmArena::Stats() const {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  return impl_->stats;
+}
+
+CmmArena& CmmArena::Default() {
+  static CmmArena* arena = new CmmArena();  // never destroyed
+  return *arena;
+}
+
+}  // namespace axsys
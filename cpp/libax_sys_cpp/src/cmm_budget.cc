@@ -0,0 +1,309 @@
+#include "axsys/cmm_budget.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "axsys/cmm.hpp"
+
+namespace axsys {
+
+namespace {
+
+using detail::CmmTokenCharge;
+using detail::CmmTokenCounters;
+using detail::TokenCharge;
+
+/** Retry period of the queue head, for memory freed by other processes. */
+constexpr std::chrono::milliseconds kRepoll(10);
+
+struct TokenEntry {
+  std::string name;
+  uint64_t quota = 0;
+};
+
+struct Waiter {
+  uint64_t ticket;
+  CmmTokenCounters* token;
+  uint64_t size;
+};
+
+// Charges are atomics: without a limit or quota, Charge/Release never
+// take mtx (only a token's first charge does, to list it for Stats()).
+struct Budget {
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::atomic<bool> limited{false};  // limit != 0 || quotas != 0
+  std::atomic<uint32_t> waiting{0};  // queue.size(), read without mtx
+  std::atomic<uint64_t> charged{0};
+  uint64_t limit = 0;
+  uint32_t quotas = 0;  // tokens with a quota
+  std::unordered_map<CmmTokenCounters*, TokenEntry> tokens;
+  std::vector<CmmTokenCounters*> order;  // first-use order, for Stats()
+  std::deque<Waiter> queue;              // AllocateWait() callers, FIFO
+  uint64_t next_ticket = 0;
+  uint64_t generation = 0;  // bumped by frees while callers wait
+  uint64_t waits = 0;
+  uint64_t timeouts = 0;
+  uint64_t wait_latency[kCmmLatencyBuckets] = {};
+};
+
+Budget& GetBudget() {
+  static Budget* b = new Budget();  // deleters may run during exit
+  return *b;
+}
+
+/** Caller holds b.mtx. */
+TokenEntry& Entry(Budget& b, CmmTokenCounters* c, const char* token) {
+  auto it = b.tokens.find(c);
+  if (it != b.tokens.end()) return it->second;
+  TokenEntry& e = b.tokens[c];
+  e.name = token ? token : "";
+  b.order.push_back(c);
+  TokenCharge(c)->listed.store(true, std::memory_order_release);
+  return e;
+}
+
+/** Caller holds b.mtx. */
+void UpdateLimited(Budget& b) {
+  b.limited.store(b.limit != 0 || b.quotas != 0, std::memory_order_release);
+}
+
+/** Caller holds b.mtx. */
+std::deque<Waiter>::iterator Find(Budget& b, uint64_t ticket) {
+  return std::find_if(b.queue.begin(), b.queue.end(),
+                      [ticket](const Waiter& w) { return w.ticket == ticket; });
+}
+
+/**
+ * Caller holds b.mtx. True when @p w's own quota keeps it waiting; a
+ * token not listed yet has no quota.
+ */
+bool QuotaBlocked(const Budget& b, const Waiter& w) {
+  const auto it = b.tokens.find(w.token);
+  if (it == b.tokens.end() || it->second.quota == 0) return false;
+  const uint64_t charged =
+      TokenCharge(w.token)->bytes.load(std::memory_order_relaxed);
+  return charged + w.size > it->second.quota;
+}
+
+/**
+ * Caller holds b.mtx. A waiter may try once everyone ahead of it waits
+ * for the quota of another token; a waiter blocked on the limit or on CMM
+ * itself keeps the ones behind it waiting.
+ */
+bool MayTry(Budget& b, uint64_t ticket) {
+  const auto self = Find(b, ticket);
+  for (auto it = b.queue.begin(); it != self; ++it) {
+    if (it->token == self->token || !QuotaBlocked(b, *it)) return false;
+  }
+  return true;
+}
+
+/**
+ * Caller holds b.mtx. Non-zero (the cap) when @p size can never fit under
+ * the limit or @p c's quota.
+ */
+uint64_t NeverFits(Budget& b, CmmTokenCounters* c, uint64_t size) {
+  if (b.limit != 0 && size > b.limit) return b.limit;
+  const auto it = b.tokens.find(c);
+  if (it != b.tokens.end() && it->second.quota != 0 &&
+      size > it->second.quota) {
+    return it->second.quota;
+  }
+  return 0;
+}
+
+}  // namespace
+
+uint64_t CmmBudgetStats::WaitPercentileNs(double q) const {
+  return detail::Log2HistogramPercentile(wait_latency, q);
+}
+
+const CmmTokenBudget* CmmBudgetStats::Find(const char* token) const {
+  const char* name = token ? token : "";
+  for (const CmmTokenBudget& t : tokens) {
+    if (t.token == name) return &t;
+  }
+  return nullptr;
+}
+
+void CmmBudget::SetLimit(uint64_t bytes) {
+  Budget& b = GetBudget();
+  {
+    std::lock_guard<std::mutex> lk(b.mtx);
+    b.limit = bytes;
+    UpdateLimited(b);
+    ++b.generation;  // a raised limit may admit the queue head
+  }
+  b.cv.notify_all();
+}
+
+void CmmBudget::SetTokenQuota(const char* token, uint64_t bytes) {
+  CmmTokenCounters* c = detail::InternCmmToken(token);
+  Budget& b = GetBudget();
+  {
+    std::lock_guard<std::mutex> lk(b.mtx);
+    TokenEntry& e = Entry(b, c, token);
+    if ((e.quota != 0) != (bytes != 0)) {
+      if (bytes != 0) {
+        ++b.quotas;
+      } else {
+        --b.quotas;
+      }
+    }
+    e.quota = bytes;
+    UpdateLimited(b);
+    ++b.generation;
+  }
+  b.cv.notify_all();
+}
+
+CmmBudgetStats CmmBudget::Stats() {
+  Budget& b = GetBudget();
+  std::lock_guard<std::mutex> lk(b.mtx);
+  CmmBudgetStats s;
+  s.limit_bytes = b.limit;
+  s.charged_bytes = b.charged.load(std::memory_order_relaxed);
+  s.waiting = static_cast<uint32_t>(b.queue.size());
+  s.waits = b.waits;
+  s.timeouts = b.timeouts;
+  memcpy(s.wait_latency, b.wait_latency, sizeof(s.wait_latency));
+  s.tokens.reserve(b.order.size());
+  for (CmmTokenCounters* c : b.order) {
+    const TokenEntry& e = b.tokens[c];
+    s.tokens.push_back(CmmTokenBudget{
+        e.name, e.quota,
+        TokenCharge(c)->bytes.load(std::memory_order_relaxed)});
+  }
+  return s;
+}
+
+Result<CmmView> CmmBuffer::AllocateWait(size_t size, CacheMode mode,
+                                        const char* token,
+                                        int64_t timeout_ms) {
+  if (timeout_ms == 0) return Allocate(size, mode, token);
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point deadline =
+      start + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+  constexpr uint64_t kNotTried = UINT64_MAX;
+
+  CmmTokenCounters* c = detail::InternCmmToken(token);
+  Budget& b = GetBudget();
+  std::unique_lock<std::mutex> lk(b.mtx);
+  const uint64_t ticket = b.next_ticket++;
+  b.queue.push_back(Waiter{ticket, c, size});
+  b.waiting.fetch_add(1);  // before the first try: frees now bump generation
+  uint64_t tried_at = kNotTried;  // generation of the last failed attempt
+
+  auto finish = [&b, ticket, start](bool timed_out) {
+    b.queue.erase(Find(b, ticket));
+    b.waiting.fetch_sub(1);
+    ++b.waits;
+    if (timed_out) ++b.timeouts;
+    const uint64_t ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start)
+            .count());
+    ++b.wait_latency[detail::Log2HistogramBucket(ns)];
+    b.cv.notify_all();  // the next ticket may now try
+  };
+
+  for (;;) {
+    const uint64_t cap = NeverFits(b, c, size);
+    if (cap != 0) {  // checked each round: the limit may have been lowered
+      finish(false);
+      return Result<CmmView>::Error(ErrorCode::kInvalidArgument, [size, cap] {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "0x%zx bytes exceed the budget of 0x%llx",
+                 size, static_cast<unsigned long long>(cap));
+        return std::string(buf);
+      });
+    }
+    const bool eligible = MayTry(b, ticket);
+    if (eligible && b.generation != tried_at) {
+      tried_at = b.generation;
+      lk.unlock();
+      Result<CmmView> r = Allocate(size, mode, token);
+      lk.lock();
+      if (r || r.Code() != ErrorCode::kAllocationFailed) {
+        finish(false);
+        return r;
+      }
+      continue;
+    }
+    const Clock::time_point now = Clock::now();
+    if (timeout_ms > 0 && now >= deadline) {
+      finish(true);
+      return Result<CmmView>::Error(ErrorCode::kTimeout, [size, timeout_ms] {
+        char buf[96];
+        snprintf(buf, sizeof(buf),
+                 "No CMM for 0x%zx bytes within %lld ms", size,
+                 static_cast<long long>(timeout_ms));
+        return std::string(buf);
+      });
+    }
+    Clock::time_point wake = now + kRepoll;
+    if (timeout_ms > 0 && deadline < wake) wake = deadline;
+    if (b.cv.wait_until(lk, wake) == std::cv_status::timeout && eligible) {
+      tried_at = kNotTried;  // poll for memory freed elsewhere
+    }
+  }
+}
+
+namespace detail {
+
+bool ChargeCmmBudget(CmmTokenCounters* c, const char* token, uint64_t bytes) {
+  Budget& b = GetBudget();
+  CmmTokenCharge* t = TokenCharge(c);
+  if (!b.limited.load(std::memory_order_acquire)) {
+    if (!t->listed.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lk(b.mtx);
+      (void)Entry(b, c, token);
+    }
+    b.charged.fetch_add(bytes, std::memory_order_relaxed);
+    t->bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return true;
+  }
+  // Checked charges are serialized; releases only lower the totals.
+  std::lock_guard<std::mutex> lk(b.mtx);
+  const TokenEntry& e = Entry(b, c, token);
+  if (b.limit != 0 &&
+      b.charged.load(std::memory_order_relaxed) + bytes > b.limit) {
+    return false;
+  }
+  if (e.quota != 0 &&
+      t->bytes.load(std::memory_order_relaxed) + bytes > e.quota) {
+    return false;
+  }
+  b.charged.fetch_add(bytes, std::memory_order_relaxed);
+  t->bytes.fetch_add(bytes, std::memory_order_relaxed);
+  return true;
+}
+
+void ReleaseCmmBudget(CmmTokenCounters* c, uint64_t bytes, bool freed) {
+  Budget& b = GetBudget();
+  b.charged.fetch_sub(bytes, std::memory_order_relaxed);
+  TokenCharge(c)->bytes.fetch_sub(bytes, std::memory_order_relaxed);
+  // Pairs with the increment in AllocateWait(): a waiter that failed
+  // before this free sees the new generation.
+  if (!freed || b.waiting.load() == 0) return;
+  {
+    std::lock_guard<std::mutex> lk(b.mtx);
+    ++b.generation;
+  }
+  b.cv.notify_all();
+}
+
+}  // namespace detail
+
+}  // namespace axsys
@@ -0,0 +1,244 @@
+#include "axsys/cmm_info.hpp"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "axsys/cmm.hpp"
+
+namespace axsys {
+
+namespace {
+
+/** Parses the number following @p key in @p line (base 0 = 0x or dec). */
+bool NumberAfter(const char* line, const char* key, uint64_t* out,
+                 const char** rest = nullptr) {
+  const char* p = strstr(line, key);
+  if (!p) return false;
+  p += strlen(key);
+  char* end = nullptr;
+  const unsigned long long v = strtoull(p, &end, 0);
+  if (end == p) return false;
+  *out = v;
+  if (rest) *rest = end;
+  return true;
+}
+
+/** Copies the quoted string following @p key, truncating to @p cap - 1. */
+void QuotedAfter(const char* line, const char* key, char* out, size_t cap) {
+  out[0] = '\0';
+  const char* p = strstr(line, key);
+  if (!p) return;
+  p += strlen(key);
+  size_t n = 0;
+  while (*p && *p != '"' && n + 1 < cap) out[n++] = *p++;
+  out[n] = '\0';
+}
+
+/** Parses "<key>(0xSTART, 0xEND)" into start and inclusive end. */
+bool RangeAfter(const char* line, const char* key, uint64_t* start,
+                uint64_t* end) {
+  const char* rest = nullptr;
+  if (!NumberAfter(line, key, start, &rest)) return false;
+  if (!NumberAfter(rest, ",", end)) return false;
+  return *end >= *start;
+}
+
+void ClearDerived(CmmPartitionLayout* p) {
+  p->used_bytes = 0;
+  p->free_bytes = 0;
+  p->free_extents = 0;
+  p->largest_free = 0;
+  p->largest_free_phys = 0;
+  memset(p->free_histogram, 0, sizeof(p->free_histogram));
+  p->fragmentation = 0.0;
+  p->has_max_free_region = false;
+  p->max_free_region_phys = 0;
+  p->max_free_region_size = 0;
+}
+
+size_t FreeBucket(uint64_t bytes) {
+  size_t b = 0;
+  uint64_t units = bytes >> 12;  // 4 KiB
+  while (units > 1 && b + 1 < kCmmFreeBuckets) {
+    units >>= 1;
+    ++b;
+  }
+  return b;
+}
+
+void AddFreeExtent(CmmPartitionLayout* p, uint64_t phys, uint64_t bytes) {
+  if (bytes == 0) return;
+  ++p->free_extents;
+  p->free_bytes += bytes;
+  ++p->free_histogram[FreeBucket(bytes)];
+  if (bytes > p->largest_free) {
+    p->largest_free = bytes;
+    p->largest_free_phys = phys;
+  }
+}
+
+void Analyze(CmmPartitionLayout* p) {
+  std::sort(
+      p->blocks.begin(), p->blocks.end(),
+      [](const CmmBlock& a, const CmmBlock& b) { return a.phys < b.phys; });
+  const uint64_t end = p->phys + p->size;
+  uint64_t cursor = p->phys;
+  for (const CmmBlock& b : p->blocks) {
+    p->used_bytes += b.size;
+    if (b.phys > cursor) {
+      AddFreeExtent(p, cursor, std::min(b.phys, end) - cursor);
+    }
+    cursor = std::max(cursor, b.phys + b.size);
+  }
+  if (cursor < end) AddFreeExtent(p, cursor, end - cursor);
+  if (p->free_bytes > 0) {
+    p->fragmentation = 1.0 - static_cast<double>(p->largest_free) /
+                                 static_cast<double>(p->free_bytes);
+  }
+}
+
+}  // namespace
+
+const CmmPartitionLayout* CmmLayout::Find(const char* name) const {
+  if (!name) return nullptr;
+  for (const CmmPartitionLayout& p : partitions) {
+    if (strcmp(p.name, name) == 0) return &p;
+  }
+  return nullptr;
+}
+
+CmmInfoParser::CmmInfoParser()
+    : partitions_used_(0), line_len_(0), line_overflow_(false) {
+  line_[0] = '\0';
+  Begin();
+}
+
+void CmmInfoParser::Begin() {
+  partitions_used_ = 0;
+  line_len_ = 0;
+  line_overflow_ = false;
+  layout_.has_totals = false;
+  layout_.total_kb = 0;
+  layout_.used_kb = 0;
+  layout_.remain_kb = 0;
+  layout_.partition_number = 0;
+  layout_.block_number = 0;
+}
+
+void CmmInfoParser::Feed(const char* data, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    const char c = data[i];
+    if (c == '\n') {
+      if (!line_overflow_) {
+        line_[line_len_] = '\0';
+        ParseLine(line_);
+      }
+      line_len_ = 0;
+      line_overflow_ = false;
+    } else if (line_len_ + 1 < sizeof(line_)) {
+      line_[line_len_++] = c;
+    } else {
+      line_overflow_ = true;
+    }
+  }
+}
+
+void CmmInfoParser::ParseLine(const char* line) {
+  uint64_t start = 0;
+  uint64_t last = 0;
+  if (strstr(line, "PARTITION:")) {
+    if (!RangeAfter(line, "Phys(", &start, &last)) return;
+    if (partitions_used_ == layout_.partitions.size()) {
+      layout_.partitions.emplace_back();
+    }
+    CmmPartitionLayout& p = layout_.partitions[partitions_used_++];
+    QuotedAfter(line, "NAME=\"", p.name, sizeof(p.name));
+    p.phys = start;
+    p.size = last - start + 1;
+    p.blocks.clear();  // keeps capacity
+    ClearDerived(&p);
+  } else if (strstr(line, "|-Block:")) {
+    if (partitions_used_ == 0) return;
+    if (!RangeAfter(line, "phys(", &start, &last)) return;
+    CmmBlock b;
+    b.phys = start;
+    b.size = last - start + 1;
+    b.cached = strstr(line, "non-cacheable") == nullptr &&
+               strstr(line, "cacheable") != nullptr;
+    QuotedAfter(line, "name=\"", b.name, sizeof(b.name));
+    layout_.partitions[partitions_used_ - 1].blocks.push_back(b);
+  } else if (strstr(line, "total size=")) {
+    uint64_t parts = 0;
+    uint64_t blocks = 0;
+    layout_.has_totals =
+        NumberAfter(line, "total size=", &layout_.total_kb) &&
+        NumberAfter(line, "used=", &layout_.used_kb) &&
+        NumberAfter(line, "remain=", &layout_.remain_kb) &&
+        NumberAfter(line, "partition_number=", &parts) &&
+        NumberAfter(line, "block_number=", &blocks);
+    layout_.partition_number = static_cast<uint32_t>(parts);
+    layout_.block_number = static_cast<uint32_t>(blocks);
+  }
+}
+
+Result<void> CmmInfoParser::End() {
+  if (line_len_ > 0 && !line_overflow_) {
+    line_[line_len_] = '\0';
+    ParseLine(line_);
+  }
+  line_len_ = 0;
+  line_overflow_ = false;
+  layout_.partitions.resize(partitions_used_);
+  if (partitions_used_ == 0) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("mem_cmm_info: no PARTITION line");
+    });
+  }
+  for (CmmPartitionLayout& p : layout_.partitions) Analyze(&p);
+  return Result<void>::Ok();
+}
+
+Result<void> CmmInfoParser::ReadProc(const char* path) {
+  Begin();
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    const int err = errno;
+    std::string p(path);
+    return Result<void>::Error(ErrorCode::kSystemCallFailed, [p, err] {
+      return "fopen " + p + " failed: " + strerror(err);
+    });
+  }
+  char chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) Feed(chunk, n);
+  fclose(f);
+  return End();
+}
+
+Result<void> CmmInfoParser::MergeMaxFreeRegion() {
+  std::string failed;
+  for (CmmPartitionLayout& p : layout_.partitions) {
+    uint64_t phys = 0;
+    uint32_t size = 0;
+    p.has_max_free_region = CmmBuffer::MaxFreeRegion(p.name, &phys, &size);
+    if (!p.has_max_free_region) {
+      failed = p.name;
+      continue;
+    }
+    p.max_free_region_phys = phys;
+    p.max_free_region_size = size;
+  }
+  if (!failed.empty()) {
+    return Result<void>::Error(ErrorCode::kSystemCallFailed, [failed] {
+      return "AX_SYS_MemGetMaxFreeRegionInfo failed for " + failed;
+    });
+  }
+  return Result<void>::Ok();
+}
+
+}  // namespace axsys
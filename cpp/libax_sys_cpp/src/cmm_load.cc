@@ -0,0 +1,210 @@
+#include "axsys/cmm_load.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "axsys/weight_cache.hpp"
+
+namespace axsys {
+
+namespace {
+
+constexpr size_t kAlign = 4096;  // O_DIRECT buffer, offset and length
+
+size_t RoundUp(size_t v) { return (v + kAlign - 1) & ~(kAlign - 1); }
+
+Result<CmmBuffer> LoadError(ErrorCode code, std::string msg) {
+  return Result<CmmBuffer>::Error(code, [msg] { return msg; });
+}
+
+Result<CmmBuffer> ErrnoError(const char* what, const char* path, int err) {
+  return LoadError(ErrorCode::kSystemCallFailed,
+                   std::string(what) + " " + path + ": " + strerror(err));
+}
+
+struct FdGuard {
+  int fd;
+  ~FdGuard() {
+    if (fd >= 0) close(fd);
+  }
+};
+
+struct Slot {
+  uint8_t* staging = nullptr;  // nullptr: read straight into the mapping
+  size_t bytes = 0;
+  int err = 0;
+  bool full = false;
+};
+
+/** Two-slot handoff between the reader thread and the caller. */
+struct Pipeline {
+  std::mutex mtx;
+  std::condition_variable cv;
+  Slot slots[2];
+  bool stop = false;  // the caller failed; the reader quits
+};
+
+/** Read @p want bytes at the file position into @p dst. */
+int ReadChunk(int fd, uint8_t* dst, size_t want, bool* direct,
+              size_t* got) {
+  *got = 0;
+  while (*got < want) {
+    // O_DIRECT lengths must be aligned; the staging chunk has the room.
+    const size_t len = *direct ? RoundUp(want - *got) : want - *got;
+    const ssize_t n = read(fd, dst + *got, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EINVAL && *direct) {
+        // The filesystem refused O_DIRECT: continue buffered.
+        const int fl = fcntl(fd, F_GETFL);
+        if (fl >= 0 && fcntl(fd, F_SETFL, fl & ~O_DIRECT) == 0) {
+          *direct = false;
+          continue;
+        }
+      }
+      return errno;
+    }
+    if (n == 0) return EIO;  // the file shrank
+    *got += std::min(static_cast<size_t>(n), want - *got);
+  }
+  return 0;
+}
+
+void Reader(Pipeline* p, int fd, uint8_t* dest, size_t size, size_t chunk,
+            bool direct) {
+  size_t k = 0;
+  for (size_t off = 0; off < size; off += chunk, ++k) {
+    Slot& s = p->slots[k & 1];
+    uint8_t* dst = nullptr;
+    {
+      std::unique_lock<std::mutex> lk(p->mtx);
+      p->cv.wait(lk, [p, &s] { return !s.full || p->stop; });
+      if (p->stop) return;
+      dst = s.staging ? s.staging : dest + off;
+    }
+    if (off + 2 * chunk < size) {
+      (void)posix_fadvise(fd, static_cast<off_t>(off + 2 * chunk),
+                          static_cast<off_t>(chunk), POSIX_FADV_WILLNEED);
+    }
+    const size_t want = std::min(chunk, size - off);
+    size_t got = 0;
+    const int err = ReadChunk(fd, dst, want, &direct, &got);
+    {
+      std::lock_guard<std::mutex> lk(p->mtx);
+      s.bytes = got;
+      s.err = err;
+      s.full = true;
+    }
+    p->cv.notify_all();
+    if (err != 0) return;
+  }
+}
+
+}  // namespace
+
+Result<CmmBuffer> LoadFileToCmm(const char* path, CacheMode mode,
+                                const CmmLoadOptions& options) {
+  if (!path || options.chunk_size == 0) {
+    return LoadError(ErrorCode::kInvalidArgument,
+                     "LoadFileToCmm needs a path and a chunk size");
+  }
+  const size_t chunk = RoundUp(options.chunk_size);
+  bool direct = options.direct_io;
+  int fd = open(path, O_RDONLY | O_CLOEXEC | (direct ? O_DIRECT : 0));
+  if (fd < 0 && direct && errno == EINVAL) {
+    direct = false;
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+  }
+  if (fd < 0) return ErrnoError("open", path, errno);
+  FdGuard guard{fd};
+  struct stat st;
+  if (fstat(fd, &st) != 0) return ErrnoError("stat", path, errno);
+  if (st.st_size <= 0) {
+    return LoadError(ErrorCode::kInvalidArgument,
+                     std::string("Empty file: ") + path);
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  CmmBuffer buf;
+  auto v = buf.Allocate(size, mode, options.token);
+  if (!v) return LoadError(v.Code(), v.Message());
+  CmmView view = v.MoveValue();
+  uint8_t* dest = static_cast<uint8_t*>(view.Data());
+
+  // The kernel writes a cached mapping at full speed; anything else goes
+  // through cached staging chunks.
+  const bool staged = direct || mode != CacheMode::kCached;
+  std::unique_ptr<void, void (*)(void*)> staging(nullptr, free);
+  Pipeline p;
+  if (staged) {
+    void* mem = nullptr;
+    if (posix_memalign(&mem, kAlign, 2 * chunk) != 0) {
+      return LoadError(ErrorCode::kAllocationFailed,
+                       "No memory for staging chunks");
+    }
+    staging.reset(mem);
+    p.slots[0].staging = static_cast<uint8_t*>(mem);
+    p.slots[1].staging = static_cast<uint8_t*>(mem) + chunk;
+  }
+
+  std::thread reader(Reader, &p, fd, dest, size, chunk, direct);
+  WeightHasher hasher;
+  ErrorCode fail_code = ErrorCode::kSuccess;
+  std::string fail_msg;
+  size_t k = 0;
+  for (size_t off = 0; off < size; off += chunk, ++k) {
+    Slot& s = p.slots[k & 1];
+    {
+      std::unique_lock<std::mutex> lk(p.mtx);
+      p.cv.wait(lk, [&s] { return s.full; });
+    }
+    if (s.err != 0) {
+      fail_code = ErrorCode::kSystemCallFailed;
+      fail_msg = std::string("read ") + path + ": " + strerror(s.err);
+      break;
+    }
+    const uint8_t* src = s.staging ? s.staging : dest + off;
+    if (options.checksum) hasher.Update(src, s.bytes);
+    if (s.staging) memcpy(dest + off, s.staging, s.bytes);
+    if (mode == CacheMode::kCached) {
+      auto f = view.Flush(off, s.bytes);
+      if (!f) {
+        fail_code = f.Code();
+        fail_msg = f.Message();
+        break;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lk(p.mtx);
+      s.full = false;
+    }
+    p.cv.notify_all();
+  }
+  if (fail_code != ErrorCode::kSuccess) {
+    {
+      std::lock_guard<std::mutex> lk(p.mtx);
+      p.stop = true;
+    }
+    p.cv.notify_all();
+  }
+  reader.join();
+  view.Reset();
+  if (fail_code != ErrorCode::kSuccess) return LoadError(fail_code, fail_msg);
+  if (options.checksum) *options.checksum = hasher.Digest();
+  return Result<CmmBuffer>::Ok(std::move(buf));
+}
+
+}  // namespace axsys
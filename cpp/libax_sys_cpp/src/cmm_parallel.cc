@@ -0,0 +1,174 @@
+#include "axsys/cmm_parallel.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace axsys {
+
+namespace {
+
+constexpr size_t kLine = 64;  // Cortex-A53 cache line
+
+size_t AlignUp(size_t v, size_t a) { return (v + a - 1) & ~(a - 1); }
+
+size_t AlignOf(SliceAlign align) {
+  if (align == SliceAlign::kPage) {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  }
+  return kLine;
+}
+
+/** One RunTasks() call; lives on the caller's stack. */
+struct Batch {
+  const std::function<void(unsigned)>* task;
+  unsigned count;
+  unsigned next;     // next index to hand out; 0 is the caller's
+  unsigned running;  // handed out and not finished
+};
+
+struct Pool {
+  std::mutex mtx;
+  std::condition_variable work;  // a batch was queued
+  std::condition_variable done;  // a batch's last task finished
+  std::deque<Batch*> batches;    // with indices left to hand out
+  size_t workers = 0;
+  // Further tasks wait in their batch for a worker or their caller.
+  const size_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+};
+
+Pool& GetPool() {
+  static Pool* p = new Pool();  // workers are never joined
+  return *p;
+}
+
+/** Hand out @p b's next index. Caller holds p.mtx. */
+unsigned Claim(Pool& p, Batch* b) {
+  const unsigned i = b->next++;
+  ++b->running;
+  if (b->next == b->count) {
+    p.batches.erase(std::find(p.batches.begin(), p.batches.end(), b));
+  }
+  return i;
+}
+
+/** Run task @p i of @p b with p.mtx released. */
+void Execute(Pool& p, std::unique_lock<std::mutex>& lk, Batch* b,
+             unsigned i) {
+  lk.unlock();
+  (*b->task)(i);
+  lk.lock();
+  if (--b->running == 0 && b->next == b->count) p.done.notify_all();
+}
+
+void Work(Pool* p) {
+  std::unique_lock<std::mutex> lk(p->mtx);
+  for (;;) {
+    p->work.wait(lk, [p] { return !p->batches.empty(); });
+    Batch* b = p->batches.front();
+    Execute(*p, lk, b, Claim(*p, b));
+  }
+}
+
+unsigned Workers(const ParallelOptions& options, size_t size) {
+  unsigned n = options.threads;
+  if (n == 0) n = std::max(1u, std::thread::hardware_concurrency());
+  const size_t by_size = size / std::max<size_t>(options.min_slice, 1);
+  if (by_size < n) n = static_cast<unsigned>(std::max<size_t>(by_size, 1));
+  return n;
+}
+
+}  // namespace
+
+void RunTasks(unsigned count, const std::function<void(unsigned)>& task) {
+  if (count == 0) return;
+  if (count == 1) {
+    task(0);
+    return;
+  }
+  Pool& p = GetPool();
+  Batch b{&task, count, 1, 0};
+  {
+    std::lock_guard<std::mutex> lk(p.mtx);
+    const size_t want = std::min<size_t>(count - 1, p.max_workers);
+    for (; p.workers < want; ++p.workers) std::thread(Work, &p).detach();
+    p.batches.push_back(&b);
+  }
+  p.work.notify_all();
+  task(0);
+  std::unique_lock<std::mutex> lk(p.mtx);
+  while (b.next < b.count) Execute(p, lk, &b, Claim(p, &b));
+  p.done.wait(lk, [&b] { return b.running == 0; });
+}
+
+std::vector<CmmSlice> PartitionView(const CmmView& view, size_t offset,
+                                    size_t size,
+                                    const ParallelOptions& options) {
+  std::vector<CmmSlice> slices;
+  if (!view || offset >= view.Size()) return slices;
+  if (size == SIZE_MAX) size = view.Size() - offset;
+  if (size == 0 || size > view.Size() - offset) return slices;
+  const size_t align = AlignOf(options.align);
+  const unsigned n = Workers(options, size);
+  uint8_t* data = static_cast<uint8_t*>(view.Data());
+  // Boundaries are aligned in virtual addresses; CMM mappings start on a
+  // page, so they are aligned physically as well.
+  const size_t start = reinterpret_cast<uintptr_t>(data) + offset;
+  const size_t end = start + size;
+  size_t prev = start;
+  for (unsigned i = 1; i <= n; ++i) {
+    const size_t cut =
+        i == n ? end
+               : std::min(end, AlignUp(start + size / n * i, align));
+    if (cut > prev) {
+      const size_t off = prev - reinterpret_cast<uintptr_t>(data);
+      slices.push_back(CmmSlice{data + off, off, cut - prev,
+                                static_cast<unsigned>(slices.size())});
+    }
+    prev = cut;
+  }
+  return slices;
+}
+
+Result<void> ParallelFor(CmmView* view, size_t offset, size_t size,
+                         const SliceKernel& kernel,
+                         const ParallelOptions& options) {
+  if (!view || !*view || !kernel) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("ParallelFor needs a mapped view and a kernel");
+    });
+  }
+  if (offset >= view->Size() ||
+      (size != SIZE_MAX && (size == 0 || size > view->Size() - offset))) {
+    return Result<void>::Error(ErrorCode::kOutOfRange, [] {
+      return std::string("ParallelFor range is empty or leaves the view");
+    });
+  }
+  const std::vector<CmmSlice> slices =
+      PartitionView(*view, offset, size, options);
+  const bool flush = options.flush && view->Mode() == CacheMode::kCached;
+  std::vector<Result<void>> results(slices.size());
+  RunTasks(static_cast<unsigned>(slices.size()),
+           [view, &kernel, &slices, &results, flush](unsigned i) {
+             kernel(slices[i]);
+             if (flush) {
+               results[i] = view->Flush(slices[i].offset, slices[i].size);
+             }
+           });
+  for (const Result<void>& r : results) {
+    if (!r) return r;
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> ParallelFor(CmmView* view, const SliceKernel& kernel,
+                         const ParallelOptions& options) {
+  return ParallelFor(view, 0, SIZE_MAX, kernel, options);
+}
+
+}  // namespace axsys
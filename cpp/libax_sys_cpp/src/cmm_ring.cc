@@ -0,0 +1,239 @@
+#include "axsys/cmm_ring.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#include "axsys/frame_queue.hpp"  // kCacheLineSize
+
+namespace axsys {
+
+namespace {
+
+Result<void> SysError(const char* what) {
+  const int err = errno;
+  std::string w(what ? what : "");  // copied: what may be options.device
+  return Result<void>::Error(ErrorCode::kSystemCallFailed, [w, err] {
+    return w + ": " + strerror(err);
+  });
+}
+
+}  // namespace
+
+struct CmmRing::Impl {
+  CmmBuffer buffer;  // kSysmap: owns the physical range
+  // kSysmap: cache maintenance of the range. The data cache is physically
+  // tagged, so maintaining the lines through this mapping also covers the
+  // two sysmap aliases.
+  CmmView view;
+  CmmRingBacking backing = CmmRingBacking::kSysmap;
+  CacheMode mode = CacheMode::kCached;
+  int fd = -1;
+  uint8_t* base = nullptr;
+  size_t capacity = 0;
+  uint64_t phys = 0;
+
+  // Producer-owned tail and consumer-owned head, as in FrameQueue<kSpsc>.
+  alignas(kCacheLineSize) std::atomic<uint64_t> head{0};
+  alignas(kCacheLineSize) std::atomic<uint64_t> tail{0};
+  uint64_t head_cache = 0;  // producer's last view of head
+
+  void Unmap() {
+    if (base) munmap(base, 2 * capacity);
+    base = nullptr;
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+
+  /** Offset of [p, p+size) in the first mapping; false if outside. */
+  bool Offset(const void* p, size_t size, size_t* offset) const {
+    const uint8_t* b = static_cast<const uint8_t*>(p);
+    if (!base || b < base || size > capacity) return false;
+    size_t off = static_cast<size_t>(b - base);
+    if (off >= 2 * capacity || size > 2 * capacity - off) return false;
+    if (off >= capacity) off -= capacity;
+    *offset = off;
+    return true;
+  }
+
+  /** Cache maintenance of a span that may wrap in the single view. */
+  template <typename Op>
+  Result<void> Maintain(const void* p, size_t size, Op op) const {
+    size_t off = 0;
+    if (!Offset(p, size, &off)) {
+      return Result<void>::Error(ErrorCode::kOutOfRange, [size] {
+        return "Span of " + std::to_string(size) + " bytes not in the ring";
+      });
+    }
+    if (backing == CmmRingBacking::kMemfd || mode == CacheMode::kNonCached ||
+        size == 0) {
+      return Result<void>::Ok();
+    }
+    const size_t first = std::min(size, capacity - off);
+    auto r = op(off, first);
+    if (!r || first == size) return r;
+    return op(0, size - first);
+  }
+};
+
+CmmRing::CmmRing() : impl_(new Impl()) {}
+
+CmmRing::~CmmRing() {
+  (void)Destroy();
+  delete impl_;
+}
+
+Result<void> CmmRing::Create(size_t capacity, const CmmRingOptions& options) {
+  if (impl_->base) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("CmmRing already created");
+    });
+  }
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  if (capacity == 0 || capacity % page != 0 || capacity > 0xFFFFFFFFu) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [capacity] {
+      char buf[96];
+      snprintf(buf, sizeof(buf),
+               "Ring capacity 0x%zx is not a page multiple up to 4 GiB",
+               capacity);
+      return std::string(buf);
+    });
+  }
+  Impl& d = *impl_;
+  d.backing = options.backing;
+  d.mode = options.mode;
+  d.capacity = capacity;
+  off_t offset = 0;
+  if (options.backing == CmmRingBacking::kSysmap) {
+    auto v = d.buffer.Allocate(capacity, options.mode, options.token);
+    if (!v) {
+      std::string msg = v.Message();
+      return Result<void>::Error(v.Code(), [msg] { return msg; });
+    }
+    d.view = v.MoveValue();
+    d.phys = d.buffer.Phys();
+    offset = static_cast<off_t>(d.phys);
+    const int flags =
+        O_RDWR | O_CLOEXEC | (options.mode == CacheMode::kCached ? 0 : O_SYNC);
+    d.fd = open(options.device, flags);
+    if (d.fd < 0) {
+      auto e = SysError(options.device);
+      (void)Destroy();
+      return e;
+    }
+  } else {
+    d.fd = memfd_create("axsys_ring", MFD_CLOEXEC);
+    if (d.fd < 0 || ftruncate(d.fd, static_cast<off_t>(capacity)) != 0) {
+      auto e = SysError("memfd_create");
+      (void)Destroy();
+      return e;
+    }
+  }
+
+  // Reserve 2 * capacity of address space, then map the range over each
+  // half so that the second half mirrors the first.
+  void* area = mmap(nullptr, 2 * capacity, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (area == MAP_FAILED) {
+    auto e = SysError("mmap reserve");
+    (void)Destroy();
+    return e;
+  }
+  d.base = static_cast<uint8_t*>(area);
+  for (size_t half = 0; half < 2; ++half) {
+    void* want = d.base + half * capacity;
+    void* got = mmap(want, capacity, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_FIXED, d.fd, offset);
+    if (got != want) {
+      auto e = SysError("mmap mirror");
+      (void)Destroy();
+      return e;
+    }
+  }
+  d.head.store(0, std::memory_order_relaxed);
+  d.tail.store(0, std::memory_order_relaxed);
+  d.head_cache = 0;
+  return Result<void>::Ok();
+}
+
+Result<void> CmmRing::Destroy() {
+  impl_->Unmap();
+  impl_->view.Reset();
+  if (impl_->buffer.Size() != 0) {
+    auto f = impl_->buffer.Free();
+    if (!f) return f;
+  }
+  impl_->phys = 0;
+  impl_->capacity = 0;
+  return Result<void>::Ok();
+}
+
+size_t CmmRing::Capacity() const { return impl_->capacity; }
+
+void* CmmRing::Data() const { return impl_->base; }
+
+uint64_t CmmRing::PhysOf(const void* p) const {
+  size_t off = 0;
+  if (impl_->phys == 0 || !impl_->Offset(p, 0, &off)) return 0;
+  return impl_->phys + off;
+}
+
+void* CmmRing::Reserve(size_t size) {
+  Impl& d = *impl_;
+  const uint64_t t = d.tail.load(std::memory_order_relaxed);
+  if (t + size - d.head_cache > d.capacity) {
+    d.head_cache = d.head.load(std::memory_order_acquire);
+    if (t + size - d.head_cache > d.capacity) return nullptr;
+  }
+  return d.base + t % d.capacity;
+}
+
+void CmmRing::Commit(size_t size) {
+  const uint64_t t = impl_->tail.load(std::memory_order_relaxed);
+  impl_->tail.store(t + size, std::memory_order_release);
+}
+
+size_t CmmRing::Writable() const {
+  const uint64_t used = impl_->tail.load(std::memory_order_relaxed) -
+                        impl_->head.load(std::memory_order_acquire);
+  return impl_->capacity - used;
+}
+
+const void* CmmRing::Peek(size_t* size) const {
+  const Impl& d = *impl_;
+  const uint64_t h = d.head.load(std::memory_order_relaxed);
+  const size_t n = d.tail.load(std::memory_order_acquire) - h;
+  if (size) *size = n;
+  return n == 0 ? nullptr : d.base + h % d.capacity;
+}
+
+void CmmRing::Consume(size_t size) {
+  const uint64_t h = impl_->head.load(std::memory_order_relaxed);
+  impl_->head.store(h + size, std::memory_order_release);
+}
+
+size_t CmmRing::Readable() const {
+  return impl_->tail.load(std::memory_order_acquire) -
+         impl_->head.load(std::memory_order_relaxed);
+}
+
+Result<void> CmmRing::Flush(const void* p, size_t size) const {
+  return impl_->Maintain(p, size, [this](size_t off, size_t n) {
+    return impl_->view.Flush(off, n);
+  });
+}
+
+Result<void> CmmRing::Invalidate(const void* p, size_t size) const {
+  return impl_->Maintain(p, size, [this](size_t off, size_t n) {
+    return impl_->view.Invalidate(off, n);
+  });
+}
+
+}  // namespace axsys
@@ -0,0 +1,288 @@
+#include "axsys/cmm_sg.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace axsys {
+
+namespace {
+
+constexpr size_t kPage = 4096;
+constexpr size_t kMaxBlock = 0xFFFFF000u;  // AX_SYS sizes are 32-bit
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_contiguous{0};
+std::atomic<uint64_t> g_fallbacks{0};
+std::atomic<uint64_t> g_segments{0};
+std::atomic<uint64_t> g_failures{0};
+
+size_t AlignDown(size_t v) { return v & ~(kPage - 1); }
+
+Result<void> RangeError(size_t offset, size_t size, size_t total) {
+  return Result<void>::Error(ErrorCode::kOutOfRange, [offset, size, total] {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "Range 0x%zx+0x%zx exceeds 0x%zx", offset,
+             size, total);
+    return std::string(buf);
+  });
+}
+
+}  // namespace
+
+struct CmmSgBuffer::Impl {
+  struct Block {
+    CmmBuffer buffer;
+    CmmView view;
+  };
+
+  std::vector<Block> blocks;
+  std::vector<CmmSegment> segments;
+  size_t size = 0;
+
+  bool Add(size_t n, CacheMode mode, const char* token) {
+    Block b;
+    auto v = b.buffer.Allocate(n, mode, token);
+    if (!v) return false;
+    b.view = v.MoveValue();
+    segments.push_back(
+        CmmSegment{b.buffer.Phys(), b.view.Data(), n, size});
+    size += n;
+    blocks.push_back(std::move(b));
+    return true;
+  }
+
+  void Release() {
+    for (Block& b : blocks) {
+      b.view.Reset();
+      (void)b.buffer.Free();
+    }
+    blocks.clear();
+    segments.clear();
+    size = 0;
+  }
+
+  /** Index of the segment holding byte @p offset (< size). */
+  size_t Find(size_t offset) const {
+    auto it = std::upper_bound(
+        segments.begin(), segments.end(), offset,
+        [](size_t o, const CmmSegment& s) { return o < s.offset; });
+    return static_cast<size_t>(it - segments.begin()) - 1;
+  }
+
+  /** Call @p fn(segment index, offset in segment, length) over a range. */
+  template <typename Fn>
+  bool ForEach(size_t offset, size_t n, Fn fn) const {
+    if (n == 0) return true;
+    for (size_t i = Find(offset); n > 0; ++i) {
+      const CmmSegment& s = segments[i];
+      const size_t in = offset - s.offset;
+      const size_t len = std::min(n, s.size - in);
+      if (!fn(i, in, len)) return false;
+      offset += len;
+      n -= len;
+    }
+    return true;
+  }
+};
+
+CmmSgBuffer::CmmSgBuffer() : impl_(new Impl()) {}
+
+CmmSgBuffer::~CmmSgBuffer() {
+  impl_->Release();
+  delete impl_;
+}
+
+Result<void> CmmSgBuffer::Allocate(size_t size, CacheMode mode,
+                                   const char* token,
+                                   const CmmSgOptions& options) {
+  if (!impl_->blocks.empty()) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("CmmSgBuffer already allocated");
+    });
+  }
+  const size_t min_segment = AlignDown(options.min_segment);
+  if (size == 0 || min_segment == 0 || options.max_segments == 0) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("CmmSgBuffer needs a size, min_segment >= 4 KiB "
+                         "and max_segments > 0");
+    });
+  }
+
+  if (options.contiguous_first && size <= kMaxBlock &&
+      impl_->Add(size, mode, token)) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_contiguous.fetch_add(1, std::memory_order_relaxed);
+    return Result<void>::Ok();
+  }
+
+  // Start at the largest free extent and halve on each failure.
+  uint64_t phys = 0;
+  uint32_t largest = 0;
+  size_t chunk = std::min(size, kMaxBlock);
+  if (CmmBuffer::MaxFreeRegion(nullptr, &phys, &largest)) {
+    chunk = std::min(chunk, std::max(AlignDown(largest), min_segment));
+  }
+  size_t remaining = size;
+  while (remaining > 0 && impl_->blocks.size() < options.max_segments) {
+    const size_t n = std::min(chunk, remaining);
+    if (impl_->Add(n, mode, token)) {
+      remaining -= n;
+      continue;
+    }
+    chunk = AlignDown(std::min(chunk, remaining) / 2);
+    if (chunk < min_segment) break;
+  }
+  if (remaining > 0) {
+    const size_t got = impl_->blocks.size();
+    impl_->Release();
+    g_failures.fetch_add(1, std::memory_order_relaxed);
+    return Result<void>::Error(ErrorCode::kAllocationFailed, [size, got] {
+      char buf[128];
+      snprintf(buf, sizeof(buf),
+               "No split of 0x%zx bytes fits (gave up after %zu segments)",
+               size, got);
+      return std::string(buf);
+    });
+  }
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (impl_->blocks.size() == 1) {
+    g_contiguous.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    g_fallbacks.fetch_add(1, std::memory_order_relaxed);
+    g_segments.fetch_add(impl_->blocks.size(), std::memory_order_relaxed);
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> CmmSgBuffer::Free() {
+  for (Impl::Block& b : impl_->blocks) {
+    b.view.Reset();
+    auto f = b.buffer.Free();
+    if (!f) return f;
+  }
+  impl_->blocks.clear();
+  impl_->segments.clear();
+  impl_->size = 0;
+  return Result<void>::Ok();
+}
+
+size_t CmmSgBuffer::Size() const { return impl_->size; }
+
+bool CmmSgBuffer::Contiguous() const { return impl_->segments.size() == 1; }
+
+const std::vector<CmmSegment>& CmmSgBuffer::Segments() const {
+  return impl_->segments;
+}
+
+CmmSgBuffer::const_iterator CmmSgBuffer::begin() const {
+  return impl_->segments.begin();
+}
+
+CmmSgBuffer::const_iterator CmmSgBuffer::end() const {
+  return impl_->segments.end();
+}
+
+Result<std::vector<CmmSegment>> CmmSgBuffer::Ranges(size_t offset,
+                                                    size_t size) const {
+  if (offset > impl_->size || size > impl_->size - offset) {
+    auto e = RangeError(offset, size, impl_->size);
+    std::string msg = e.Message();
+    return Result<std::vector<CmmSegment>>::Error(e.Code(),
+                                                  [msg] { return msg; });
+  }
+  std::vector<CmmSegment> out;
+  impl_->ForEach(offset, size, [this, &out](size_t i, size_t in, size_t n) {
+    const CmmSegment& s = impl_->segments[i];
+    out.push_back(CmmSegment{s.phys + in, static_cast<uint8_t*>(s.virt) + in,
+                             n, s.offset + in});
+    return true;
+  });
+  return Result<std::vector<CmmSegment>>::Ok(std::move(out));
+}
+
+Result<void> CmmSgBuffer::CopyIn(size_t offset, const void* src,
+                                 size_t size) {
+  if (offset > impl_->size || size > impl_->size - offset) {
+    return RangeError(offset, size, impl_->size);
+  }
+  const uint8_t* p = static_cast<const uint8_t*>(src);
+  impl_->ForEach(offset, size, [this, &p](size_t i, size_t in, size_t n) {
+    memcpy(static_cast<uint8_t*>(impl_->segments[i].virt) + in, p, n);
+    p += n;
+    return true;
+  });
+  return Result<void>::Ok();
+}
+
+Result<void> CmmSgBuffer::CopyOut(size_t offset, void* dst,
+                                  size_t size) const {
+  if (offset > impl_->size || size > impl_->size - offset) {
+    return RangeError(offset, size, impl_->size);
+  }
+  uint8_t* p = static_cast<uint8_t*>(dst);
+  impl_->ForEach(offset, size, [this, &p](size_t i, size_t in, size_t n) {
+    memcpy(p, static_cast<const uint8_t*>(impl_->segments[i].virt) + in, n);
+    p += n;
+    return true;
+  });
+  return Result<void>::Ok();
+}
+
+Result<void> CmmSgBuffer::CopyFrom(size_t offset, const CmmSgBuffer& src,
+                                   size_t src_offset, size_t size) {
+  if (offset > impl_->size || size > impl_->size - offset) {
+    return RangeError(offset, size, impl_->size);
+  }
+  auto pieces = src.Ranges(src_offset, size);
+  if (!pieces) {
+    std::string msg = pieces.Message();
+    return Result<void>::Error(pieces.Code(), [msg] { return msg; });
+  }
+  for (const CmmSegment& s : pieces.Value()) {
+    (void)CopyIn(offset, s.virt, s.size);
+    offset += s.size;
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> CmmSgBuffer::Flush(size_t offset, size_t size) const {
+  if (offset >= impl_->size) return Result<void>::Ok();
+  size = std::min(size, impl_->size - offset);
+  Result<void> result = Result<void>::Ok();
+  impl_->ForEach(offset, size, [this, &result](size_t i, size_t in,
+                                               size_t n) {
+    result = impl_->blocks[i].view.Flush(in, n);
+    return static_cast<bool>(result);
+  });
+  return result;
+}
+
+Result<void> CmmSgBuffer::Invalidate(size_t offset, size_t size) const {
+  if (offset >= impl_->size) return Result<void>::Ok();
+  size = std::min(size, impl_->size - offset);
+  Result<void> result = Result<void>::Ok();
+  impl_->ForEach(offset, size, [this, &result](size_t i, size_t in,
+                                               size_t n) {
+    result = impl_->blocks[i].view.Invalidate(in, n);
+    return static_cast<bool>(result);
+  });
+  return result;
+}
+
+CmmSgCounters CmmSgBuffer::Counters() {
+  CmmSgCounters c;
+  c.allocations = g_allocations.load(std::memory_order_relaxed);
+  c.contiguous = g_contiguous.load(std::memory_order_relaxed);
+  c.fallbacks = g_fallbacks.load(std::memory_order_relaxed);
+  c.segments = g_segments.load(std::memory_order_relaxed);
+  c.failures = g_failures.load(std::memory_order_relaxed);
+  return c;
+}
+
+}  // namespace axsys
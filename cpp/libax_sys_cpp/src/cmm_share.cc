@@ -0,0 +1,585 @@
+#include "axsys/cmm_share.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace axsys {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x48535841u;  // "AXSH"
+constexpr size_t kNameMax = 32;           // including the terminator
+
+enum MsgType : uint32_t { kImport = 1, kDescriptorReply = 2, kRelease = 3 };
+
+/** One SOCK_SEQPACKET datagram, both directions. */
+struct WireMsg {
+  uint32_t magic;
+  uint32_t type;
+  uint32_t generation;
+  int32_t status;  // reply: 0 or -1 (name not published)
+  uint64_t phys;
+  uint64_t size;
+  uint32_t mode;
+  char name[kNameMax];
+  uint32_t reserved;
+};
+
+WireMsg MakeMsg(MsgType type, const std::string& name) {
+  WireMsg m;
+  memset(&m, 0, sizeof(m));
+  m.magic = kMagic;
+  m.type = type;
+  memcpy(m.name, name.c_str(), std::min(name.size(), kNameMax - 1));
+  return m;
+}
+
+std::string MsgName(const WireMsg& m) {
+  return std::string(m.name, strnlen(m.name, kNameMax));
+}
+
+bool SendMsg(int fd, const WireMsg& m) {
+  for (;;) {
+    const ssize_t n = send(fd, &m, sizeof(m), MSG_NOSIGNAL);
+    if (n == static_cast<ssize_t>(sizeof(m))) return true;
+    if (n < 0 && errno == EINTR) continue;
+    return false;
+  }
+}
+
+/** @return 1 on a message, 0 on orderly close, -1 on error. */
+int RecvMsg(int fd, WireMsg* m) {
+  for (;;) {
+    const ssize_t n = recv(fd, m, sizeof(*m), 0);
+    if (n == static_cast<ssize_t>(sizeof(*m)) && m->magic == kMagic) {
+      return 1;
+    }
+    if (n == 0) return 0;
+    if (n < 0 && errno == EINTR) continue;
+    return -1;
+  }
+}
+
+Result<void> FillAddress(const char* path, sockaddr_un* addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (!path || path[0] == '\0' || strlen(path) >= sizeof(addr->sun_path)) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("Socket path empty or too long");
+    });
+  }
+  memcpy(addr->sun_path, path, strlen(path) + 1);
+  return Result<void>::Ok();
+}
+
+Result<void> SocketError(const char* what) {
+  const int err = errno;
+  std::string w(what);
+  return Result<void>::Error(ErrorCode::kSystemCallFailed, [w, err] {
+    return w + " failed: " + strerror(err);
+  });
+}
+
+struct Entry {
+  std::string name;
+  CmmDescriptor desc;
+  CmmBuffer buffer;
+  bool retired = false;
+  uint32_t refs = 0;
+  uint64_t imports = 0;
+  uint64_t last_import_ns = 0;
+};
+
+uint64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+struct Client {
+  int fd;
+  std::vector<Entry*> held;  // one element per import
+};
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// CmmExporter
+// ---------------------------------------------------------------------------
+
+struct CmmExporter::Impl {
+  mutable std::mutex mtx;
+  std::list<Entry> entries;  // stable addresses for Client::held
+  std::unordered_map<std::string, uint32_t> generations;
+  std::vector<Client> clients;  // server thread only
+  std::string path;
+  int listen_fd = -1;
+  int wake_fd = -1;
+  std::thread thread;
+  bool closing = false;   // Close() waits for importers; guarded by mtx
+  bool orphaned = false;  // exporter destroyed; the thread deletes this
+
+  /** Current publication of @p name. Caller holds mtx. */
+  Entry* Current(const std::string& name) {
+    for (Entry& e : entries) {
+      if (!e.retired && e.name == name) return &e;
+    }
+    return nullptr;
+  }
+
+  /** Destroy @p e. Caller holds mtx. */
+  void Erase(Entry* e) {
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (&*it == e) {
+        entries.erase(it);
+        return;
+      }
+    }
+  }
+
+  /** Retire every entry and destroy the unimported ones. Caller holds mtx. */
+  void RetireAll() {
+    for (auto it = entries.begin(); it != entries.end();) {
+      it->retired = true;
+      it = it->refs == 0 ? entries.erase(it) : std::next(it);
+    }
+  }
+
+  /** Caller holds mtx. */
+  void Unref(Entry* e) {
+    if (e->refs > 0) --e->refs;
+    if (e->retired && e->refs == 0) Erase(e);
+  }
+
+  void Drop(Client* c) {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      for (Entry* e : c->held) Unref(e);
+      c->held.clear();
+    }
+    close(c->fd);
+    c->fd = -1;
+  }
+
+  void Handle(Client* c, const WireMsg& m) {
+    const std::string name = MsgName(m);
+    if (m.type == kImport) {
+      WireMsg reply = MakeMsg(kDescriptorReply, name);
+      {
+        std::lock_guard<std::mutex> lk(mtx);
+        Entry* e = Current(name);
+        if (e) {
+          ++e->refs;
+          ++e->imports;
+          e->last_import_ns = MonotonicNs();
+          c->held.push_back(e);
+          reply.phys = e->desc.phys;
+          reply.size = e->desc.size;
+          reply.mode = static_cast<uint32_t>(e->desc.mode);
+          reply.generation = e->desc.generation;
+        } else {
+          reply.status = -1;
+        }
+      }
+      (void)SendMsg(c->fd, reply);  // a vanished client is dropped on HUP
+    } else if (m.type == kRelease) {
+      std::lock_guard<std::mutex> lk(mtx);
+      for (auto it = c->held.begin(); it != c->held.end(); ++it) {
+        if ((*it)->name == name && (*it)->desc.generation == m.generation) {
+          Entry* e = *it;
+          c->held.erase(it);
+          Unref(e);
+          break;
+        }
+      }
+    }
+  }
+
+  /** Close the sockets once the server thread is gone. */
+  void CloseFds() {
+    for (Client& c : clients) {
+      if (c.fd >= 0) close(c.fd);
+    }
+    clients.clear();
+    if (listen_fd >= 0) {
+      close(listen_fd);
+      unlink(path.c_str());
+      listen_fd = -1;
+    }
+    if (wake_fd >= 0) {
+      close(wake_fd);
+      wake_fd = -1;
+    }
+  }
+
+  /** Serve(), then free this Impl if the exporter was destroyed. */
+  static void Run(Impl* impl) {
+    impl->Serve();
+    bool orphaned;
+    {
+      std::lock_guard<std::mutex> lk(impl->mtx);
+      orphaned = impl->orphaned;
+    }
+    if (!orphaned) return;
+    impl->CloseFds();
+    delete impl;
+  }
+
+  void Serve() {
+    std::vector<pollfd> fds;
+    for (;;) {
+      fds.clear();
+      fds.push_back(pollfd{wake_fd, POLLIN, 0});
+      fds.push_back(pollfd{listen_fd, POLLIN, 0});
+      for (const Client& c : clients) fds.push_back(pollfd{c.fd, POLLIN, 0});
+      if (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno == EINTR) continue;
+        perror("[CmmExporter] poll");
+        return;
+      }
+      if (fds[0].revents) return;
+      if (fds[1].revents & POLLIN) {
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd >= 0) clients.push_back(Client{fd, {}});
+      }
+      for (size_t i = 2; i < fds.size(); ++i) {
+        Client& c = clients[i - 2];
+        if (fds[i].revents == 0) continue;
+        WireMsg m;
+        // A final release can arrive together with the hang-up: read first.
+        const int r = (fds[i].revents & POLLIN) ? RecvMsg(c.fd, &m) : 0;
+        if (r > 0) {
+          Handle(&c, m);
+        } else {
+          Drop(&c);
+        }
+      }
+      for (size_t i = clients.size(); i-- > 0;) {
+        if (clients[i].fd < 0) {
+          clients.erase(clients.begin() + static_cast<ptrdiff_t>(i));
+        }
+      }
+      std::lock_guard<std::mutex> lk(mtx);
+      if (orphaned && entries.empty()) return;  // last import released
+    }
+  }
+};
+
+CmmExporter::CmmExporter() : impl_(new Impl()) {}
+
+CmmExporter::~CmmExporter() {
+  if (Close()) {
+    delete impl_;
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(impl_->mtx);
+    if (!impl_->entries.empty()) {
+      // Importers still map buffers: the server thread keeps serving
+      // their releases and frees the buffers, then the Impl.
+      impl_->orphaned = true;
+      impl_->thread.detach();
+      return;
+    }
+  }
+  (void)Close();  // released meanwhile
+  delete impl_;
+}
+
+Result<void> CmmExporter::Listen(const char* path) {
+  if (impl_->listen_fd >= 0) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("CmmExporter already listening");
+    });
+  }
+  sockaddr_un addr;
+  auto a = FillAddress(path, &addr);
+  if (!a) return a;
+  const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd < 0) return SocketError("socket");
+  unlink(path);  // stale socket of a previous run
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(fd, 16) != 0) {
+    auto err = SocketError("bind/listen");
+    close(fd);
+    return err;
+  }
+  const int wake = eventfd(0, EFD_CLOEXEC);
+  if (wake < 0) {
+    auto err = SocketError("eventfd");
+    close(fd);
+    unlink(path);
+    return err;
+  }
+  impl_->listen_fd = fd;
+  impl_->wake_fd = wake;
+  impl_->path = path;
+  impl_->thread = std::thread(&Impl::Run, impl_);
+  return Result<void>::Ok();
+}
+
+Result<uint32_t> CmmExporter::Publish(const char* name, CmmBuffer&& buffer,
+                                      CacheMode mode) {
+  if (!name || strlen(name) >= kNameMax || buffer.Size() == 0) {
+    return Result<uint32_t>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("Publish needs a name < 32 bytes and a buffer");
+    });
+  }
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  if (impl_->closing) {
+    return Result<uint32_t>::Error(ErrorCode::kClosed, [] {
+      return std::string("CmmExporter closing: buffers still imported");
+    });
+  }
+  if (Entry* old = impl_->Current(name)) {
+    old->retired = true;
+    if (old->refs == 0) impl_->Erase(old);
+  }
+  Entry e;
+  e.name = name;
+  e.desc.phys = buffer.Phys();
+  e.desc.size = buffer.Size();
+  e.desc.mode = mode;
+  e.desc.generation = ++impl_->generations[e.name];
+  e.buffer = std::move(buffer);
+  impl_->entries.push_back(std::move(e));
+  return Result<uint32_t>::Ok(impl_->entries.back().desc.generation);
+}
+
+Result<void> CmmExporter::Retire(const char* name) {
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  Entry* e = name ? impl_->Current(name) : nullptr;
+  if (!e) {
+    std::string n(name ? name : "");
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [n] {
+      return "Not published: " + n;
+    });
+  }
+  e->retired = true;
+  if (e->refs == 0) impl_->Erase(e);
+  return Result<void>::Ok();
+}
+
+uint32_t CmmExporter::Importers(const char* name) const {
+  if (!name) return 0;
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  const Entry* e = impl_->Current(name);
+  return e ? e->refs : 0;
+}
+
+bool CmmExporter::Query(const char* name, CmmPublicationInfo* out) const {
+  if (!name || !out) return false;
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  const Entry* e = impl_->Current(name);
+  if (!e) return false;
+  out->desc = e->desc;
+  out->importers = e->refs;
+  out->imports = e->imports;
+  out->last_import_ns = e->last_import_ns;
+  return true;
+}
+
+size_t CmmExporter::PendingFrees() const {
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  size_t n = 0;
+  for (const Entry& e : impl_->entries) n += e.retired ? 1 : 0;
+  return n;
+}
+
+Result<void> CmmExporter::Close() {
+  {
+    std::lock_guard<std::mutex> lk(impl_->mtx);
+    impl_->closing = true;
+    impl_->RetireAll();
+    const size_t held = impl_->entries.size();
+    if (held != 0) {
+      return Result<void>::Error(ErrorCode::kReferencesRemain, [held] {
+        return std::to_string(held) + " buffer(s) still imported";
+      });
+    }
+  }
+  if (impl_->thread.joinable()) {
+    const uint64_t one = 1;
+    if (write(impl_->wake_fd, &one, sizeof(one)) < 0) perror("eventfd");
+    impl_->thread.join();
+  }
+  impl_->CloseFds();
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  impl_->closing = false;
+  return Result<void>::Ok();
+}
+
+// ---------------------------------------------------------------------------
+// CmmImporter / CmmImportedBuffer
+// ---------------------------------------------------------------------------
+
+namespace {
+/** Shared by the importer and every buffer imported through it. */
+struct Connection {
+  int fd = -1;
+  std::mutex mtx;  // one Import() request/reply at a time
+  ~Connection() {
+    if (fd >= 0) close(fd);
+  }
+};
+}  // namespace
+
+struct CmmImporter::Impl {
+  std::shared_ptr<Connection> conn;
+};
+
+struct CmmImportedBuffer::Impl {
+  std::shared_ptr<Connection> conn;
+  std::string name;
+  CmmDescriptor desc;
+  CmmBuffer buffer;
+  CmmView view;
+};
+
+CmmImportedBuffer::CmmImportedBuffer() : impl_(nullptr) {}
+
+CmmImportedBuffer::CmmImportedBuffer(CmmImportedBuffer&& other) noexcept
+    : impl_(other.impl_) {
+  other.impl_ = nullptr;
+}
+
+CmmImportedBuffer& CmmImportedBuffer::operator=(
+    CmmImportedBuffer&& other) noexcept {
+  if (this != &other) {
+    Release();
+    impl_ = other.impl_;
+    other.impl_ = nullptr;
+  }
+  return *this;
+}
+
+CmmImportedBuffer::~CmmImportedBuffer() { Release(); }
+
+const CmmDescriptor& CmmImportedBuffer::Descriptor() const {
+  static const CmmDescriptor kEmpty = {0, 0, CacheMode::kNonCached, 0};
+  return impl_ ? impl_->desc : kEmpty;
+}
+
+CmmView& CmmImportedBuffer::View() {
+  static CmmView empty;
+  return impl_ ? impl_->view : empty;
+}
+
+CmmImportedBuffer::operator bool() const { return impl_ != nullptr; }
+
+void CmmImportedBuffer::Release() {
+  if (!impl_) return;
+  impl_->view.Reset();
+  auto d = impl_->buffer.DetachExternal();
+  if (!d) fprintf(stderr, "[CmmImportedBuffer] %s\n", d.Message().c_str());
+  WireMsg m = MakeMsg(kRelease, impl_->name);
+  m.generation = impl_->desc.generation;
+  (void)SendMsg(impl_->conn->fd, m);  // exporter gone: nothing to release
+  delete impl_;
+  impl_ = nullptr;
+}
+
+CmmImporter::CmmImporter() : impl_(new Impl()) {}
+
+CmmImporter::~CmmImporter() { delete impl_; }
+
+Result<void> CmmImporter::Connect(const char* path) {
+  if (impl_->conn) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("CmmImporter already connected");
+    });
+  }
+  sockaddr_un addr;
+  auto a = FillAddress(path, &addr);
+  if (!a) return a;
+  auto conn = std::make_shared<Connection>();
+  conn->fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (conn->fd < 0) return SocketError("socket");
+  if (connect(conn->fd, reinterpret_cast<const sockaddr*>(&addr),
+              sizeof(addr)) != 0) {
+    return SocketError("connect");
+  }
+  impl_->conn = std::move(conn);
+  return Result<void>::Ok();
+}
+
+Result<CmmImportedBuffer> CmmImporter::Import(const char* name) {
+  if (!impl_->conn) {
+    return Result<CmmImportedBuffer>::Error(ErrorCode::kNotInitialized, [] {
+      return std::string("CmmImporter not connected");
+    });
+  }
+  const std::string n(name ? name : "");
+  if (n.empty() || n.size() >= kNameMax) {
+    return Result<CmmImportedBuffer>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("Name empty or too long");
+    });
+  }
+  Connection& c = *impl_->conn;
+  WireMsg reply;
+  int r = 0;
+  {
+    std::lock_guard<std::mutex> lk(c.mtx);
+    if (!SendMsg(c.fd, MakeMsg(kImport, n))) {
+      r = 0;
+    } else {
+      do {
+        r = RecvMsg(c.fd, &reply);
+      } while (r > 0 && reply.type != kDescriptorReply);
+    }
+  }
+  if (r <= 0) {
+    return Result<CmmImportedBuffer>::Error(ErrorCode::kClosed, [] {
+      return std::string("CmmExporter connection closed");
+    });
+  }
+  if (reply.status != 0) {
+    return Result<CmmImportedBuffer>::Error(ErrorCode::kInvalidArgument, [n] {
+      return "Not published: " + n;
+    });
+  }
+
+  std::unique_ptr<CmmImportedBuffer::Impl> impl(new CmmImportedBuffer::Impl());
+  impl->conn = impl_->conn;
+  impl->name = n;
+  impl->desc.phys = reply.phys;
+  impl->desc.size = reply.size;
+  impl->desc.mode =
+      reply.mode == 0 ? CacheMode::kNonCached : CacheMode::kCached;
+  impl->desc.generation = reply.generation;
+  CmmImportedBuffer out;
+  out.impl_ = impl.release();  // Release() now tells the owner on failure
+  auto att = out.impl_->buffer.AttachExternal(reply.phys, reply.size);
+  if (!att) {
+    const std::string msg = att.Message();
+    return Result<CmmImportedBuffer>::Error(att.Code(), [msg] { return msg; });
+  }
+  auto v = out.impl_->buffer.MapView(0, reply.size, out.impl_->desc.mode);
+  if (!v) {
+    const std::string msg = v.Message();
+    return Result<CmmImportedBuffer>::Error(v.Code(), [msg] { return msg; });
+  }
+  out.impl_->view = v.MoveValue();
+  return Result<CmmImportedBuffer>::Ok(std::move(out));
+}
+
+}  // namespace axsys
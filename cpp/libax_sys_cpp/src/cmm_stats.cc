@@ -0,0 +1,337 @@
+#include "axsys/cmm_stats.hpp"
+
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace axsys {
+
+namespace detail {
+
+namespace {
+constexpr uint32_t kShards = 8;
+}  // namespace
+
+/**
+ * One token's counters. A thread always writes the same shard, so
+ * shards only share cache lines with readers (Snapshot) and threads
+ * that happen to hash to the same shard.
+ */
+struct CmmTokenCounters {
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> allocs{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> latency[kCmmLatencyBuckets] = {};
+  };
+
+  std::string name;
+  uint64_t first_ns = 0;
+  std::atomic<uint64_t> peak{0};
+  CmmTokenCharge budget;
+  Shard shards[kShards];
+};
+
+}  // namespace detail
+
+namespace {
+
+using detail::CmmTokenCounters;
+using detail::kShards;
+
+uint64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+struct Registry {
+  std::mutex mtx;
+  std::unordered_map<std::string, CmmTokenCounters*> by_name;
+  std::vector<CmmTokenCounters*> in_order;  // first-use order
+};
+
+Registry& GetRegistry() {
+  static Registry* r = new Registry();  // entries are never freed
+  return *r;
+}
+
+uint32_t ThisThreadShard() {
+  static std::atomic<uint32_t> next{0};
+  thread_local uint32_t shard =
+      next.fetch_add(1, std::memory_order_relaxed) % kShards;
+  return shard;
+}
+
+/** Small per-thread cache so the registry lock is not taken per call. */
+struct TokenCache {
+  static constexpr size_t kSize = 8;
+  const char* keys[kSize] = {};
+  CmmTokenCounters* values[kSize] = {};
+  size_t next = 0;
+};
+
+uint64_t LiveBytes(const CmmTokenCounters& c) {
+  uint64_t in = 0;
+  uint64_t out = 0;
+  for (const auto& s : c.shards) {
+    in += s.bytes_in.load(std::memory_order_relaxed);
+    out += s.bytes_out.load(std::memory_order_relaxed);
+  }
+  return in > out ? in - out : 0;
+}
+
+CmmTokenStats Collect(const CmmTokenCounters& c, uint64_t now_ns) {
+  CmmTokenStats t;
+  t.token = c.name;
+  t.allocs = 0;
+  t.frees = 0;
+  t.failures = 0;
+  uint64_t in = 0;
+  uint64_t out = 0;
+  memset(t.alloc_latency, 0, sizeof(t.alloc_latency));
+  for (const auto& s : c.shards) {
+    t.allocs += s.allocs.load(std::memory_order_relaxed);
+    t.frees += s.frees.load(std::memory_order_relaxed);
+    t.failures += s.failures.load(std::memory_order_relaxed);
+    in += s.bytes_in.load(std::memory_order_relaxed);
+    out += s.bytes_out.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kCmmLatencyBuckets; ++i) {
+      t.alloc_latency[i] += s.latency[i].load(std::memory_order_relaxed);
+    }
+  }
+  t.live_bytes = in > out ? in - out : 0;
+  t.live_blocks = t.allocs > t.frees ? t.allocs - t.frees : 0;
+  t.peak_bytes = c.peak.load(std::memory_order_relaxed);
+  if (t.peak_bytes < t.live_bytes) t.peak_bytes = t.live_bytes;
+  const uint64_t age_ns = now_ns > c.first_ns ? now_ns - c.first_ns : 0;
+  t.alloc_rate_hz = age_ns > 0 ? static_cast<double>(t.allocs) * 1e9 /
+                                     static_cast<double>(age_ns)
+                               : 0.0;
+  return t;
+}
+
+/**
+ * @p prev (may be null) turns the rate column into allocations per
+ * second since that snapshot.
+ */
+void PrintTable(FILE* out, const CmmStatsSnapshot& snap,
+                const CmmStatsSnapshot* prev) {
+  fprintf(out,
+          "[CmmStats] %zu token(s)\n"
+          "  %-20s %12s %7s %12s %9s %9s %6s %9s %9s %9s\n",
+          snap.tokens.size(), "token", "live_bytes", "blocks", "peak_bytes",
+          "allocs", "frees", "fail", "rate/s", "p50_ns", "p99_ns");
+  for (const CmmTokenStats& t : snap.tokens) {
+    double rate = t.alloc_rate_hz;
+    if (prev && snap.time_ns > prev->time_ns) {
+      const CmmTokenStats* p = prev->Find(t.token.c_str());
+      const uint64_t before = p ? p->allocs : 0;
+      rate = static_cast<double>(t.allocs - before) * 1e9 /
+             static_cast<double>(snap.time_ns - prev->time_ns);
+    }
+    fprintf(out,
+            "  %-20s %12" PRIu64 " %7" PRIu64 " %12" PRIu64 " %9" PRIu64
+            " %9" PRIu64 " %6" PRIu64 " %9.1f %9" PRIu64 " %9" PRIu64 "\n",
+            t.token.empty() ? "(none)" : t.token.c_str(), t.live_bytes,
+            t.live_blocks, t.peak_bytes, t.allocs, t.frees, t.failures, rate,
+            t.LatencyPercentileNs(0.5), t.LatencyPercentileNs(0.99));
+  }
+  fflush(out);
+}
+
+struct PeriodicDump {
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::thread thread;
+  bool running = false;
+  bool stop = false;
+};
+
+PeriodicDump& GetPeriodicDump() {
+  static PeriodicDump* d = new PeriodicDump();  // thread may outlive main
+  return *d;
+}
+
+}  // namespace
+
+uint64_t CmmTokenStats::LatencyPercentileNs(double q) const {
+  return detail::Log2HistogramPercentile(alloc_latency, q);
+}
+
+const CmmTokenStats* CmmStatsSnapshot::Find(const char* token) const {
+  const char* name = token ? token : "";
+  for (const CmmTokenStats& t : tokens) {
+    if (t.token == name) return &t;
+  }
+  return nullptr;
+}
+
+CmmStatsSnapshot CmmStats::Snapshot() {
+  Registry& reg = GetRegistry();
+  std::vector<CmmTokenCounters*> all;
+  {
+    std::lock_guard<std::mutex> lk(reg.mtx);
+    all = reg.in_order;
+  }
+  CmmStatsSnapshot snap;
+  snap.time_ns = MonotonicNs();
+  snap.tokens.reserve(all.size());
+  for (const CmmTokenCounters* c : all) {
+    snap.tokens.push_back(Collect(*c, snap.time_ns));
+  }
+  return snap;
+}
+
+void CmmStats::Dump(FILE* out) { PrintTable(out, Snapshot(), nullptr); }
+
+Result<void> CmmStats::StartPeriodicDump(uint32_t interval_ms, FILE* out) {
+  if (interval_ms == 0 || !out) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("interval_ms must be > 0 and out non-null");
+    });
+  }
+  PeriodicDump& d = GetPeriodicDump();
+  std::lock_guard<std::mutex> lk(d.mtx);
+  if (d.running) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("Periodic dump already running");
+    });
+  }
+  d.running = true;
+  d.stop = false;
+  d.thread = std::thread([&d, interval_ms, out] {
+    CmmStatsSnapshot prev = CmmStats::Snapshot();
+    std::unique_lock<std::mutex> lock(d.mtx);
+    while (!d.cv.wait_for(lock, std::chrono::milliseconds(interval_ms),
+                          [&d] { return d.stop; })) {
+      lock.unlock();
+      CmmStatsSnapshot snap = CmmStats::Snapshot();
+      PrintTable(out, snap, &prev);
+      prev = std::move(snap);
+      lock.lock();
+    }
+  });
+  return Result<void>::Ok();
+}
+
+void CmmStats::StopPeriodicDump() {
+  PeriodicDump& d = GetPeriodicDump();
+  std::thread t;
+  {
+    std::lock_guard<std::mutex> lk(d.mtx);
+    if (!d.running || d.stop) return;
+    d.stop = true;
+    t = std::move(d.thread);
+  }
+  d.cv.notify_all();
+  t.join();
+  // Only now may StartPeriodicDump() reuse the state.
+  std::lock_guard<std::mutex> lk(d.mtx);
+  d.running = false;
+}
+
+namespace detail {
+
+CmmTokenCounters* InternCmmToken(const char* token) {
+  const char* name = token ? token : "";
+  thread_local TokenCache cache;
+  for (size_t i = 0; i < TokenCache::kSize; ++i) {
+    // Same pointer with different contents (a reused buffer) misses.
+    if (cache.keys[i] == name && cache.values[i]->name == name) {
+      return cache.values[i];
+    }
+  }
+  Registry& reg = GetRegistry();
+  CmmTokenCounters* c = nullptr;
+  {
+    std::lock_guard<std::mutex> lk(reg.mtx);
+    auto it = reg.by_name.find(name);
+    if (it != reg.by_name.end()) {
+      c = it->second;
+    } else {
+      std::unique_ptr<CmmTokenCounters> fresh(new CmmTokenCounters());
+      fresh->name = name;
+      fresh->first_ns = MonotonicNs();
+      c = fresh.get();
+      reg.by_name.emplace(fresh->name, c);
+      reg.in_order.push_back(c);
+      fresh.release();
+    }
+  }
+  cache.keys[cache.next] = name;
+  cache.values[cache.next] = c;
+  cache.next = (cache.next + 1) % TokenCache::kSize;
+  return c;
+}
+
+void RecordCmmAllocate(CmmTokenCounters* c, uint64_t bytes, bool ok,
+                       uint64_t latency_ns) {
+  if (!c) return;
+  CmmTokenCounters::Shard& s = c->shards[ThisThreadShard()];
+  if (!ok) {
+    s.failures.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  s.allocs.fetch_add(1, std::memory_order_relaxed);
+  s.bytes_in.fetch_add(bytes, std::memory_order_relaxed);
+  s.latency[Log2HistogramBucket(latency_ns)].fetch_add(
+      1, std::memory_order_relaxed);
+  // Exact for one thread; with concurrent allocations of the same token
+  // the mark may miss a peak that lasted only while both were in flight.
+  const uint64_t live = LiveBytes(*c);
+  uint64_t peak = c->peak.load(std::memory_order_relaxed);
+  while (live > peak && !c->peak.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+}
+
+size_t Log2HistogramBucket(uint64_t ns) {
+  size_t b = 0;
+  while (ns > 1 && b + 1 < kCmmLatencyBuckets) {
+    ns >>= 1;
+    ++b;
+  }
+  return b;
+}
+
+uint64_t Log2HistogramPercentile(const uint64_t* buckets, double q) {
+  uint64_t total = 0;
+  for (size_t i = 0; i < kCmmLatencyBuckets; ++i) total += buckets[i];
+  if (total == 0) return 0;
+  if (q < 0.0) q = 0.0;
+  if (q > 1.0) q = 1.0;
+  const double rank = q * static_cast<double>(total);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kCmmLatencyBuckets; ++i) {
+    seen += buckets[i];
+    if (seen > 0 && static_cast<double>(seen) >= rank) {
+      return (2ULL << i) - 1;
+    }
+  }
+  return (2ULL << (kCmmLatencyBuckets - 1)) - 1;
+}
+
+void RecordCmmFree(CmmTokenCounters* c, uint64_t bytes) {
+  if (!c) return;
+  CmmTokenCounters::Shard& s = c->shards[ThisThreadShard()];
+  s.frees.fetch_add(1, std::memory_order_relaxed);
+  s.bytes_out.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+CmmTokenCharge* TokenCharge(CmmTokenCounters* c) { return &c->budget; }
+
+}  // namespace detail
+
+}  // namespace axsys
@@ -0,0 +1,282 @@
+#include "axsys/epoch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace axsys {
+
+namespace detail {
+
+// One per thread and domain, on its own cache line so that readers never
+// share a line with each other.
+struct alignas(64) EpochRecord {
+  std::atomic<uint64_t> state{0};  ///< (epoch << 1) | 1 inside, 0 outside
+  std::atomic<bool> in_use{false};
+  uint32_t nest = 0;  ///< Owner thread only
+  const std::atomic<uint64_t>* epoch = nullptr;  ///< Domain's global epoch
+};
+
+}  // namespace detail
+
+namespace {
+
+// Shared between the domain and the threads that cached a record of it,
+// so that a thread exiting after the domain is gone can still release its
+// record.
+struct Registry {
+  std::atomic<uint64_t> epoch{0};
+  std::atomic<bool> closed{false};
+  mutable std::mutex mtx;
+  std::vector<std::unique_ptr<detail::EpochRecord>> records;
+
+  detail::EpochRecord* Acquire() {
+    std::lock_guard<std::mutex> lk(mtx);
+    for (auto& r : records) {
+      bool expected = false;
+      if (r->in_use.compare_exchange_strong(expected, true)) return r.get();
+    }
+    records.emplace_back(new detail::EpochRecord());
+    detail::EpochRecord* r = records.back().get();
+    r->in_use.store(true, std::memory_order_relaxed);
+    r->epoch = &epoch;
+    return r;
+  }
+
+  // Bumps the epoch when every thread inside a section has announced the
+  // current one.
+  bool TryAdvance() {
+    std::lock_guard<std::mutex> lk(mtx);
+    const uint64_t current = epoch.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (const auto& r : records) {
+      const uint64_t s = r->state.load(std::memory_order_relaxed);
+      if ((s & 1) != 0 && (s >> 1) != current) return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    epoch.store(current + 1, std::memory_order_release);  // under mtx
+    return true;
+  }
+};
+
+struct LocalSlot {
+  std::shared_ptr<Registry> registry;
+  detail::EpochRecord* record;
+};
+
+struct LocalCache {
+  std::vector<LocalSlot> slots;
+  ~LocalCache() {
+    for (LocalSlot& s : slots) {
+      s.record->in_use.store(false, std::memory_order_release);
+    }
+  }
+};
+
+thread_local LocalCache tls_cache;
+
+detail::EpochRecord* FindLocal(const Registry* registry) {
+  for (const LocalSlot& s : tls_cache.slots) {
+    if (s.registry.get() == registry) return s.record;
+  }
+  return nullptr;
+}
+
+detail::EpochRecord* RegisterLocal(const std::shared_ptr<Registry>& registry) {
+  std::vector<LocalSlot>& slots = tls_cache.slots;
+  for (size_t i = 0; i < slots.size();) {
+    if (slots[i].registry->closed.load(std::memory_order_relaxed)) {
+      slots[i] = std::move(slots.back());
+      slots.pop_back();
+    } else {
+      ++i;
+    }
+  }
+  slots.push_back(LocalSlot{registry, registry->Acquire()});
+  return slots.back().record;
+}
+
+struct Retired {
+  uint64_t epoch;
+  std::function<void()> release;
+  CmmView view;
+  std::unique_ptr<CmmBuffer> buffer;
+
+  // Dropping the buffer releases its reference to the allocation; the
+  // block is freed (or detached) with the last view still alive elsewhere.
+  void Release() {
+    if (release) release();
+    view.Reset();
+    buffer.reset();
+  }
+};
+
+}  // namespace
+
+struct EpochDomain::Impl {
+  std::shared_ptr<Registry> registry;
+  size_t batch;
+  mutable std::mutex mtx;
+  std::deque<Retired> retired;  ///< Epochs non-decreasing
+  uint64_t retired_count = 0;
+  uint64_t reclaimed_count = 0;
+
+  // Queues @p item; true when the batch is full and Reclaim() is due.
+  bool Push(Retired item) {
+    std::lock_guard<std::mutex> lk(mtx);
+    // Whatever the caller unlinked before this point is invisible to
+    // sections that announce the epoch read here or a later one.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    item.epoch = registry->epoch.load(std::memory_order_relaxed);
+    retired.push_back(std::move(item));
+    ++retired_count;
+    return batch != 0 && retired.size() >= batch;
+  }
+
+  size_t Pending() const {
+    std::lock_guard<std::mutex> lk(mtx);
+    return retired.size();
+  }
+};
+
+EpochGuard::EpochGuard() : record_(nullptr) {}
+
+EpochGuard::EpochGuard(detail::EpochRecord* record) : record_(record) {}
+
+EpochGuard::EpochGuard(EpochGuard&& other) noexcept : record_(other.record_) {
+  other.record_ = nullptr;
+}
+
+EpochGuard& EpochGuard::operator=(EpochGuard&& other) noexcept {
+  if (this != &other) {
+    Exit();
+    record_ = other.record_;
+    other.record_ = nullptr;
+  }
+  return *this;
+}
+
+EpochGuard::~EpochGuard() { Exit(); }
+
+EpochGuard::operator bool() const { return record_ != nullptr; }
+
+void EpochGuard::Exit() {
+  if (!record_) return;
+  if (--record_->nest == 0) {
+    record_->state.store(0, std::memory_order_release);
+  }
+  record_ = nullptr;
+}
+
+EpochDomain::EpochDomain(const EpochOptions& options) : impl_(new Impl()) {
+  impl_->registry = std::make_shared<Registry>();
+  impl_->batch = options.batch;
+}
+
+EpochDomain::~EpochDomain() {
+  impl_->registry->closed.store(true, std::memory_order_relaxed);
+  for (Retired& item : impl_->retired) item.Release();
+  delete impl_;
+}
+
+EpochGuard EpochDomain::Enter() {
+  const std::shared_ptr<Registry>& registry = impl_->registry;
+  detail::EpochRecord* r = FindLocal(registry.get());
+  if (!r) r = RegisterLocal(registry);
+  if (r->nest++ == 0) {
+    const uint64_t e = r->epoch->load(std::memory_order_relaxed);
+    r->state.store((e << 1) | 1, std::memory_order_relaxed);
+    // Publish the announcement before any load of shared pointers.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+  return EpochGuard(r);
+}
+
+void EpochDomain::Retire(std::function<void()> release) {
+  Retired item;
+  item.release = std::move(release);
+  if (impl_->Push(std::move(item))) (void)Reclaim();
+}
+
+void EpochDomain::Retire(CmmView&& view) {
+  Retired item;
+  item.view = std::move(view);
+  if (impl_->Push(std::move(item))) (void)Reclaim();
+}
+
+void EpochDomain::Retire(CmmBuffer&& buffer) {
+  Retired item;
+  item.buffer.reset(new CmmBuffer(std::move(buffer)));
+  if (impl_->Push(std::move(item))) (void)Reclaim();
+}
+
+size_t EpochDomain::Reclaim() {
+  Registry& registry = *impl_->registry;
+  // Two steps when nobody is inside a section, so a quiet domain releases
+  // everything in one call.
+  if (registry.TryAdvance()) (void)registry.TryAdvance();
+  // An object retired in epoch e may be seen by sections that announced
+  // e - 1 or e; once the epoch has moved two past e, none is left.
+  const uint64_t now = registry.epoch.load(std::memory_order_acquire);
+  std::vector<Retired> ready;
+  {
+    std::lock_guard<std::mutex> lk(impl_->mtx);
+    std::deque<Retired>& q = impl_->retired;
+    while (!q.empty() && q.front().epoch + 2 <= now) {
+      ready.push_back(std::move(q.front()));
+      q.pop_front();
+    }
+  }
+  if (ready.empty()) return 0;
+  for (Retired& item : ready) item.Release();
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  impl_->reclaimed_count += ready.size();
+  return ready.size();
+}
+
+Result<void> EpochDomain::Drain(int64_t timeout_ms) {
+  const detail::EpochRecord* r = FindLocal(impl_->registry.get());
+  if (r && r->nest != 0) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("Drain() inside a critical section of the domain");
+    });
+  }
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  for (;;) {
+    (void)Reclaim();
+    if (impl_->Pending() == 0) return Result<void>::Ok();
+    if (timeout_ms >= 0 && std::chrono::steady_clock::now() >= deadline) {
+      return Result<void>::Error(ErrorCode::kTimeout, [] {
+        return std::string("Objects still pending: a thread stays inside a "
+                           "section");
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+EpochStats EpochDomain::Stats() const {
+  EpochStats s{};
+  Registry& registry = *impl_->registry;
+  s.epoch = registry.epoch.load(std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lk(registry.mtx);
+    for (const auto& r : registry.records) {
+      if (r->in_use.load(std::memory_order_relaxed)) ++s.threads;
+    }
+  }
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  s.retired = impl_->retired_count;
+  s.reclaimed = impl_->reclaimed_count;
+  s.pending = impl_->retired.size();
+  return s;
+}
+
+}  // namespace axsys
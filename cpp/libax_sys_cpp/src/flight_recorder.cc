@@ -0,0 +1,277 @@
+#include "axsys/flight_recorder.hpp"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+namespace axsys {
+namespace flight {
+
+namespace {
+
+static_assert((kEntries & (kEntries - 1)) == 0,
+              "kEntries must be a power of two");
+
+/**
+ * One ring slot. A writer clears seq, fills the fields and publishes
+ * seq = operation number + 1; readers accept a slot only if seq has the
+ * expected value both before and after copying it. The fields are relaxed
+ * atomics (plain loads and stores in practice) so that concurrent
+ * overwrites are not data races.
+ */
+struct alignas(64) Slot {
+  std::atomic<uint64_t> seq;
+  std::atomic<uint64_t> ticks;
+  std::atomic<uint64_t> phys;
+  std::atomic<uint64_t> virt;
+  std::atomic<uint64_t> size;
+  std::atomic<uint64_t> tid_ret;  // tid << 32 | (uint32_t)ret
+  std::atomic<uint32_t> op_mode;  // op << 8 | mode
+};
+
+Slot g_slots[kEntries];
+std::atomic<uint64_t> g_next{0};
+
+__attribute__((tls_model("initial-exec"))) thread_local uint32_t t_tid = 0;
+
+uint64_t Ticks() {
+#if defined(__aarch64__)
+  uint64_t v;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+  return v;
+#else
+  // The coarse clock is a vDSO memory read; the precise one can cost tens
+  // of nanoseconds under virtualisation.
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+         static_cast<uint64_t>(ts.tv_nsec);
+#endif
+}
+
+uint64_t TicksToNs(uint64_t ticks) {
+#if defined(__aarch64__)
+  uint64_t freq;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+  return ticks / freq * 1000000000ULL + ticks % freq * 1000000000ULL / freq;
+#else
+  return ticks;
+#endif
+}
+
+/** Copies slot @p seq into @p out; false if it was overwritten or torn. */
+bool ReadSlot(uint64_t seq, Entry* out) {
+  const Slot& s = g_slots[seq & (kEntries - 1)];
+  if (s.seq.load(std::memory_order_acquire) != seq + 1) return false;
+  const uint64_t ticks = s.ticks.load(std::memory_order_relaxed);
+  out->phys = s.phys.load(std::memory_order_relaxed);
+  out->virt = s.virt.load(std::memory_order_relaxed);
+  out->size = s.size.load(std::memory_order_relaxed);
+  const uint64_t tid_ret = s.tid_ret.load(std::memory_order_relaxed);
+  const uint32_t op_mode = s.op_mode.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (s.seq.load(std::memory_order_relaxed) != seq + 1) return false;
+  out->seq = seq;
+  out->time_ns = TicksToNs(ticks);
+  out->tid = static_cast<uint32_t>(tid_ret >> 32);
+  out->ret = static_cast<int32_t>(static_cast<uint32_t>(tid_ret));
+  out->op = static_cast<Op>(op_mode >> 8);
+  out->mode = static_cast<CacheMode>(op_mode & 0xff);
+  return true;
+}
+
+/** Fixed-buffer line formatter; async-signal-safe. */
+class Line {
+ public:
+  Line() : n_(0) {}
+  void Str(const char* s) {
+    while (*s && n_ < sizeof(buf_)) buf_[n_++] = *s++;
+  }
+  void Pad(size_t width, size_t from) {
+    while (n_ - from < width && n_ < sizeof(buf_)) buf_[n_++] = ' ';
+  }
+  void Dec(uint64_t v) {
+    char tmp[20];
+    size_t i = 0;
+    do {
+      tmp[i++] = static_cast<char>('0' + v % 10);
+      v /= 10;
+    } while (v != 0);
+    while (i > 0 && n_ < sizeof(buf_)) buf_[n_++] = tmp[--i];
+  }
+  void Hex(uint64_t v) {
+    static const char kDigits[] = "0123456789abcdef";
+    char tmp[16];
+    size_t i = 0;
+    do {
+      tmp[i++] = kDigits[v & 0xf];
+      v >>= 4;
+    } while (v != 0);
+    Str("0x");
+    while (i > 0 && n_ < sizeof(buf_)) buf_[n_++] = tmp[--i];
+  }
+  size_t Length() const { return n_; }
+  void Write(int fd) {
+    size_t off = 0;
+    while (off < n_) {
+      const ssize_t w = write(fd, buf_ + off, n_ - off);
+      if (w <= 0) {
+        if (w < 0 && errno == EINTR) continue;
+        break;
+      }
+      off += static_cast<size_t>(w);
+    }
+    n_ = 0;
+  }
+
+ private:
+  char buf_[192];
+  size_t n_;
+};
+
+const int kCrashSignals[] = {SIGSEGV, SIGBUS, SIGABRT};
+constexpr size_t kNumCrashSignals =
+    sizeof(kCrashSignals) / sizeof(kCrashSignals[0]);
+struct sigaction g_old_actions[kNumCrashSignals];
+std::atomic<bool> g_installed{false};
+std::atomic<bool> g_dumped{false};
+
+void OnCrashSignal(int sig) {
+  if (!g_dumped.exchange(true)) Dump(STDERR_FILENO);
+  for (size_t i = 0; i < kNumCrashSignals; ++i) {
+    if (kCrashSignals[i] != sig) continue;
+    struct sigaction prev = g_old_actions[i];
+    // An ignored SIGSEGV/SIGBUS would re-fault forever.
+    if (prev.sa_handler == SIG_IGN && sig != SIGABRT) {
+      prev.sa_handler = SIG_DFL;
+    }
+    sigaction(sig, &prev, nullptr);
+    raise(sig);
+    return;
+  }
+}
+
+}  // namespace
+
+const char* OpName(Op op) {
+  switch (op) {
+    case Op::kAllocate:
+      return "allocate";
+    case Op::kMap:
+      return "map";
+    case Op::kUnmap:
+      return "unmap";
+    case Op::kFlush:
+      return "flush";
+    case Op::kInvalidate:
+      return "invalidate";
+    case Op::kFree:
+      return "free";
+  }
+  return "unknown";
+}
+
+void Record(Op op, uint64_t phys, const void* virt, uint64_t size,
+            CacheMode mode, int32_t ret) {
+  uint32_t tid = t_tid;
+  if (tid == 0) {
+    tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    t_tid = tid;
+  }
+  const uint64_t seq = g_next.fetch_add(1, std::memory_order_relaxed);
+  Slot& s = g_slots[seq & (kEntries - 1)];
+  s.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.ticks.store(Ticks(), std::memory_order_relaxed);
+  s.phys.store(phys, std::memory_order_relaxed);
+  s.virt.store(reinterpret_cast<uintptr_t>(virt), std::memory_order_relaxed);
+  s.size.store(size, std::memory_order_relaxed);
+  s.tid_ret.store(static_cast<uint64_t>(tid) << 32 | static_cast<uint32_t>(ret),
+                  std::memory_order_relaxed);
+  s.op_mode.store(static_cast<uint32_t>(op) << 8 | static_cast<uint32_t>(mode),
+                  std::memory_order_relaxed);
+  s.seq.store(seq + 1, std::memory_order_release);
+}
+
+std::vector<Entry> Snapshot() {
+  const uint64_t end = g_next.load(std::memory_order_acquire);
+  const uint64_t begin = end > kEntries ? end - kEntries : 0;
+  std::vector<Entry> out;
+  out.reserve(end - begin);
+  for (uint64_t seq = begin; seq < end; ++seq) {
+    Entry e;
+    if (ReadSlot(seq, &e)) out.push_back(e);
+  }
+  return out;
+}
+
+void Dump(int fd) {
+  const uint64_t now_ns = TicksToNs(Ticks());
+  const uint64_t end = g_next.load(std::memory_order_acquire);
+  const uint64_t begin = end > kEntries ? end - kEntries : 0;
+  Line line;
+  line.Str("axsys flight recorder: last ");
+  line.Dec(end - begin);
+  line.Str(" of ");
+  line.Dec(end);
+  line.Str(" CMM operations, oldest first\n");
+  line.Write(fd);
+  for (uint64_t seq = begin; seq < end; ++seq) {
+    Entry e;
+    if (!ReadSlot(seq, &e)) continue;
+    line.Str("  #");
+    line.Dec(e.seq);
+    line.Str(" -");
+    line.Dec(now_ns > e.time_ns ? (now_ns - e.time_ns) / 1000 : 0);
+    line.Str("us tid ");
+    line.Dec(e.tid);
+    line.Str(" ");
+    const size_t op_at = line.Length();
+    line.Str(OpName(e.op));
+    line.Pad(10, op_at);
+    line.Str(" phys ");
+    line.Hex(e.phys);
+    line.Str(" virt ");
+    line.Hex(e.virt);
+    line.Str(" size ");
+    line.Hex(e.size);
+    line.Str(e.mode == CacheMode::kCached ? " cached ret " : " noncached ret ");
+    if (e.ret == 0) {
+      line.Str("0");
+    } else {
+      line.Hex(static_cast<uint32_t>(e.ret));
+    }
+    line.Str("\n");
+    line.Write(fd);
+  }
+}
+
+Result<void> InstallCrashHandler() {
+  if (g_installed.exchange(true)) return Result<void>::Ok();
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = OnCrashSignal;
+  sigemptyset(&sa.sa_mask);
+  for (size_t i = 0; i < kNumCrashSignals; ++i) {
+    if (sigaction(kCrashSignals[i], &sa, &g_old_actions[i]) != 0) {
+      const int err = errno;
+      for (size_t j = 0; j < i; ++j) {
+        sigaction(kCrashSignals[j], &g_old_actions[j], nullptr);
+      }
+      g_installed.store(false);
+      return Result<void>::Error(ErrorCode::kSystemCallFailed, [err] {
+        return std::string("sigaction failed: ") + strerror(err);
+      });
+    }
+  }
+  return Result<void>::Ok();
+}
+
+}  // namespace flight
+}  // namespace axsys
@@ -0,0 +1,112 @@
+#include "axsys/frame_map_cache.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace axsys {
+
+namespace {
+// Declaration order matters: the view must be unmapped before the
+// attached buffer goes away.
+struct Entry {
+  CmmBuffer buf;
+  CmmView view;
+};
+}  // namespace
+
+struct FrameMapCache::Impl {
+  CacheMode mode;
+  size_t capacity;
+  mutable std::mutex mtx;
+  std::unordered_map<uint64_t, std::unique_ptr<Entry>> entries;
+  Stats stats;
+  Impl(CacheMode m, size_t cap) : mode(m), capacity(cap), stats() {
+    entries.reserve(cap);
+  }
+
+  // Caller holds mtx.
+  void DropAllLocked() {
+    stats.unmap_calls += entries.size();
+    entries.clear();
+  }
+};
+
+FrameMapCache::FrameMapCache(CacheMode mode, size_t capacity)
+    : impl_(new Impl(mode, capacity == 0 ? 1 : capacity)) {}
+
+FrameMapCache::~FrameMapCache() { delete impl_; }
+
+Result<void*> FrameMapCache::Map(uint64_t phys, size_t size) {
+  if (phys == 0 || size == 0) {
+    return Result<void*>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("FrameMapCache::Map requires phys and size");
+    });
+  }
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  auto it = impl_->entries.find(phys);
+  if (it != impl_->entries.end() && it->second->view.Size() >= size) {
+    ++impl_->stats.hits;
+  } else {
+    ++impl_->stats.misses;
+    if (it != impl_->entries.end()) {
+      // Same block requested with a larger size: remap.
+      impl_->entries.erase(it);
+      ++impl_->stats.unmap_calls;
+    } else if (impl_->entries.size() >= impl_->capacity) {
+      impl_->DropAllLocked();
+      ++impl_->stats.invalidations;
+    }
+    std::unique_ptr<Entry> e(new Entry());
+    auto ar = e->buf.AttachExternal(phys, size);
+    if (!ar) {
+      std::string msg = ar.Message();
+      return Result<void*>::Error(ar.Code(), [msg] { return msg; });
+    }
+    ++impl_->stats.map_calls;
+    auto vr = e->buf.MapView(0, size, impl_->mode);
+    if (!vr) {
+      return Result<void*>::Error(vr.Code(), [phys, size] {
+        char buf[128];
+        snprintf(buf, sizeof(buf),
+                 "FrameMapCache map failed (phy=0x%" PRIx64 " size=0x%zx)",
+                 phys, size);
+        return std::string(buf);
+      });
+    }
+    e->view = vr.MoveValue();
+    it = impl_->entries.emplace(phys, std::move(e)).first;
+  }
+
+  CmmView& view = it->second->view;
+  if (impl_->mode == CacheMode::kCached) {
+    auto ir = view.Invalidate(0, size);
+    if (!ir) {
+      std::string msg = ir.Message();
+      return Result<void*>::Error(ir.Code(), [msg] { return msg; });
+    }
+  }
+  return Result<void*>::Ok(view.Data());
+}
+
+void FrameMapCache::Invalidate() {
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  impl_->DropAllLocked();
+  ++impl_->stats.invalidations;
+}
+
+FrameMapCache::Stats FrameMapCache::GetStats() const {
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  Stats s = impl_->stats;
+  s.entries = impl_->entries.size();
+  return s;
+}
+
+CacheMode FrameMapCache::Mode() const { return impl_->mode; }
+
+}  // namespace axsys
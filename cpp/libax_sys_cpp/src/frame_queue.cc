@@ -0,0 +1,34 @@
+#include "axsys/frame_queue.hpp"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace axsys {
+namespace detail {
+
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+               int64_t timeout_ms) {
+  // std::atomic<uint32_t> is layout-compatible with uint32_t on Linux.
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "futex word must be 32-bit");
+  struct timespec ts;
+  struct timespec* pts = nullptr;
+  if (timeout_ms >= 0) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+    pts = &ts;
+  }
+  // EAGAIN (value changed), EINTR and ETIMEDOUT all mean "re-check".
+  (void)syscall(SYS_futex, reinterpret_cast<uint32_t*>(word),
+                FUTEX_WAIT_PRIVATE, expected, pts, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word, int count) {
+  (void)syscall(SYS_futex, reinterpret_cast<uint32_t*>(word),
+                FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+}  // namespace detail
+}  // namespace axsys
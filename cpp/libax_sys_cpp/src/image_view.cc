@@ -0,0 +1,321 @@
+#include "axsys/image_view.hpp"
+
+#include <string>
+#include <utility>
+
+namespace axsys {
+
+namespace {
+
+constexpr size_t kLine = 64;  // Cortex-A53 cache line
+
+struct PlaneFormat {
+  uint32_t bits;  ///< Bits per sample (a UV pair counts as one sample)
+  uint32_t hsub;  ///< Horizontal subsampling
+  uint32_t vsub;  ///< Vertical subsampling
+};
+
+PlaneFormat FormatOf(PixelFormat format, uint32_t plane) {
+  switch (format) {
+    case PixelFormat::kRaw10Packed:
+      return {10, 1, 1};
+    case PixelFormat::kRaw16:
+      return {16, 1, 1};
+    case PixelFormat::kRgb888:
+      return {24, 1, 1};
+    case PixelFormat::kNv12:
+    case PixelFormat::kNv21:
+      return plane == 0 ? PlaneFormat{8, 1, 1} : PlaneFormat{16, 2, 2};
+    case PixelFormat::kGray8:
+    default:
+      return {8, 1, 1};
+  }
+}
+
+/** Alignment of a crop origin so that every plane starts on a byte. */
+uint32_t XAlign(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::kRaw10Packed:
+      return 4;
+    case PixelFormat::kNv12:
+    case PixelFormat::kNv21:
+      return 2;
+    default:
+      return 1;
+  }
+}
+
+uint32_t YAlign(PixelFormat format) {
+  return format == PixelFormat::kNv12 || format == PixelFormat::kNv21 ? 2 : 1;
+}
+
+uint32_t CeilDiv(uint32_t a, uint32_t b) { return (a + b - 1) / b; }
+
+size_t SampleBytes(size_t samples, uint32_t bits) {
+  return (samples * bits + 7) / 8;
+}
+
+size_t RowBytesOf(PixelFormat format, uint32_t plane, uint32_t width) {
+  const PlaneFormat f = FormatOf(format, plane);
+  return SampleBytes(CeilDiv(width, f.hsub), f.bits);
+}
+
+uint32_t RowsOf(PixelFormat format, uint32_t plane, uint32_t height) {
+  return CeilDiv(height, FormatOf(format, plane).vsub);
+}
+
+bool Inside(const ImageRect& r, uint32_t width, uint32_t height) {
+  return r.width != 0 && r.height != 0 && r.x < width && r.y < height &&
+         r.width <= width - r.x && r.height <= height - r.y;
+}
+
+bool IsPow2(size_t v) { return v != 0 && (v & (v - 1)) == 0; }
+
+size_t AlignUp(size_t v, size_t a) { return (v + a - 1) & ~(a - 1); }
+
+}  // namespace
+
+uint32_t PlaneCount(PixelFormat format) {
+  return format == PixelFormat::kNv12 || format == PixelFormat::kNv21 ? 2 : 1;
+}
+
+ImageView::ImageView() = default;
+
+Result<ImageView> ImageView::Wrap(uint32_t width, uint32_t height,
+                                  PixelFormat format, const ImagePlane* planes,
+                                  uint32_t plane_count) {
+  if (width == 0 || height == 0 || !planes ||
+      plane_count != PlaneCount(format)) {
+    return Result<ImageView>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("ImageView needs a size and one plane per format "
+                         "plane");
+    });
+  }
+  ImageView v;
+  v.width_ = width;
+  v.height_ = height;
+  v.format_ = format;
+  for (uint32_t p = 0; p < plane_count; ++p) {
+    const ImagePlane& in = planes[p];
+    const size_t row = RowBytesOf(format, p, width);
+    if (!in.view || !*in.view || in.stride < row) {
+      return Result<ImageView>::Error(ErrorCode::kInvalidArgument, [p] {
+        return "Plane " + std::to_string(p) +
+               " has no mapping or a stride shorter than a row";
+      });
+    }
+    const size_t rows = RowsOf(format, p, height);
+    const size_t span = (rows - 1) * in.stride + row;
+    if (in.offset > in.view->Size() || span > in.view->Size() - in.offset) {
+      return Result<ImageView>::Error(ErrorCode::kOutOfRange, [p] {
+        return "Plane " + std::to_string(p) + " ends past its view";
+      });
+    }
+    v.planes_[p] = in;
+  }
+  return Result<ImageView>::Ok(v);
+}
+
+uint32_t ImageView::PlaneRows(uint32_t plane) const {
+  return RowsOf(format_, plane, height_);
+}
+
+size_t ImageView::RowBytes(uint32_t plane) const {
+  return RowBytesOf(format_, plane, width_);
+}
+
+uint8_t* ImageView::Row(uint32_t plane, uint32_t y) const {
+  const ImagePlane& p = planes_[plane];
+  return static_cast<uint8_t*>(p.view->Data()) + p.offset + y * p.stride;
+}
+
+uint64_t ImageView::Phys(uint32_t plane) const {
+  const ImagePlane& p = planes_[plane];
+  return p.view->Phys() + p.offset;
+}
+
+Result<ImageView> ImageView::Crop(const ImageRect& rect) const {
+  if (!Inside(rect, width_, height_)) {
+    return Result<ImageView>::Error(ErrorCode::kOutOfRange, [] {
+      return std::string("Crop rectangle is empty or leaves the image");
+    });
+  }
+  if (rect.x % XAlign(format_) != 0 || rect.y % YAlign(format_) != 0) {
+    return Result<ImageView>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("Crop origin splits a byte or a chroma sample");
+    });
+  }
+  ImageView v = *this;
+  v.width_ = rect.width;
+  v.height_ = rect.height;
+  for (uint32_t p = 0; p < Planes(); ++p) {
+    const PlaneFormat f = FormatOf(format_, p);
+    v.planes_[p].offset += (rect.y / f.vsub) * planes_[p].stride +
+                           SampleBytes(rect.x / f.hsub, f.bits);
+  }
+  return Result<ImageView>::Ok(v);
+}
+
+std::vector<ImageSpan> ImageView::Spans(uint32_t plane,
+                                        const ImageRect& rect) const {
+  std::vector<ImageSpan> spans;
+  if (plane >= Planes() || !Inside(rect, width_, height_)) return spans;
+  const PlaneFormat f = FormatOf(format_, plane);
+  const ImagePlane& p = planes_[plane];
+  // Bytes [b0, b1) of rows [r0, r1) of this plane. A sample that shares
+  // a byte with its neighbour (RAW10) is included whole.
+  const size_t b0 = size_t{rect.x / f.hsub} * f.bits / 8;
+  const size_t b1 = SampleBytes(CeilDiv(rect.x + rect.width, f.hsub), f.bits);
+  const uint32_t r0 = rect.y / f.vsub;
+  const uint32_t r1 = CeilDiv(rect.y + rect.height, f.vsub);
+  const uintptr_t base = reinterpret_cast<uintptr_t>(p.view->Data());
+  for (uint32_t r = r0; r < r1; ++r) {
+    const size_t start = p.offset + r * p.stride + b0;
+    const size_t end = p.offset + r * p.stride + b1;
+    if (!spans.empty()) {
+      // Merge when the gap only covers lines the previous span touches.
+      ImageSpan& last = spans.back();
+      const uintptr_t last_line_end = AlignUp(base + last.offset + last.size,
+                                              kLine);
+      if (((base + start) & ~(kLine - 1)) <= last_line_end) {
+        last.size = end - last.offset;
+        continue;
+      }
+    }
+    spans.push_back(ImageSpan{start, end - start});
+  }
+  return spans;
+}
+
+Result<void> ImageView::FlushRows(uint32_t y, uint32_t rows) const {
+  return Maintain(ImageRect{0, y, width_, rows}, true);
+}
+
+Result<void> ImageView::InvalidateRows(uint32_t y, uint32_t rows) const {
+  return Maintain(ImageRect{0, y, width_, rows}, false);
+}
+
+Result<void> ImageView::FlushRect(const ImageRect& rect) const {
+  return Maintain(rect, true);
+}
+
+Result<void> ImageView::InvalidateRect(const ImageRect& rect) const {
+  return Maintain(rect, false);
+}
+
+Result<void> ImageView::Maintain(const ImageRect& rect, bool flush) const {
+  if (!Inside(rect, width_, height_)) {
+    return Result<void>::Error(ErrorCode::kOutOfRange, [] {
+      return std::string("Rectangle is empty or leaves the image");
+    });
+  }
+  for (uint32_t p = 0; p < Planes(); ++p) {
+    CmmView* view = planes_[p].view;
+    if (view->Mode() != CacheMode::kCached) continue;
+    for (const ImageSpan& s : Spans(p, rect)) {
+      Result<void> r = flush ? view->Flush(s.offset, s.size)
+                             : view->Invalidate(s.offset, s.size);
+      if (!r) return r;
+    }
+  }
+  return Result<void>::Ok();
+}
+
+struct Image::Impl {
+  CmmBuffer buffer;
+  CmmView view;
+  ImageView image;
+
+  void Release() {
+    image = ImageView();
+    view.Reset();
+    (void)buffer.Free();
+  }
+};
+
+Image::Image() : impl_(new Impl()) {}
+
+Image::Image(Image&& other) noexcept : impl_(other.impl_) {
+  other.impl_ = nullptr;
+}
+
+Image& Image::operator=(Image&& other) noexcept {
+  if (this != &other) {
+    if (impl_) impl_->Release();
+    delete impl_;
+    impl_ = other.impl_;
+    other.impl_ = nullptr;
+  }
+  return *this;
+}
+
+Image::~Image() {
+  if (impl_) impl_->Release();
+  delete impl_;
+}
+
+Result<void> Image::Allocate(uint32_t width, uint32_t height,
+                             PixelFormat format, CacheMode mode,
+                             const char* token,
+                             const ImageLayoutOptions& options) {
+  if (!impl_) impl_ = new Impl();
+  if (impl_->view) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("Image already allocated");
+    });
+  }
+  if (width == 0 || height == 0 || !IsPow2(options.stride_align) ||
+      !IsPow2(options.plane_align)) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("Image needs a size and power-of-two alignments");
+    });
+  }
+  ImagePlane planes[ImageView::kMaxPlanes] = {};
+  const uint32_t count = PlaneCount(format);
+  size_t total = 0;
+  for (uint32_t p = 0; p < count; ++p) {
+    total = AlignUp(total, options.plane_align);
+    planes[p].offset = total;
+    planes[p].stride =
+        AlignUp(RowBytesOf(format, p, width), options.stride_align);
+    total += planes[p].stride * RowsOf(format, p, height);
+  }
+  auto v = impl_->buffer.Allocate(total, mode, token);
+  if (!v) {
+    std::string msg = v.Message();
+    return Result<void>::Error(v.Code(), [msg] { return msg; });
+  }
+  impl_->view = v.MoveValue();
+  for (uint32_t p = 0; p < count; ++p) planes[p].view = &impl_->view;
+  auto image = ImageView::Wrap(width, height, format, planes, count);
+  if (!image) {
+    impl_->Release();
+    std::string msg = image.Message();
+    return Result<void>::Error(image.Code(), [msg] { return msg; });
+  }
+  impl_->image = image.Value();
+  return Result<void>::Ok();
+}
+
+Result<void> Image::Free() {
+  if (!impl_ || !impl_->view) {
+    return Result<void>::Error(ErrorCode::kNoAllocation, [] {
+      return std::string("Image not allocated");
+    });
+  }
+  impl_->image = ImageView();
+  impl_->view.Reset();
+  return impl_->buffer.Free();
+}
+
+ImageView Image::View() const { return impl_ ? impl_->image : ImageView(); }
+
+size_t Image::Size() const {
+  return impl_ && impl_->view ? impl_->view.Size() : 0;
+}
+
+uint64_t Image::Phys() const {
+  return impl_ && impl_->view ? impl_->view.Phys() : 0;
+}
+
+}  // namespace axsys
@@ -0,0 +1,371 @@
+#include "axsys/kv_cache.hpp"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace axsys {
+
+namespace {
+
+constexpr size_t kPageAlign = 64;
+
+Result<void> OutOfRange(uint32_t seq) {
+  return Result<void>::Error(ErrorCode::kOutOfRange, [seq] {
+    return "No KV sequence " + std::to_string(seq);
+  });
+}
+
+}  // namespace
+
+struct KvCache::Impl {
+  struct Seq {
+    bool live = false;
+    uint32_t length = 0;
+    std::vector<uint32_t> pages;
+  };
+
+  CmmBuffer buffer;
+  CmmView base;
+  uint8_t* data = nullptr;
+  uint64_t phys = 0;
+  uint32_t num_pages = 0;
+  uint32_t tokens_per_page = 0;
+  size_t bytes_per_token = 0;
+  size_t page_bytes = 0;
+  size_t stride = 0;
+
+  // Free list: (tag << 32) | top page index. The tag changes on every
+  // push and pop so that a stale compare-exchange cannot succeed (ABA).
+  std::atomic<uint64_t> head{kNoKvPage};
+  std::vector<std::atomic<uint32_t>> next;
+  std::vector<std::atomic<uint32_t>> refs;
+  std::atomic<uint32_t> free_pages{0};
+
+  mutable std::mutex mu;  // sequences and free_ids
+  std::vector<Seq> seqs;
+  std::vector<uint32_t> free_ids;
+
+  void Push(uint32_t page) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t nh;
+    do {
+      next[page].store(static_cast<uint32_t>(h), std::memory_order_relaxed);
+      nh = (((h >> 32) + 1) << 32) | page;
+    } while (!head.compare_exchange_weak(h, nh, std::memory_order_release,
+                                         std::memory_order_relaxed));
+    free_pages.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint32_t Pop() {
+    uint64_t h = head.load(std::memory_order_acquire);
+    for (;;) {
+      const uint32_t page = static_cast<uint32_t>(h);
+      if (page == kNoKvPage) return kNoKvPage;
+      const uint32_t nx = next[page].load(std::memory_order_relaxed);
+      const uint64_t nh = (((h >> 32) + 1) << 32) | nx;
+      if (head.compare_exchange_weak(h, nh, std::memory_order_acquire,
+                                     std::memory_order_acquire)) {
+        free_pages.fetch_sub(1, std::memory_order_relaxed);
+        return page;
+      }
+    }
+  }
+
+  Seq* Find(uint32_t seq) {
+    if (seq >= seqs.size() || !seqs[seq].live) return nullptr;
+    return &seqs[seq];
+  }
+  const Seq* Find(uint32_t seq) const {
+    if (seq >= seqs.size() || !seqs[seq].live) return nullptr;
+    return &seqs[seq];
+  }
+
+  uint32_t NewSeq() {
+    if (!free_ids.empty()) {
+      const uint32_t id = free_ids.back();
+      free_ids.pop_back();
+      seqs[id].live = true;
+      return id;
+    }
+    seqs.emplace_back();
+    seqs.back().live = true;
+    return static_cast<uint32_t>(seqs.size() - 1);
+  }
+};
+
+KvCache::KvCache() : impl_(new Impl()) {}
+
+KvCache::~KvCache() {
+  (void)Close();
+  delete impl_;
+}
+
+Result<void> KvCache::Init(const KvCacheConfig& config) {
+  if (impl_->data) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("KvCache already initialized");
+    });
+  }
+  if (config.num_pages == 0 || config.num_pages == kNoKvPage ||
+      config.tokens_per_page == 0 || config.bytes_per_token == 0) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("KvCache needs pages, tokens per page and bytes");
+    });
+  }
+  const size_t page_bytes = config.bytes_per_token * config.tokens_per_page;
+  if (page_bytes / config.tokens_per_page != config.bytes_per_token ||
+      page_bytes > SIZE_MAX / config.num_pages - kPageAlign) {
+    return Result<void>::Error(ErrorCode::kMemoryTooLarge, [] {
+      return std::string("KvCache reservation too large");
+    });
+  }
+  const size_t stride = (page_bytes + kPageAlign - 1) & ~(kPageAlign - 1);
+  auto v = impl_->buffer.Allocate(stride * config.num_pages, config.mode,
+                                  config.token);
+  if (!v) {
+    std::string msg = v.Message();
+    return Result<void>::Error(v.Code(), [msg] { return msg; });
+  }
+  impl_->base = v.MoveValue();
+  impl_->data = static_cast<uint8_t*>(impl_->base.Data());
+  impl_->phys = impl_->buffer.Phys();
+  impl_->num_pages = config.num_pages;
+  impl_->tokens_per_page = config.tokens_per_page;
+  impl_->bytes_per_token = config.bytes_per_token;
+  impl_->page_bytes = page_bytes;
+  impl_->stride = stride;
+  std::vector<std::atomic<uint32_t>> next(config.num_pages);
+  std::vector<std::atomic<uint32_t>> refs(config.num_pages);
+  impl_->next.swap(next);
+  impl_->refs.swap(refs);
+  impl_->head.store(kNoKvPage, std::memory_order_relaxed);
+  impl_->free_pages.store(0, std::memory_order_relaxed);
+  // Push in reverse so that pages are handed out in address order.
+  for (uint32_t p = config.num_pages; p-- > 0;) impl_->Push(p);
+  return Result<void>::Ok();
+}
+
+Result<void> KvCache::Close() {
+  if (!impl_->data) return Result<void>::Ok();
+  {
+    std::lock_guard<std::mutex> lock(impl_->mu);
+    impl_->seqs.clear();
+    impl_->free_ids.clear();
+  }
+  impl_->base.Reset();
+  auto f = impl_->buffer.Free();
+  if (!f) return f;
+  impl_->data = nullptr;
+  impl_->phys = 0;
+  impl_->num_pages = 0;
+  impl_->next.clear();
+  impl_->refs.clear();
+  impl_->head.store(kNoKvPage, std::memory_order_relaxed);
+  impl_->free_pages.store(0, std::memory_order_relaxed);
+  return Result<void>::Ok();
+}
+
+uint32_t KvCache::AllocPage() {
+  if (!impl_->data) return kNoKvPage;
+  const uint32_t page = impl_->Pop();
+  if (page != kNoKvPage) {
+    impl_->refs[page].store(1, std::memory_order_relaxed);
+  }
+  return page;
+}
+
+void KvCache::RetainPage(uint32_t page) {
+  if (page >= impl_->num_pages) return;
+  impl_->refs[page].fetch_add(1, std::memory_order_relaxed);
+}
+
+void KvCache::ReleasePage(uint32_t page) {
+  if (page >= impl_->num_pages) return;
+  if (impl_->refs[page].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    impl_->Push(page);
+  }
+}
+
+uint32_t KvCache::PageRefs(uint32_t page) const {
+  if (page >= impl_->num_pages) return 0;
+  return impl_->refs[page].load(std::memory_order_relaxed);
+}
+
+void* KvCache::PageData(uint32_t page) const {
+  if (page >= impl_->num_pages) return nullptr;
+  return impl_->data + size_t{page} * impl_->stride;
+}
+
+uint64_t KvCache::PagePhys(uint32_t page) const {
+  if (page >= impl_->num_pages) return 0;
+  return impl_->phys + uint64_t{page} * impl_->stride;
+}
+
+Result<void> KvCache::FlushPage(uint32_t page) const {
+  if (page >= impl_->num_pages) {
+    return Result<void>::Error(ErrorCode::kOutOfRange, [page] {
+      return "No KV page " + std::to_string(page);
+    });
+  }
+  return impl_->base.Flush(size_t{page} * impl_->stride, impl_->page_bytes);
+}
+
+size_t KvCache::PageBytes() const { return impl_->page_bytes; }
+
+uint32_t KvCache::TokensPerPage() const { return impl_->tokens_per_page; }
+
+Result<uint32_t> KvCache::CreateSequence() {
+  if (!impl_->data) {
+    return Result<uint32_t>::Error(ErrorCode::kNotInitialized, [] {
+      return std::string("KvCache not initialized");
+    });
+  }
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  return Result<uint32_t>::Ok(impl_->NewSeq());
+}
+
+Result<uint32_t> KvCache::ForkSequence(uint32_t parent) {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  if (!impl_->Find(parent)) {
+    auto e = OutOfRange(parent);
+    std::string msg = e.Message();
+    return Result<uint32_t>::Error(e.Code(), [msg] { return msg; });
+  }
+  const uint32_t id = impl_->NewSeq();
+  // NewSeq() may grow seqs; look the parent up again.
+  const Impl::Seq& p = impl_->seqs[parent];
+  Impl::Seq& s = impl_->seqs[id];
+  s.length = p.length;
+  s.pages = p.pages;
+  for (uint32_t page : s.pages) RetainPage(page);
+  return Result<uint32_t>::Ok(id);
+}
+
+Result<void*> KvCache::AppendToken(uint32_t seq) {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  Impl::Seq* s = impl_->Find(seq);
+  if (!s) {
+    auto e = OutOfRange(seq);
+    std::string msg = e.Message();
+    return Result<void*>::Error(e.Code(), [msg] { return msg; });
+  }
+  const uint32_t slot = s->length % impl_->tokens_per_page;
+  if (slot == 0 || PageRefs(s->pages.back()) > 1) {
+    const uint32_t page = AllocPage();
+    if (page == kNoKvPage) {
+      return Result<void*>::Error(ErrorCode::kAllocationFailed, [] {
+        return std::string("No free KV page");
+      });
+    }
+    if (slot == 0) {
+      s->pages.push_back(page);
+    } else {
+      // Copy-on-write: the other holders keep the old page.
+      const uint32_t old = s->pages.back();
+      const size_t copied = slot * impl_->bytes_per_token;
+      memcpy(PageData(page), PageData(old), copied);
+      if (impl_->base.Mode() == CacheMode::kCached) {
+        auto f = impl_->base.Flush(size_t{page} * impl_->stride, copied);
+        if (!f) {
+          ReleasePage(page);
+          std::string msg = f.Message();
+          return Result<void*>::Error(f.Code(), [msg] { return msg; });
+        }
+      }
+      s->pages.back() = page;
+      ReleasePage(old);
+    }
+  }
+  ++s->length;
+  return Result<void*>::Ok(static_cast<uint8_t*>(PageData(s->pages.back())) +
+                           slot * impl_->bytes_per_token);
+}
+
+const void* KvCache::TokenData(uint32_t seq, uint32_t pos) const {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  const Impl::Seq* s = impl_->Find(seq);
+  if (!s || pos >= s->length) return nullptr;
+  const uint32_t page = s->pages[pos / impl_->tokens_per_page];
+  return static_cast<const uint8_t*>(PageData(page)) +
+         (pos % impl_->tokens_per_page) * impl_->bytes_per_token;
+}
+
+Result<void> KvCache::FreeSequence(uint32_t seq) {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  Impl::Seq* s = impl_->Find(seq);
+  if (!s) return OutOfRange(seq);
+  for (uint32_t page : s->pages) ReleasePage(page);
+  *s = Impl::Seq();
+  impl_->free_ids.push_back(seq);
+  return Result<void>::Ok();
+}
+
+uint32_t KvCache::Length(uint32_t seq) const {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  const Impl::Seq* s = impl_->Find(seq);
+  return s ? s->length : 0;
+}
+
+Result<std::vector<uint64_t>> KvCache::PageTable(uint32_t seq) const {
+  std::lock_guard<std::mutex> lock(impl_->mu);
+  const Impl::Seq* s = impl_->Find(seq);
+  if (!s) {
+    auto e = OutOfRange(seq);
+    std::string msg = e.Message();
+    return Result<std::vector<uint64_t>>::Error(e.Code(),
+                                                [msg] { return msg; });
+  }
+  std::vector<uint64_t> table;
+  table.reserve(s->pages.size());
+  for (uint32_t page : s->pages) table.push_back(PagePhys(page));
+  return Result<std::vector<uint64_t>>::Ok(std::move(table));
+}
+
+KvCacheStats KvCache::Stats() const {
+  KvCacheStats st{};
+  st.pages_total = impl_->num_pages;
+  st.pages_free = impl_->free_pages.load(std::memory_order_relaxed);
+  const uint32_t tpp = impl_->tokens_per_page;
+  std::vector<uint32_t> fill(impl_->num_pages, 0);
+  {
+    std::lock_guard<std::mutex> lock(impl_->mu);
+    for (const Impl::Seq& s : impl_->seqs) {
+      if (!s.live) continue;
+      ++st.sequences;
+      st.tokens += s.length;
+      st.logical_pages += s.pages.size();
+      for (size_t k = 0; k < s.pages.size(); ++k) {
+        const uint32_t in_page =
+            k + 1 < s.pages.size() ? tpp
+                                   : s.length - static_cast<uint32_t>(k) * tpp;
+        fill[s.pages[k]] = std::max(fill[s.pages[k]], in_page);
+      }
+    }
+  }
+  uint64_t used = 0;
+  uint64_t filled = 0;
+  for (uint32_t p = 0; p < impl_->num_pages; ++p) {
+    const uint32_t r = PageRefs(p);
+    if (r == 0) continue;
+    ++used;
+    filled += fill[p];
+    if (r > 1) ++st.pages_shared;
+  }
+  if (st.pages_total > 0) {
+    st.occupancy =
+        static_cast<double>(used) / static_cast<double>(st.pages_total);
+  }
+  if (used > 0) {
+    st.fragmentation =
+        1.0 - static_cast<double>(filled) / static_cast<double>(used * tpp);
+  }
+  return st;
+}
+
+}  // namespace axsys
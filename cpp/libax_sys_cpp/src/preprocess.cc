@@ -0,0 +1,583 @@
+#include "axsys/preprocess.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "axsys/cmm_parallel.hpp"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AXSYS_PREPROCESS_NEON 1
+#endif
+
+namespace axsys {
+
+namespace {
+
+// Bilinear weights are in 1/128 steps: a horizontal sample fits 16 bits
+// (255 * 128) and the vertical blend 32 bits.
+constexpr uint32_t kWeightOne = 128;
+constexpr uint32_t kNoRow = UINT32_MAX;
+
+/** Per-channel quantization table; `affine` when it is x + offset. */
+struct Lut {
+  uint8_t v[3][256];
+  uint8_t offset[3];
+  bool affine;
+};
+
+// ---- Row kernels, scalar -------------------------------------------------
+
+// BT.601 limited range in 1/64 steps, laid out so the NEON path stays in
+// 16 bits: the luma term is floor(Y * 74.5) - 16 * 74.5 + 32 (rounding).
+inline uint8_t Clamp6(int32_t v) {
+  v >>= 6;
+  return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+void Nv12RowTail(const uint8_t* yrow, const uint8_t* uvrow, uint8_t* out,
+                 uint32_t x, uint32_t width, bool nv21, bool bgr) {
+  for (; x < width; ++x) {
+    const int32_t c = ((yrow[x] * 149) >> 1) - 1160;
+    const uint8_t* uv = uvrow + (x & ~1u);
+    const int32_t d = (nv21 ? uv[1] : uv[0]) - 128;
+    const int32_t e = (nv21 ? uv[0] : uv[1]) - 128;
+    const uint8_t r = Clamp6(c + 102 * e);
+    const uint8_t g = Clamp6(c - 25 * d - 52 * e);
+    const uint8_t b = Clamp6(c + 129 * d);
+    uint8_t* o = out + x * 3;
+    o[0] = bgr ? b : r;
+    o[1] = g;
+    o[2] = bgr ? r : b;
+  }
+}
+
+void VerticalTail(const uint16_t* h0, const uint16_t* h1, uint8_t* out,
+                  size_t i, size_t n, uint32_t wy) {
+  const uint32_t w0 = kWeightOne - wy;
+  for (; i < n; ++i) {
+    out[i] = static_cast<uint8_t>((h0[i] * w0 + h1[i] * wy + 8192) >> 14);
+  }
+}
+
+// One tensor row from one image row starting at pixel x. `out` is the row
+// in channel 0; for CHW the other channels follow every `plane` bytes.
+void TensorRowTail(const uint8_t* s, uint8_t* out, size_t plane,
+                   uint32_t x, uint32_t width, uint32_t ch, bool chw,
+                   const Lut& lut) {
+  for (; x < width; ++x) {
+    for (uint32_t c = 0; c < ch; ++c) {
+      const uint8_t v = lut.v[c][s[x * ch + c]];
+      if (chw) {
+        out[c * plane + x] = v;
+      } else {
+        out[x * ch + c] = v;
+      }
+    }
+  }
+}
+
+// ---- Row kernels, NEON (scalar entry points otherwise) --------------------
+
+#if defined(AXSYS_PREPROCESS_NEON)
+
+// floor(Y * 149 / 2) - 1160, as in Nv12RowTail.
+inline int16x8_t LumaNeon(uint8x8_t y, uint8x8_t k149, int16x8_t bias) {
+  const uint16x8_t t = vshrq_n_u16(vmull_u8(y, k149), 1);
+  return vsubq_s16(vreinterpretq_s16_u16(t), bias);
+}
+
+void Nv12RowNeon(const uint8_t* yrow, const uint8_t* uvrow, uint8_t* out,
+                 uint32_t width, bool nv21, bool bgr) {
+  const uint8x8_t k149 = vdup_n_u8(149);
+  const int16x8_t bias = vdupq_n_s16(1160);
+  const int16x8_t k128 = vdupq_n_s16(128);
+  uint32_t x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const uint8x16_t y = vld1q_u8(yrow + x);
+    const uint8x8x2_t uv = vld2_u8(uvrow + x);
+    const uint8x8_t u = nv21 ? uv.val[1] : uv.val[0];
+    const uint8x8_t v = nv21 ? uv.val[0] : uv.val[1];
+    const int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)), k128);
+    const int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)), k128);
+    // Chroma terms for 8 pairs, each repeated for its two pixels.
+    const int16x8_t rc = vmulq_n_s16(e, 102);
+    const int16x8_t gc = vmlaq_n_s16(vmulq_n_s16(d, -25), e, -52);
+    const int16x8_t bc = vmulq_n_s16(d, 129);
+    const int16x8x2_t r2 = vzipq_s16(rc, rc);
+    const int16x8x2_t g2 = vzipq_s16(gc, gc);
+    const int16x8x2_t b2 = vzipq_s16(bc, bc);
+    const int16x8_t c0 = LumaNeon(vget_low_u8(y), k149, bias);
+    const int16x8_t c1 = LumaNeon(vget_high_u8(y), k149, bias);
+    // Only blue can exceed 16 bits; saturating there still clamps to 255.
+    const uint8x16_t r =
+        vcombine_u8(vqshrun_n_s16(vaddq_s16(c0, r2.val[0]), 6),
+                    vqshrun_n_s16(vaddq_s16(c1, r2.val[1]), 6));
+    const uint8x16_t g =
+        vcombine_u8(vqshrun_n_s16(vaddq_s16(c0, g2.val[0]), 6),
+                    vqshrun_n_s16(vaddq_s16(c1, g2.val[1]), 6));
+    const uint8x16_t b =
+        vcombine_u8(vqshrun_n_s16(vqaddq_s16(c0, b2.val[0]), 6),
+                    vqshrun_n_s16(vqaddq_s16(c1, b2.val[1]), 6));
+    uint8x16x3_t o;
+    o.val[0] = bgr ? b : r;
+    o.val[1] = g;
+    o.val[2] = bgr ? r : b;
+    vst3q_u8(out + x * 3, o);
+  }
+  Nv12RowTail(yrow, uvrow, out, x, width, nv21, bgr);
+}
+
+void VerticalNeon(const uint16_t* h0, const uint16_t* h1, uint8_t* out,
+                  size_t n, uint32_t wy) {
+  const uint16_t w0 = static_cast<uint16_t>(kWeightOne - wy);
+  const uint16_t w1 = static_cast<uint16_t>(wy);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const uint16x8_t a = vld1q_u16(h0 + i);
+    const uint16x8_t b = vld1q_u16(h1 + i);
+    const uint32x4_t lo =
+        vmlal_n_u16(vmull_n_u16(vget_low_u16(a), w0), vget_low_u16(b), w1);
+    const uint32x4_t hi =
+        vmlal_n_u16(vmull_n_u16(vget_high_u16(a), w0), vget_high_u16(b), w1);
+    const uint16x8_t v =
+        vcombine_u16(vrshrn_n_u32(lo, 14), vrshrn_n_u32(hi, 14));
+    vst1_u8(out + i, vmovn_u16(v));
+  }
+  VerticalTail(h0, h1, out, i, n, wy);
+}
+
+void TensorRowNeon(const uint8_t* s, uint8_t* out, size_t plane,
+                   uint32_t width, uint32_t ch, bool chw, const Lut& lut) {
+  uint32_t x = 0;
+  if (lut.affine && ch == 3) {
+    const uint8x16_t k0 = vdupq_n_u8(lut.offset[0]);
+    const uint8x16_t k1 = vdupq_n_u8(lut.offset[1]);
+    const uint8x16_t k2 = vdupq_n_u8(lut.offset[2]);
+    for (; x + 16 <= width; x += 16) {
+      uint8x16x3_t v = vld3q_u8(s + x * 3);
+      v.val[0] = vaddq_u8(v.val[0], k0);
+      v.val[1] = vaddq_u8(v.val[1], k1);
+      v.val[2] = vaddq_u8(v.val[2], k2);
+      if (chw) {
+        vst1q_u8(out + x, v.val[0]);
+        vst1q_u8(out + plane + x, v.val[1]);
+        vst1q_u8(out + 2 * plane + x, v.val[2]);
+      } else {
+        vst3q_u8(out + x * 3, v);
+      }
+    }
+  } else if (lut.affine && ch == 1) {
+    const uint8x16_t k0 = vdupq_n_u8(lut.offset[0]);
+    for (; x + 16 <= width; x += 16) {
+      vst1q_u8(out + x, vaddq_u8(vld1q_u8(s + x), k0));
+    }
+  }
+  TensorRowTail(s, out, plane, x, width, ch, chw, lut);
+}
+
+#else
+
+void Nv12RowScalar(const uint8_t* yrow, const uint8_t* uvrow, uint8_t* out,
+                   uint32_t width, bool nv21, bool bgr) {
+  Nv12RowTail(yrow, uvrow, out, 0, width, nv21, bgr);
+}
+
+void VerticalScalar(const uint16_t* h0, const uint16_t* h1, uint8_t* out,
+                    size_t n, uint32_t wy) {
+  VerticalTail(h0, h1, out, 0, n, wy);
+}
+
+void TensorRowScalar(const uint8_t* s, uint8_t* out, size_t plane,
+                     uint32_t width, uint32_t ch, bool chw, const Lut& lut) {
+  TensorRowTail(s, out, plane, 0, width, ch, chw, lut);
+}
+
+#endif
+
+using Nv12RowFn = void (*)(const uint8_t* yrow, const uint8_t* uvrow,
+                           uint8_t* out, uint32_t width, bool nv21, bool bgr);
+using VerticalFn = void (*)(const uint16_t* h0, const uint16_t* h1,
+                            uint8_t* out, size_t n, uint32_t wy);
+using TensorRowFn = void (*)(const uint8_t* s, uint8_t* out, size_t plane,
+                             uint32_t width, uint32_t ch, bool chw,
+                             const Lut& lut);
+
+struct Kernels {
+  Nv12RowFn nv12;
+  VerticalFn vertical;
+  TensorRowFn tensor;
+  const char* name;
+};
+
+const Kernels& GetKernels() {
+#if defined(AXSYS_PREPROCESS_NEON)
+  static const Kernels kernels{Nv12RowNeon, VerticalNeon, TensorRowNeon,
+                               "neon"};
+#else
+  static const Kernels kernels{Nv12RowScalar, VerticalScalar,
+                               TensorRowScalar, "scalar"};
+#endif
+  return kernels;
+}
+
+// ---- Helpers -------------------------------------------------------------
+
+// Run fn(row_begin, row_end) over [0, rows) on up to `threads` threads of
+// the RunTasks() pool; the calling thread takes the first slice.
+template <typename Fn>
+void ForEachRowSlice(uint32_t rows, unsigned threads, Fn fn) {
+  if (threads > rows) threads = rows;
+  if (threads <= 1) {
+    fn(0u, rows);
+    return;
+  }
+  RunTasks(threads, [rows, threads, &fn](unsigned t) {
+    fn(static_cast<uint32_t>(uint64_t{rows} * t / threads),
+       static_cast<uint32_t>(uint64_t{rows} * (t + 1) / threads));
+  });
+}
+
+Result<void> Invalid(const char* fn, const char* what) {
+  const std::string msg = std::string(fn) + ": " + what;
+  return Result<void>::Error(ErrorCode::kInvalidArgument,
+                             [msg] { return msg; });
+}
+
+uint32_t ChannelsOf(PixelFormat format) {
+  return format == PixelFormat::kRgb888 ? 3 : 1;
+}
+
+bool Resizable(PixelFormat format) {
+  return format == PixelFormat::kGray8 || format == PixelFormat::kRgb888;
+}
+
+/** Source index pairs and the weight of the second, per output index. */
+struct AxisMap {
+  std::vector<uint32_t> i0;
+  std::vector<uint32_t> i1;
+  std::vector<uint32_t> w;
+};
+
+AxisMap BilinearMap(uint32_t src, uint32_t dst) {
+  AxisMap m;
+  m.i0.resize(dst);
+  m.i1.resize(dst);
+  m.w.resize(dst);
+  const double ratio = static_cast<double>(src) / dst;
+  for (uint32_t d = 0; d < dst; ++d) {
+    const double s = std::max(0.0, (d + 0.5) * ratio - 0.5);
+    const uint32_t i = std::min(static_cast<uint32_t>(s), src - 1);
+    m.i0[d] = i;
+    m.i1[d] = std::min(i + 1, src - 1);
+    m.w[d] = m.i1[d] == i ? 0
+                          : static_cast<uint32_t>(lround((s - i) * kWeightOne));
+  }
+  return m;
+}
+
+std::vector<uint32_t> NearestMap(uint32_t src, uint32_t dst) {
+  std::vector<uint32_t> m(dst);
+  for (uint32_t d = 0; d < dst; ++d) {
+    const uint64_t s = (2 * uint64_t{d} + 1) * src / (2 * uint64_t{dst});
+    m[d] = std::min(static_cast<uint32_t>(s), src - 1);
+  }
+  return m;
+}
+
+void HorizontalRow(const uint8_t* s, uint16_t* h, const AxisMap& mx,
+                   uint32_t ch) {
+  for (size_t x = 0; x < mx.w.size(); ++x) {
+    const uint8_t* a = s + mx.i0[x] * ch;
+    const uint8_t* b = s + mx.i1[x] * ch;
+    const uint32_t w1 = mx.w[x];
+    const uint32_t w0 = kWeightOne - w1;
+    for (uint32_t c = 0; c < ch; ++c) {
+      h[x * ch + c] = static_cast<uint16_t>(a[c] * w0 + b[c] * w1);
+    }
+  }
+}
+
+/** Source maps of one resize, shared by the row slices. */
+struct ResizePlan {
+  ResizeFilter filter;
+  uint32_t ch;
+  size_t row_bytes;
+  std::vector<uint32_t> nx, ny;  // kNearest
+  AxisMap bx, by;                // kBilinear
+  VerticalFn vertical;
+};
+
+ResizePlan PlanResize(const ImageView& src, const ImageView& dst,
+                      ResizeFilter filter) {
+  ResizePlan plan;
+  plan.filter = filter;
+  plan.ch = ChannelsOf(src.Format());
+  plan.row_bytes = dst.RowBytes(0);
+  plan.vertical = GetKernels().vertical;
+  if (filter == ResizeFilter::kNearest) {
+    plan.nx = NearestMap(src.Width(), dst.Width());
+    plan.ny = NearestMap(src.Height(), dst.Height());
+  } else {
+    plan.bx = BilinearMap(src.Width(), dst.Width());
+    plan.by = BilinearMap(src.Height(), dst.Height());
+  }
+  return plan;
+}
+
+/** Resize destination rows [y0, y1). */
+void ResizeRowRange(const ResizePlan& plan, const ImageView& src,
+                    const ImageView& dst, uint32_t y0, uint32_t y1) {
+  const uint32_t ch = plan.ch;
+  const size_t row_bytes = plan.row_bytes;
+  if (plan.filter == ResizeFilter::kNearest) {
+    const std::vector<uint32_t>& mx = plan.nx;
+    const std::vector<uint32_t>& my = plan.ny;
+    for (uint32_t y = y0; y < y1; ++y) {
+      uint8_t* o = dst.Row(0, y);
+      if (y > y0 && my[y] == my[y - 1]) {
+        memcpy(o, dst.Row(0, y - 1), row_bytes);
+        continue;
+      }
+      const uint8_t* s = src.Row(0, my[y]);
+      if (ch == 3) {
+        for (size_t x = 0; x < mx.size(); ++x) {
+          const uint8_t* p = s + mx[x] * 3;
+          o[x * 3] = p[0];
+          o[x * 3 + 1] = p[1];
+          o[x * 3 + 2] = p[2];
+        }
+      } else {
+        for (size_t x = 0; x < mx.size(); ++x) o[x] = s[mx[x]];
+      }
+    }
+    return;
+  }
+
+  const AxisMap& mx = plan.bx;
+  const AxisMap& my = plan.by;
+  // Horizontally resampled source rows, reused by neighbouring outputs.
+  std::vector<uint16_t> h0(row_bytes);
+  std::vector<uint16_t> h1(row_bytes);
+  uint32_t row0 = kNoRow;
+  uint32_t row1 = kNoRow;
+  for (uint32_t y = y0; y < y1; ++y) {
+    const uint32_t want0 = my.i0[y];
+    const uint32_t want1 = my.i1[y];
+    if (row0 != want0) {
+      if (row1 == want0) {
+        std::swap(h0, h1);
+        std::swap(row0, row1);
+      } else {
+        HorizontalRow(src.Row(0, want0), h0.data(), mx, ch);
+        row0 = want0;
+      }
+    }
+    if (row1 != want1) {
+      HorizontalRow(src.Row(0, want1), h1.data(), mx, ch);
+      row1 = want1;
+    }
+    plan.vertical(h0.data(), h1.data(), dst.Row(0, y), row_bytes, my.w[y]);
+  }
+}
+
+void ResizeRows(const ImageView& src, const ImageView& dst,
+                ResizeFilter filter, unsigned threads) {
+  const ResizePlan plan = PlanResize(src, dst, filter);
+  ForEachRowSlice(dst.Height(), threads, [&](uint32_t y0, uint32_t y1) {
+    ResizeRowRange(plan, src, dst, y0, y1);
+  });
+}
+
+Result<void> CheckResize(const char* fn, const ImageView& src,
+                         const ImageView& dst) {
+  if (!src || !dst) return Invalid(fn, "views must be set");
+  if (src.Format() != dst.Format() || !Resizable(src.Format())) {
+    return Invalid(fn, "source and destination must both be Gray8 or RGB888");
+  }
+  return Result<void>::Ok();
+}
+
+Lut BuildLut(const QuantParams& q, TensorType type) {
+  const long lo = type == TensorType::kU8 ? 0 : -128;
+  const long hi = type == TensorType::kU8 ? 255 : 127;
+  Lut lut;
+  lut.affine = true;
+  for (int c = 0; c < 3; ++c) {
+    for (int x = 0; x < 256; ++x) {
+      long v = lroundf((static_cast<float>(x) - q.mean[c]) * q.scale[c]) +
+               q.zero_point;
+      v = std::min(hi, std::max(lo, v));
+      lut.v[c][x] = static_cast<uint8_t>(v & 0xff);
+    }
+    lut.offset[c] = lut.v[c][0];
+    for (int x = 0; x < 256; ++x) {
+      if (lut.v[c][x] != static_cast<uint8_t>(x + lut.offset[c])) {
+        lut.affine = false;
+      }
+    }
+  }
+  return lut;
+}
+
+}  // namespace
+
+Result<void> Nv12ToRgb(const ImageView& src, const ImageView& dst,
+                       ChannelOrder order, unsigned threads) {
+  if (!src || !dst) return Invalid("Nv12ToRgb", "views must be set");
+  if ((src.Format() != PixelFormat::kNv12 &&
+       src.Format() != PixelFormat::kNv21) ||
+      dst.Format() != PixelFormat::kRgb888 || src.Width() != dst.Width() ||
+      src.Height() != dst.Height()) {
+    return Invalid("Nv12ToRgb", "needs NV12/NV21 in and same-size RGB888 out");
+  }
+  auto ir = src.InvalidateRows(0, src.Height());
+  if (!ir) return ir;
+  const bool nv21 = src.Format() == PixelFormat::kNv21;
+  const bool bgr = order == ChannelOrder::kBgr;
+  const Nv12RowFn fn = GetKernels().nv12;
+  ForEachRowSlice(dst.Height(), threads, [&](uint32_t y0, uint32_t y1) {
+    for (uint32_t y = y0; y < y1; ++y) {
+      fn(src.Row(0, y), src.Row(1, y / 2), dst.Row(0, y), dst.Width(), nv21,
+         bgr);
+    }
+  });
+  return dst.FlushRows(0, dst.Height());
+}
+
+Result<void> Resize(const ImageView& src, const ImageView& dst,
+                    ResizeFilter filter, unsigned threads) {
+  auto cr = CheckResize("Resize", src, dst);
+  if (!cr) return cr;
+  auto ir = src.InvalidateRows(0, src.Height());
+  if (!ir) return ir;
+  ResizeRows(src, dst, filter, threads);
+  return dst.FlushRows(0, dst.Height());
+}
+
+Result<LetterboxInfo> Letterbox(const ImageView& src, const ImageView& dst,
+                                ResizeFilter filter, uint8_t pad,
+                                unsigned threads) {
+  auto cr = CheckResize("Letterbox", src, dst);
+  if (!cr) {
+    std::string msg = cr.Message();
+    return Result<LetterboxInfo>::Error(cr.Code(), [msg] { return msg; });
+  }
+  const double scale =
+      std::min(static_cast<double>(dst.Width()) / src.Width(),
+               static_cast<double>(dst.Height()) / src.Height());
+  const uint32_t w = std::min(
+      dst.Width(),
+      std::max(1u, static_cast<uint32_t>(lround(src.Width() * scale))));
+  const uint32_t h = std::min(
+      dst.Height(),
+      std::max(1u, static_cast<uint32_t>(lround(src.Height() * scale))));
+  LetterboxInfo info;
+  info.scale = static_cast<float>(scale);
+  info.content = ImageRect{(dst.Width() - w) / 2, (dst.Height() - h) / 2, w, h};
+
+  auto ir = src.InvalidateRows(0, src.Height());
+  if (!ir) {
+    std::string msg = ir.Message();
+    return Result<LetterboxInfo>::Error(ir.Code(), [msg] { return msg; });
+  }
+  const uint32_t ch = ChannelsOf(dst.Format());
+  const ImageRect c = info.content;
+  const ImageView inner = dst.Crop(c).Value();
+  const ResizePlan plan = PlanResize(src, inner, filter);
+  const size_t row_bytes = dst.RowBytes(0);
+  // One split over the content rows: each slice pads the sides of its own
+  // rows and resizes them; the first and last slices also fill the top
+  // and bottom bands.
+  ForEachRowSlice(h, threads, [&](uint32_t y0, uint32_t y1) {
+    if (y0 == 0) {
+      for (uint32_t y = 0; y < c.y; ++y) memset(dst.Row(0, y), pad, row_bytes);
+    }
+    if (y1 == h) {
+      for (uint32_t y = c.y + h; y < dst.Height(); ++y) {
+        memset(dst.Row(0, y), pad, row_bytes);
+      }
+    }
+    const size_t right = size_t{c.x + c.width} * ch;
+    for (uint32_t y = c.y + y0; y < c.y + y1; ++y) {
+      uint8_t* row = dst.Row(0, y);
+      memset(row, pad, size_t{c.x} * ch);
+      memset(row + right, pad, row_bytes - right);
+    }
+    ResizeRowRange(plan, src, inner, y0, y1);
+  });
+  auto fr = dst.FlushRows(0, dst.Height());
+  if (!fr) {
+    std::string msg = fr.Message();
+    return Result<LetterboxInfo>::Error(fr.Code(), [msg] { return msg; });
+  }
+  return Result<LetterboxInfo>::Ok(info);
+}
+
+Result<void> CropImage(const ImageView& src, const ImageRect& rect,
+                       const ImageView& dst, unsigned threads) {
+  if (!src || !dst) return Invalid("CropImage", "views must be set");
+  if (src.Format() != dst.Format() || dst.Width() != rect.width ||
+      dst.Height() != rect.height) {
+    return Invalid("CropImage", "destination must match the format and rect");
+  }
+  auto crop = src.Crop(rect);
+  if (!crop) {
+    std::string msg = crop.Message();
+    return Result<void>::Error(crop.Code(), [msg] { return msg; });
+  }
+  const ImageView& s = crop.Value();
+  auto ir = s.InvalidateRows(0, s.Height());
+  if (!ir) return ir;
+  for (uint32_t p = 0; p < dst.Planes(); ++p) {
+    const size_t bytes = dst.RowBytes(p);
+    ForEachRowSlice(dst.PlaneRows(p), threads, [&](uint32_t y0, uint32_t y1) {
+      for (uint32_t y = y0; y < y1; ++y) {
+        memcpy(dst.Row(p, y), s.Row(p, y), bytes);
+      }
+    });
+  }
+  return dst.FlushRows(0, dst.Height());
+}
+
+Result<void> ToTensor(const ImageView& src, const TensorView& dst,
+                      const QuantParams& q, unsigned threads) {
+  if (!src || !dst.view || !*dst.view) {
+    return Invalid("ToTensor", "views must be set");
+  }
+  if (!Resizable(src.Format()) || dst.channels != ChannelsOf(src.Format()) ||
+      dst.width != src.Width() || dst.height != src.Height()) {
+    return Invalid("ToTensor", "tensor must match the image size and channels");
+  }
+  const size_t bytes = TensorBytes(dst);
+  if (dst.offset > dst.view->Size() || bytes > dst.view->Size() - dst.offset) {
+    return Invalid("ToTensor", "tensor ends past its view");
+  }
+  auto ir = src.InvalidateRows(0, src.Height());
+  if (!ir) return ir;
+
+  const Lut lut = BuildLut(q, dst.type);
+  const TensorRowFn fn = GetKernels().tensor;
+  const bool chw = dst.layout == TensorLayout::kChw;
+  const size_t plane = size_t{dst.width} * dst.height;
+  uint8_t* base = static_cast<uint8_t*>(dst.view->Data()) + dst.offset;
+  ForEachRowSlice(dst.height, threads, [&](uint32_t y0, uint32_t y1) {
+    for (uint32_t y = y0; y < y1; ++y) {
+      uint8_t* out = base + size_t{y} * dst.width * (chw ? 1 : dst.channels);
+      fn(src.Row(0, y), out, plane, dst.width, dst.channels, chw, lut);
+    }
+  });
+  if (dst.view->Mode() == CacheMode::kCached) {
+    return dst.view->Flush(dst.offset, bytes);
+  }
+  return Result<void>::Ok();
+}
+
+const char* PreprocessKernelName() { return GetKernels().name; }
+
+}  // namespace axsys
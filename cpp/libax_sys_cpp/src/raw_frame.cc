@@ -0,0 +1,143 @@
+#include "axsys/raw_frame.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <string>
+#include <utility>
+
+namespace axsys {
+
+PoolGauge::PoolGauge(uint32_t capacity)
+    : capacity_(capacity),
+      held_(0),
+      peak_(0),
+      acquired_(0),
+      released_(0),
+      exhausted_(0) {}
+
+void PoolGauge::OnAcquire() {
+  const uint32_t held = held_.fetch_add(1, std::memory_order_relaxed) + 1;
+  acquired_.fetch_add(1, std::memory_order_relaxed);
+  uint32_t peak = peak_.load(std::memory_order_relaxed);
+  while (held > peak && !peak_.compare_exchange_weak(
+                            peak, held, std::memory_order_relaxed)) {
+  }
+  if (capacity_ != 0 && held >= capacity_) {
+    exhausted_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void PoolGauge::OnRelease() {
+  held_.fetch_sub(1, std::memory_order_relaxed);
+  released_.fetch_add(1, std::memory_order_relaxed);
+}
+
+PoolGauge::Snapshot PoolGauge::Read() const {
+  Snapshot s;
+  s.capacity = capacity_;
+  s.held = held_.load(std::memory_order_relaxed);
+  s.peak = peak_.load(std::memory_order_relaxed);
+  s.acquired = acquired_.load(std::memory_order_relaxed);
+  s.released = released_.load(std::memory_order_relaxed);
+  s.exhausted = exhausted_.load(std::memory_order_relaxed);
+  return s;
+}
+
+// Declaration order matters: views are unmapped before the attached
+// buffers go away.
+struct RawFrame::Impl {
+  Info info;
+  Releaser release;
+  PoolGauge* gauge;
+  CacheMode mode;
+  CmmBuffer bufs[kMaxPlanes];
+  CmmView views[kMaxPlanes];
+
+  Impl(const Info& i, Releaser r, PoolGauge* g, CacheMode m)
+      : info(i), release(std::move(r)), gauge(g), mode(m) {}
+};
+
+RawFrame::RawFrame() : impl_(nullptr) {}
+
+RawFrame::RawFrame(const Info& info, Releaser release, PoolGauge* gauge,
+                   CacheMode mode)
+    : impl_(new Impl(info, std::move(release), gauge, mode)) {
+  if (impl_->info.plane_count > kMaxPlanes) {
+    impl_->info.plane_count = kMaxPlanes;
+  }
+  if (gauge) gauge->OnAcquire();
+}
+
+RawFrame::RawFrame(RawFrame&& other) noexcept : impl_(other.impl_) {
+  other.impl_ = nullptr;
+}
+
+RawFrame& RawFrame::operator=(RawFrame&& other) noexcept {
+  if (this != &other) {
+    Release();
+    impl_ = other.impl_;
+    other.impl_ = nullptr;
+  }
+  return *this;
+}
+
+RawFrame::~RawFrame() { Release(); }
+
+RawFrame::operator bool() const { return impl_ != nullptr; }
+
+const RawFrame::Info& RawFrame::GetInfo() const { return impl_->info; }
+
+Result<CmmView*> RawFrame::Plane(uint32_t index) {
+  if (!impl_) {
+    return Result<CmmView*>::Error(ErrorCode::kNoAllocation, [] {
+      return std::string("RawFrame::Plane on a released frame");
+    });
+  }
+  if (index >= impl_->info.plane_count) {
+    const uint32_t count = impl_->info.plane_count;
+    return Result<CmmView*>::Error(ErrorCode::kOutOfRange, [index, count] {
+      char buf[96];
+      snprintf(buf, sizeof(buf), "RawFrame plane %u out of range (%u planes)",
+               index, count);
+      return std::string(buf);
+    });
+  }
+  CmmView& view = impl_->views[index];
+  if (view) return Result<CmmView*>::Ok(&view);
+
+  const PlaneInfo& p = impl_->info.planes[index];
+  CmmBuffer& buf = impl_->bufs[index];
+  auto ar = buf.AttachExternal(p.phys, p.size);
+  if (!ar) {
+    std::string msg = ar.Message();
+    return Result<CmmView*>::Error(ar.Code(), [msg] { return msg; });
+  }
+  auto vr = buf.MapView(0, p.size, impl_->mode);
+  if (!vr) {
+    (void)buf.DetachExternal();
+    const uint64_t phys = p.phys;
+    const uint32_t size = p.size;
+    return Result<CmmView*>::Error(vr.Code(), [phys, size] {
+      char msg[128];
+      snprintf(msg, sizeof(msg),
+               "RawFrame plane map failed (phy=0x%" PRIx64 " size=0x%x)", phys,
+               size);
+      return std::string(msg);
+    });
+  }
+  view = vr.MoveValue();
+  return Result<CmmView*>::Ok(&view);
+}
+
+void RawFrame::Release() {
+  Impl* impl = impl_;
+  if (!impl) return;
+  impl_ = nullptr;
+  for (uint32_t i = 0; i < kMaxPlanes; ++i) impl->views[i].Reset();
+  if (impl->release) impl->release();
+  if (impl->gauge) impl->gauge->OnRelease();
+  delete impl;
+}
+
+}  // namespace axsys
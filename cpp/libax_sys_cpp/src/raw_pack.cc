@@ -0,0 +1,327 @@
+#include "axsys/raw_pack.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AXSYS_RAW10_NEON 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define AXSYS_RAW10_SSSE3 1
+#endif
+
+namespace axsys {
+
+namespace {
+
+using UnpackRowFn = void (*)(const uint8_t* src, uint16_t* dst,
+                             uint32_t width);
+using PackRowFn = void (*)(const uint16_t* src, uint8_t* dst, uint32_t width);
+
+// The SIMD loops below handle eight pixels (ten packed bytes) per step but
+// load/store sixteen bytes, so they stop while at least sixteen bytes of the
+// packed row remain: x * 10 / 8 + 16 <= width * 10 / 8.
+constexpr uint32_t kSimdSlack = 13;
+
+// Scalar code finishes a row starting at pixel x (a multiple of four).
+void UnpackRowTail(const uint8_t* s, uint16_t* d, uint32_t x,
+                   uint32_t width) {
+  for (; x + 4 <= width; x += 4) {
+    const uint8_t* g = s + x / 4 * 5;
+    d[x] = static_cast<uint16_t>(g[0] | (g[1] & 0x03) << 8);
+    d[x + 1] = static_cast<uint16_t>(g[1] >> 2 | (g[2] & 0x0f) << 6);
+    d[x + 2] = static_cast<uint16_t>(g[2] >> 4 | (g[3] & 0x3f) << 4);
+    d[x + 3] = static_cast<uint16_t>(g[3] >> 6 | g[4] << 2);
+  }
+  for (; x < width; ++x) {
+    const size_t bit = static_cast<size_t>(x) * 10;
+    const size_t byte = bit / 8;
+    const unsigned v = static_cast<unsigned>(s[byte] | s[byte + 1] << 8);
+    d[x] = static_cast<uint16_t>((v >> (bit % 8)) & 0x3ff);
+  }
+}
+
+void PackRowTail(const uint16_t* s, uint8_t* d, uint32_t x, uint32_t width) {
+  for (; x + 4 <= width; x += 4) {
+    uint8_t* g = d + x / 4 * 5;
+    const unsigned p0 = s[x] & 0x3ffu;
+    const unsigned p1 = s[x + 1] & 0x3ffu;
+    const unsigned p2 = s[x + 2] & 0x3ffu;
+    const unsigned p3 = s[x + 3] & 0x3ffu;
+    g[0] = static_cast<uint8_t>(p0);
+    g[1] = static_cast<uint8_t>(p0 >> 8 | p1 << 2);
+    g[2] = static_cast<uint8_t>(p1 >> 6 | p2 << 4);
+    g[3] = static_cast<uint8_t>(p2 >> 4 | p3 << 6);
+    g[4] = static_cast<uint8_t>(p3 >> 2);
+  }
+  if (x == width) return;
+  // Partial group: clear it, then OR each pixel into its two bytes.
+  const size_t begin = x / 4 * 5;
+  memset(d + begin, 0, Raw10RowBytes(width) - begin);
+  for (; x < width; ++x) {
+    const size_t bit = static_cast<size_t>(x) * 10;
+    const size_t byte = bit / 8;
+    const unsigned v = (s[x] & 0x3ffu) << (bit % 8);
+    d[byte] = static_cast<uint8_t>(d[byte] | v);
+    d[byte + 1] = static_cast<uint8_t>(d[byte + 1] | v >> 8);
+  }
+}
+
+void UnpackRowScalar(const uint8_t* s, uint16_t* d, uint32_t width) {
+  UnpackRowTail(s, d, 0, width);
+}
+
+void PackRowScalar(const uint16_t* s, uint8_t* d, uint32_t width) {
+  PackRowTail(s, d, 0, width);
+}
+
+// Both SIMD paths use the same byte tables. Unpack gathers, for each of
+// eight pixels, the two packed bytes holding it into a 16-bit lane; the
+// pixel then sits at bit 0, 2, 4 or 6 of that lane. Pack does the reverse:
+// shift each sample up by 0/2/4/6 and merge low/high lane bytes.
+alignas(16) const uint8_t kUnpackIdx[16] = {0, 1, 1, 2, 2, 3, 3, 4,
+                                            5, 6, 6, 7, 7, 8, 8, 9};
+alignas(16) const uint8_t kPackLo[16] = {0,    1,    3,    5,    7,    8,
+                                         9,    11,   13,   15,   0x80, 0x80,
+                                         0x80, 0x80, 0x80, 0x80};
+alignas(16) const uint8_t kPackHi[16] = {0x80, 2,    4,    6,    0x80, 0x80,
+                                         10,   12,   14,   0x80, 0x80, 0x80,
+                                         0x80, 0x80, 0x80, 0x80};
+
+#if defined(AXSYS_RAW10_NEON)
+
+void UnpackRowNeon(const uint8_t* s, uint16_t* d, uint32_t width) {
+  static const int16_t kShift[8] = {0, -2, -4, -6, 0, -2, -4, -6};
+  const uint8x16_t idx = vld1q_u8(kUnpackIdx);
+  const int16x8_t shift = vld1q_s16(kShift);
+  const uint16x8_t mask = vdupq_n_u16(0x3ff);
+  uint32_t x = 0;
+  for (; x + kSimdSlack <= width; x += 8) {
+    const uint8x16_t in = vld1q_u8(s + x / 4 * 5);
+    uint16x8_t v = vreinterpretq_u16_u8(vqtbl1q_u8(in, idx));
+    v = vandq_u16(vshlq_u16(v, shift), mask);
+    vst1q_u16(d + x, v);
+  }
+  UnpackRowTail(s, d, x, width);
+}
+
+void PackRowNeon(const uint16_t* s, uint8_t* d, uint32_t width) {
+  static const int16_t kShift[8] = {0, 2, 4, 6, 0, 2, 4, 6};
+  const int16x8_t shift = vld1q_s16(kShift);
+  const uint16x8_t mask = vdupq_n_u16(0x3ff);
+  // vqtbl1q_u8 yields zero for out-of-range indices such as 0x80.
+  const uint8x16_t lo = vld1q_u8(kPackLo);
+  const uint8x16_t hi = vld1q_u8(kPackHi);
+  uint32_t x = 0;
+  for (; x + kSimdSlack <= width; x += 8) {
+    const uint16x8_t v = vshlq_u16(vandq_u16(vld1q_u16(s + x), mask), shift);
+    const uint8x16_t b = vreinterpretq_u8_u16(v);
+    vst1q_u8(d + x / 4 * 5, vorrq_u8(vqtbl1q_u8(b, lo), vqtbl1q_u8(b, hi)));
+  }
+  PackRowTail(s, d, x, width);
+}
+
+#elif defined(AXSYS_RAW10_SSSE3)
+
+// SSE has no per-lane variable 16-bit shift; multiplying by 64/16/4/1 moves
+// each pixel to bits 6-15 (dropping the neighbour's bits off the top), and a
+// uniform shift right by 6 brings it down.
+__attribute__((target("ssse3"))) void UnpackRowSsse3(const uint8_t* s,
+                                                     uint16_t* d,
+                                                     uint32_t width) {
+  const __m128i idx =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kUnpackIdx));
+  const __m128i mul = _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1);
+  uint32_t x = 0;
+  for (; x + kSimdSlack <= width; x += 8) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x / 4 * 5));
+    __m128i v = _mm_shuffle_epi8(in, idx);
+    v = _mm_srli_epi16(_mm_mullo_epi16(v, mul), 6);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x), v);
+  }
+  UnpackRowTail(s, d, x, width);
+}
+
+__attribute__((target("ssse3"))) void PackRowSsse3(const uint16_t* s,
+                                                   uint8_t* d,
+                                                   uint32_t width) {
+  const __m128i mask = _mm_set1_epi16(0x3ff);
+  const __m128i mul = _mm_setr_epi16(1, 4, 16, 64, 1, 4, 16, 64);
+  const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(kPackLo));
+  const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(kPackHi));
+  uint32_t x = 0;
+  for (; x + kSimdSlack <= width; x += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + x));
+    v = _mm_mullo_epi16(_mm_and_si128(v, mask), mul);
+    const __m128i out =
+        _mm_or_si128(_mm_shuffle_epi8(v, lo), _mm_shuffle_epi8(v, hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x / 4 * 5), out);
+  }
+  PackRowTail(s, d, x, width);
+}
+
+#endif
+
+struct Kernels {
+  UnpackRowFn unpack;
+  PackRowFn pack;
+  const char* name;
+};
+
+Kernels SelectKernels() {
+#if defined(AXSYS_RAW10_NEON)
+  return Kernels{UnpackRowNeon, PackRowNeon, "neon"};
+#elif defined(AXSYS_RAW10_SSSE3)
+  if (__builtin_cpu_supports("ssse3")) {
+    return Kernels{UnpackRowSsse3, PackRowSsse3, "ssse3"};
+  }
+  return Kernels{UnpackRowScalar, PackRowScalar, "scalar"};
+#else
+  return Kernels{UnpackRowScalar, PackRowScalar, "scalar"};
+#endif
+}
+
+const Kernels& GetKernels() {
+  static const Kernels kernels = SelectKernels();
+  return kernels;
+}
+
+// Run fn(row_begin, row_end) over [0, rows) on up to `threads` threads; the
+// calling thread takes the first slice.
+template <typename Fn>
+void ForEachRowSlice(uint32_t rows, unsigned threads, Fn fn) {
+  if (threads > rows) threads = rows;
+  if (threads <= 1) {
+    fn(0u, rows);
+    return;
+  }
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (unsigned t = 1; t < threads; ++t) {
+    const uint32_t begin = static_cast<uint32_t>(
+        static_cast<uint64_t>(rows) * t / threads);
+    const uint32_t end = static_cast<uint32_t>(
+        static_cast<uint64_t>(rows) * (t + 1) / threads);
+    workers.emplace_back([fn, begin, end] { fn(begin, end); });
+  }
+  fn(0u, rows / threads);
+  for (auto& w : workers) w.join();
+}
+
+// Bytes of a view touched by `rows` rows of `row_bytes` at `stride`.
+size_t SpanBytes(uint32_t rows, size_t stride, size_t row_bytes) {
+  return (static_cast<size_t>(rows) - 1) * stride + row_bytes;
+}
+
+Result<void> CheckGeometry(const char* fn, const CmmView* packed,
+                           const CmmView* unpacked, const RawGeometry& g) {
+  const size_t packed_row = Raw10RowBytes(g.width);
+  const size_t unpacked_row = static_cast<size_t>(g.width) * 2;
+  const char* what = nullptr;
+  if (!packed || !unpacked || !*packed || !*unpacked) {
+    what = "views must be mapped";
+  } else if (g.width == 0 || g.height == 0) {
+    what = "width and height must be non-zero";
+  } else if (g.packed_stride < packed_row) {
+    what = "packed_stride is shorter than a row";
+  } else if (g.unpacked_stride < unpacked_row || g.unpacked_stride % 2 != 0) {
+    what = "unpacked_stride must be even and hold a row";
+  } else if (SpanBytes(g.height, g.packed_stride, packed_row) >
+             packed->Size()) {
+    what = "packed view is smaller than the frame";
+  } else if (SpanBytes(g.height, g.unpacked_stride, unpacked_row) >
+             unpacked->Size()) {
+    what = "unpacked view is smaller than the frame";
+  }
+  if (!what) return Result<void>::Ok();
+  const RawGeometry geo = g;
+  return Result<void>::Error(ErrorCode::kInvalidArgument, [fn, what, geo] {
+    char buf[192];
+    snprintf(buf, sizeof(buf),
+             "%s: %s (width=%u height=%u packed_stride=%zu "
+             "unpacked_stride=%zu)",
+             fn, what, geo.width, geo.height, geo.packed_stride,
+             geo.unpacked_stride);
+    return std::string(buf);
+  });
+}
+
+}  // namespace
+
+void UnpackRaw10Rows(const uint8_t* src, size_t src_stride, uint16_t* dst,
+                     size_t dst_stride, uint32_t width, uint32_t rows) {
+  const UnpackRowFn fn = GetKernels().unpack;
+  uint8_t* d = reinterpret_cast<uint8_t*>(dst);
+  for (uint32_t y = 0; y < rows; ++y) {
+    fn(src + y * src_stride, reinterpret_cast<uint16_t*>(d + y * dst_stride),
+       width);
+  }
+}
+
+void PackRaw10Rows(const uint16_t* src, size_t src_stride, uint8_t* dst,
+                   size_t dst_stride, uint32_t width, uint32_t rows) {
+  const PackRowFn fn = GetKernels().pack;
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(src);
+  for (uint32_t y = 0; y < rows; ++y) {
+    fn(reinterpret_cast<const uint16_t*>(s + y * src_stride),
+       dst + y * dst_stride, width);
+  }
+}
+
+Result<void> UnpackRaw10(CmmView* src, CmmView* dst, const RawGeometry& g,
+                         unsigned threads) {
+  auto cr = CheckGeometry("UnpackRaw10", src, dst, g);
+  if (!cr) return cr;
+  const size_t src_span = SpanBytes(g.height, g.packed_stride,
+                                    Raw10RowBytes(g.width));
+  if (src->Mode() == CacheMode::kCached) {
+    auto ir = src->Invalidate(0, src_span);
+    if (!ir) return ir;
+  }
+  const uint8_t* s = static_cast<const uint8_t*>(src->Data());
+  uint8_t* d = static_cast<uint8_t*>(dst->Data());
+  ForEachRowSlice(g.height, threads, [s, d, &g](uint32_t y0, uint32_t y1) {
+    UnpackRaw10Rows(s + y0 * g.packed_stride, g.packed_stride,
+                    reinterpret_cast<uint16_t*>(d + y0 * g.unpacked_stride),
+                    g.unpacked_stride, g.width, y1 - y0);
+  });
+  if (dst->Mode() == CacheMode::kCached) {
+    return dst->Flush(0, SpanBytes(g.height, g.unpacked_stride,
+                                   static_cast<size_t>(g.width) * 2));
+  }
+  return Result<void>::Ok();
+}
+
+Result<void> PackRaw10(CmmView* src, CmmView* dst, const RawGeometry& g,
+                       unsigned threads) {
+  auto cr = CheckGeometry("PackRaw10", dst, src, g);
+  if (!cr) return cr;
+  if (src->Mode() == CacheMode::kCached) {
+    auto ir = src->Invalidate(0, SpanBytes(g.height, g.unpacked_stride,
+                                           static_cast<size_t>(g.width) * 2));
+    if (!ir) return ir;
+  }
+  const uint8_t* s = static_cast<const uint8_t*>(src->Data());
+  uint8_t* d = static_cast<uint8_t*>(dst->Data());
+  ForEachRowSlice(g.height, threads, [s, d, &g](uint32_t y0, uint32_t y1) {
+    PackRaw10Rows(
+        reinterpret_cast<const uint16_t*>(s + y0 * g.unpacked_stride),
+        g.unpacked_stride, d + y0 * g.packed_stride, g.packed_stride, g.width,
+        y1 - y0);
+  });
+  if (dst->Mode() == CacheMode::kCached) {
+    return dst->Flush(0, SpanBytes(g.height, g.packed_stride,
+                                   Raw10RowBytes(g.width)));
+  }
+  return Result<void>::Ok();
+}
+
+const char* Raw10KernelName() { return GetKernels().name; }
+
+}  // namespace axsys
@@ -0,0 +1,286 @@
+#include "axsys/replay_frame_source.hpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace axsys {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * Fixed set of CMM blocks shared with the frames handed out. Frames keep
+ * the pool alive through their releaser, so Close() never frees a block
+ * that is still held.
+ */
+struct BlockPool {
+  struct Block {
+    CmmBuffer buffer;
+    CmmView view;  // destroyed before buffer
+  };
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::vector<Block> blocks;
+  std::vector<uint32_t> free_list;
+};
+
+/** Waits until a block is free or @p deadline passes. */
+bool TakeBlock(BlockPool* pool, bool bounded, Clock::time_point deadline,
+               uint32_t* out) {
+  std::unique_lock<std::mutex> lk(pool->mtx);
+  auto ready = [pool] { return !pool->free_list.empty(); };
+  if (bounded) {
+    if (!pool->cv.wait_until(lk, deadline, ready)) return false;
+  } else {
+    pool->cv.wait(lk, ready);
+  }
+  *out = pool->free_list.back();
+  pool->free_list.pop_back();
+  return true;
+}
+
+void GiveBlock(BlockPool* pool, uint32_t index) {
+  {
+    std::lock_guard<std::mutex> lk(pool->mtx);
+    pool->free_list.push_back(index);
+  }
+  pool->cv.notify_one();
+}
+
+}  // namespace
+
+struct ReplayFrameSource::Impl {
+  CaptureReader reader;
+  Options options;
+  PoolGauge* gauge = nullptr;
+  std::shared_ptr<BlockPool> pool;
+  bool open = false;
+
+  // Pacing: frame k (counted across passes) is due at start + k * period.
+  std::chrono::nanoseconds period{0};
+  bool started = false;
+  Clock::time_point start;
+  uint64_t next = 0;
+
+  // Added per completed pass so looped seq/PTS keep increasing.
+  uint64_t seq_span = 0;
+  uint64_t pts_span = 0;
+
+  std::atomic<uint64_t> delivered{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> passes{0};
+};
+
+ReplayFrameSource::ReplayFrameSource() : impl_(new Impl()) {}
+
+ReplayFrameSource::~ReplayFrameSource() {
+  Close();
+  delete impl_;
+}
+
+Result<void> ReplayFrameSource::Open(const char* path, const Options& options,
+                                     PoolGauge* gauge) {
+  if (impl_->open) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("ReplayFrameSource already open");
+    });
+  }
+  if (options.depth == 0) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("ReplayFrameSource depth must be > 0");
+    });
+  }
+  auto r = impl_->reader.Open(path);
+  if (!r) return r;
+
+  const size_t count = impl_->reader.FrameCount();
+  uint64_t max_size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    auto f = impl_->reader.GetFrame(i);
+    if (f && f->size > max_size) max_size = f->size;
+  }
+  if (count == 0 || max_size == 0) {
+    impl_->reader.Close();
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [path] {
+      return std::string("No frames to replay in ") + path;
+    });
+  }
+  if (max_size > UINT32_MAX) {
+    impl_->reader.Close();
+    return Result<void>::Error(ErrorCode::kMemoryTooLarge, [max_size] {
+      char buf[80];
+      snprintf(buf, sizeof(buf), "Replay frame too large: %" PRIu64 " bytes",
+               max_size);
+      return std::string(buf);
+    });
+  }
+
+  // Blocks are written through a cached mapping and flushed, so the copy
+  // runs at cached speed and any later mapping sees the data.
+  auto pool = std::make_shared<BlockPool>();
+  pool->blocks.resize(options.depth);
+  for (uint32_t i = 0; i < options.depth; ++i) {
+    BlockPool::Block& b = pool->blocks[i];
+    auto v = b.buffer.Allocate(max_size, CacheMode::kCached, "replay");
+    if (!v) {
+      impl_->reader.Close();
+      std::string msg = v.Message();
+      return Result<void>::Error(v.Code(), [msg] { return msg; });
+    }
+    b.view = v.MoveValue();
+    pool->free_list.push_back(options.depth - 1 - i);
+  }
+
+  uint32_t fps = options.fps_x1000;
+  if (fps == kRecordedRate) fps = impl_->reader.Info().fps_x1000;
+  impl_->period = std::chrono::nanoseconds(
+      fps == 0 ? 0 : 1000000000000LL / static_cast<int64_t>(fps));
+
+  const CaptureReader::Frame first = impl_->reader.GetFrame(0).Value();
+  const CaptureReader::Frame last = impl_->reader.GetFrame(count - 1).Value();
+  impl_->seq_span = last.seq - first.seq + 1;
+  impl_->pts_span = last.pts - first.pts;
+  if (count > 1) impl_->pts_span += impl_->pts_span / (count - 1);
+
+  impl_->options = options;
+  impl_->gauge = gauge;
+  impl_->pool = std::move(pool);
+  impl_->started = false;
+  impl_->next = 0;
+  impl_->delivered.store(0, std::memory_order_relaxed);
+  impl_->dropped.store(0, std::memory_order_relaxed);
+  impl_->passes.store(0, std::memory_order_relaxed);
+  impl_->open = true;
+  return Result<void>();
+}
+
+void ReplayFrameSource::Close() {
+  if (!impl_->open) return;
+  impl_->open = false;
+  impl_->pool.reset();
+  impl_->reader.Close();
+}
+
+const CaptureStreamInfo& ReplayFrameSource::StreamInfo() const {
+  return impl_->reader.Info();
+}
+
+size_t ReplayFrameSource::FrameCount() const {
+  return impl_->reader.FrameCount();
+}
+
+ReplayFrameSource::Stats ReplayFrameSource::GetStats() const {
+  Stats s;
+  s.delivered = impl_->delivered.load(std::memory_order_relaxed);
+  s.dropped = impl_->dropped.load(std::memory_order_relaxed);
+  s.passes = impl_->passes.load(std::memory_order_relaxed);
+  return s;
+}
+
+Result<RawFrame> ReplayFrameSource::Next(int32_t timeout_ms) {
+  Impl* d = impl_;
+  if (!d->open) {
+    return Result<RawFrame>::Error(ErrorCode::kNotInitialized, [] {
+      return std::string("ReplayFrameSource not open");
+    });
+  }
+  const uint64_t count = d->reader.FrameCount();
+  const uint64_t end = d->options.loop ? UINT64_MAX : count;
+  if (d->next >= end) {
+    return Result<RawFrame>::Error(ErrorCode::kClosed, [] {
+      return std::string("End of replay");
+    });
+  }
+
+  const Clock::time_point now = Clock::now();
+  const bool bounded = timeout_ms >= 0;
+  const Clock::time_point deadline =
+      now + std::chrono::milliseconds(bounded ? timeout_ms : 0);
+  auto timed_out = [] {
+    return Result<RawFrame>::Error(ErrorCode::kTimeout, [] {
+      return std::string("No replay frame ready");
+    });
+  };
+
+  const bool paced = d->period.count() > 0;
+  if (paced) {
+    if (!d->started) {
+      d->start = now;
+      d->started = true;
+    }
+    const Clock::time_point due =
+        d->start + d->period * static_cast<int64_t>(d->next);
+    if (due > now) {
+      if (bounded && deadline < due) {
+        std::this_thread::sleep_until(deadline);
+        return timed_out();
+      }
+      std::this_thread::sleep_until(due);
+    }
+  }
+
+  uint32_t block = 0;
+  if (!TakeBlock(d->pool.get(), bounded, deadline, &block)) {
+    return timed_out();
+  }
+
+  if (paced && d->options.drop_late) {
+    // Jump to the newest frame that is due, as a sensor would have
+    // overwritten the ones nobody picked up.
+    const auto late = Clock::now() - d->start;
+    uint64_t newest = static_cast<uint64_t>(late / d->period);
+    if (newest >= end) newest = end - 1;
+    if (newest > d->next) {
+      d->dropped.fetch_add(newest - d->next, std::memory_order_relaxed);
+      d->next = newest;
+    }
+  }
+
+  const uint64_t k = d->next++;
+  const uint64_t pass = k / count;
+  const CaptureReader::Frame f =
+      d->reader.GetFrame(k % count).Value();
+  d->passes.store(d->next / count, std::memory_order_relaxed);
+
+  BlockPool::Block& b = d->pool->blocks[block];
+  memcpy(b.view.Data(), f.data, f.size);
+  auto fl = b.view.Flush(0, f.size);
+  if (!fl) {
+    GiveBlock(d->pool.get(), block);
+    std::string msg = fl.Message();
+    return Result<RawFrame>::Error(fl.Code(), [msg] { return msg; });
+  }
+
+  const CaptureStreamInfo& si = d->reader.Info();
+  RawFrame::Info info{};
+  info.width = si.width;
+  info.height = si.height;
+  info.format = si.format;
+  info.pts = f.pts + pass * d->pts_span;
+  info.seq = f.seq + pass * d->seq_span;
+  info.plane_count = 1;
+  info.planes[0].phys = b.buffer.Phys();
+  info.planes[0].stride = si.stride;
+  info.planes[0].size = static_cast<uint32_t>(f.size);
+
+  std::shared_ptr<BlockPool> pool = d->pool;
+  auto release = [pool, block] { GiveBlock(pool.get(), block); };
+  d->delivered.fetch_add(1, std::memory_order_relaxed);
+  return Result<RawFrame>::Ok(
+      RawFrame(info, release, d->gauge, d->options.mode));
+}
+
+}  // namespace axsys
@@ -3,9 +3,12 @@
 #include <ax_sys_api.h>
 #include <stdio.h>
 
+#include "axsys/trace.hpp"
+
 namespace axsys {
 
-System::System() : ok_(AX_SYS_Init() == 0) {
+System::System()
+    : ok_(AXSYS_TRACED(kSysInit, 0, AX_SYS_Init()) == 0) {
   if (!ok_) {
     printf("AX_SYS_Init failed\n");
   }
@@ -13,7 +16,7 @@ System::System() : ok_(AX_SYS_Init() == 0) {
 
 System::~System() {
   if (ok_.load()) {
-    AX_SYS_Deinit();
+    AXSYS_TRACED(kSysDeinit, 0, AX_SYS_Deinit());
   }
 }
 
@@ -24,7 +27,7 @@ System::System(System&& other) noexcept : ok_(other.ok_.load()) {
 System& System::operator=(System&& other) noexcept {
   if (this != &other) {
     if (ok_.load()) {
-      AX_SYS_Deinit();
+      AXSYS_TRACED(kSysDeinit, 0, AX_SYS_Deinit());
     }
     ok_.store(other.ok_.load());
     other.ok_.store(false);
@@ -0,0 +1,245 @@
+#include "axsys/tensor_arena.hpp"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace axsys {
+
+namespace {
+
+constexpr uint64_t kMaxAlignment = 4096;  // CMM blocks are page aligned
+
+uint64_t Alignment(const TensorSpec& t) {
+  return t.alignment == 0 ? 1 : t.alignment;
+}
+
+uint64_t AlignUp(uint64_t v, uint64_t a) { return (v + a - 1) & ~(a - 1); }
+
+bool LifetimesOverlap(const TensorSpec& a, const TensorSpec& b) {
+  return a.first_use <= b.last_use && b.first_use <= a.last_use;
+}
+
+struct Placed {
+  uint64_t offset;
+  uint64_t end;
+  size_t index;
+};
+
+/**
+ * Smallest gap between the placed tensors in @p live (sorted by offset)
+ * that holds @p t, else the first aligned offset past all of them.
+ */
+uint64_t FindOffset(const std::vector<Placed>& live, const TensorSpec& t) {
+  const uint64_t align = Alignment(t);
+  uint64_t prev_end = 0;
+  uint64_t best = UINT64_MAX;
+  uint64_t best_gap = UINT64_MAX;
+  for (const Placed& p : live) {
+    const uint64_t cand = AlignUp(prev_end, align);
+    if (cand + t.size <= p.offset && p.offset - prev_end < best_gap) {
+      best_gap = p.offset - prev_end;
+      best = cand;
+    }
+    prev_end = std::max(prev_end, p.end);
+  }
+  return best != UINT64_MAX ? best : AlignUp(prev_end, align);
+}
+
+uint64_t LowerBound(const std::vector<TensorSpec>& tensors) {
+  // (step, delta): frees at step s sort before allocations at step s.
+  std::vector<std::pair<uint64_t, int64_t>> events;
+  events.reserve(tensors.size() * 2);
+  for (const TensorSpec& t : tensors) {
+    events.emplace_back(t.first_use, static_cast<int64_t>(t.size));
+    events.emplace_back(uint64_t{t.last_use} + 1,
+                        -static_cast<int64_t>(t.size));
+  }
+  std::sort(events.begin(), events.end());
+  int64_t live = 0;
+  int64_t peak = 0;
+  for (const auto& e : events) {
+    live += e.second;
+    peak = std::max(peak, live);
+  }
+  return static_cast<uint64_t>(peak);
+}
+
+}  // namespace
+
+Result<ArenaPlan> PlanTensorArena(const std::vector<TensorSpec>& tensors,
+                                  ArenaStrategy strategy) {
+  for (const TensorSpec& t : tensors) {
+    const uint64_t a = Alignment(t);
+    if (t.size == 0 || t.last_use < t.first_use || (a & (a - 1)) != 0 ||
+        a > kMaxAlignment) {
+      std::string name = t.name;
+      return Result<ArenaPlan>::Error(ErrorCode::kInvalidArgument, [name] {
+        return "Bad size, lifetime or alignment for tensor " + name;
+      });
+    }
+  }
+
+  std::vector<size_t> order(tensors.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  auto by_size = [&tensors](size_t a, size_t b) {
+    const TensorSpec& x = tensors[a];
+    const TensorSpec& y = tensors[b];
+    if (x.size != y.size) return x.size > y.size;
+    if (x.first_use != y.first_use) return x.first_use < y.first_use;
+    return a < b;
+  };
+  auto by_first_use = [&tensors](size_t a, size_t b) {
+    const TensorSpec& x = tensors[a];
+    const TensorSpec& y = tensors[b];
+    if (x.first_use != y.first_use) return x.first_use < y.first_use;
+    if (x.size != y.size) return x.size > y.size;
+    return a < b;
+  };
+  if (strategy == ArenaStrategy::kGreedyBySize) {
+    std::sort(order.begin(), order.end(), by_size);
+  } else {
+    std::sort(order.begin(), order.end(), by_first_use);
+  }
+
+  ArenaPlan plan;
+  plan.offsets.assign(tensors.size(), 0);
+  plan.arena_size = 0;
+  plan.naive_size = 0;
+  plan.lower_bound = LowerBound(tensors);
+  std::vector<Placed> placed;  // sorted by offset
+  std::vector<Placed> live;
+  placed.reserve(tensors.size());
+  live.reserve(tensors.size());
+  for (size_t i : order) {
+    const TensorSpec& t = tensors[i];
+    live.clear();
+    for (const Placed& p : placed) {
+      if (LifetimesOverlap(t, tensors[p.index])) live.push_back(p);
+    }
+    const uint64_t offset = FindOffset(live, t);
+    plan.offsets[i] = offset;
+    plan.arena_size = std::max(plan.arena_size, offset + t.size);
+    plan.naive_size += t.size;
+    const Placed p{offset, offset + t.size, i};
+    placed.insert(std::upper_bound(placed.begin(), placed.end(), p,
+                                   [](const Placed& x, const Placed& y) {
+                                     return x.offset < y.offset;
+                                   }),
+                  p);
+  }
+  return Result<ArenaPlan>::Ok(std::move(plan));
+}
+
+bool CheckTensorArena(const std::vector<TensorSpec>& tensors,
+                      const ArenaPlan& plan) {
+  if (plan.offsets.size() != tensors.size()) return false;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    const uint64_t off = plan.offsets[i];
+    if (off % Alignment(tensors[i]) != 0) return false;
+    if (off + tensors[i].size > plan.arena_size) return false;
+    for (size_t j = i + 1; j < tensors.size(); ++j) {
+      if (!LifetimesOverlap(tensors[i], tensors[j])) continue;
+      const uint64_t o = plan.offsets[j];
+      if (off < o + tensors[j].size && o < off + tensors[i].size) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// TensorArena
+// ---------------------------------------------------------------------------
+
+struct TensorArena::Impl {
+  ArenaPlan plan{};
+  std::vector<uint64_t> sizes;
+  CmmBuffer buffer;
+  CmmView base;
+  uint8_t* data = nullptr;
+  uint64_t phys = 0;
+};
+
+TensorArena::TensorArena() : impl_(new Impl()) {}
+
+TensorArena::~TensorArena() {
+  (void)Free();
+  delete impl_;
+}
+
+Result<void> TensorArena::Allocate(const std::vector<TensorSpec>& tensors,
+                                   ArenaStrategy strategy, CacheMode mode,
+                                   const char* token) {
+  if (impl_->data) {
+    return Result<void>::Error(ErrorCode::kAlreadyInitialized, [] {
+      return std::string("TensorArena already allocated");
+    });
+  }
+  if (tensors.empty()) {
+    return Result<void>::Error(ErrorCode::kInvalidArgument, [] {
+      return std::string("TensorArena needs at least one tensor");
+    });
+  }
+  auto plan = PlanTensorArena(tensors, strategy);
+  if (!plan) {
+    std::string msg = plan.Message();
+    return Result<void>::Error(plan.Code(), [msg] { return msg; });
+  }
+  auto v = impl_->buffer.Allocate(plan.Value().arena_size, mode, token);
+  if (!v) {
+    std::string msg = v.Message();
+    return Result<void>::Error(v.Code(), [msg] { return msg; });
+  }
+  impl_->base = v.MoveValue();
+  impl_->data = static_cast<uint8_t*>(impl_->base.Data());
+  impl_->phys = impl_->buffer.Phys();
+  impl_->plan = plan.MoveValue();
+  impl_->sizes.clear();
+  for (const TensorSpec& t : tensors) impl_->sizes.push_back(t.size);
+  return Result<void>::Ok();
+}
+
+const ArenaPlan& TensorArena::Plan() const { return impl_->plan; }
+
+size_t TensorArena::Count() const { return impl_->sizes.size(); }
+
+void* TensorArena::Data(size_t i) const {
+  if (!impl_->data || i >= impl_->sizes.size()) return nullptr;
+  return impl_->data + impl_->plan.offsets[i];
+}
+
+uint64_t TensorArena::Phys(size_t i) const {
+  if (!impl_->data || i >= impl_->sizes.size()) return 0;
+  return impl_->phys + impl_->plan.offsets[i];
+}
+
+Result<CmmView> TensorArena::View(size_t i, CacheMode mode) const {
+  if (!impl_->data || i >= impl_->sizes.size()) {
+    return Result<CmmView>::Error(ErrorCode::kOutOfRange, [i] {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "No tensor %zu in the arena", i);
+      return std::string(buf);
+    });
+  }
+  return impl_->buffer.MapView(impl_->plan.offsets[i], impl_->sizes[i],
+                               mode);
+}
+
+Result<void> TensorArena::Free() {
+  if (!impl_->data) return Result<void>::Ok();
+  impl_->base.Reset();
+  auto f = impl_->buffer.Free();
+  if (!f) return f;
+  impl_->data = nullptr;
+  impl_->phys = 0;
+  impl_->sizes.clear();
+  impl_->plan = ArenaPlan{};
+  return Result<void>::Ok();
+}
+
+}  // namespace axsys
@@ -0,0 +1,301 @@
+#include "axsys/trace.hpp"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace axsys {
+namespace trace {
+
+namespace {
+
+const char* const kCallNames[] = {
+    "AX_SYS_Init",
+    "AX_SYS_Deinit",
+    "AX_SYS_MemAlloc",
+    "AX_SYS_MemAllocCached",
+    "AX_SYS_MemFree",
+    "AX_SYS_Mmap",
+    "AX_SYS_MmapCache",
+    "AX_SYS_MmapFast",
+    "AX_SYS_MmapCacheFast",
+    "AX_SYS_Munmap",
+    "AX_SYS_MflushCache",
+    "AX_SYS_MinvalidateCache",
+    "AX_SYS_MemGetBlockInfoByVirt",
+    "AX_SYS_MemGetBlockInfoByPhy",
+    "AX_SYS_MemGetPartitionInfo",
+    "AX_SYS_MemQueryStatus",
+    "AX_SYS_MemGetMaxFreeRegionInfo",
+    "AX_VIN_GetRawFrame",
+    "AX_VIN_ReleaseRawFrame",
+};
+static_assert(sizeof(kCallNames) / sizeof(kCallNames[0]) ==
+                  static_cast<size_t>(Call::kCount),
+              "kCallNames out of sync with Call");
+
+}  // namespace
+
+const char* CallName(Call call) {
+  const size_t i = static_cast<size_t>(call);
+  return i < static_cast<size_t>(Call::kCount) ? kCallNames[i] : "unknown";
+}
+
+#if AXSYS_TRACE
+
+namespace {
+
+static_assert((kRingEvents & (kRingEvents - 1)) == 0,
+              "kRingEvents must be a power of two");
+
+struct RawEvent {
+  uint64_t start;
+  uint64_t stop;
+  uint64_t bytes;
+  int32_t ret;
+  Call call;
+};
+
+/** Ring slot; seq is 1 + the index of the event it holds, 0 while written. */
+struct Slot {
+  std::atomic<uint64_t> seq{0};
+  RawEvent event;
+};
+
+/**
+ * Single-writer ring owned by one thread. The writer clears a slot's
+ * sequence number, fills the slot, stamps it and then advances head;
+ * readers copy a slot between two reads of its sequence number and drop
+ * it unless both name the event they expected.
+ */
+struct Ring {
+  Slot slots[kRingEvents];
+  std::atomic<uint64_t> head{0};
+  uint32_t tid = 0;
+};
+
+struct Registry {
+  std::mutex mtx;
+  std::vector<std::shared_ptr<Ring>> rings;
+  // Counter/clock pair taken when tracing was first enabled; a second
+  // pair on export gives the counter rate.
+  bool have_base = false;
+  uint64_t base_ticks = 0;
+  uint64_t base_ns = 0;
+};
+
+Registry& GetRegistry() {
+  static Registry* r = new Registry();  // outlives thread_local rings
+  return *r;
+}
+
+// The owning reference is kept apart from the raw pointer so the hot path
+// reads a trivially destructible thread_local (no TLS init wrapper call).
+// initial-exec avoids __tls_get_addr; the library is linked, not dlopen()ed.
+thread_local std::shared_ptr<Ring> t_ring_owner;
+__attribute__((tls_model("initial-exec"))) thread_local Ring* t_ring = nullptr;
+
+uint64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+Ring* AttachRing() {
+  t_ring_owner = std::make_shared<Ring>();
+  t_ring_owner->tid = static_cast<uint32_t>(syscall(SYS_gettid));
+  Registry& reg = GetRegistry();
+  std::lock_guard<std::mutex> lk(reg.mtx);
+  reg.rings.push_back(t_ring_owner);
+  t_ring = t_ring_owner.get();
+  return t_ring;
+}
+
+/** Nanoseconds per counter tick, measured against CLOCK_MONOTONIC. */
+double NsPerTick(Registry* reg) {
+#if defined(__aarch64__)
+  (void)reg;
+  uint64_t freq;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+  return 1e9 / static_cast<double>(freq);
+#elif defined(__x86_64__)
+  // Too short a span makes the ratio noisy; 10 ms gives < 0.01 %.
+  uint64_t ns = MonotonicNs();
+  if (ns - reg->base_ns < 10000000ULL) {
+    std::this_thread::sleep_for(
+        std::chrono::nanoseconds(10000000ULL - (ns - reg->base_ns)));
+    ns = MonotonicNs();
+  }
+  const uint64_t ticks = detail::Ticks();
+  return static_cast<double>(ns - reg->base_ns) /
+         static_cast<double>(ticks - reg->base_ticks);
+#else
+  (void)reg;
+  return 1.0;
+#endif
+}
+
+}  // namespace
+
+namespace detail {
+
+std::atomic<bool> g_enabled{false};
+
+void Record(Call call, uint64_t start, uint64_t stop, uint64_t bytes,
+            int32_t ret) {
+  Ring* ring = t_ring ? t_ring : AttachRing();
+  const uint64_t h = ring->head.load(std::memory_order_relaxed);
+  Slot& s = ring->slots[h & (kRingEvents - 1)];
+  s.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  s.event.start = start;
+  s.event.stop = stop;
+  s.event.bytes = bytes;
+  s.event.ret = ret;
+  s.event.call = call;
+  s.seq.store(h + 1, std::memory_order_release);
+  ring->head.store(h + 1, std::memory_order_release);
+}
+
+}  // namespace detail
+
+void SetEnabled(bool on) {
+  if (on) {
+    Registry& reg = GetRegistry();
+    std::lock_guard<std::mutex> lk(reg.mtx);
+    if (!reg.have_base) {
+      reg.base_ns = MonotonicNs();
+      reg.base_ticks = detail::Ticks();
+      reg.have_base = true;
+    }
+  }
+  detail::g_enabled.store(on, std::memory_order_relaxed);
+}
+
+bool IsEnabled() {
+  return detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+void Clear() {
+  Registry& reg = GetRegistry();
+  std::lock_guard<std::mutex> lk(reg.mtx);
+  // Live threads keep their ring (they hold a reference); dropping the
+  // registry's reference only forgets rings of exited threads.
+  std::vector<std::shared_ptr<Ring>> live;
+  for (auto& r : reg.rings) {
+    r->head.store(0, std::memory_order_relaxed);
+    if (r.use_count() > 1) live.push_back(r);
+  }
+  reg.rings.swap(live);
+}
+
+std::vector<Event> Snapshot() {
+  Registry& reg = GetRegistry();
+  std::lock_guard<std::mutex> lk(reg.mtx);
+  std::vector<Event> out;
+  if (!reg.have_base) return out;
+  const double ns_per_tick = NsPerTick(&reg);
+  auto to_ns = [&](uint64_t ticks) {
+    const double rel = static_cast<double>(ticks - reg.base_ticks);
+    return reg.base_ns + static_cast<uint64_t>(rel * ns_per_tick);
+  };
+
+  for (const auto& r : reg.rings) {
+    const uint64_t end = r->head.load(std::memory_order_acquire);
+    const uint64_t begin = end > kRingEvents ? end - kRingEvents : 0;
+    for (uint64_t i = begin; i < end; ++i) {
+      const Slot& slot = r->slots[i & (kRingEvents - 1)];
+      const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+      const RawEvent e = slot.event;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // Lapped, or being rewritten while we copied.
+      if (seq != i + 1 || slot.seq.load(std::memory_order_relaxed) != seq) {
+        continue;
+      }
+      if (e.start < reg.base_ticks || e.stop < e.start) continue;
+      Event ev;
+      ev.start_ns = to_ns(e.start);
+      ev.duration_ns = to_ns(e.stop) - ev.start_ns;
+      ev.bytes = e.bytes;
+      ev.ret = e.ret;
+      ev.tid = r->tid;
+      ev.call = e.call;
+      out.push_back(ev);
+    }
+  }
+  std::sort(out.begin(), out.end(), [](const Event& a, const Event& b) {
+    return a.start_ns < b.start_ns;
+  });
+  return out;
+}
+
+Result<void> ExportChromeJson(const char* path) {
+  const std::vector<Event> events = Snapshot();
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    const int err = errno;
+    std::string p(path);
+    return Result<void>::Error(ErrorCode::kSystemCallFailed, [p, err] {
+      return "fopen " + p + " failed: " + strerror(err);
+    });
+  }
+  const int pid = getpid();
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (size_t i = 0; i < events.size(); ++i) {
+    const Event& e = events[i];
+    // Trace Event Format timestamps are microseconds; keep ns precision.
+    fprintf(f,
+            "{\"name\":\"%s\",\"cat\":\"ax\",\"ph\":\"X\",\"ts\":%" PRIu64
+            ".%03u,\"dur\":%" PRIu64 ".%03u,\"pid\":%d,\"tid\":%" PRIu32
+            ",\"args\":{\"bytes\":%" PRIu64 ",\"ret\":%" PRId32 "}}%s\n",
+            CallName(e.call), e.start_ns / 1000,
+            static_cast<unsigned>(e.start_ns % 1000), e.duration_ns / 1000,
+            static_cast<unsigned>(e.duration_ns % 1000), pid, e.tid, e.bytes,
+            e.ret, i + 1 < events.size() ? "," : "");
+  }
+  fprintf(f, "]}\n");
+  if (fclose(f) != 0) {
+    const int err = errno;
+    std::string p(path);
+    return Result<void>::Error(ErrorCode::kSystemCallFailed, [p, err] {
+      return "write " + p + " failed: " + strerror(err);
+    });
+  }
+  return Result<void>();
+}
+
+#else  // !AXSYS_TRACE
+
+void SetEnabled(bool) {}
+bool IsEnabled() { return false; }
+void Clear() {}
+std::vector<Event> Snapshot() { return std::vector<Event>(); }
+
+Result<void> ExportChromeJson(const char* path) {
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    std::string p(path);
+    return Result<void>::Error(ErrorCode::kSystemCallFailed,
+                               [p] { return "fopen " + p + " failed"; });
+  }
+  fprintf(f, "{\"traceEvents\":[]}\n");
+  fclose(f);
+  return Result<void>();
+}
+
+#endif  // AXSYS_TRACE
+
+}  // namespace trace
+}  // namespace axsys
@@ -0,0 +1,340 @@
+#include "axsys/weight_cache.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "axsys/cmm_load.hpp"
+
+namespace axsys {
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr size_t kReadChunk = 1 << 20;
+
+uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t Round(uint64_t acc, uint64_t word) {
+  return Rotl(acc + word * kPrime2, 31) * kPrime1;
+}
+
+uint64_t Load64(const uint8_t* p) {
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+uint64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL +
+         static_cast<uint64_t>(ts.tv_nsec);
+}
+
+template <typename T>
+Result<T> FileError(const char* what, const char* path) {
+  const int err = errno;
+  std::string msg = std::string(what) + " " + path + ": " + strerror(err);
+  return Result<T>::Error(ErrorCode::kSystemCallFailed, [msg] { return msg; });
+}
+
+Result<std::string> EmptyFile(const char* path) {
+  std::string msg = std::string("Empty weight file: ") + path;
+  return Result<std::string>::Error(ErrorCode::kInvalidArgument,
+                                    [msg] { return msg; });
+}
+
+/**
+ * Hash the remaining @p size bytes of @p fd.
+ * @return false with errno set on a read error or a short file.
+ */
+bool ReadHashed(int fd, uint64_t size, WeightHasher* h) {
+  std::vector<uint8_t> chunk(kReadChunk);
+  uint64_t done = 0;
+  while (done < size) {
+    const size_t want =
+        static_cast<size_t>(std::min<uint64_t>(size - done, kReadChunk));
+    const ssize_t n = read(fd, chunk.data(), want);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (n == 0) {
+      errno = EIO;  // file shrank under us
+      return false;
+    }
+    h->Update(chunk.data(), static_cast<size_t>(n));
+    done += static_cast<uint64_t>(n);
+  }
+  return true;
+}
+
+struct Blob {
+  std::string key;
+  std::string path;
+  uint64_t size = 0;
+  uint64_t mtime_ns = 0;  // of path when it was loaded
+  uint64_t loaded_ns = 0;
+};
+
+uint64_t MtimeNs(const struct stat& st) {
+  return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL +
+         static_cast<uint64_t>(st.st_mtim.tv_nsec);
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// Hash
+// ---------------------------------------------------------------------------
+
+WeightHasher::WeightHasher()
+    : lane_{kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1},
+      tail_{},
+      tail_size_(0),
+      total_(0) {}
+
+void WeightHasher::Stripe(const uint8_t* p) {
+  for (int i = 0; i < 4; ++i) lane_[i] = Round(lane_[i], Load64(p + 8 * i));
+}
+
+void WeightHasher::Update(const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  total_ += size;
+  if (tail_size_ > 0) {
+    const size_t n = std::min(size, sizeof(tail_) - tail_size_);
+    memcpy(tail_ + tail_size_, p, n);
+    tail_size_ += n;
+    p += n;
+    size -= n;
+    if (tail_size_ < sizeof(tail_)) return;
+    Stripe(tail_);
+    tail_size_ = 0;
+  }
+  for (; size >= sizeof(tail_); p += sizeof(tail_), size -= sizeof(tail_)) {
+    Stripe(p);
+  }
+  memcpy(tail_, p, size);
+  tail_size_ = size;
+}
+
+uint64_t WeightHasher::Digest() const {
+  uint64_t h = Rotl(lane_[0], 1) + Rotl(lane_[1], 7) + Rotl(lane_[2], 12) +
+               Rotl(lane_[3], 18);
+  h += total_;
+  size_t i = 0;
+  for (; i + 8 <= tail_size_; i += 8) {
+    h = Rotl(h ^ Round(0, Load64(tail_ + i)), 27) * kPrime1;
+  }
+  for (; i < tail_size_; ++i) h = Rotl(h ^ (tail_[i] * kPrime1), 11) * kPrime2;
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  return h;
+}
+
+uint64_t HashWeights(const void* data, size_t size) {
+  WeightHasher h;
+  h.Update(data, size);
+  return h.Digest();
+}
+
+std::string WeightKey(uint64_t digest) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "w%016llx",
+           static_cast<unsigned long long>(digest));
+  return std::string(buf);
+}
+
+Result<std::string> WeightKeyOfFile(const char* path) {
+  const int fd = path ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+  if (fd < 0) return FileError<std::string>("open", path ? path : "");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    auto err = FileError<std::string>("stat", path);
+    close(fd);
+    return err;
+  }
+  if (st.st_size <= 0) {
+    close(fd);
+    return EmptyFile(path);
+  }
+  WeightHasher h;
+  const bool ok = ReadHashed(fd, static_cast<uint64_t>(st.st_size), &h);
+  if (!ok) {
+    auto err = FileError<std::string>("read", path);
+    close(fd);
+    return err;
+  }
+  close(fd);
+  return Result<std::string>::Ok(WeightKey(h.Digest()));
+}
+
+// ---------------------------------------------------------------------------
+// WeightCache
+// ---------------------------------------------------------------------------
+
+struct WeightCache::Impl {
+  mutable std::mutex mtx;  // guards blobs; exporter locks on its own
+  CmmExporter exporter;
+  std::vector<Blob> blobs;  // load order
+
+  /** Caller holds mtx. */
+  Blob* Find(const std::string& key) {
+    for (Blob& b : blobs) {
+      if (b.key == key) return &b;
+    }
+    return nullptr;
+  }
+
+  /** Last load or import of @p b. Caller holds mtx. */
+  uint64_t LastUse(const Blob& b, CmmPublicationInfo* info) const {
+    if (!exporter.Query(b.key.c_str(), info)) return b.loaded_ns;
+    return std::max(b.loaded_ns, info->last_import_ns);
+  }
+};
+
+WeightCache::WeightCache() : impl_(new Impl()) {}
+
+WeightCache::~WeightCache() {
+  Close();
+  delete impl_;
+}
+
+Result<void> WeightCache::Listen(const char* path) {
+  return impl_->exporter.Listen(path);
+}
+
+Result<std::string> WeightCache::Load(const char* file) {
+  struct stat st;
+  if (!file || stat(file, &st) != 0) {
+    return FileError<std::string>("stat", file ? file : "");
+  }
+  if (st.st_size <= 0) return EmptyFile(file);
+  const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+  bool same_size = false;
+  {
+    std::lock_guard<std::mutex> lk(impl_->mtx);
+    for (Blob& b : impl_->blobs) {
+      if (b.path == file && b.size == file_size &&
+          b.mtime_ns == MtimeNs(st)) {
+        b.loaded_ns = MonotonicNs();
+        return Result<std::string>::Ok(b.key);
+      }
+      same_size = same_size || b.size == file_size;
+    }
+  }
+  // Only a blob of the same size can hold the same contents: hash first
+  // then, so a duplicate costs a read but no CMM. Otherwise the load's own
+  // checksum gives the key in a single pass.
+  if (same_size) {
+    auto hashed = WeightKeyOfFile(file);
+    if (!hashed) return hashed;
+    std::lock_guard<std::mutex> lk(impl_->mtx);
+    if (Blob* b = impl_->Find(hashed.Value())) {
+      b->loaded_ns = MonotonicNs();
+      return hashed;
+    }
+  }
+
+  uint64_t digest = 0;
+  CmmLoadOptions opt;
+  opt.token = "weights";
+  opt.checksum = &digest;
+  auto r = LoadFileToCmm(file, CacheMode::kCached, opt);
+  if (!r) {
+    std::string msg = r.Message();
+    return Result<std::string>::Error(r.Code(), [msg] { return msg; });
+  }
+  CmmBuffer buf = r.MoveValue();
+  const uint64_t size = buf.Size();
+
+  // The load's own digest: the file may have changed since it was stat'ed.
+  const std::string key = WeightKey(digest);
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  if (Blob* b = impl_->Find(key)) {  // loaded concurrently
+    b->loaded_ns = MonotonicNs();
+    return Result<std::string>::Ok(key);  // duplicate freed with buf
+  }
+  auto pub = impl_->exporter.Publish(key.c_str(), std::move(buf),
+                                     CacheMode::kCached);
+  if (!pub) {
+    std::string msg = pub.Message();
+    return Result<std::string>::Error(pub.Code(), [msg] { return msg; });
+  }
+  Blob b;
+  b.key = key;
+  b.path = file;
+  b.size = size;
+  b.mtime_ns = MtimeNs(st);
+  b.loaded_ns = MonotonicNs();
+  impl_->blobs.push_back(std::move(b));
+  return Result<std::string>::Ok(key);
+}
+
+size_t WeightCache::EvictUnderPressure(uint64_t min_free_bytes,
+                                       size_t max_evictions) {
+  size_t evicted = 0;
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  while (evicted < max_evictions) {
+    CmmBuffer::CmmStatus st;
+    if (!CmmBuffer::MemQueryStatus(&st)) break;
+    if ((static_cast<uint64_t>(st.remain_size) << 10) >= min_free_bytes) {
+      break;
+    }
+    size_t victim = impl_->blobs.size();
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < impl_->blobs.size(); ++i) {
+      CmmPublicationInfo info{};
+      const uint64_t last = impl_->LastUse(impl_->blobs[i], &info);
+      if (info.importers == 0 && last < oldest) {
+        oldest = last;
+        victim = i;
+      }
+    }
+    if (victim == impl_->blobs.size()) break;  // every blob is in use
+    (void)impl_->exporter.Retire(impl_->blobs[victim].key.c_str());
+    impl_->blobs.erase(impl_->blobs.begin() +
+                       static_cast<ptrdiff_t>(victim));
+    ++evicted;
+  }
+  return evicted;
+}
+
+std::vector<WeightBlob> WeightCache::Blobs() const {
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  std::vector<WeightBlob> out;
+  out.reserve(impl_->blobs.size());
+  for (const Blob& b : impl_->blobs) {
+    CmmPublicationInfo info{};
+    WeightBlob w;
+    w.key = b.key;
+    w.path = b.path;
+    w.size = b.size;
+    w.last_use_ns = impl_->LastUse(b, &info);
+    w.importers = info.importers;
+    w.imports = info.imports;
+    out.push_back(std::move(w));
+  }
+  return out;
+}
+
+void WeightCache::Close() {
+  std::lock_guard<std::mutex> lk(impl_->mtx);
+  (void)impl_->exporter.Close();  // imported blobs go on release
+  impl_->blobs.clear();
+}
+
+}  // namespace axsys
@@ -0,0 +1,263 @@
+// Throughput and latency of axsys::FrameQueue (SPSC and MPMC) versus a
+// mutex + condition_variable ring buffer of the same capacity.
+
+// C system headers
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// C++ headers
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// libax_sys_cpp
+#include "axsys/frame_queue.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Stand-in for a frame handle: sequence number plus enqueue timestamp.
+struct Token {
+  uint64_t seq;
+  int64_t enqueue_ns;
+};
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+// Baseline: bounded ring guarded by one mutex and two condition variables.
+class MutexQueue {
+ public:
+  explicit MutexQueue(size_t capacity) : ring_(capacity), head_(0), size_(0) {}
+
+  bool Push(Token&& t) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    not_full_.wait(lk, [this] { return size_ < ring_.size() || closed_; });
+    if (closed_) return false;
+    ring_[(head_ + size_) % ring_.size()] = t;
+    ++size_;
+    lk.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  bool Pop(Token* out) {
+    std::unique_lock<std::mutex> lk(mtx_);
+    not_empty_.wait(lk, [this] { return size_ > 0 || closed_; });
+    if (size_ == 0) return false;
+    *out = ring_[head_];
+    head_ = (head_ + 1) % ring_.size();
+    --size_;
+    lk.unlock();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+ private:
+  std::vector<Token> ring_;
+  size_t head_;
+  size_t size_;
+  bool closed_ = false;
+  std::mutex mtx_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
+
+// Adapters so the drivers below treat all queues alike.
+template <typename Q>
+bool QPush(Q* q, Token&& t) {
+  return static_cast<bool>(q->Push(std::move(t)));
+}
+bool QPush(MutexQueue* q, Token&& t) { return q->Push(std::move(t)); }
+template <typename Q>
+bool QPop(Q* q, Token* t) {
+  return static_cast<bool>(q->Pop(t));
+}
+bool QPop(MutexQueue* q, Token* t) { return q->Pop(t); }
+
+struct RunResult {
+  double mops;     // million items per second
+  double p50_us;   // enqueue->dequeue latency percentiles
+  double p99_us;
+  double max_us;
+};
+
+double Percentile(std::vector<int64_t>* v, double p) {
+  if (v->empty()) return 0.0;
+  const size_t idx = std::min(
+      v->size() - 1,
+      static_cast<size_t>(p * static_cast<double>(v->size() - 1) + 0.5));
+  std::nth_element(v->begin(), v->begin() + static_cast<ptrdiff_t>(idx),
+                   v->end());
+  return static_cast<double>((*v)[idx]) / 1000.0;
+}
+
+// Saturating run: producers push as fast as possible; throughput plus the
+// latency every item saw (dominated by queueing delay when full).
+template <typename Q>
+RunResult Run(Q* q, int producers, int consumers, uint64_t items) {
+  const uint64_t per_producer = items / static_cast<uint64_t>(producers);
+  std::vector<std::vector<int64_t>> lat(static_cast<size_t>(consumers));
+  std::vector<std::thread> threads;
+  const Clock::time_point start = Clock::now();
+  for (int c = 0; c < consumers; ++c) {
+    std::vector<int64_t>* out = &lat[static_cast<size_t>(c)];
+    out->reserve(items / static_cast<uint64_t>(consumers) + 1024);
+    threads.emplace_back([q, out] {
+      Token t{};
+      while (QPop(q, &t)) out->push_back(NowNs() - t.enqueue_ns);
+    });
+  }
+  std::vector<std::thread> prod;
+  for (int p = 0; p < producers; ++p) {
+    prod.emplace_back([q, per_producer] {
+      for (uint64_t i = 0; i < per_producer; ++i) {
+        if (!QPush(q, Token{i, NowNs()})) return;
+      }
+    });
+  }
+  for (auto& t : prod) t.join();
+  q->Close();
+  for (auto& t : threads) t.join();
+  const double sec =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<int64_t> all;
+  for (auto& v : lat) all.insert(all.end(), v.begin(), v.end());
+  RunResult r{};
+  r.mops = static_cast<double>(all.size()) / sec / 1e6;
+  r.p50_us = Percentile(&all, 0.50);
+  r.p99_us = Percentile(&all, 0.99);
+  r.max_us = Percentile(&all, 1.0);
+  return r;
+}
+
+// Paced run: one producer pushes at a fixed interval so the queue is
+// mostly empty and the latency reflects the wake-up path (futex vs condvar).
+template <typename Q>
+RunResult RunPaced(Q* q, uint64_t items, int64_t interval_us) {
+  std::vector<int64_t> lat;
+  lat.reserve(items);
+  std::thread consumer([q, &lat] {
+    Token t{};
+    while (QPop(q, &t)) lat.push_back(NowNs() - t.enqueue_ns);
+  });
+  for (uint64_t i = 0; i < items; ++i) {
+    if (!QPush(q, Token{i, NowNs()})) break;
+    std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+  }
+  q->Close();
+  consumer.join();
+  RunResult r{};
+  r.p50_us = Percentile(&lat, 0.50);
+  r.p99_us = Percentile(&lat, 0.99);
+  r.max_us = Percentile(&lat, 1.0);
+  return r;
+}
+
+void Print(const char* name, const RunResult& r, bool with_rate) {
+  if (with_rate) {
+    printf("  %-22s %8.2f Mitems/s  p50 %9.2f us  p99 %9.2f us  max %9.2f us\n",
+           name, r.mops, r.p50_us, r.p99_us, r.max_us);
+  } else {
+    printf("  %-22s %18s  p50 %9.2f us  p99 %9.2f us  max %9.2f us\n", name,
+           "", r.p50_us, r.p99_us, r.max_us);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint64_t items = 2000000;
+  size_t capacity = 64;
+  int c = 0;
+  while ((c = getopt(argc, argv, "n:c:h")) != -1) {
+    switch (c) {
+      case 'n':
+        items = strtoull(optarg, nullptr, 10);
+        break;
+      case 'c':
+        capacity = strtoull(optarg, nullptr, 10);
+        break;
+      case 'h':
+      default:
+        fprintf(stderr,
+                "Usage: %s [-n items] [-c capacity]\n"
+                "  -n items     Items per throughput run (default 2000000)\n"
+                "  -c capacity  Queue capacity (default 64)\n",
+                argv[0]);
+        return c == 'h' ? 0 : -1;
+    }
+  }
+  if (items == 0 || capacity == 0) {
+    fprintf(stderr, "items and capacity must be > 0\n");
+    return -1;
+  }
+
+  printf("[sample_frame_queue] items=%" PRIu64 " capacity=%zu cpus=%u\n",
+         items, capacity, std::thread::hardware_concurrency());
+
+  printf("1 producer / 1 consumer (saturated)\n");
+  {
+    axsys::FrameQueue<Token, axsys::QueueKind::kSpsc> q(capacity);
+    Print("FrameQueue<SPSC>", Run(&q, 1, 1, items), true);
+  }
+  {
+    axsys::FrameQueue<Token> q(capacity);
+    Print("FrameQueue<MPMC>", Run(&q, 1, 1, items), true);
+  }
+  {
+    MutexQueue q(capacity);
+    Print("mutex+condvar", Run(&q, 1, 1, items), true);
+  }
+
+  for (int n : {2, 4}) {
+    printf("%d producers / %d consumers (saturated)\n", n, n);
+    {
+      axsys::FrameQueue<Token> q(capacity);
+      Print("FrameQueue<MPMC>", Run(&q, n, n, items), true);
+    }
+    {
+      MutexQueue q(capacity);
+      Print("mutex+condvar", Run(&q, n, n, items), true);
+    }
+  }
+
+  // 20 fps capture hands over one frame every 50 ms; 200 us keeps the run
+  // short while still letting the consumer go to sleep between items.
+  const uint64_t paced_items = 2000;
+  printf("1 producer / 1 consumer (paced, 200 us interval, wake-up latency)\n");
+  {
+    axsys::FrameQueue<Token, axsys::QueueKind::kSpsc> q(capacity);
+    Print("FrameQueue<SPSC>", RunPaced(&q, paced_items, 200), false);
+  }
+  {
+    axsys::FrameQueue<Token> q(capacity);
+    Print("FrameQueue<MPMC>", RunPaced(&q, paced_items, 200), false);
+  }
+  {
+    MutexQueue q(capacity);
+    Print("mutex+condvar", RunPaced(&q, paced_items, 200), false);
+  }
+  return 0;
+}
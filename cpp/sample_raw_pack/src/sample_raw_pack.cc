@@ -0,0 +1,146 @@
+// RAW10 pack/unpack throughput on CMM buffers for a 3840x2160 frame.
+//
+// For each kernel and thread count the frame is converted repeatedly and
+// the best and mean rates are reported in GB/s of RAW16 data (the larger
+// side of the conversion), plus milliseconds per frame.
+
+// C system headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// C++ headers
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// libax_sys_cpp
+#include "axsys/raw_pack.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using Clock = std::chrono::steady_clock;
+
+enum class Kernel { kUnpack, kPack };
+
+struct Rate {
+  double best_gbps;
+  double mean_gbps;
+  double mean_ms;
+};
+
+bool RunKernel(Kernel k, axsys::CmmView* raw10, axsys::CmmView* raw16,
+               const axsys::RawGeometry& g, unsigned threads, int iterations,
+               Rate* out) {
+  const double bytes = static_cast<double>(g.unpacked_stride) * g.height;
+  double best = 0.0;
+  double total_sec = 0.0;
+  for (int i = 0; i < iterations; ++i) {
+    const Clock::time_point t0 = Clock::now();
+    auto r = k == Kernel::kUnpack ? axsys::UnpackRaw10(raw10, raw16, g, threads)
+                                  : axsys::PackRaw10(raw16, raw10, g, threads);
+    const double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+    if (!r) {
+      fprintf(stderr, "%s\n", r.Message().c_str());
+      return false;
+    }
+    total_sec += sec;
+    best = std::max(best, bytes / sec / 1e9);
+  }
+  out->best_gbps = best;
+  out->mean_gbps = bytes * iterations / total_sec / 1e9;
+  out->mean_ms = total_sec * 1e3 / iterations;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  uint32_t width = 3840;
+  uint32_t height = 2160;
+  int iterations = 20;
+  unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+  CacheMode mode = CacheMode::kCached;
+  int c = 0;
+  while ((c = getopt(argc, argv, "w:h:n:t:u")) != -1) {
+    switch (c) {
+      case 'w':
+        width = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+        break;
+      case 'h':
+        height = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+        break;
+      case 'n':
+        iterations = atoi(optarg);
+        break;
+      case 't':
+        max_threads = static_cast<unsigned>(strtoul(optarg, nullptr, 10));
+        break;
+      case 'u':
+        mode = CacheMode::kNonCached;
+        break;
+      default:
+        fprintf(stderr,
+                "Usage: %s [-w width] [-h height] [-n iterations] "
+                "[-t max_threads] [-u]\n"
+                "  -u  map buffers non-cached (default cached)\n",
+                argv[0]);
+        return -1;
+    }
+  }
+  if (width == 0 || height == 0 || iterations <= 0 || max_threads == 0) {
+    fprintf(stderr, "width, height, iterations and threads must be > 0\n");
+    return -1;
+  }
+
+  axsys::System sys;
+  if (!sys.Ok()) {
+    fprintf(stderr, "AX_SYS_Init failed\n");
+    return -1;
+  }
+
+  axsys::RawGeometry g;
+  g.width = width;
+  g.height = height;
+  g.packed_stride = axsys::Raw10RowBytes(width);
+  g.unpacked_stride = static_cast<size_t>(width) * 2;
+
+  axsys::CmmBuffer raw10_buf;
+  axsys::CmmBuffer raw16_buf;
+  auto r10 = raw10_buf.Allocate(g.packed_stride * height, mode, "raw10");
+  auto r16 = raw16_buf.Allocate(g.unpacked_stride * height, mode, "raw16");
+  if (!r10 || !r16) {
+    fprintf(stderr, "allocation failed: %s%s\n", r10.Message().c_str(),
+            r16.Message().c_str());
+    return -1;
+  }
+  axsys::CmmView raw10 = r10.MoveValue();
+  axsys::CmmView raw16 = r16.MoveValue();
+  memset(raw10.Data(), 0x5a, raw10.Size());
+
+  printf("[sample_raw_pack] %ux%u kernel=%s mode=%s iterations=%d\n", width,
+         height, axsys::Raw10KernelName(),
+         mode == CacheMode::kCached ? "cached" : "noncached", iterations);
+  printf("%-8s %7s %10s %10s %10s\n", "kernel", "threads", "best GB/s",
+         "mean GB/s", "ms/frame");
+
+  std::vector<unsigned> thread_counts;
+  for (unsigned t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+  thread_counts.push_back(max_threads);
+
+  for (Kernel k : {Kernel::kUnpack, Kernel::kPack}) {
+    for (unsigned t : thread_counts) {
+      Rate rate{};
+      if (!RunKernel(k, &raw10, &raw16, g, t, iterations, &rate)) return -1;
+      printf("%-8s %7u %10.2f %10.2f %10.2f\n",
+             k == Kernel::kUnpack ? "unpack" : "pack", t, rate.best_gbps,
+             rate.mean_gbps, rate.mean_ms);
+    }
+  }
+  return 0;
+}
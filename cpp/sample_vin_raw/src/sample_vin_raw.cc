@@ -1,5 +1,6 @@
 // Capture RAW Bayer frames from SC850SL without enabling YUV channel.
 // Method 2: Disable YUV output, capture RAW only from IFE dump.
+// --replay FILE feeds a recorded capture file through the same loop.
 
 #include <ax_base_type.h>
 #include <ax_buffer_tool.h>
@@ -29,6 +30,13 @@
 #include <thread>
 #include <vector>
 
+#include "axsys/capture_file.hpp"
+#include "axsys/frame_map_cache.hpp"
+#include "axsys/frame_source.hpp"
+#include "axsys/raw_frame.hpp"
+#include "axsys/replay_frame_source.hpp"
+#include "axsys/vin_raw_frame.hpp"
+
 namespace {
 constexpr AX_U8 kPipeId = 0;
 constexpr AX_U8 kDevId = 0;
@@ -48,6 +56,11 @@ constexpr AX_F32 kSensorFrameRate = 20.0F;
 // Default AI-ISP disabled for RAW capture only.
 constexpr AX_BOOL kDefaultAiIsp = AX_FALSE;
 
+// Upper bound on distinct frame buffers kept mapped. RAW frames come from the
+// private IFE pool (4 blocks) or, as a fallback, the common RAW pool (8
+// blocks), so steady state never exceeds this.
+constexpr size_t kFrameMapCapacity = 16;
+
 struct PoolConfig {
   AX_U32 width;
   AX_U32 height;
@@ -85,6 +98,8 @@ std::atomic<uint64_t> g_captured_frames{0};
 // the main loop writes RAW frame bytes to stdout, then exits after N frames.
 std::atomic<bool> g_save_frames_mode{false};
 std::atomic<uint32_t> g_save_frames_remaining{0};
+// --bare: write payload bytes only instead of the capture container.
+std::atomic<bool> g_save_bare{false};
 static std::atomic<uint32_t> g_skip_frames_count{30};
 
 void InfoOut(const char *fmt, ...) {
@@ -95,14 +110,28 @@ void InfoOut(const char *fmt, ...) {
   va_end(args);
 }
 
-void PrintFrameRate() {
+// Reports capture rate and AX_SYS_Mmap/Munmap calls issued by the frame map
+// cache during the last second. Both mapping rates drop to zero once every
+// pool block has been seen. "held" is the number of RAW frames not yet
+// returned to the pool; "exhausted" counts frames that took the last block.
+void PrintFrameRate(const axsys::FrameMapCache *frame_maps,
+                    const axsys::PoolGauge *pool_gauge) {
   uint64_t previous_count = 0;
+  axsys::FrameMapCache::Stats previous_maps = frame_maps->GetStats();
   while (g_keep_running.load()) {
     std::this_thread::sleep_for(std::chrono::seconds(1));
     uint64_t current = g_captured_frames.load();
     uint64_t diff = current - previous_count;
     previous_count = current;
-    InfoOut("[sample_vin_raw] FPS: %" PRIu64 "\n", diff);
+    const axsys::FrameMapCache::Stats maps = frame_maps->GetStats();
+    const axsys::PoolGauge::Snapshot pool = pool_gauge->Read();
+    InfoOut("[sample_vin_raw] FPS: %" PRIu64 " mmap/s: %" PRIu64
+            " munmap/s: %" PRIu64 " mapped blocks: %zu held: %u/%u"
+            " peak: %u exhausted: %" PRIu64 "\n",
+            diff, maps.map_calls - previous_maps.map_calls,
+            maps.unmap_calls - previous_maps.unmap_calls, maps.entries,
+            pool.held, pool.capacity, pool.peak, pool.exhausted);
+    previous_maps = maps;
   }
 }
 
@@ -582,6 +611,8 @@ void StopStreaming() {
 struct CommandLineOptions {
   AX_BOOL enable_ai_isp = kDefaultAiIsp;
   uint32_t save_frames = 0;  // When > 0, write N RAW frames to stdout and exit.
+  std::string replay_path;  // Capture file to replay instead of VIN.
+  uint32_t replay_fps_x1000 = axsys::ReplayFrameSource::kRecordedRate;
 };
 
 CommandLineOptions ParseOptions(int argc, char *argv[]) {
@@ -607,6 +638,9 @@ CommandLineOptions ParseOptions(int argc, char *argv[]) {
       argv[i][0] = '\0';
       argv[i + 1][0] = '\0';
       ++i;
+    } else if (std::strcmp(argv[i], "--bare") == 0) {
+      g_save_bare.store(true);
+      argv[i][0] = '\0';
     } else if (std::strcmp(argv[i], "--skip-frames") == 0) {
       if (i + 1 >= argc) {
         std::fprintf(stderr, "Error: --skip-frames requires a number\n");
@@ -621,6 +655,29 @@ CommandLineOptions ParseOptions(int argc, char *argv[]) {
       argv[i][0] = '\0';
       argv[i + 1][0] = '\0';
       ++i;
+    } else if (std::strcmp(argv[i], "--replay") == 0) {
+      if (i + 1 >= argc) {
+        std::fprintf(stderr, "Error: --replay requires a capture file\n");
+        std::exit(-1);
+      }
+      opts.replay_path = argv[i + 1];
+      argv[i][0] = '\0';
+      argv[i + 1][0] = '\0';
+      ++i;
+    } else if (std::strcmp(argv[i], "--replay-fps") == 0) {
+      if (i + 1 >= argc) {
+        std::fprintf(stderr, "Error: --replay-fps requires a number\n");
+        std::exit(-1);
+      }
+      double fps = std::strtod(argv[i + 1], nullptr);
+      if (fps < 0.0 || fps > 1000.0) {
+        std::fprintf(stderr, "Error: --replay-fps must be in [0, 1000]\n");
+        std::exit(-1);
+      }
+      opts.replay_fps_x1000 = static_cast<uint32_t>(fps * 1000.0);
+      argv[i][0] = '\0';
+      argv[i + 1][0] = '\0';
+      ++i;
     }
   }
 
@@ -636,15 +693,23 @@ CommandLineOptions ParseOptions(int argc, char *argv[]) {
       default: {
         std::fprintf(
             stderr,
-            "Usage: %s [-a enable_ai_isp] [--save-frames N] [--skip-frames N]\n"
+            "Usage: %s [-a enable_ai_isp] [--save-frames N] [--skip-frames N]"
+            " [--bare]\n"
+            "       %s --replay FILE [--replay-fps N] [--save-frames N] ...\n"
             "\n"
             "Options:\n"
             "  -a 0|1           Enable AI ISP (default %d)\n"
             "  -h               Show this help\n"
-            "  --save-frames N  Save N RAW frames to stdout and exit\n"
+            "  --save-frames N  Save N RAW frames to stdout as a capture\n"
+            "                   container (see axsys/capture_file.hpp)\n"
+            "  --bare           With --save-frames, write frame bytes only\n"
             "  --skip-frames N  Skip first N frames before saving (default: "
-            "30)\n",
-            argv[0], kDefaultAiIsp ? 1 : 0);
+            "30)\n"
+            "  --replay FILE    Feed a capture file through the capture loop\n"
+            "                   instead of the sensor (no VIN/ISP bring-up)\n"
+            "  --replay-fps N   Replay rate; 0 = as fast as possible\n"
+            "                   (default: rate recorded in FILE)\n",
+            argv[0], argv[0], kDefaultAiIsp ? 1 : 0);
         std::exit(c == 'h' ? 0 : -1);
       }
     }
@@ -652,6 +717,182 @@ CommandLineOptions ParseOptions(int argc, char *argv[]) {
   return opts;
 }
 
+// Pulls frames from a live pipe or a replayed file until stopped, the
+// stream ends or --save-frames is satisfied. |recorded| supplies the sample
+// depth, packing and rate written to the capture header in save mode.
+AX_S32 RunCaptureLoop(axsys::FrameSource *source,
+                      const axsys::CaptureStreamInfo &recorded,
+                      axsys::FrameMapCache *frame_maps,
+                      axsys::CaptureWriter *capture) {
+  AX_S32 ret = 0;
+  bool capture_open = false;
+  bool first_frame_logged = false;
+  uint32_t empty_count = 0;
+  while (g_keep_running.load()) {
+    // RawFrame returns the block to the pool when it goes out of scope, so
+    // no path below needs an explicit release.
+    auto frame_result = source->Next(1000);
+    if (!frame_result) {
+      if (frame_result.Code() == axsys::ErrorCode::kClosed) {
+        InfoOut("[sample_vin_raw] end of replay\n");
+        break;
+      }
+      if (frame_result.Code() == axsys::ErrorCode::kTimeout) {
+        if (++empty_count % 30 == 0) {
+          InfoOut("[sample_vin_raw] waiting for frames... %u empty polls\n",
+                  empty_count);
+        }
+        continue;
+      }
+      std::fprintf(stderr, "%s\n", frame_result.Message().c_str());
+      ret = -1;
+      break;
+    }
+    axsys::RawFrame frame = frame_result.MoveValue();
+    const axsys::RawFrame::Info &info = frame.GetInfo();
+    uint64_t frame_index =
+        g_captured_frames.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // If save mode is enabled, write RAW frames to stdout and exit after N.
+    if (g_save_frames_mode.load()) {
+      // Skip initial frames for AE stabilization
+      if (g_skip_frames_count.load() > 0) {
+        g_skip_frames_count.fetch_sub(1);
+        continue;
+      }
+
+      // RAW10 packed size per frame: stride (bytes) * height.
+      const uint32_t size_bytes = info.planes[0].size;
+
+      auto map_result = frame_maps->Map(info.planes[0].phys, size_bytes);
+      if (!map_result) {
+        std::fprintf(stderr,
+                     "Frame map failed for frame #%" PRIu64
+                     " phys=0x%" PRIx64 " size=%u: %s\n",
+                     frame_index, info.planes[0].phys, size_bytes,
+                     map_result.Message().c_str());
+        ret = -1;
+        break;
+      }
+
+      if (g_save_bare.load()) {
+        size_t wrote =
+            std::fwrite(map_result.Value(), 1, size_bytes, stdout);
+        std::fflush(stdout);
+
+        if (wrote != size_bytes) {
+          std::fprintf(stderr,
+                       "fwrite wrote %zu of %u bytes (frame #%" PRIu64 ")\n",
+                       wrote, size_bytes, frame_index);
+          ret = -1;
+          break;
+        }
+      } else {
+        // The writer goes straight to the descriptor, one writev() per
+        // frame; nothing may sit in the stdio buffer ahead of it.
+        if (!capture_open) {
+          std::fflush(stdout);
+          axsys::CaptureStreamInfo stream{};
+          stream.width = info.width;
+          stream.height = info.height;
+          stream.stride = info.planes[0].stride;
+          stream.format = info.format;
+          stream.bits_per_pixel = recorded.bits_per_pixel;
+          stream.packed = recorded.packed;
+          stream.fps_x1000 = recorded.fps_x1000;
+          auto open_result = capture->Open(STDOUT_FILENO, stream);
+          if (!open_result) {
+            std::fprintf(stderr, "Capture stream open failed: %s\n",
+                         open_result.Message().c_str());
+            ret = -1;
+            break;
+          }
+          capture_open = true;
+        }
+        auto append_result = capture->Append(map_result.Value(), size_bytes,
+                                             info.seq, info.pts);
+        if (!append_result) {
+          std::fprintf(stderr,
+                       "Capture write failed (frame #%" PRIu64 "): %s\n",
+                       frame_index, append_result.Message().c_str());
+          ret = -1;
+          break;
+        }
+      }
+
+      // Countdown and stop after N frames.
+      uint32_t remaining = g_save_frames_remaining.fetch_sub(1) - 1;
+      if (remaining == 0) {
+        g_keep_running.store(false);
+        break;
+      }
+      continue;
+    }
+
+    // Normal mode: periodic log to info output.
+    if (!first_frame_logged || (frame_index % 60U) == 0U) {
+      InfoOut("[sample_vin_raw] Frame #%" PRIu64 " seq %" PRIu64
+              " size %ux%u stride %u fmt %d pts %" PRIu64 "\n",
+              frame_index, info.seq, info.width, info.height,
+              info.planes[0].stride, info.format, info.pts);
+      first_frame_logged = true;
+    }
+
+    empty_count = 0;
+  }
+  return ret;
+}
+
+// --replay: the same loop fed from a capture file. Only AX_SYS is brought
+// up; the replay source allocates its own CMM blocks, as many as the IFE
+// private pool has, so pool pressure behaves as on the live pipe.
+AX_S32 RunReplay(const CommandLineOptions &options) {
+  AX_S32 ret = AX_SYS_Init();
+  if (ret != 0) {
+    std::fprintf(stderr, "AX_SYS_Init failed: 0x%x\n", ret);
+    return ret;
+  }
+  {
+    axsys::ReplayFrameSource::Options replay_options;
+    replay_options.depth = kPrivatePools[0].block_count;
+    replay_options.fps_x1000 = options.replay_fps_x1000;
+    axsys::PoolGauge pool_gauge(replay_options.depth);
+    axsys::FrameMapCache frame_maps(axsys::CacheMode::kNonCached,
+                                    kFrameMapCapacity);
+    axsys::CaptureWriter capture;
+    axsys::ReplayFrameSource source;
+    auto open_result =
+        source.Open(options.replay_path.c_str(), replay_options, &pool_gauge);
+    if (!open_result) {
+      std::fprintf(stderr, "Replay open failed: %s\n",
+                   open_result.Message().c_str());
+      ret = -1;
+    } else {
+      std::thread fps_thread(PrintFrameRate, &frame_maps, &pool_gauge);
+      InfoOut("sample_vin_raw replaying %s (%zu frames). Press Ctrl+C to "
+              "stop.\n",
+              options.replay_path.c_str(), source.FrameCount());
+      ret = RunCaptureLoop(&source, source.StreamInfo(), &frame_maps,
+                           &capture);
+      g_keep_running.store(false);
+      auto capture_close = capture.Close();
+      if (!capture_close) {
+        std::fprintf(stderr, "Capture stream close failed: %s\n",
+                     capture_close.Message().c_str());
+      }
+      fps_thread.join();
+      const axsys::ReplayFrameSource::Stats stats = source.GetStats();
+      InfoOut("[sample_vin_raw] replayed %" PRIu64 " frames, dropped %" PRIu64
+              "\n",
+              stats.delivered, stats.dropped);
+    }
+    // Replay blocks are freed with the source; drop their mappings first.
+    frame_maps.Invalidate();
+  }
+  AX_SYS_Deinit();
+  return ret;
+}
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
@@ -676,6 +917,17 @@ int main(int argc, char *argv[]) {
   g_keep_running.store(true);
   g_captured_frames.store(0);
 
+  if (!options.replay_path.empty()) {
+    AX_S32 replay_ret = RunReplay(options);
+    if (replay_ret == 0) {
+      InfoOut("sample_vin_raw stopped.\n");
+    } else {
+      std::fprintf(stderr, "sample_vin_raw exited with error 0x%x\n",
+                   replay_ret);
+    }
+    return replay_ret;
+  }
+
   AX_S32 ret = 0;
   bool system_initialized = false;
   bool streaming_started = false;
@@ -687,6 +939,14 @@ int main(int argc, char *argv[]) {
 
   SensorLibrary sensor_library;
   AX_SENSOR_REGISTER_FUNC_T *sensor = nullptr;
+  // Maps each RAW pool block once; frames are then resolved by physical
+  // address instead of a per-frame AX_SYS_Mmap/AX_SYS_Munmap pair.
+  axsys::FrameMapCache frame_maps(axsys::CacheMode::kNonCached,
+                                  kFrameMapCapacity);
+  // Save mode output; opened on the first saved frame, once geometry is known.
+  axsys::CaptureWriter capture;
+  // Occupancy of the private IFE pool; every RawFrame counts while held.
+  axsys::PoolGauge pool_gauge(kPrivatePools[0].block_count);
   std::thread fps_thread;
   int stdout_backup = -1;
   bool stdout_redirected = false;
@@ -809,111 +1069,34 @@ int main(int argc, char *argv[]) {
     }
     restore_stdout();
 
-    if (!g_save_frames_mode.load()) {
-      fps_thread = std::thread(PrintFrameRate);
-    }
+    // In save mode InfoOut() targets stderr, so the rate report does not
+    // interleave with frame bytes on stdout.
+    fps_thread = std::thread(PrintFrameRate, &frame_maps, &pool_gauge);
     InfoOut("sample_vin_raw (sc850sl) running. Press Ctrl+C to stop.\n");
 
-    bool first_frame_logged = false;
-    uint32_t empty_count = 0;
-    while (g_keep_running.load()) {
-      AX_IMG_INFO_T frame{};
-      AX_S32 frame_ret = AX_VIN_GetRawFrame(kPipeId, AX_VIN_PIPE_DUMP_NODE_IFE,
-                                            AX_SNS_HDR_FRAME_L, &frame, 1000);
-      if (frame_ret == 0) {
-        uint64_t frame_index =
-            g_captured_frames.fetch_add(1, std::memory_order_relaxed) + 1;
-        const AX_VIDEO_FRAME_T &vf = frame.tFrameInfo.stVFrame;
-
-        // If save mode is enabled, write RAW bytes to stdout and exit after N.
-        if (g_save_frames_mode.load()) {
-          // Skip initial frames for AE stabilization
-          if (g_skip_frames_count.load() > 0) {
-            g_skip_frames_count.fetch_sub(1);
-            AX_VIN_ReleaseRawFrame(kPipeId, AX_VIN_PIPE_DUMP_NODE_IFE,
-                                   AX_SNS_HDR_FRAME_L, &frame);
-            continue;
-          }
-
-          const uint32_t stride = vf.u32PicStride[0];
-          const uint32_t height = vf.u32Height;
-          // RAW10 packed size per frame: stride * height * 10 / 8.
-          const uint64_t size64 = static_cast<uint64_t>(stride) *
-                                  static_cast<uint64_t>(height) * 10ULL / 8ULL;
-          const uint32_t size_bytes = static_cast<uint32_t>(size64);
-
-          void *vir = AX_SYS_Mmap(vf.u64PhyAddr[0], size_bytes);
-          if (vir == nullptr) {
-            std::fprintf(stderr,
-                         "AX_SYS_Mmap failed for frame #%" PRIu64
-                         " phys=0x%" PRIx64 " size=%u\n",
-                         frame_index, static_cast<uint64_t>(vf.u64PhyAddr[0]),
-                         size_bytes);
-            AX_VIN_ReleaseRawFrame(kPipeId, AX_VIN_PIPE_DUMP_NODE_IFE,
-                                   AX_SNS_HDR_FRAME_L, &frame);
-            ret = -1;
-            break;
-          }
-
-          size_t wrote = std::fwrite(vir, 1, size_bytes, stdout);
-          std::fflush(stdout);
-          AX_SYS_Munmap(vir, size_bytes);
-
-          if (wrote != size_bytes) {
-            std::fprintf(stderr,
-                         "fwrite wrote %zu of %u bytes (frame #%" PRIu64 ")\n",
-                         wrote, size_bytes, frame_index);
-            AX_VIN_ReleaseRawFrame(kPipeId, AX_VIN_PIPE_DUMP_NODE_IFE,
-                                   AX_SNS_HDR_FRAME_L, &frame);
-            ret = -1;
-            break;
-          }
-
-          AX_VIN_ReleaseRawFrame(kPipeId, AX_VIN_PIPE_DUMP_NODE_IFE,
-                                 AX_SNS_HDR_FRAME_L, &frame);
-
-          // Countdown and stop after N frames.
-          uint32_t remaining = g_save_frames_remaining.fetch_sub(1) - 1;
-          if (remaining == 0) {
-            g_keep_running.store(false);
-            break;
-          }
-          continue;
-        }
-
-        // Normal mode: periodic log to info output.
-        if (!first_frame_logged || (frame_index % 60U) == 0U) {
-          InfoOut("[sample_vin_raw] Frame #%" PRIu64 " seq %" PRIu64
-                  " size %ux%u stride %u fmt %d pts %" PRIu64 "\n",
-                  frame_index, static_cast<uint64_t>(vf.u64SeqNum), vf.u32Width,
-                  vf.u32Height, vf.u32PicStride[0],
-                  static_cast<int>(vf.enImgFormat),
-                  static_cast<uint64_t>(vf.u64PTS));
-          first_frame_logged = true;
-        }
-
-        empty_count = 0;
-        AX_VIN_ReleaseRawFrame(kPipeId, AX_VIN_PIPE_DUMP_NODE_IFE,
-                               AX_SNS_HDR_FRAME_L, &frame);
-      } else if (frame_ret == AX_ERR_VIN_RES_EMPTY) {
-        if (++empty_count % 30 == 0) {
-          InfoOut("[sample_vin_raw] waiting for frames... %u empty polls\n",
-                  empty_count);
-        }
-        continue;
-      } else {
-        std::fprintf(stderr, "AX_VIN_GetRawFrame failed: 0x%x\n", frame_ret);
-        ret = frame_ret;
-        break;
-      }
-    }
+    axsys::VinFrameSource source(kPipeId, AX_VIN_PIPE_DUMP_NODE_IFE,
+                                 AX_SNS_HDR_FRAME_L, &pool_gauge);
+    axsys::CaptureStreamInfo recorded{};
+    recorded.bits_per_pixel = 10;
+    recorded.packed = 1;
+    recorded.fps_x1000 = static_cast<uint32_t>(kSensorFrameRate * 1000);
+    ret = RunCaptureLoop(&source, recorded, &frame_maps, &capture);
   } while (false);
 
   g_keep_running.store(false);
+  // Finish the capture stream: index and trailer follow the last frame.
+  auto capture_close = capture.Close();
+  if (!capture_close) {
+    std::fprintf(stderr, "Capture stream close failed: %s\n",
+                 capture_close.Message().c_str());
+  }
   restore_stdout();
   if (fps_thread.joinable()) {
     fps_thread.join();
   }
+  // Pool blocks are torn down with the pipe; drop their mappings first so a
+  // reconfigured pipe never resolves to stale addresses.
+  frame_maps.Invalidate();
 
   if (streaming_started && sensor && sensor->pfn_sensor_streaming_ctrl) {
     sensor->pfn_sensor_streaming_ctrl(kPipeId, AX_FALSE);
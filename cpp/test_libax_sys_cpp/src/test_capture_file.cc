@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "axsys/capture_file.hpp"
+
+namespace {
+
+using axsys::CaptureReader;
+using axsys::CaptureStreamInfo;
+using axsys::CaptureWriter;
+using axsys::ErrorCode;
+
+std::string TempPath(const char* name) {
+  return testing::TempDir() + name + std::to_string(getpid());
+}
+
+std::vector<uint8_t> Pattern(size_t size, uint8_t seed) {
+  std::vector<uint8_t> v(size);
+  for (size_t i = 0; i < size; ++i) {
+    v[i] = static_cast<uint8_t>(seed + i * 7);
+  }
+  return v;
+}
+
+const size_t kSizes[] = {0, 1, 63, 64, 65, 4099, 100000};
+
+/**
+ * @brief Case030: Frames round-trip with metadata and O(1) index lookup.
+ *
+ * Steps:
+ * - Write a stream header and frames of awkward sizes (0, 1, 63, 64, 65,
+ *   4099, 100000 bytes) with distinct seq/PTS; Close().
+ * - Open with CaptureReader and fetch frames in reverse order.
+ * Expected:
+ * - Stream info matches; Indexed() is true; every payload, seq and PTS
+ *   matches; payloads are 64-byte aligned; an index past the end is
+ *   kOutOfRange.
+ */
+TEST(CaptureFile, Case030_RoundTripIndexed) {
+  const std::string path = TempPath("axcap_030_");
+  const CaptureStreamInfo si = {3840, 2160, 4800, 0x7a, 10, 1, 20000};
+  {
+    CaptureWriter w;
+    auto r = w.Open(path.c_str(), si);
+    ASSERT_TRUE(r) << r.Message();
+    for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+      std::vector<uint8_t> d = Pattern(kSizes[i], static_cast<uint8_t>(i));
+      r = w.Append(d.data(), d.size(), 100 + i, 1000000 * i);
+      ASSERT_TRUE(r) << r.Message();
+    }
+    EXPECT_EQ(w.FrameCount(), sizeof(kSizes) / sizeof(kSizes[0]));
+    ASSERT_TRUE(w.Close());
+  }
+
+  CaptureReader rd;
+  auto r = rd.Open(path.c_str());
+  ASSERT_TRUE(r) << r.Message();
+  EXPECT_TRUE(rd.Indexed());
+  EXPECT_EQ(rd.Info().width, si.width);
+  EXPECT_EQ(rd.Info().stride, si.stride);
+  EXPECT_EQ(rd.Info().format, si.format);
+  EXPECT_EQ(rd.Info().fps_x1000, si.fps_x1000);
+  ASSERT_EQ(rd.FrameCount(), sizeof(kSizes) / sizeof(kSizes[0]));
+  for (size_t i = rd.FrameCount(); i-- > 0;) {
+    auto f = rd.GetFrame(i);
+    ASSERT_TRUE(f) << f.Message();
+    const CaptureReader::Frame& fr = f.Value();
+    EXPECT_EQ(fr.seq, 100 + i);
+    EXPECT_EQ(fr.pts, 1000000 * i);
+    ASSERT_EQ(fr.size, kSizes[i]);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(fr.data) % 64, 0u);
+    std::vector<uint8_t> d = Pattern(kSizes[i], static_cast<uint8_t>(i));
+    EXPECT_EQ(memcmp(fr.data, d.data(), d.size()), 0) << "frame " << i;
+  }
+  EXPECT_EQ(rd.GetFrame(rd.FrameCount()).Code(), ErrorCode::kOutOfRange);
+  rd.Close();
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case030s: A stream cut short is recovered by scanning records.
+ *
+ * Steps:
+ * - Write three 10000-byte frames and Close().
+ * - Truncate the file in the middle of the third payload (drops the
+ *   index and trailer).
+ * Expected:
+ * - Reader opens with Indexed() == false and exposes the first two
+ *   complete frames.
+ */
+TEST(CaptureFile, Case030s_TruncatedScan) {
+  const std::string path = TempPath("axcap_030s_");
+  const CaptureStreamInfo si = {64, 64, 128, 0, 16, 0, 0};
+  uint64_t cut = 0;
+  {
+    CaptureWriter w;
+    ASSERT_TRUE(w.Open(path.c_str(), si));
+    for (uint64_t i = 0; i < 3; ++i) {
+      std::vector<uint8_t> d = Pattern(10000, static_cast<uint8_t>(i));
+      if (i == 2) cut = w.BytesWritten() + 64 + 5000;
+      ASSERT_TRUE(w.Append(d.data(), d.size(), i, i));
+    }
+    ASSERT_TRUE(w.Close());
+  }
+  ASSERT_EQ(truncate(path.c_str(), static_cast<off_t>(cut)), 0);
+
+  CaptureReader rd;
+  auto r = rd.Open(path.c_str());
+  ASSERT_TRUE(r) << r.Message();
+  EXPECT_FALSE(rd.Indexed());
+  ASSERT_EQ(rd.FrameCount(), 2u);
+  auto f = rd.GetFrame(1);
+  ASSERT_TRUE(f);
+  std::vector<uint8_t> d = Pattern(10000, 1);
+  EXPECT_EQ(memcmp(f.Value().data, d.data(), d.size()), 0);
+  rd.Close();
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case030j: A file that is not a capture stream is rejected.
+ *
+ * Steps:
+ * - Write 256 bytes of pattern data and Open() it.
+ * Expected:
+ * - kInvalidArgument.
+ */
+TEST(CaptureFile, Case030j_ForeignFileRejected) {
+  const std::string junk = TempPath("axcap_030j_");
+  FILE* fp = fopen(junk.c_str(), "wb");
+  ASSERT_NE(fp, nullptr);
+  std::vector<uint8_t> bytes = Pattern(256, 3);
+  fwrite(bytes.data(), 1, bytes.size(), fp);
+  fclose(fp);
+  CaptureReader rd;
+  EXPECT_EQ(rd.Open(junk.c_str()).Code(), ErrorCode::kInvalidArgument);
+  unlink(junk.c_str());
+}
+
+}  // namespace
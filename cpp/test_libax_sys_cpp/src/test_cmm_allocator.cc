@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
+#include "axsys/cmm_allocator.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmAllocator;
+using axsys::CmmArena;
+using axsys::CmmArenaOptions;
+using axsys::CmmBuffer;
+using axsys::CmmVector;
+using axsys::ErrorCode;
+
+CmmArenaOptions ArenaOptions(const char* token) {
+  CmmArenaOptions opt;
+  opt.chunk_size = 256 << 10;
+  opt.token = token;
+  return opt;
+}
+
+/**
+ * @brief Case046: std containers live in one arena chunk.
+ *
+ * Steps:
+ * - Create an arena with 256 KiB chunks; fill a std::vector<uint32_t>
+ *   using CmmAllocator with 1000 values and Flush() it.
+ * - Create 200 small std::vectors of 16 ints each in the same arena.
+ * Expected:
+ * - Values read back; Phys(&v[i]) == Phys(v.data()) + 4 * i, nonzero.
+ * - Still one chunk and one CmmBuffer::Allocate() in total; nothing in
+ *   use once the containers are gone.
+ */
+TEST(CmmAllocator, Case046_StdContainers) {
+  CmmArena arena(ArenaOptions("arena046"));
+  {
+    std::vector<uint32_t, CmmAllocator<uint32_t>> v{
+        CmmAllocator<uint32_t>(&arena)};
+    for (uint32_t i = 0; i < 1000; ++i) v.push_back(i * 3);
+    for (uint32_t i = 0; i < 1000; ++i) ASSERT_EQ(v[i], i * 3);
+    const uint64_t phys = arena.Phys(v.data());
+    EXPECT_NE(phys, 0u);
+    EXPECT_EQ(arena.Phys(&v[999]), phys + 4 * 999);
+    EXPECT_TRUE(arena.Flush(v.data(), v.size() * sizeof(uint32_t)));
+
+    std::vector<std::vector<int, CmmAllocator<int>>> many;
+    for (int i = 0; i < 200; ++i) {
+      many.emplace_back(16, i, CmmAllocator<int>(&arena));
+    }
+    EXPECT_EQ(many[199][15], 199);
+    EXPECT_EQ(arena.Stats().chunks, 1u);
+    EXPECT_EQ(arena.Stats().mem_allocs, 1u);
+  }
+  EXPECT_EQ(arena.Stats().bytes_in_use, 0u);
+}
+
+/**
+ * @brief Case046r: A released block is handed out again.
+ *
+ * Steps:
+ * - Allocate a 64-byte block, release it, allocate again.
+ * Expected:
+ * - The second allocation returns the released block.
+ */
+TEST(CmmAllocator, Case046r_ReleasedBlockReused) {
+  CmmArena arena(ArenaOptions("arena046r"));
+  void* a = arena.Allocate(64);
+  ASSERT_NE(a, nullptr);
+  arena.Deallocate(a, 64);
+  EXPECT_EQ(arena.Allocate(64), a);
+  arena.Deallocate(a, 64);
+}
+
+/**
+ * @brief Case046l: Large blocks get their own allocation.
+ *
+ * Steps:
+ * - Allocate 64 bytes (one chunk), then 1 MiB (above chunk_size / 4);
+ *   release the 1 MiB block.
+ * Expected:
+ * - large_blocks 1 then 0; bytes_reserved back to one chunk.
+ */
+TEST(CmmAllocator, Case046l_LargeBlock) {
+  CmmArena arena(ArenaOptions("arena046l"));
+  void* a = arena.Allocate(64);
+  ASSERT_NE(a, nullptr);
+  void* big = arena.Allocate(1 << 20);
+  ASSERT_NE(big, nullptr);
+  EXPECT_EQ(arena.Stats().large_blocks, 1u);
+  EXPECT_EQ(arena.Stats().bytes_reserved, (256u << 10) + (1u << 20));
+  arena.Deallocate(big, 1 << 20);
+  EXPECT_EQ(arena.Stats().large_blocks, 0u);
+  EXPECT_EQ(arena.Stats().bytes_reserved, 256u << 10);
+  arena.Deallocate(a, 64);
+}
+
+/**
+ * @brief Case046e: Addresses and alignments outside the arena.
+ *
+ * Steps:
+ * - Flush() a range crossing the end of a block's chunk; Phys() of a
+ *   stack address; Allocate() with an 8 KiB alignment.
+ * Expected:
+ * - kOutOfRange; 0; nullptr.
+ */
+TEST(CmmAllocator, Case046e_OutsideArena) {
+  CmmArena arena(ArenaOptions("arena046e"));
+  uint8_t* last = static_cast<uint8_t*>(arena.Allocate(64 << 10));
+  ASSERT_NE(last, nullptr);
+  EXPECT_EQ(arena.Flush(last, 1 << 20).Code(), ErrorCode::kOutOfRange);
+  int local = 0;
+  EXPECT_EQ(arena.Phys(&local), 0u);
+  arena.Deallocate(last, 64 << 10);
+  EXPECT_EQ(arena.Allocate(64, 8192), nullptr);
+}
+
+/**
+ * @brief Case046p: CmmVector grows geometrically and keeps its values.
+ *
+ * Steps:
+ * - push_back 100 values into a CmmVector<uint32_t> in a private arena,
+ *   recording capacity changes.
+ * Expected:
+ * - No storage (Phys() 0) before the first element.
+ * - Capacities 16, 32, 64, 128; values intact after each reallocation.
+ */
+TEST(CmmAllocator, Case046p_CmmVectorGrowth) {
+  CmmArenaOptions opt;
+  opt.token = "arena046p";
+  CmmArena arena(opt);
+  CmmVector<uint32_t> v(&arena);
+  EXPECT_EQ(v.Phys(), 0u);
+  std::vector<size_t> caps;
+  for (uint32_t i = 0; i < 100; ++i) {
+    v.push_back(i);
+    if (caps.empty() || caps.back() != v.capacity()) {
+      caps.push_back(v.capacity());
+    }
+  }
+  EXPECT_EQ(caps, (std::vector<size_t>{16, 32, 64, 128}));
+  for (uint32_t i = 0; i < 100; ++i) ASSERT_EQ(v[i], i);
+}
+
+/**
+ * @brief Case046t: TryPushBack() never reallocates.
+ *
+ * Steps:
+ * - reserve(4096); fill it with TryPushBack(); TryPushBack() once more.
+ * Expected:
+ * - data() and Phys() unchanged while filling; the extra call is false.
+ */
+TEST(CmmAllocator, Case046t_TryPushBackKeepsStorage) {
+  CmmArenaOptions opt;
+  opt.token = "arena046t";
+  CmmArena arena(opt);
+  CmmVector<uint32_t> v(&arena);
+  v.reserve(4096);
+  uint32_t* data = v.data();
+  const uint64_t phys = v.Phys();
+  for (uint32_t i = 0; i < 4096; ++i) {
+    ASSERT_TRUE(v.TryPushBack(i ^ 0x46u));
+  }
+  EXPECT_FALSE(v.TryPushBack(0));
+  EXPECT_EQ(v.data(), data);
+  EXPECT_EQ(v.Phys(), phys);
+}
+
+/**
+ * @brief Case046d: A device mapping sees the flushed elements.
+ *
+ * Steps:
+ * - Fill a reserved CmmVector of 4096 values; Flush(); map Phys() again
+ *   non-cached via AttachExternal()+MapView().
+ * Expected:
+ * - The non-cached view reads the values written through the vector.
+ */
+TEST(CmmAllocator, Case046d_DeviceSeesElements) {
+  CmmArenaOptions opt;
+  opt.token = "arena046d";
+  CmmArena arena(opt);
+  CmmVector<uint32_t> v(&arena);
+  v.reserve(4096);
+  for (uint32_t i = 0; i < 4096; ++i) {
+    ASSERT_TRUE(v.TryPushBack(i ^ 0x46u));
+  }
+  const uint64_t phys = v.Phys();
+
+  ASSERT_TRUE(v.Flush());
+  CmmBuffer ext;
+  ASSERT_TRUE(ext.AttachExternal(phys, 4096 * sizeof(uint32_t)));
+  auto view = ext.MapView(0, 4096 * sizeof(uint32_t), CacheMode::kNonCached);
+  ASSERT_TRUE(view);
+  const uint32_t* nc = static_cast<const uint32_t*>(view.Value().Data());
+  for (uint32_t i = 0; i < 4096; ++i) ASSERT_EQ(nc[i], i ^ 0x46u) << i;
+  view.Value().Reset();
+  ASSERT_TRUE(ext.DetachExternal());
+}
+
+/**
+ * @brief Case046m: Moves keep storage; self-append survives growth.
+ *
+ * Steps:
+ * - Fill a reserved CmmVector of 4096 values; move it into another;
+ *   push_back(v[0]) at full capacity; Invalidate().
+ * Expected:
+ * - The source is empty; the moved-to vector keeps data(); the appended
+ *   element equals the first one.
+ */
+TEST(CmmAllocator, Case046m_MoveAndSelfAppend) {
+  CmmArenaOptions opt;
+  opt.token = "arena046m";
+  CmmArena arena(opt);
+  CmmVector<uint32_t> v(&arena);
+  v.reserve(4096);
+  for (uint32_t i = 0; i < 4096; ++i) {
+    ASSERT_TRUE(v.TryPushBack(i ^ 0x46u));
+  }
+  uint32_t* data = v.data();
+
+  CmmVector<uint32_t> w(std::move(v));
+  EXPECT_TRUE(v.empty());
+  EXPECT_EQ(v.data(), nullptr);
+  EXPECT_EQ(w.data(), data);
+  w.push_back(w[0]);
+  EXPECT_EQ(w.size(), 4097u);
+  EXPECT_EQ(w[4096], 0x46u);
+  EXPECT_TRUE(w.Invalidate());
+}
+
+}  // namespace
@@ -0,0 +1,342 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "axsys/cmm_budget.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBudget;
+using axsys::CmmBudgetStats;
+using axsys::CmmBuffer;
+using axsys::CmmTokenBudget;
+using axsys::ErrorCode;
+using Clock = std::chrono::steady_clock;
+
+/** Spin until @p n callers are queued in AllocateWait() (or 2 s pass). */
+bool WaitForWaiters(uint32_t n) {
+  const Clock::time_point until = Clock::now() + std::chrono::seconds(2);
+  while (CmmBudget::Stats().waiting < n) {
+    if (Clock::now() > until) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+/**
+ * @brief Case038: An allocation over the limit is refused at once.
+ *
+ * Steps:
+ * - Limit the budget to the current charge + 64 KiB (a small CMM).
+ * - Allocate 48 KiB, then try 32 KiB with Allocate().
+ * Expected:
+ * - 32 KiB: kAllocationFailed at once.
+ * - Stats report the limit and the 48 KiB charged to its token.
+ */
+TEST(CmmBudget, Case038_LimitRefusesAtOnce) {
+  const uint64_t base = CmmBudget::Stats().charged_bytes;
+  CmmBudget::SetLimit(base + 65536);
+
+  CmmBuffer a;
+  CmmBuffer b;
+  ASSERT_TRUE(a.Allocate(49152, CacheMode::kNonCached, "budget038"));
+  auto now = b.Allocate(32768, CacheMode::kNonCached, "budget038b");
+  EXPECT_EQ(now.Code(), ErrorCode::kAllocationFailed);
+
+  const CmmBudgetStats s = CmmBudget::Stats();
+  EXPECT_EQ(s.limit_bytes, base + 65536);
+  EXPECT_EQ(s.charged_bytes, base + 49152);
+  const CmmTokenBudget* t = s.Find("budget038");
+  ASSERT_NE(t, nullptr);
+  EXPECT_EQ(t->charged_bytes, 49152u);
+  EXPECT_EQ(t->quota_bytes, 0u);
+  CmmBudget::SetLimit(0);
+}
+
+/**
+ * @brief Case038t: AllocateWait() times out, then succeeds once freed.
+ *
+ * Steps:
+ * - Budget = current charge + 64 KiB; allocate 48 KiB.
+ * - AllocateWait() 32 KiB with a 30 ms timeout.
+ * - Free the 48 KiB block and AllocateWait() 32 KiB again.
+ * Expected:
+ * - kTimeout after >= 30 ms; Stats count one wait and one timeout, and
+ *   the wait histogram holds a sample of at least 30 ms.
+ * - After the free, the 32 KiB AllocateWait() succeeds.
+ */
+TEST(CmmBudget, Case038t_WaitTimesOut) {
+  const CmmBudgetStats before = CmmBudget::Stats();
+  CmmBudget::SetLimit(before.charged_bytes + 65536);
+
+  CmmBuffer a;
+  CmmBuffer b;
+  ASSERT_TRUE(a.Allocate(49152, CacheMode::kNonCached, "budget038"));
+  const Clock::time_point t0 = Clock::now();
+  auto late = b.AllocateWait(32768, CacheMode::kNonCached, "budget038b", 30);
+  EXPECT_EQ(late.Code(), ErrorCode::kTimeout);
+  EXPECT_GE(Clock::now() - t0, std::chrono::milliseconds(30));
+
+  const CmmBudgetStats s = CmmBudget::Stats();
+  EXPECT_EQ(s.waiting, 0u);
+  EXPECT_EQ(s.waits, before.waits + 1);
+  EXPECT_EQ(s.timeouts, before.timeouts + 1);
+  EXPECT_GE(s.WaitPercentileNs(1.0), 30000000u);
+
+  ASSERT_TRUE(a.Free());
+  EXPECT_TRUE(
+      b.AllocateWait(32768, CacheMode::kNonCached, "budget038b", 30));
+  CmmBudget::SetLimit(0);
+}
+
+/**
+ * @brief Case038q: A token quota caps the token below the limit.
+ *
+ * Steps:
+ * - Budget = current charge + 64 KiB.
+ * - Give token "budget038q" an 8 KiB quota; allocate 16 KiB and 8 KiB
+ *   under it.
+ * Expected:
+ * - 16 KiB refused although the limit allows it, 8 KiB succeeds.
+ * - Stats report the token's charge and quota.
+ */
+TEST(CmmBudget, Case038q_TokenQuota) {
+  const uint64_t base = CmmBudget::Stats().charged_bytes;
+  CmmBudget::SetLimit(base + 65536);
+
+  CmmBudget::SetTokenQuota("budget038q", 8192);
+  CmmBuffer q;
+  auto over = q.Allocate(16384, CacheMode::kNonCached, "budget038q");
+  EXPECT_EQ(over.Code(), ErrorCode::kAllocationFailed);
+  ASSERT_TRUE(q.Allocate(8192, CacheMode::kNonCached, "budget038q"));
+
+  const CmmBudgetStats s = CmmBudget::Stats();
+  EXPECT_EQ(s.charged_bytes, base + 8192);
+  const CmmTokenBudget* tq = s.Find("budget038q");
+  ASSERT_NE(tq, nullptr);
+  EXPECT_EQ(tq->charged_bytes, 8192u);
+  EXPECT_EQ(tq->quota_bytes, 8192u);
+
+  CmmBudget::SetTokenQuota("budget038q", 0);
+  CmmBudget::SetLimit(0);
+}
+
+/**
+ * @brief Case038w: A waiter held by its token quota does not stall others.
+ *
+ * Steps:
+ * - Give token "budget038a" a 64 KiB quota and use all of it.
+ * - A thread AllocateWait()s 32 KiB under "budget038a" (2 s timeout).
+ * - Once it is queued, AllocateWait() 32 KiB under "budget038z" with a
+ *   1 s timeout; then free the 64 KiB block.
+ * Expected:
+ * - The "budget038z" call succeeds well before the first waiter's timeout.
+ * - The "budget038a" waiter succeeds after the free.
+ */
+TEST(CmmBudget, Case038w_QuotaWaiterDoesNotStallOtherTokens) {
+  CmmBudget::SetTokenQuota("budget038a", 65536);
+  CmmBuffer holder;
+  ASSERT_TRUE(holder.Allocate(65536, CacheMode::kNonCached, "budget038a"));
+  std::atomic<bool> got{false};
+  std::thread waiter([&got] {
+    CmmBuffer buf;
+    auto v = buf.AllocateWait(32768, CacheMode::kNonCached, "budget038a",
+                              2000);
+    got.store(static_cast<bool>(v));
+  });
+  ASSERT_TRUE(WaitForWaiters(1));
+
+  const Clock::time_point t0 = Clock::now();
+  CmmBuffer other;
+  EXPECT_TRUE(
+      other.AllocateWait(32768, CacheMode::kNonCached, "budget038z", 1000));
+  EXPECT_LT(Clock::now() - t0, std::chrono::milliseconds(500));
+  EXPECT_FALSE(got.load());
+
+  ASSERT_TRUE(holder.Free());
+  waiter.join();
+  EXPECT_TRUE(got.load());
+  CmmBudget::SetTokenQuota("budget038a", 0);
+}
+
+/**
+ * @brief Case038o: Requests larger than the limit or quota fail at once.
+ *
+ * Steps:
+ * - Give token "budget038o" an 8 KiB quota; AllocateWait() 16 KiB under
+ *   it with a 1 s timeout.
+ * - Remove the quota, set a limit of 8 KiB and repeat.
+ * Expected:
+ * - Both calls return kInvalidArgument without waiting for the timeout.
+ */
+TEST(CmmBudget, Case038o_OversizeFailsAtOnce) {
+  CmmBudget::SetTokenQuota("budget038o", 8192);
+  CmmBuffer buf;
+  const Clock::time_point t0 = Clock::now();
+  auto q = buf.AllocateWait(16384, CacheMode::kNonCached, "budget038o", 1000);
+  EXPECT_EQ(q.Code(), ErrorCode::kInvalidArgument);
+  CmmBudget::SetTokenQuota("budget038o", 0);
+
+  CmmBudget::SetLimit(8192);
+  auto l = buf.AllocateWait(16384, CacheMode::kNonCached, "budget038o", 1000);
+  EXPECT_EQ(l.Code(), ErrorCode::kInvalidArgument);
+  CmmBudget::SetLimit(0);
+  EXPECT_LT(Clock::now() - t0, std::chrono::milliseconds(500));
+}
+
+/**
+ * @brief Case038u: Charges are counted without a limit or quota.
+ *
+ * Steps:
+ * - With no limit set, allocate 24 KiB under token "budget038u", read
+ *   Stats(), then free the block.
+ * Expected:
+ * - The process and token charges include the 24 KiB while allocated and
+ *   drop back after the free.
+ */
+TEST(CmmBudget, Case038u_UnlimitedChargesCounted) {
+  const uint64_t base = CmmBudget::Stats().charged_bytes;
+  CmmBuffer buf;
+  ASSERT_TRUE(buf.Allocate(24576, CacheMode::kNonCached, "budget038u"));
+  CmmBudgetStats s = CmmBudget::Stats();
+  EXPECT_EQ(s.limit_bytes, 0u);
+  EXPECT_EQ(s.charged_bytes, base + 24576);
+  const CmmTokenBudget* t = s.Find("budget038u");
+  ASSERT_NE(t, nullptr);
+  EXPECT_EQ(t->charged_bytes, 24576u);
+
+  ASSERT_TRUE(buf.Free());
+  s = CmmBudget::Stats();
+  EXPECT_EQ(s.charged_bytes, base);
+  t = s.Find("budget038u");
+  ASSERT_NE(t, nullptr);
+  EXPECT_EQ(t->charged_bytes, 0u);
+}
+
+/**
+ * @brief Case038p: Waiters are served in arrival order.
+ *
+ * Steps:
+ * - Budget = current charge + 64 KiB, held entirely by one block. Three
+ *   threads queue one after another for 64 KiB each; release the block.
+ * Expected:
+ * - The queued threads get the block in arrival order.
+ */
+TEST(CmmBudget, Case038p_FifoOrder) {
+  const uint64_t base = CmmBudget::Stats().charged_bytes;
+  CmmBudget::SetLimit(base + 65536);
+  CmmBuffer holder;
+  ASSERT_TRUE(holder.Allocate(65536, CacheMode::kNonCached, "budget038p"));
+  std::mutex mtx;
+  std::vector<int> order;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 3; ++i) {
+    threads.emplace_back([i, &mtx, &order] {
+      CmmBuffer buf;
+      auto v = buf.AllocateWait(65536, CacheMode::kNonCached, "budget038p",
+                                2000);
+      if (!v) return;
+      {
+        std::lock_guard<std::mutex> lk(mtx);
+        order.push_back(i);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    });
+    ASSERT_TRUE(WaitForWaiters(static_cast<uint32_t>(i + 1)));
+  }
+  ASSERT_TRUE(holder.Free());
+  for (auto& th : threads) th.join();
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+  CmmBudget::SetLimit(0);
+}
+
+/**
+ * @brief Case038c: Contending threads never exceed the limit.
+ *
+ * Steps:
+ * - Four threads do 50 AllocateWait()/free cycles of 16 KiB against a
+ *   32 KiB budget while a monitor samples the charge.
+ * Expected:
+ * - Every cycle succeeds and the charge never exceeds the limit; the wait
+ *   histogram counts every call.
+ */
+TEST(CmmBudget, Case038c_ContentionStaysUnderLimit) {
+  const uint64_t base = CmmBudget::Stats().charged_bytes;
+  const uint64_t limit = base + 32768;
+  CmmBudget::SetLimit(limit);
+  const uint64_t waits_before = CmmBudget::Stats().waits;
+  constexpr int kThreads = 4;
+  constexpr int kIters = 50;
+  std::atomic<int> ok{0};
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> max_charged{0};
+  std::thread monitor([&] {
+    while (!done.load()) {
+      const uint64_t c = CmmBudget::Stats().charged_bytes;
+      if (c > max_charged.load()) max_charged.store(c);
+      std::this_thread::yield();
+    }
+  });
+  std::vector<std::thread> workers;
+  for (int i = 0; i < kThreads; ++i) {
+    workers.emplace_back([&ok] {
+      for (int n = 0; n < kIters; ++n) {
+        CmmBuffer buf;
+        auto v = buf.AllocateWait(16384, CacheMode::kNonCached, "budget038c",
+                                  5000);
+        if (!v) continue;
+        ok.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    });
+  }
+  for (auto& th : workers) th.join();
+  done.store(true);
+  monitor.join();
+  EXPECT_EQ(ok.load(), kThreads * kIters);
+  EXPECT_LE(max_charged.load(), limit);
+  const CmmBudgetStats s = CmmBudget::Stats();
+  EXPECT_EQ(s.waits - waits_before, static_cast<uint64_t>(kThreads * kIters));
+  EXPECT_GE(s.WaitPercentileNs(0.99), s.WaitPercentileNs(0.5));
+  CmmBudget::SetLimit(0);
+}
+
+/**
+ * @brief Case038x: AllocateWait() also waits out CMM exhaustion.
+ *
+ * Steps:
+ * - Without a limit, allocate the largest free region of "anonymous";
+ *   a thread waits for the same size; free the region after 30 ms.
+ * Expected:
+ * - The waiter is still queued at 30 ms and succeeds after the free.
+ */
+TEST(CmmBudget, Case038x_WaitsForCmmExhaustion) {
+  uint64_t phys = 0;
+  uint32_t size = 0;
+  ASSERT_TRUE(CmmBuffer::MaxFreeRegion("anonymous", &phys, &size));
+  ASSERT_GT(size, 0u);
+  CmmBuffer hog;
+  ASSERT_TRUE(hog.Allocate(size, CacheMode::kNonCached, "budget038h"));
+  std::atomic<bool> got{false};
+  std::thread waiter([size, &got] {
+    CmmBuffer buf;
+    auto v = buf.AllocateWait(size, CacheMode::kNonCached, "budget038h", 5000);
+    got.store(static_cast<bool>(v));
+  });
+  ASSERT_TRUE(WaitForWaiters(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  EXPECT_FALSE(got.load());
+  EXPECT_EQ(CmmBudget::Stats().waiting, 1u);
+  ASSERT_TRUE(hog.Free());
+  waiter.join();
+  EXPECT_TRUE(got.load());
+}
+
+}  // namespace
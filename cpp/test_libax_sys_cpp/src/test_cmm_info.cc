@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "axsys/cmm_info.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::CmmInfoParser;
+using axsys::CmmLayout;
+using axsys::CmmPartitionLayout;
+using axsys::ErrorCode;
+
+// Captured from an LLM630 board (two partitions, blocks out of order,
+// free gaps of 16 KiB, 1 MiB and the tail of each partition).
+constexpr const char kBoardText[] =
+    "--------------------SDK VERSION-------------------\n"
+    "[Axera version]: ax_cmm V2.26.2 Jun 17 2025 10:12:33 JK\n"
+    "+---PARTITION: Phys(0x80000000, 0x80FFFFFF), Size=16384KB(16MB),    "
+    "NAME=\"anonymous\"\n"
+    " nBlock(Max=3, Cur=3, New=0, Free=0)  nbytes(Max=1130496B(1104KB,1MB),"
+    " Cur=1130496B(1104KB,1MB))\n"
+    "   |-Block: phys(0x80108000, 0x80117FFF), cache =cacheable, "
+    "length=64KB(0MB),    name=\"npu_input\"\n"
+    "   |-Block: phys(0x80000000, 0x80003FFF), cache =non-cacheable, "
+    "length=16KB(0MB),    name=\"vin_raw\"\n"
+    "   |-Block: phys(0x80008000, 0x80107FFF), cache =non-cacheable, "
+    "length=1024KB(1MB),    name=\"a_very_long_token_name_that_is_truncated"
+    "\"\n"
+    "\n"
+    "+---PARTITION: Phys(0x90000000, 0x903FFFFF), Size=4096KB(4MB),    "
+    "NAME=\"dsp\"\n"
+    " nBlock(Max=1, Cur=1, New=0, Free=0)  nbytes(Max=4096B(4KB,0MB), "
+    "Cur=4096B(4KB,0MB))\n"
+    "   |-Block: phys(0x90100000, 0x90100FFF), cache =non-cacheable, "
+    "length=4KB(0MB),    name=\"dsp_fw\"\n"
+    "\n"
+    "---CMM_USE_INFO:\n"
+    " total size=20480KB(20MB),used=1108KB(1MB + 84KB),remain=19372KB(18MB"
+    " + 940KB),partition_number=2,block_number=4\n";
+
+void Parse(CmmInfoParser* parser, const char* text, size_t chunk) {
+  parser->Begin();
+  const size_t len = strlen(text);
+  for (size_t off = 0; off < len; off += chunk) {
+    parser->Feed(text + off, std::min(chunk, len - off));
+  }
+}
+
+/** Checks the layout parsed from kBoardText. */
+void ExpectBoardLayout(const CmmLayout& l) {
+  ASSERT_EQ(l.partitions.size(), 2u);
+
+  const CmmPartitionLayout* a = l.Find("anonymous");
+  ASSERT_NE(a, nullptr);
+  EXPECT_EQ(a->phys, 0x80000000u);
+  EXPECT_EQ(a->size, 16u << 20);
+  ASSERT_EQ(a->blocks.size(), 3u);
+  EXPECT_EQ(a->blocks[0].phys, 0x80000000u);
+  EXPECT_EQ(a->blocks[0].size, 16384u);
+  EXPECT_FALSE(a->blocks[0].cached);
+  EXPECT_STREQ(a->blocks[0].name, "vin_raw");
+  EXPECT_EQ(a->blocks[1].size, 1u << 20);
+  EXPECT_EQ(strlen(a->blocks[1].name), sizeof(a->blocks[1].name) - 1);
+  EXPECT_TRUE(a->blocks[2].cached);
+  EXPECT_STREQ(a->blocks[2].name, "npu_input");
+  EXPECT_EQ(a->used_bytes, 1104u << 10);
+  EXPECT_EQ(a->free_bytes, a->size - a->used_bytes);
+  EXPECT_EQ(a->free_extents, 2u);
+  EXPECT_EQ(a->largest_free, (16u << 20) - 0x118000u);
+  EXPECT_EQ(a->largest_free_phys, 0x80118000u);
+  EXPECT_EQ(a->free_histogram[2], 1u);   // 16 KiB
+  EXPECT_EQ(a->free_histogram[11], 1u);  // 14.9 MiB
+  EXPECT_NEAR(a->fragmentation,
+              16384.0 / static_cast<double>(a->free_bytes), 1e-9);
+  EXPECT_FALSE(a->has_max_free_region);
+
+  const CmmPartitionLayout* d = l.Find("dsp");
+  ASSERT_NE(d, nullptr);
+  ASSERT_EQ(d->blocks.size(), 1u);
+  EXPECT_EQ(d->free_extents, 2u);
+  EXPECT_EQ(d->largest_free, (3u << 20) - 4096u);
+  EXPECT_EQ(d->largest_free_phys, 0x90101000u);
+  EXPECT_EQ(d->free_histogram[8], 1u);  // 1 MiB
+  EXPECT_EQ(d->free_histogram[9], 1u);  // 3 MiB - 4 KiB
+  EXPECT_GT(d->fragmentation, 0.24);
+  EXPECT_LT(d->fragmentation, 0.26);
+
+  EXPECT_TRUE(l.has_totals);
+  EXPECT_EQ(l.total_kb, 20480u);
+  EXPECT_EQ(l.used_kb, 1108u);
+  EXPECT_EQ(l.remain_kb, 19372u);
+  EXPECT_EQ(l.partition_number, 2u);
+  EXPECT_EQ(l.block_number, 4u);
+  EXPECT_EQ(l.Find("missing"), nullptr);
+}
+
+/**
+ * @brief Case037: Parse captured mem_cmm_info text.
+ *
+ * Steps:
+ * - Feed the board capture in one piece.
+ * Expected:
+ * - Two partitions; blocks sorted by address with size, cache mode and
+ *   (truncated) name.
+ * - anonymous: 1104 KiB used, free extents 16 KiB, 0 and the 14.9 MiB tail
+ *   (2 extents), largest at 0x80118000, fragmentation ~0.001.
+ * - dsp: free extents 1 MiB and 3 MiB - 4 KiB, largest at 0x90101000.
+ * - Histogram buckets match the extent sizes; totals parsed.
+ */
+TEST(CmmInfo, Case037_ParseCapturedText) {
+  CmmInfoParser parser;
+  Parse(&parser, kBoardText, sizeof(kBoardText));
+  ASSERT_TRUE(parser.End());
+  ExpectBoardLayout(parser.Layout());
+}
+
+/**
+ * @brief Case037c: Any feeding pattern gives the same layout.
+ *
+ * Steps:
+ * - Feed the board capture one byte at a time, then in 7-byte chunks,
+ *   reusing one parser.
+ * Expected:
+ * - Each pass gives the same layout as Case037.
+ */
+TEST(CmmInfo, Case037c_ChunkedFeed) {
+  CmmInfoParser parser;
+  for (size_t chunk : {size_t{1}, size_t{7}}) {
+    SCOPED_TRACE(chunk);
+    Parse(&parser, kBoardText, chunk);
+    ASSERT_TRUE(parser.End());
+    ExpectBoardLayout(parser.Layout());
+  }
+}
+
+/**
+ * @brief Case037e: Empty input is rejected.
+ *
+ * Steps:
+ * - Begin() then End() with nothing fed.
+ * Expected:
+ * - kInvalidArgument and no partitions.
+ */
+TEST(CmmInfo, Case037e_EmptyInput) {
+  CmmInfoParser parser;
+  parser.Begin();
+  auto empty = parser.End();
+  EXPECT_EQ(empty.Code(), ErrorCode::kInvalidArgument);
+  EXPECT_TRUE(parser.Layout().partitions.empty());
+}
+
+/**
+ * @brief Case037p: The live proc file lists current blocks and gaps.
+ *
+ * Steps:
+ * - Allocate three 64 KiB blocks and free the middle one.
+ * - ReadProc().
+ * Expected:
+ * - "anonymous" lists the two remaining blocks and not the freed one;
+ *   it has a free extent of at least 64 KiB.
+ */
+TEST(CmmInfo, Case037p_ProcListsLiveBlocks) {
+  CmmBuffer a;
+  CmmBuffer b;
+  CmmBuffer c;
+  ASSERT_TRUE(a.Allocate(65536, CacheMode::kNonCached, "info037a"));
+  ASSERT_TRUE(b.Allocate(65536, CacheMode::kNonCached, "info037b"));
+  ASSERT_TRUE(c.Allocate(65536, CacheMode::kNonCached, "info037c"));
+  ASSERT_TRUE(b.Free());
+
+  CmmInfoParser parser;
+  ASSERT_TRUE(parser.ReadProc());
+  const CmmPartitionLayout* p = parser.Layout().Find("anonymous");
+  ASSERT_NE(p, nullptr);
+  int found = 0;
+  for (const auto& blk : p->blocks) {
+    if (strcmp(blk.name, "info037a") == 0) ++found;
+    if (strcmp(blk.name, "info037c") == 0) ++found;
+    EXPECT_STRNE(blk.name, "info037b");
+  }
+  EXPECT_EQ(found, 2);
+  EXPECT_GE(p->free_extents, 1u);
+  EXPECT_GE(p->largest_free, 65536u);
+  EXPECT_LE(p->used_bytes + p->free_bytes, p->size);
+}
+
+/**
+ * @brief Case037m: AX_SYS_MemGetMaxFreeRegionInfo agrees with the text.
+ *
+ * Steps:
+ * - Allocate 64 KiB; ReadProc() and MergeMaxFreeRegion().
+ * Expected:
+ * - MaxFreeRegion reports the same largest extent as the text.
+ */
+TEST(CmmInfo, Case037m_MaxFreeRegionMatchesText) {
+  CmmBuffer a;
+  ASSERT_TRUE(a.Allocate(65536, CacheMode::kNonCached, "info037m"));
+
+  CmmInfoParser parser;
+  ASSERT_TRUE(parser.ReadProc());
+  ASSERT_TRUE(parser.MergeMaxFreeRegion());
+  const CmmPartitionLayout* p = parser.Layout().Find("anonymous");
+  ASSERT_NE(p, nullptr);
+  ASSERT_TRUE(p->has_max_free_region);
+  EXPECT_EQ(p->max_free_region_size, p->largest_free);
+  EXPECT_EQ(p->max_free_region_phys, p->largest_free_phys);
+}
+
+/**
+ * @brief Case037r: Re-reading reuses the parser's storage.
+ *
+ * Steps:
+ * - Allocate 64 KiB; ReadProc() three times.
+ * Expected:
+ * - The block vector's capacity does not grow after the first read.
+ */
+TEST(CmmInfo, Case037r_RereadKeepsCapacity) {
+  CmmBuffer a;
+  ASSERT_TRUE(a.Allocate(65536, CacheMode::kNonCached, "info037r"));
+
+  CmmInfoParser parser;
+  ASSERT_TRUE(parser.ReadProc());
+  const CmmPartitionLayout* p = parser.Layout().Find("anonymous");
+  ASSERT_NE(p, nullptr);
+  const size_t cap = p->blocks.capacity();
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(parser.ReadProc());
+    p = parser.Layout().Find("anonymous");
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(p->blocks.capacity(), cap);
+  }
+}
+
+/**
+ * @brief Case037n: A missing proc file is a system call failure.
+ *
+ * Steps:
+ * - ReadProc() on a missing path.
+ * Expected:
+ * - kSystemCallFailed.
+ */
+TEST(CmmInfo, Case037n_MissingProcFile) {
+  CmmInfoParser parser;
+  auto missing = parser.ReadProc("/nonexistent/mem_cmm_info");
+  EXPECT_EQ(missing.Code(), ErrorCode::kSystemCallFailed);
+}
+
+}  // namespace
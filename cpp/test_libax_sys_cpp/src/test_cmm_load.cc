@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "axsys/cmm_load.hpp"
+#include "axsys/sys.hpp"
+#include "axsys/weight_cache.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::CmmLoadOptions;
+using axsys::ErrorCode;
+
+std::string TempPath(const char* tag) {
+  return "/tmp/axsys_" + std::string(tag) + "_" + std::to_string(getpid());
+}
+
+std::vector<uint8_t> Pattern(size_t size, uint32_t seed) {
+  std::vector<uint8_t> data(size);
+  uint32_t x = seed;
+  for (size_t i = 0; i < size; ++i) {
+    x = x * 1664525u + 1013904223u;
+    data[i] = static_cast<uint8_t>(x >> 24);
+  }
+  return data;
+}
+
+bool WriteFile(const std::string& path, const std::vector<uint8_t>& data) {
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  return fclose(f) == 0 && ok;
+}
+
+/** Map @p buf non-cached and compare it with @p want. */
+bool SameContents(const CmmBuffer& buf, const std::vector<uint8_t>& want) {
+  if (buf.Size() != want.size()) return false;
+  auto v = buf.MapView(0, want.size(), CacheMode::kNonCached);
+  return v && memcmp(v.Value().Data(), want.data(), want.size()) == 0;
+}
+
+/**
+ * @brief Case041: Load through both pipelines with a checksum.
+ *
+ * Steps:
+ * - Write 3 * 64 KiB + 123 bytes of pseudo-random data.
+ * - LoadFileToCmm() with 64 KiB chunks into a cached and a non-cached
+ *   buffer, and with a 5000-byte chunk size, computing the checksum.
+ * - Free each buffer.
+ * Expected:
+ * - Every buffer has the file's size and contents (the cached one read
+ *   through a non-cached mapping, so the flush happened).
+ * - The checksum equals HashWeights() of the data.
+ * - Free() succeeds: no view is left alive.
+ */
+TEST(CmmLoad, Case041_LoadModesAndChecksum) {
+  const std::string path = TempPath("041");
+  const std::vector<uint8_t> data = Pattern(3 * 65536 + 123, 41);
+  ASSERT_TRUE(WriteFile(path, data));
+  const uint64_t want_sum = axsys::HashWeights(data.data(), data.size());
+
+  const size_t chunks[] = {65536, 65536, 5000};
+  const CacheMode modes[] = {CacheMode::kCached, CacheMode::kNonCached,
+                             CacheMode::kCached};
+  for (int i = 0; i < 3; ++i) {
+    uint64_t sum = 0;
+    CmmLoadOptions opt;
+    opt.token = "load041";
+    opt.chunk_size = chunks[i];
+    opt.checksum = &sum;
+    auto r = axsys::LoadFileToCmm(path.c_str(), modes[i], opt);
+    ASSERT_TRUE(r) << r.Message();
+    CmmBuffer buf = r.MoveValue();
+    EXPECT_TRUE(SameContents(buf, data)) << "case " << i;
+    EXPECT_EQ(sum, want_sum) << "case " << i;
+    EXPECT_TRUE(buf.Free()) << "case " << i;
+  }
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case041p: O_DIRECT loads the file's contents.
+ *
+ * Steps:
+ * - Load a 6 MiB file with direct_io and 1 MiB chunks into non-cached
+ *   CMM.
+ * Expected:
+ * - The buffer holds the file's contents (O_DIRECT falls back to
+ *   buffered reads where the filesystem refuses it).
+ */
+TEST(CmmLoad, Case041p_DirectIo) {
+  const std::string path = TempPath("041p");
+  const std::vector<uint8_t> data = Pattern(6 << 20, 7);
+  ASSERT_TRUE(WriteFile(path, data));
+
+  CmmLoadOptions direct;
+  direct.direct_io = true;
+  direct.chunk_size = 1 << 20;
+  auto d = axsys::LoadFileToCmm(path.c_str(), CacheMode::kNonCached, direct);
+  ASSERT_TRUE(d) << d.Message();
+  EXPECT_TRUE(SameContents(d.Value(), data));
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case041d: Default options load the file's contents.
+ *
+ * Steps:
+ * - Load a 6 MiB file into cached CMM without options.
+ * Expected:
+ * - The buffer holds the file's contents.
+ */
+TEST(CmmLoad, Case041d_DefaultOptions) {
+  const std::string path = TempPath("041d");
+  const std::vector<uint8_t> data = Pattern(6 << 20, 7);
+  ASSERT_TRUE(WriteFile(path, data));
+
+  auto plain = axsys::LoadFileToCmm(path.c_str(), CacheMode::kCached);
+  ASSERT_TRUE(plain) << plain.Message();
+  EXPECT_TRUE(SameContents(plain.Value(), data));
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case041e: Empty files, missing files and a zero chunk fail.
+ *
+ * Steps:
+ * - Load an empty file, a missing file, and use a chunk size of 0.
+ * Expected:
+ * - Empty file and chunk size 0: kInvalidArgument; missing file:
+ *   kSystemCallFailed.
+ */
+TEST(CmmLoad, Case041e_Errors) {
+  const std::string empty = TempPath("041e");
+  ASSERT_TRUE(WriteFile(empty, {}));
+  EXPECT_EQ(axsys::LoadFileToCmm(empty.c_str(), CacheMode::kCached).Code(),
+            ErrorCode::kInvalidArgument);
+  unlink(empty.c_str());
+
+  const std::string missing = TempPath("041-missing");
+  EXPECT_EQ(axsys::LoadFileToCmm(missing.c_str(), CacheMode::kCached).Code(),
+            ErrorCode::kSystemCallFailed);
+  CmmLoadOptions zero;
+  zero.chunk_size = 0;
+  EXPECT_EQ(
+      axsys::LoadFileToCmm(missing.c_str(), CacheMode::kCached, zero).Code(),
+      ErrorCode::kInvalidArgument);
+}
+
+}  // namespace
@@ -0,0 +1,371 @@
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "axsys/cmm_parallel.hpp"
+#include "axsys/sys.hpp"
+#include "axsys/trace.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::CmmSlice;
+using axsys::CmmView;
+using axsys::ErrorCode;
+using axsys::ParallelFor;
+using axsys::ParallelOptions;
+using axsys::PartitionView;
+using axsys::SliceAlign;
+
+uintptr_t Addr(const uint8_t* p) { return reinterpret_cast<uintptr_t>(p); }
+
+// Threads of this process, from /proc/self/task.
+size_t ThreadCount() {
+  DIR* d = opendir("/proc/self/task");
+  if (!d) return 0;
+  size_t n = 0;
+  while (const dirent* e = readdir(d)) n += e->d_name[0] != '.' ? 1 : 0;
+  closedir(d);
+  return n;
+}
+
+// Slices cover [offset, offset + size) in order without gaps.
+void ExpectTiled(const std::vector<CmmSlice>& slices, size_t offset,
+                 size_t size) {
+  size_t next = offset;
+  for (size_t i = 0; i < slices.size(); ++i) {
+    EXPECT_EQ(slices[i].index, i);
+    EXPECT_EQ(slices[i].offset, next);
+    EXPECT_GT(slices[i].size, 0u);
+    next += slices[i].size;
+  }
+  EXPECT_EQ(next, offset + size);
+}
+
+constexpr size_t kRange = 1 << 20;
+constexpr size_t kTotal = kRange + 4096;
+
+// Four threads, one-byte minimum slice, cache-line aligned.
+ParallelOptions FourThreads() {
+  ParallelOptions opt;
+  opt.threads = 4;
+  opt.min_slice = 1;
+  opt.align = SliceAlign::kCacheLine;
+  return opt;
+}
+
+/**
+ * @brief Case050: Partitions are aligned to the requested boundary.
+ *
+ * Steps:
+ * - Allocate a cached 1 MiB + 4 KiB buffer. PartitionView() of 1 MiB at
+ *   offset 10 for 4 threads (min_slice 1), line and page aligned.
+ * Expected:
+ * - 4 slices tiling the range; every inner boundary on a 64-byte (page)
+ *   boundary of the mapping.
+ */
+TEST(CmmParallel, Case050_PartitionAligned) {
+  CmmBuffer buf;
+  auto v = buf.Allocate(kTotal, CacheMode::kCached, "par050");
+  ASSERT_TRUE(v);
+  CmmView view = v.MoveValue();
+  const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  ParallelOptions opt = FourThreads();
+  for (SliceAlign align : {SliceAlign::kCacheLine, SliceAlign::kPage}) {
+    opt.align = align;
+    const size_t a = align == SliceAlign::kPage ? page : 64;
+    const std::vector<CmmSlice> slices = PartitionView(view, 10, kRange, opt);
+    ASSERT_EQ(slices.size(), 4u);
+    ExpectTiled(slices, 10, kRange);
+    for (size_t i = 1; i < slices.size(); ++i) {
+      EXPECT_EQ(Addr(slices[i].data) % a, 0u);
+      EXPECT_EQ(slices[i].data,
+                static_cast<uint8_t*>(view.Data()) + slices[i].offset);
+    }
+  }
+  view.Reset();
+  EXPECT_TRUE(buf.Free());
+}
+
+/**
+ * @brief Case050s: Small ranges get fewer slices than threads.
+ *
+ * Steps:
+ * - PartitionView() of 128 bytes at offset 0 for 8 threads (min_slice 1),
+ *   and of 1000 bytes for 8 threads with the default min_slice.
+ * Expected:
+ * - 2 slices (the cuts round up to the line); 1 slice.
+ */
+TEST(CmmParallel, Case050s_SmallRangeFewerSlices) {
+  CmmBuffer buf;
+  auto v = buf.Allocate(4096, CacheMode::kCached, "par050s");
+  ASSERT_TRUE(v);
+  CmmView view = v.MoveValue();
+  ParallelOptions eight = FourThreads();
+  eight.threads = 8;
+  const std::vector<CmmSlice> tiny = PartitionView(view, 0, 128, eight);
+  EXPECT_EQ(tiny.size(), 2u);
+  ExpectTiled(tiny, 0, 128);
+  eight.min_slice = ParallelOptions().min_slice;
+  EXPECT_EQ(PartitionView(view, 0, 1000, eight).size(), 1u);
+  view.Reset();
+  EXPECT_TRUE(buf.Free());
+}
+
+/**
+ * @brief Case050f: ParallelFor() runs every slice and flushes once each.
+ *
+ * Steps:
+ * - With tracing, ParallelFor() 4 threads over 1 MiB at offset 10 of a
+ *   cached buffer; each kernel fills its slice with index + 1 and
+ *   records its thread.
+ * Expected:
+ * - Every byte holds its slice's index + 1; slice 0 ran on the caller;
+ *   4 MflushCache calls whose sizes sum to 1 MiB.
+ */
+TEST(CmmParallel, Case050f_FillAndFlushPerWorker) {
+  CmmBuffer buf;
+  auto v = buf.Allocate(kTotal, CacheMode::kCached, "par050f");
+  ASSERT_TRUE(v);
+  CmmView view = v.MoveValue();
+  std::mutex mtx;
+  std::vector<std::thread::id> ids(4);
+  std::vector<CmmSlice> seen;
+  auto fill = [&](const CmmSlice& s) {
+    memset(s.data, static_cast<int>(s.index + 1), s.size);
+    std::lock_guard<std::mutex> lk(mtx);
+    ids[s.index] = std::this_thread::get_id();
+    seen.push_back(s);
+  };
+#if AXSYS_TRACE
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+#endif
+  ASSERT_TRUE(ParallelFor(&view, 10, kRange, fill, FourThreads()));
+#if AXSYS_TRACE
+  axsys::trace::SetEnabled(false);
+  size_t flushes = 0;
+  uint64_t flushed = 0;
+  for (const auto& e : axsys::trace::Snapshot()) {
+    if (e.call != axsys::trace::Call::kMflushCache) continue;
+    ++flushes;
+    flushed += e.bytes;
+  }
+  EXPECT_EQ(flushes, 4u);
+  EXPECT_EQ(flushed, kRange);
+  axsys::trace::Clear();
+#endif
+  ASSERT_EQ(seen.size(), 4u);
+  std::sort(seen.begin(), seen.end(),
+            [](const CmmSlice& a, const CmmSlice& b) {
+              return a.offset < b.offset;
+            });
+  ExpectTiled(seen, 10, kRange);
+  for (const CmmSlice& s : seen) {
+    for (size_t i = 0; i < s.size; i += 97) {
+      ASSERT_EQ(s.data[i], s.index + 1);
+    }
+  }
+  EXPECT_EQ(ids[0], std::this_thread::get_id());
+  view.Reset();
+  EXPECT_TRUE(buf.Free());
+}
+
+/**
+ * @brief Case050e: ParallelFor() argument checks.
+ *
+ * Steps:
+ * - ParallelFor() without kernel, past the view, on an unmapped view.
+ * Expected:
+ * - kInvalidArgument, kOutOfRange, kInvalidArgument.
+ */
+TEST(CmmParallel, Case050e_ParallelForChecks) {
+  CmmBuffer buf;
+  auto v = buf.Allocate(kTotal, CacheMode::kCached, "par050e");
+  ASSERT_TRUE(v);
+  CmmView view = v.MoveValue();
+  auto noop = [](const CmmSlice&) {};
+  EXPECT_EQ(ParallelFor(&view, axsys::SliceKernel()).Code(),
+            ErrorCode::kInvalidArgument);
+  EXPECT_EQ(ParallelFor(&view, kTotal - 8, 16, noop).Code(),
+            ErrorCode::kOutOfRange);
+  CmmView empty;
+  EXPECT_EQ(ParallelFor(&empty, noop).Code(), ErrorCode::kInvalidArgument);
+  view.Reset();
+  EXPECT_TRUE(buf.Free());
+}
+
+/**
+ * @brief Case050r: RunTasks() runs every index once.
+ *
+ * Steps:
+ * - RunTasks(4) recording which thread ran each index.
+ * Expected:
+ * - Every index runs once, index 0 on the caller.
+ */
+TEST(CmmParallel, Case050r_RunTasksEveryIndexOnce) {
+  std::mutex mtx;
+  std::vector<std::thread::id> ids(4);
+  std::vector<int> runs(4, 0);
+  axsys::RunTasks(4, [&](unsigned i) {
+    std::lock_guard<std::mutex> lk(mtx);
+    ids[i] = std::this_thread::get_id();
+    ++runs[i];
+  });
+  EXPECT_EQ(runs, (std::vector<int>{1, 1, 1, 1}));
+  EXPECT_EQ(ids[0], std::this_thread::get_id());
+}
+
+/**
+ * @brief Case050w: RunTasks() reuses its workers.
+ *
+ * Steps:
+ * - RunTasks(4) once; count the process's threads; run RunTasks(4) 50
+ *   more times.
+ * Expected:
+ * - 200 tasks ran; the thread count does not grow over the 50 calls.
+ */
+TEST(CmmParallel, Case050w_RunTasksReusesWorkers) {
+  axsys::RunTasks(4, [](unsigned) {});
+  const size_t threads = ThreadCount();
+  std::atomic<unsigned> total{0};
+  for (int n = 0; n < 50; ++n) {
+    axsys::RunTasks(4, [&total](unsigned) { total.fetch_add(1); });
+  }
+  EXPECT_EQ(total.load(), 200u);
+  EXPECT_EQ(ThreadCount(), threads);
+}
+
+/**
+ * @brief Case050x: The worker pool is capped at the CPU count.
+ *
+ * Steps:
+ * - RunTasks(64) whose tasks sleep 100 us and record their thread.
+ * Expected:
+ * - 64 tasks ran on at most hardware_concurrency() workers plus the
+ *   caller; the process gained at most that many threads.
+ */
+TEST(CmmParallel, Case050x_RunTasksPoolCapped) {
+  const size_t cap = std::max(1u, std::thread::hardware_concurrency());
+  const size_t threads = ThreadCount();
+  std::mutex mtx;
+  std::set<std::thread::id> ids;
+  std::atomic<unsigned> total{0};
+  axsys::RunTasks(64, [&](unsigned) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+    total.fetch_add(1);
+    std::lock_guard<std::mutex> lk(mtx);
+    ids.insert(std::this_thread::get_id());
+  });
+  EXPECT_EQ(total.load(), 64u);
+  EXPECT_LE(ids.size(), cap + 1);
+  EXPECT_LE(ThreadCount(), threads + cap);
+}
+
+/**
+ * @brief Case050n: RunTasks() may be called from inside a task.
+ *
+ * Steps:
+ * - RunTasks(3) whose tasks each run RunTasks(3) and count the inner
+ *   tasks.
+ * Expected:
+ * - The nested calls finish and run 9 inner tasks.
+ */
+TEST(CmmParallel, Case050n_NestedRunTasks) {
+  std::atomic<unsigned> inner{0};
+  axsys::RunTasks(3, [&inner](unsigned) {
+    axsys::RunTasks(3, [&inner](unsigned) { inner.fetch_add(1); });
+  });
+  EXPECT_EQ(inner.load(), 9u);
+}
+
+/**
+ * @brief Case050p: ParallelFor() over a whole view with default threads.
+ *
+ * Steps:
+ * - Allocate a cached 3 MiB + 12 bytes buffer; ParallelFor() over the
+ *   whole view with default options writing the byte offset pattern.
+ * Expected:
+ * - Every byte holds (offset & 0xff).
+ */
+TEST(CmmParallel, Case050p_WholeView) {
+  CmmBuffer buf;
+  const size_t total = (3 << 20) + 12;
+  auto v = buf.Allocate(total, CacheMode::kCached, "par050p");
+  ASSERT_TRUE(v);
+  CmmView view = v.MoveValue();
+  auto pattern = [](const CmmSlice& s) {
+    for (size_t i = 0; i < s.size; ++i) {
+      s.data[i] = static_cast<uint8_t>(s.offset + i);
+    }
+  };
+  ASSERT_TRUE(ParallelFor(&view, pattern));
+  const uint8_t* d = static_cast<const uint8_t*>(view.Data());
+  for (size_t i = 0; i < total; i += 61) {
+    ASSERT_EQ(d[i], static_cast<uint8_t>(i));
+  }
+  EXPECT_EQ(d[total - 1], static_cast<uint8_t>(total - 1));
+  view.Reset();
+  EXPECT_TRUE(buf.Free());
+}
+
+/**
+ * @brief Case050c: No flush with flush = false or on non-cached views.
+ *
+ * Steps:
+ * - With tracing, ParallelFor() 2 threads with flush = false over a
+ *   cached 3 MiB + 12 bytes view; then with flush = true over a
+ *   non-cached 1 MiB view of the same buffer.
+ * Expected:
+ * - No MflushCache call in either case; the kernels covered both views.
+ */
+TEST(CmmParallel, Case050c_NoFlushWhenNotNeeded) {
+  CmmBuffer buf;
+  const size_t total = (3 << 20) + 12;
+  auto v = buf.Allocate(total, CacheMode::kCached, "par050c");
+  ASSERT_TRUE(v);
+  CmmView view = v.MoveValue();
+  auto nc = buf.MapView(0, 1 << 20, CacheMode::kNonCached);
+  ASSERT_TRUE(nc);
+  CmmView plain = nc.MoveValue();
+  ParallelOptions opt;
+  opt.threads = 2;
+  opt.flush = false;
+  size_t bytes = 0;
+  std::mutex mtx;
+  auto count = [&](const CmmSlice& s) {
+    std::lock_guard<std::mutex> lk(mtx);
+    bytes += s.size;
+  };
+#if AXSYS_TRACE
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+#endif
+  ASSERT_TRUE(ParallelFor(&view, count, opt));
+  opt.flush = true;
+  ASSERT_TRUE(ParallelFor(&plain, count, opt));
+#if AXSYS_TRACE
+  axsys::trace::SetEnabled(false);
+  for (const auto& e : axsys::trace::Snapshot()) {
+    EXPECT_NE(e.call, axsys::trace::Call::kMflushCache);
+  }
+  axsys::trace::Clear();
+#endif
+  EXPECT_EQ(bytes, total + (1 << 20));
+  plain.Reset();
+  view.Reset();
+  EXPECT_TRUE(buf.Free());
+}
+
+}  // namespace
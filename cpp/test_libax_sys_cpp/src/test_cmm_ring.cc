@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "axsys/cmm_ring.hpp"
+#include "axsys/cmm_stats.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CmmRing;
+using axsys::CmmRingBacking;
+using axsys::CmmRingOptions;
+using axsys::CmmStats;
+using axsys::ErrorCode;
+
+CmmRingOptions MemfdOptions() {
+  CmmRingOptions opt;
+  opt.backing = CmmRingBacking::kMemfd;
+  return opt;
+}
+
+/**
+ * @brief Case045: The ring is mapped twice back to back.
+ *
+ * Steps:
+ * - Create a 64 KiB memfd-backed ring; write one byte at Data()[0].
+ * Expected:
+ * - Data()[Capacity()] reads the byte written at Data()[0].
+ * - A memfd ring has no physical address.
+ */
+TEST(CmmRing, Case045_MirroredMapping) {
+  CmmRing ring;
+  ASSERT_TRUE(ring.Create(65536, MemfdOptions()));
+  uint8_t* base = static_cast<uint8_t*>(ring.Data());
+  base[0] = 0x45;
+  EXPECT_EQ(base[ring.Capacity()], 0x45);
+  EXPECT_EQ(ring.PhysOf(base), 0u);
+  ASSERT_TRUE(ring.Destroy());
+}
+
+/**
+ * @brief Case045w: A record across the end is one contiguous span.
+ *
+ * Steps:
+ * - Create a 64 KiB memfd-backed ring; commit and consume 60000 bytes.
+ * - Reserve() 10000 bytes, fill them with a pattern and Commit(); Peek()
+ *   and Consume() them.
+ * Expected:
+ * - The reservation starts at offset 60000 and runs past the end of the
+ *   first mapping; Peek() returns the 10000 bytes as one span equal to
+ *   the pattern, and its last 4464 bytes are at the start of the ring.
+ * - Once consumed, Peek() returns nullptr and 0 bytes.
+ */
+TEST(CmmRing, Case045w_SpanAcrossEnd) {
+  CmmRing ring;
+  ASSERT_TRUE(ring.Create(65536, MemfdOptions()));
+  uint8_t* base = static_cast<uint8_t*>(ring.Data());
+
+  ASSERT_NE(ring.Reserve(60000), nullptr);
+  ring.Commit(60000);
+  EXPECT_EQ(ring.Readable(), 60000u);
+  ring.Consume(60000);
+
+  uint8_t* w = static_cast<uint8_t*>(ring.Reserve(10000));
+  ASSERT_EQ(w, base + 60000);
+  for (size_t i = 0; i < 10000; ++i) w[i] = static_cast<uint8_t>(i * 7);
+  ring.Commit(10000);
+  EXPECT_EQ(ring.Writable(), 65536u - 10000);
+
+  size_t avail = 0;
+  const uint8_t* r = static_cast<const uint8_t*>(ring.Peek(&avail));
+  ASSERT_EQ(avail, 10000u);
+  ASSERT_EQ(r, base + 60000);
+  for (size_t i = 0; i < 10000; ++i) {
+    ASSERT_EQ(r[i], static_cast<uint8_t>(i * 7)) << i;
+  }
+  EXPECT_EQ(base[0], static_cast<uint8_t>(5536 * 7));
+  EXPECT_EQ(base[4463], static_cast<uint8_t>(9999 * 7));
+  ring.Consume(avail);
+  EXPECT_EQ(ring.Peek(&avail), nullptr);
+  EXPECT_EQ(avail, 0u);
+  ASSERT_TRUE(ring.Destroy());
+}
+
+/**
+ * @brief Case045f: Reserve() refuses more than Writable().
+ *
+ * Steps:
+ * - Create a 64 KiB memfd-backed ring and commit 10000 bytes.
+ * - Reserve() one byte more than Writable(), then exactly Writable().
+ * Expected:
+ * - nullptr, then a valid pointer.
+ */
+TEST(CmmRing, Case045f_ReserveBeyondWritable) {
+  CmmRing ring;
+  ASSERT_TRUE(ring.Create(65536, MemfdOptions()));
+  ASSERT_NE(ring.Reserve(10000), nullptr);
+  ring.Commit(10000);
+  EXPECT_EQ(ring.Reserve(65536 - 10000 + 1), nullptr);
+  EXPECT_NE(ring.Reserve(65536 - 10000), nullptr);
+  ASSERT_TRUE(ring.Destroy());
+}
+
+/**
+ * @brief Case045c: Flush() accepts spans of the ring only.
+ *
+ * Steps:
+ * - Commit a 10000-byte record to a memfd ring; Flush() its span; Flush()
+ *   a span outside the ring.
+ * Expected:
+ * - Flush() succeeds (no cache to maintain); kOutOfRange.
+ */
+TEST(CmmRing, Case045c_FlushChecksRange) {
+  CmmRing ring;
+  ASSERT_TRUE(ring.Create(65536, MemfdOptions()));
+  uint8_t* base = static_cast<uint8_t*>(ring.Data());
+  ASSERT_NE(ring.Reserve(10000), nullptr);
+  ring.Commit(10000);
+  size_t avail = 0;
+  const void* r = ring.Peek(&avail);
+  ASSERT_NE(r, nullptr);
+  EXPECT_TRUE(ring.Flush(r, avail));
+  EXPECT_EQ(ring.Flush(base + 2 * 65536, 16).Code(), ErrorCode::kOutOfRange);
+  ASSERT_TRUE(ring.Destroy());
+}
+
+/**
+ * @brief Case045p: Records stream intact between two threads.
+ *
+ * Steps:
+ * - Stream 16 MiB of records (8-byte header with length and sequence,
+ *   then a sequence-derived payload of 1..3000 bytes) from a producer
+ *   thread through a 64 KiB ring; the consumer checks each record in
+ *   place.
+ * Expected:
+ * - Every record arrives in order and intact, read as one span.
+ */
+TEST(CmmRing, Case045p_ProducerConsumer) {
+  CmmRing ring;
+  ASSERT_TRUE(ring.Create(65536, MemfdOptions()));
+  const uint64_t total = 16u << 20;
+
+  std::thread producer([&ring, total] {
+    uint64_t sent = 0;
+    for (uint32_t seq = 0; sent < total; ++seq) {
+      const uint32_t len = 1 + (seq * 2654435761u) % 3000;
+      uint8_t* p = nullptr;
+      while ((p = static_cast<uint8_t*>(ring.Reserve(8 + len))) == nullptr) {
+        std::this_thread::yield();
+      }
+      memcpy(p, &len, 4);
+      memcpy(p + 4, &seq, 4);
+      for (uint32_t i = 0; i < len; ++i) {
+        p[8 + i] = static_cast<uint8_t>(seq + i);
+      }
+      ring.Commit(8 + len);
+      sent += 8 + len;
+    }
+  });
+
+  uint64_t received = 0;
+  uint32_t expect_seq = 0;
+  size_t bad = 0;
+  while (received < total) {
+    size_t avail = 0;
+    const uint8_t* p = static_cast<const uint8_t*>(ring.Peek(&avail));
+    size_t used = 0;
+    while (avail - used >= 8) {
+      uint32_t len = 0;
+      uint32_t seq = 0;
+      memcpy(&len, p + used, 4);
+      memcpy(&seq, p + used + 4, 4);
+      if (avail - used < 8 + len) break;
+      if (seq != expect_seq++) ++bad;
+      for (uint32_t i = 0; i < len; ++i) {
+        if (p[used + 8 + i] != static_cast<uint8_t>(seq + i)) ++bad;
+      }
+      used += 8 + len;
+    }
+    if (used == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    ring.Consume(used);
+    received += used;
+  }
+  producer.join();
+  EXPECT_EQ(bad, 0u);
+  EXPECT_EQ(ring.Readable(), 0u);
+}
+
+/**
+ * @brief Case045i: Create() checks its size and state.
+ *
+ * Steps:
+ * - Create with 1000 bytes; Create a 64 KiB ring twice.
+ * Expected:
+ * - kInvalidArgument, kAlreadyInitialized.
+ */
+TEST(CmmRing, Case045i_CreateChecks) {
+  CmmRing small;
+  EXPECT_EQ(small.Create(1000, MemfdOptions()).Code(),
+            ErrorCode::kInvalidArgument);
+  CmmRing ring;
+  ASSERT_TRUE(ring.Create(65536, MemfdOptions()));
+  EXPECT_EQ(ring.Create(65536, MemfdOptions()).Code(),
+            ErrorCode::kAlreadyInitialized);
+}
+
+/**
+ * @brief Case045s: A missing sysmap device fails without leaking CMM.
+ *
+ * Steps:
+ * - Create a kSysmap ring on a device path that does not exist (token
+ *   "ring045p").
+ * Expected:
+ * - kSystemCallFailed with no CMM left allocated under the token.
+ */
+TEST(CmmRing, Case045s_MissingSysmapDevice) {
+  CmmRingOptions sysmap;
+  sysmap.device = "/nonexistent/ax_sysmap";
+  sysmap.token = "ring045p";
+  CmmRing board;
+  EXPECT_EQ(board.Create(65536, sysmap).Code(), ErrorCode::kSystemCallFailed);
+  EXPECT_EQ(CmmStats::Snapshot().Find("ring045p")->live_bytes, 0u);
+}
+
+}  // namespace
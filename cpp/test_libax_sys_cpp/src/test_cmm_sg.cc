@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "axsys/cmm_sg.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::CmmSegment;
+using axsys::CmmSgBuffer;
+using axsys::CmmSgCounters;
+using axsys::CmmSgOptions;
+using axsys::ErrorCode;
+
+constexpr size_t kMiB = 1 << 20;
+
+std::vector<uint8_t> Pattern(size_t size, uint32_t seed) {
+  std::vector<uint8_t> data(size);
+  uint32_t x = seed;
+  for (size_t i = 0; i < size; ++i) {
+    x = x * 1664525u + 1013904223u;
+    data[i] = static_cast<uint8_t>(x >> 24);
+  }
+  return data;
+}
+
+/**
+ * Fill the CMM with @p block sized allocations, then free every other
+ * one: plenty of free memory, no free extent longer than @p block.
+ */
+std::vector<CmmBuffer> Fragment(size_t block) {
+  std::vector<CmmBuffer> all;
+  for (;;) {
+    CmmBuffer b;
+    auto v = b.Allocate(block, CacheMode::kNonCached, "sg044_fill");
+    if (!v) break;
+    v.Value().Reset();
+    all.push_back(std::move(b));
+  }
+  std::vector<CmmBuffer> kept;
+  for (size_t i = 0; i < all.size(); ++i) {
+    if (i % 2 == 0) {
+      kept.push_back(std::move(all[i]));
+    } else {
+      (void)all[i].Free();
+    }
+  }
+  return kept;
+}
+
+/**
+ * @brief Case044: Fallback to segments in a fragmented CMM.
+ *
+ * Steps:
+ * - Fragment the CMM into free 8 MiB extents.
+ * - Allocate 40 MiB (cached) plainly and through CmmSgBuffer.
+ * Expected:
+ * - A plain CmmBuffer::Allocate() of 40 MiB fails; CmmSgBuffer succeeds
+ *   with 5 or more segments of at most 8 MiB laid out back to back, and
+ *   Counters() counts one fallback with that many segments.
+ */
+TEST(CmmSg, Case044_FragmentedFallback) {
+  std::vector<CmmBuffer> held = Fragment(8 * kMiB);
+  ASSERT_GT(held.size(), 8u);
+  {
+    CmmBuffer big;
+    EXPECT_FALSE(big.Allocate(40 * kMiB, CacheMode::kCached, "sg044"));
+  }
+  const CmmSgCounters before = CmmSgBuffer::Counters();
+
+  CmmSgBuffer sg;
+  auto r = sg.Allocate(40 * kMiB, CacheMode::kCached, "sg044");
+  ASSERT_TRUE(r) << r.Message();
+  EXPECT_FALSE(sg.Contiguous());
+  EXPECT_GE(sg.Segments().size(), 5u);
+  size_t expect_offset = 0;
+  for (const CmmSegment& s : sg) {
+    EXPECT_EQ(s.offset, expect_offset);
+    EXPECT_LE(s.size, 8 * kMiB);
+    expect_offset += s.size;
+  }
+  EXPECT_EQ(expect_offset, 40 * kMiB);
+  const CmmSgCounters after = CmmSgBuffer::Counters();
+  EXPECT_EQ(after.fallbacks, before.fallbacks + 1);
+  EXPECT_EQ(after.segments, before.segments + sg.Segments().size());
+
+  ASSERT_TRUE(sg.Free());
+  for (CmmBuffer& b : held) ASSERT_TRUE(b.Free());
+}
+
+/**
+ * @brief Case044d: Data round-trips through a segmented buffer.
+ *
+ * Steps:
+ * - Fragment the CMM into free 8 MiB extents; allocate 40 MiB (cached)
+ *   through CmmSgBuffer.
+ * - CopyIn a pattern, Flush(), Invalidate(), CopyOut and compare.
+ * - Allocate a contiguous 5 MiB buffer and CopyFrom() the middle of the
+ *   segmented one into it.
+ * Expected:
+ * - The data round-trips; the copy reads the same bytes.
+ */
+TEST(CmmSg, Case044d_SegmentedDataRoundTrip) {
+  std::vector<CmmBuffer> held = Fragment(8 * kMiB);
+  ASSERT_GT(held.size(), 8u);
+  CmmSgBuffer sg;
+  auto r = sg.Allocate(40 * kMiB, CacheMode::kCached, "sg044d");
+  ASSERT_TRUE(r) << r.Message();
+  ASSERT_FALSE(sg.Contiguous());
+
+  const std::vector<uint8_t> data = Pattern(40 * kMiB, 44);
+  ASSERT_TRUE(sg.CopyIn(0, data.data(), data.size()));
+  ASSERT_TRUE(sg.Flush());
+  std::vector<uint8_t> back(data.size());
+  ASSERT_TRUE(sg.Invalidate());
+  ASSERT_TRUE(sg.CopyOut(0, back.data(), back.size()));
+  EXPECT_EQ(back, data);
+
+  CmmSgBuffer flat;
+  ASSERT_TRUE(flat.Allocate(5 * kMiB, CacheMode::kNonCached, "sg044d"));
+  EXPECT_TRUE(flat.Contiguous());
+  ASSERT_TRUE(flat.CopyFrom(0, sg, 6 * kMiB, 5 * kMiB));
+  std::vector<uint8_t> mid(5 * kMiB);
+  ASSERT_TRUE(flat.CopyOut(0, mid.data(), mid.size()));
+  EXPECT_EQ(memcmp(mid.data(), data.data() + 6 * kMiB, mid.size()), 0);
+
+  ASSERT_TRUE(sg.Free());
+  ASSERT_TRUE(flat.Free());
+  for (CmmBuffer& b : held) ASSERT_TRUE(b.Free());
+}
+
+/**
+ * @brief Case044r: Ranges() splits at segment borders.
+ *
+ * Steps:
+ * - Fragment the CMM into free 8 MiB extents; allocate 40 MiB through
+ *   CmmSgBuffer; take Ranges() of 300 bytes across the first border.
+ * Expected:
+ * - Two ranges of 100 and 200 bytes starting at phys/virt + offset of
+ *   their segment.
+ */
+TEST(CmmSg, Case044r_RangesCrossSegments) {
+  std::vector<CmmBuffer> held = Fragment(8 * kMiB);
+  ASSERT_GT(held.size(), 8u);
+  CmmSgBuffer sg;
+  auto r = sg.Allocate(40 * kMiB, CacheMode::kCached, "sg044r");
+  ASSERT_TRUE(r) << r.Message();
+  ASSERT_GE(sg.Segments().size(), 2u);
+
+  const CmmSegment& first = sg.Segments()[0];
+  auto ranges = sg.Ranges(first.size - 100, 300);
+  ASSERT_TRUE(ranges);
+  ASSERT_EQ(ranges.Value().size(), 2u);
+  EXPECT_EQ(ranges.Value()[0].phys, first.phys + first.size - 100);
+  EXPECT_EQ(ranges.Value()[0].size, 100u);
+  EXPECT_EQ(ranges.Value()[1].phys, sg.Segments()[1].phys);
+  EXPECT_EQ(ranges.Value()[1].virt, sg.Segments()[1].virt);
+  EXPECT_EQ(ranges.Value()[1].size, 200u);
+
+  ASSERT_TRUE(sg.Free());
+  for (CmmBuffer& b : held) ASSERT_TRUE(b.Free());
+}
+
+/**
+ * @brief Case044m: A minimum segment larger than any extent fails.
+ *
+ * Steps:
+ * - Fragment the CMM into free 8 MiB extents; allocate 40 MiB with
+ *   min_segment 16 MiB.
+ * Expected:
+ * - kAllocationFailed, counted as a failure; the buffer stays empty.
+ */
+TEST(CmmSg, Case044m_MinSegmentTooLarge) {
+  std::vector<CmmBuffer> held = Fragment(8 * kMiB);
+  ASSERT_GT(held.size(), 8u);
+  const CmmSgCounters before = CmmSgBuffer::Counters();
+
+  CmmSgOptions coarse;
+  coarse.min_segment = 16 * kMiB;
+  CmmSgBuffer fail;
+  EXPECT_EQ(fail.Allocate(40 * kMiB, CacheMode::kCached, "sg044m", coarse)
+                .Code(),
+            ErrorCode::kAllocationFailed);
+  EXPECT_EQ(CmmSgBuffer::Counters().failures, before.failures + 1);
+  EXPECT_EQ(fail.Size(), 0u);
+
+  for (CmmBuffer& b : held) ASSERT_TRUE(b.Free());
+}
+
+/**
+ * @brief Case044p: An allocation that fits takes the contiguous path.
+ *
+ * Steps:
+ * - Allocate 3 MiB + 5 bytes non-cached; write through the segment list
+ *   and read the tail back with CopyOut(); Free().
+ * Expected:
+ * - One segment covering the buffer; Counters().contiguous grows by one.
+ * - The tail reads the written bytes; Size() is 0 after Free().
+ */
+TEST(CmmSg, Case044p_ContiguousPath) {
+  const CmmSgCounters before = CmmSgBuffer::Counters();
+  CmmSgBuffer sg;
+  const size_t size = 3 * kMiB + 5;
+  ASSERT_TRUE(sg.Allocate(size, CacheMode::kNonCached, "sg044p"));
+  EXPECT_TRUE(sg.Contiguous());
+  ASSERT_EQ(sg.Segments().size(), 1u);
+  EXPECT_EQ(sg.Segments()[0].size, size);
+  EXPECT_EQ(sg.Size(), size);
+  EXPECT_EQ(CmmSgBuffer::Counters().contiguous, before.contiguous + 1);
+  memset(sg.Segments()[0].virt, 0x5a, size);
+  uint8_t tail[5] = {};
+  ASSERT_TRUE(sg.CopyOut(size - 5, tail, 5));
+  EXPECT_EQ(tail[4], 0x5a);
+  ASSERT_TRUE(sg.Free());
+  EXPECT_EQ(sg.Size(), 0u);
+}
+
+/**
+ * @brief Case044o: Accesses past the end are rejected.
+ *
+ * Steps:
+ * - Allocate 3 MiB + 5 bytes, then Allocate again.
+ * - CopyIn/CopyOut/Ranges past the end; Flush with an offset past the end.
+ * Expected:
+ * - kAlreadyInitialized; kOutOfRange for the ranges; Flush() past the
+ *   end succeeds doing nothing.
+ */
+TEST(CmmSg, Case044o_OutOfRange) {
+  CmmSgBuffer sg;
+  const size_t size = 3 * kMiB + 5;
+  ASSERT_TRUE(sg.Allocate(size, CacheMode::kNonCached, "sg044o"));
+  uint8_t tail[5] = {};
+  EXPECT_EQ(sg.Allocate(size, CacheMode::kNonCached, "sg044o").Code(),
+            ErrorCode::kAlreadyInitialized);
+  EXPECT_EQ(sg.CopyIn(size - 4, tail, 5).Code(), ErrorCode::kOutOfRange);
+  EXPECT_EQ(sg.CopyOut(size + 1, tail, 0).Code(), ErrorCode::kOutOfRange);
+  EXPECT_EQ(sg.Ranges(0, size + 1).Code(), ErrorCode::kOutOfRange);
+  EXPECT_TRUE(sg.Flush(size + 100));
+  ASSERT_TRUE(sg.Free());
+}
+
+/**
+ * @brief Case044i: Invalid sizes and options are rejected.
+ *
+ * Steps:
+ * - Allocate 0 bytes; allocate with max_segments 0.
+ * Expected:
+ * - kInvalidArgument for both.
+ */
+TEST(CmmSg, Case044i_InvalidArguments) {
+  CmmSgBuffer bad;
+  EXPECT_EQ(bad.Allocate(0, CacheMode::kNonCached, "sg044i").Code(),
+            ErrorCode::kInvalidArgument);
+  CmmSgOptions none;
+  none.max_segments = 0;
+  EXPECT_EQ(bad.Allocate(4096, CacheMode::kNonCached, "sg044i", none).Code(),
+            ErrorCode::kInvalidArgument);
+}
+
+}  // namespace
@@ -0,0 +1,388 @@
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "axsys/cmm_share.hpp"
+#include "axsys/cmm_stats.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::CmmExporter;
+using axsys::CmmImportedBuffer;
+using axsys::CmmImporter;
+using axsys::CmmStats;
+using axsys::ErrorCode;
+using Clock = std::chrono::steady_clock;
+
+std::string SocketPath(const char* tag) {
+  return "/tmp/axsys_" + std::string(tag) + "_" + std::to_string(getpid()) +
+         ".sock";
+}
+
+/** Allocate @p size bytes filled with @p fill; the base view is dropped. */
+CmmBuffer FilledBuffer(size_t size, uint8_t fill, const char* token) {
+  CmmBuffer buf;
+  auto v = buf.Allocate(size, CacheMode::kNonCached, token);
+  if (v) memset(v.Value().Data(), fill, size);
+  return buf;
+}
+
+template <typename Pred>
+bool WaitUntil(Pred pred) {
+  const Clock::time_point until = Clock::now() + std::chrono::seconds(2);
+  while (!pred()) {
+    if (Clock::now() > until) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+uint64_t LiveBytes(const char* token) {
+  auto snap = CmmStats::Snapshot();
+  const auto* t = snap.Find(token);
+  return t ? t->live_bytes : 0;
+}
+
+/**
+ * @brief Case039: A published buffer is imported without a copy.
+ *
+ * Steps:
+ * - Import before Connect().
+ * - Listen, publish a 64 KiB buffer filled with 0x5A as "share039",
+ *   connect and import it.
+ * Expected:
+ * - kNotInitialized before Connect(); generation 1; the importer sees
+ *   the owner's bytes at the owner's physical address.
+ * - While imported: Importers() is 1.
+ */
+TEST(CmmShare, Case039_PublishAndImport) {
+  const std::string path = SocketPath("039");
+  CmmImporter importer;
+  auto early = importer.Import("share039");
+  EXPECT_EQ(early.Code(), ErrorCode::kNotInitialized);
+
+  CmmExporter exporter;
+  ASSERT_TRUE(exporter.Listen(path.c_str()));
+  CmmBuffer buf = FilledBuffer(65536, 0x5A, "share039");
+  const uint64_t phys = buf.Phys();
+  ASSERT_NE(phys, 0u);
+  auto gen = exporter.Publish("share039", std::move(buf),
+                              CacheMode::kNonCached);
+  ASSERT_TRUE(gen);
+  EXPECT_EQ(gen.Value(), 1u);
+
+  ASSERT_TRUE(importer.Connect(path.c_str()));
+  auto imp = importer.Import("share039");
+  ASSERT_TRUE(imp) << imp.Message();
+  CmmImportedBuffer shared = imp.MoveValue();
+  EXPECT_EQ(shared.Descriptor().phys, phys);
+  EXPECT_EQ(shared.Descriptor().size, 65536u);
+  EXPECT_EQ(shared.Descriptor().generation, 1u);
+  const uint8_t* p = static_cast<const uint8_t*>(shared.View().Data());
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(p[0], 0x5A);
+  EXPECT_EQ(p[65535], 0x5A);
+  EXPECT_EQ(exporter.Importers("share039"), 1u);
+  shared.Release();
+  EXPECT_TRUE(WaitUntil([&] { return exporter.Importers("share039") == 0; }));
+  EXPECT_TRUE(exporter.Close());
+}
+
+/**
+ * @brief Case039r: Retiring an imported buffer defers its free.
+ *
+ * Steps:
+ * - Publish a 64 KiB buffer filled with 0x5A as "share039r"; import it.
+ * - Retire it, read through the import, release the import.
+ * Expected:
+ * - After Retire the block is still allocated (PendingFrees() 1) and
+ *   readable; Importers() is 0 as nothing is published under the name.
+ * - After release the block is freed (PendingFrees() 0, token has no
+ *   live bytes).
+ */
+TEST(CmmShare, Case039r_RetireDefersFree) {
+  const std::string path = SocketPath("039r");
+  CmmExporter exporter;
+  ASSERT_TRUE(exporter.Listen(path.c_str()));
+  ASSERT_TRUE(exporter.Publish("share039r",
+                               FilledBuffer(65536, 0x5A, "share039r"),
+                               CacheMode::kNonCached));
+  CmmImporter importer;
+  ASSERT_TRUE(importer.Connect(path.c_str()));
+  auto imp = importer.Import("share039r");
+  ASSERT_TRUE(imp) << imp.Message();
+  CmmImportedBuffer shared = imp.MoveValue();
+  const uint8_t* p = static_cast<const uint8_t*>(shared.View().Data());
+  ASSERT_NE(p, nullptr);
+
+  ASSERT_TRUE(exporter.Retire("share039r"));
+  EXPECT_EQ(exporter.PendingFrees(), 1u);
+  EXPECT_EQ(exporter.Importers("share039r"), 0u);  // no current publication
+  EXPECT_EQ(LiveBytes("share039r"), 65536u);
+  EXPECT_EQ(p[4096], 0x5A);
+  shared.Release();
+  EXPECT_FALSE(shared);
+  EXPECT_TRUE(WaitUntil([&] { return exporter.PendingFrees() == 0; }));
+  EXPECT_EQ(LiveBytes("share039r"), 0u);
+  EXPECT_TRUE(exporter.Close());
+}
+
+/**
+ * @brief Case039g: Republishing a name bumps its generation.
+ *
+ * Steps:
+ * - Publish two 4 KiB buffers (filled 1, then 2) as "share039g"; import
+ *   it; Close().
+ * Expected:
+ * - Generation 2; the unimported first buffer is freed at once; the
+ *   import sees the second buffer; Close() frees it.
+ */
+TEST(CmmShare, Case039g_RepublishBumpsGeneration) {
+  const std::string path = SocketPath("039g");
+  CmmExporter exporter;
+  ASSERT_TRUE(exporter.Listen(path.c_str()));
+  ASSERT_TRUE(exporter.Publish("share039g", FilledBuffer(4096, 1, "share039g"),
+                               CacheMode::kNonCached));
+  auto gen2 = exporter.Publish("share039g",
+                               FilledBuffer(4096, 2, "share039g"),
+                               CacheMode::kNonCached);
+  ASSERT_TRUE(gen2);
+  EXPECT_EQ(gen2.Value(), 2u);
+  EXPECT_EQ(exporter.PendingFrees(), 0u);
+  EXPECT_EQ(LiveBytes("share039g"), 4096u);
+
+  CmmImporter importer;
+  ASSERT_TRUE(importer.Connect(path.c_str()));
+  {
+    auto b = importer.Import("share039g");
+    ASSERT_TRUE(b);
+    EXPECT_EQ(static_cast<const uint8_t*>(b.Value().View().Data())[0], 2);
+  }
+  EXPECT_TRUE(
+      WaitUntil([&] { return exporter.Importers("share039g") == 0; }));
+  EXPECT_TRUE(exporter.Close());
+  EXPECT_EQ(LiveBytes("share039g"), 0u);
+}
+
+/**
+ * @brief Case039u: Unknown names are rejected on both sides.
+ *
+ * Steps:
+ * - Import and Retire a name that was never published.
+ * Expected:
+ * - Both return kInvalidArgument.
+ */
+TEST(CmmShare, Case039u_UnknownName) {
+  const std::string path = SocketPath("039u");
+  CmmExporter exporter;
+  ASSERT_TRUE(exporter.Listen(path.c_str()));
+  CmmImporter importer;
+  ASSERT_TRUE(importer.Connect(path.c_str()));
+  auto unknown = importer.Import("share039-missing");
+  EXPECT_EQ(unknown.Code(), ErrorCode::kInvalidArgument);
+  auto retire_unknown = exporter.Retire("share039-missing");
+  EXPECT_EQ(retire_unknown.Code(), ErrorCode::kInvalidArgument);
+  EXPECT_TRUE(exporter.Close());
+}
+
+/**
+ * @brief Case039c: An import stays valid after the exporter closes.
+ *
+ * Steps:
+ * - Publish a 64 KiB buffer filled with 0x3C as "share039c" and import
+ *   it; Close() the exporter and Publish() again.
+ * - Release the import; Close() again.
+ * Expected:
+ * - The first Close() returns kReferencesRemain, Publish() kClosed; the
+ *   block stays allocated and readable through the import.
+ * - After the release the block is freed and Close() succeeds.
+ */
+TEST(CmmShare, Case039c_ImportOutlivesClose) {
+  const std::string path = SocketPath("039c");
+  CmmExporter exporter;
+  ASSERT_TRUE(exporter.Listen(path.c_str()));
+  CmmBuffer buf = FilledBuffer(65536, 0x3C, "share039c");
+  ASSERT_TRUE(
+      exporter.Publish("share039c", std::move(buf), CacheMode::kNonCached));
+  CmmImporter importer;
+  ASSERT_TRUE(importer.Connect(path.c_str()));
+  auto imp = importer.Import("share039c");
+  ASSERT_TRUE(imp) << imp.Message();
+  CmmImportedBuffer shared = imp.MoveValue();
+
+  EXPECT_EQ(exporter.Close().Code(), ErrorCode::kReferencesRemain);
+  auto late = exporter.Publish("share039c", FilledBuffer(4096, 1, "share039c"),
+                               CacheMode::kNonCached);
+  EXPECT_EQ(late.Code(), ErrorCode::kClosed);
+  EXPECT_EQ(LiveBytes("share039c"), 65536u);
+  const uint8_t* p = static_cast<const uint8_t*>(shared.View().Data());
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(p[0], 0x3C);
+  EXPECT_EQ(p[65535], 0x3C);
+  shared.Release();
+  EXPECT_TRUE(WaitUntil([] { return LiveBytes("share039c") == 0; }));
+  EXPECT_TRUE(exporter.Close());
+}
+
+/**
+ * @brief Case039d: An import stays valid after the exporter is destroyed.
+ *
+ * Steps:
+ * - Publish a 64 KiB buffer filled with 0x4D as "share039d", import it
+ *   and destroy the exporter.
+ * - Read through the import, then release it.
+ * Expected:
+ * - The block stays allocated and readable while imported and is freed
+ *   only after the import is released.
+ */
+TEST(CmmShare, Case039d_ImportOutlivesExporter) {
+  const std::string path = SocketPath("039d");
+  CmmImporter importer;
+  CmmImportedBuffer kept;
+  {
+    CmmExporter gone;
+    ASSERT_TRUE(gone.Listen(path.c_str()));
+    CmmBuffer buf = FilledBuffer(65536, 0x4D, "share039d");
+    ASSERT_TRUE(
+        gone.Publish("share039d", std::move(buf), CacheMode::kNonCached));
+    ASSERT_TRUE(importer.Connect(path.c_str()));
+    auto r = importer.Import("share039d");
+    ASSERT_TRUE(r) << r.Message();
+    kept = r.MoveValue();
+  }
+  EXPECT_EQ(LiveBytes("share039d"), 65536u);
+  const uint8_t* q = static_cast<const uint8_t*>(kept.View().Data());
+  ASSERT_NE(q, nullptr);
+  EXPECT_EQ(q[32768], 0x4D);
+  kept.Release();
+  EXPECT_TRUE(WaitUntil([] { return LiveBytes("share039d") == 0; }));
+}
+
+/**
+ * @brief Case039p: Two-process import throughput and crash release.
+ *
+ * Steps:
+ * - Publish four 1 MiB buffers, buffer i filled with i + 1.
+ * - A forked child imports them round-robin 2000 times, checking the
+ *   first and last byte of each, and reports count and time through a
+ *   pipe.
+ * Expected:
+ * - Every import in the child succeeds with the right contents; the
+ *   import rate is printed (a 1 MiB buffer per import, no copy).
+ */
+TEST(CmmShare, Case039p_TwoProcessThroughput) {
+  const std::string path = SocketPath("039p");
+  CmmExporter exporter;
+  ASSERT_TRUE(exporter.Listen(path.c_str()));
+  constexpr int kBuffers = 4;
+  constexpr size_t kSize = 1 << 20;
+  for (int i = 0; i < kBuffers; ++i) {
+    const std::string name = "share039p" + std::to_string(i);
+    ASSERT_TRUE(exporter.Publish(
+        name.c_str(),
+        FilledBuffer(kSize, static_cast<uint8_t>(i + 1), "share039p"),
+        CacheMode::kNonCached));
+  }
+
+  constexpr int kImports = 2000;
+  int pipe_fd[2];
+  ASSERT_EQ(pipe(pipe_fd), 0);
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    close(pipe_fd[0]);
+    int64_t report[2] = {0, 0};  // good imports, elapsed ns
+    CmmImporter importer;
+    if (importer.Connect(path.c_str())) {
+      const Clock::time_point t0 = Clock::now();
+      for (int n = 0; n < kImports; ++n) {
+        const int i = n % kBuffers;
+        const std::string name = "share039p" + std::to_string(i);
+        auto r = importer.Import(name.c_str());
+        if (!r) continue;
+        const uint8_t* p =
+            static_cast<const uint8_t*>(r.Value().View().Data());
+        if (p && p[0] == i + 1 && p[kSize - 1] == i + 1) ++report[0];
+      }
+      report[1] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      Clock::now() - t0)
+                      .count();
+    }
+    const bool sent = write(pipe_fd[1], report, sizeof(report)) ==
+                      static_cast<ssize_t>(sizeof(report));
+    _exit(sent ? 0 : 1);
+  }
+  close(pipe_fd[1]);
+  int64_t report[2] = {0, 0};
+  const ssize_t got = read(pipe_fd[0], report, sizeof(report));
+  close(pipe_fd[0]);
+  int status = 0;
+  ASSERT_EQ(waitpid(child, &status, 0), child);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  ASSERT_EQ(got, static_cast<ssize_t>(sizeof(report)));
+  EXPECT_EQ(report[0], kImports);
+  if (report[1] > 0) {
+    const double per_s = kImports * 1e9 / static_cast<double>(report[1]);
+    printf("[CmmShare] %.0f imports/s, %.1f GiB/s of 1 MiB buffers shared\n",
+           per_s, per_s / 1024.0);
+  }
+  EXPECT_TRUE(WaitUntil([&] { return exporter.Importers("share039p0") == 0; }));
+}
+
+/**
+ * @brief Case039k: A killed importer's references are released.
+ *
+ * Steps:
+ * - Publish a 4 KiB buffer as "share039k".
+ * - A forked child imports it and is killed with SIGKILL.
+ * Expected:
+ * - "share039k" has one importer while the child lives and none after it
+ *   is killed.
+ */
+TEST(CmmShare, Case039k_KilledImporterReleased) {
+  const std::string path = SocketPath("039k");
+  CmmExporter exporter;
+  ASSERT_TRUE(exporter.Listen(path.c_str()));
+  ASSERT_TRUE(exporter.Publish("share039k", FilledBuffer(4096, 1, "share039k"),
+                               CacheMode::kNonCached));
+
+  int pipe_fd[2];
+  ASSERT_EQ(pipe(pipe_fd), 0);
+  const pid_t crasher = fork();
+  ASSERT_GE(crasher, 0);
+  if (crasher == 0) {
+    close(pipe_fd[0]);
+    CmmImporter importer;
+    if (!importer.Connect(path.c_str())) _exit(1);
+    auto held = importer.Import("share039k");
+    const char ready = held ? 1 : 0;
+    if (write(pipe_fd[1], &ready, 1) != 1) _exit(1);
+    pause();  // killed while holding the import
+    _exit(0);
+  }
+  close(pipe_fd[1]);
+  char ready = 0;
+  EXPECT_EQ(read(pipe_fd[0], &ready, 1), 1);
+  close(pipe_fd[0]);
+  EXPECT_EQ(ready, 1);
+  EXPECT_EQ(exporter.Importers("share039k"), 1u);
+  kill(crasher, SIGKILL);
+  int status = 0;
+  ASSERT_EQ(waitpid(crasher, &status, 0), crasher);
+  EXPECT_TRUE(WIFSIGNALED(status));
+  EXPECT_TRUE(WaitUntil([&] { return exporter.Importers("share039k") == 0; }));
+}
+
+}  // namespace
@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "axsys/cmm_stats.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::CmmStats;
+using axsys::CmmStatsSnapshot;
+using axsys::CmmTokenStats;
+using axsys::CmmView;
+using axsys::ErrorCode;
+
+uint64_t HistogramTotal(const CmmTokenStats& t) {
+  uint64_t n = 0;
+  for (size_t i = 0; i < axsys::kCmmLatencyBuckets; ++i) {
+    n += t.alloc_latency[i];
+  }
+  return n;
+}
+
+std::string ReadAll(FILE* f) {
+  std::string text;
+  rewind(f);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+  return text;
+}
+
+/**
+ * @brief Case036: Live bytes, blocks, peak and latency per token.
+ *
+ * Steps:
+ * - Allocate 4, 8 and 16 KiB under token "stats036", free the 8 KiB
+ *   block, then allocate 4 KiB under "stats036b".
+ * - Snapshot.
+ * Expected:
+ * - stats036: 3 allocs, 1 free, no failure, 2 live blocks, 20 KiB live,
+ *   28 KiB peak; one latency sample per allocation and a non-zero p50.
+ * - stats036b is separate (4 KiB live); an unknown token is not found.
+ */
+TEST(CmmStats, Case036_PerTokenCounters) {
+  CmmBuffer a;
+  CmmBuffer b;
+  CmmBuffer c;
+  CmmBuffer d;
+  ASSERT_TRUE(a.Allocate(4096, CacheMode::kNonCached, "stats036"));
+  {
+    auto v = b.Allocate(8192, CacheMode::kCached, "stats036");
+    ASSERT_TRUE(v);
+  }
+  ASSERT_TRUE(c.Allocate(16384, CacheMode::kNonCached, "stats036"));
+  ASSERT_TRUE(b.Free());
+  ASSERT_TRUE(d.Allocate(4096, CacheMode::kNonCached, "stats036b"));
+
+  const CmmStatsSnapshot snap = CmmStats::Snapshot();
+  const CmmTokenStats* t = snap.Find("stats036");
+  ASSERT_NE(t, nullptr);
+  EXPECT_EQ(t->allocs, 3u);
+  EXPECT_EQ(t->frees, 1u);
+  EXPECT_EQ(t->failures, 0u);
+  EXPECT_EQ(t->live_blocks, 2u);
+  EXPECT_EQ(t->live_bytes, 20480u);
+  EXPECT_EQ(t->peak_bytes, 28672u);
+  EXPECT_EQ(HistogramTotal(*t), t->allocs);
+  EXPECT_GT(t->LatencyPercentileNs(0.5), 0u);
+  EXPECT_GE(t->LatencyPercentileNs(0.99), t->LatencyPercentileNs(0.5));
+  EXPECT_GT(t->alloc_rate_hz, 0.0);
+
+  const CmmTokenStats* tb = snap.Find("stats036b");
+  ASSERT_NE(tb, nullptr);
+  EXPECT_EQ(tb->live_bytes, 4096u);
+  EXPECT_EQ(tb->live_blocks, 1u);
+  EXPECT_EQ(snap.Find("stats036-missing"), nullptr);
+}
+
+/**
+ * @brief Case036f: A failed allocation is counted as a failure.
+ *
+ * Steps:
+ * - Attempt a 4 GiB - 4 KiB allocation under token "stats036f".
+ * Expected:
+ * - If it failed: one failure, no alloc, nothing live.
+ * - If the platform granted it: one alloc, no failure.
+ */
+TEST(CmmStats, Case036f_FailureCounted) {
+  CmmBuffer huge;
+  const bool huge_ok = static_cast<bool>(
+      huge.Allocate(0xFFFFF000u, CacheMode::kNonCached, "stats036f"));
+
+  const CmmStatsSnapshot snap = CmmStats::Snapshot();
+  const CmmTokenStats* t = snap.Find("stats036f");
+  ASSERT_NE(t, nullptr);
+  EXPECT_EQ(t->allocs, huge_ok ? 1u : 0u);
+  EXPECT_EQ(t->failures, huge_ok ? 0u : 1u);
+  if (!huge_ok) {
+    EXPECT_EQ(t->live_blocks, 0u);
+    EXPECT_EQ(t->live_bytes, 0u);
+  }
+}
+
+/**
+ * @brief Case036d: Dump() writes one table naming every token.
+ *
+ * Steps:
+ * - Allocate 4 KiB under "stats036d" and "stats036e".
+ * - Dump() to a temporary file.
+ * Expected:
+ * - The text has the [CmmStats] header and a row per token.
+ */
+TEST(CmmStats, Case036d_DumpListsTokens) {
+  CmmBuffer a;
+  CmmBuffer b;
+  ASSERT_TRUE(a.Allocate(4096, CacheMode::kNonCached, "stats036d"));
+  ASSERT_TRUE(b.Allocate(4096, CacheMode::kNonCached, "stats036e"));
+
+  FILE* f = tmpfile();
+  ASSERT_NE(f, nullptr);
+  CmmStats::Dump(f);
+  const std::string text = ReadAll(f);
+  fclose(f);
+  EXPECT_NE(text.find("[CmmStats]"), std::string::npos);
+  EXPECT_NE(text.find("stats036d "), std::string::npos);
+  EXPECT_NE(text.find("stats036e "), std::string::npos);
+}
+
+/**
+ * @brief Case036p: Counters stay exact under concurrent threads.
+ *
+ * Steps:
+ * - Four threads allocate and free 200 blocks of 4 KiB each under token
+ *   "stats036p", using a per-iteration copy of the token string.
+ * Expected:
+ * - 800 allocs and frees, nothing live, peak between 4 KiB and 16 KiB.
+ */
+TEST(CmmStats, Case036p_ConcurrentThreads) {
+  constexpr int kThreads = 4;
+  constexpr int kIters = 200;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([] {
+      for (int n = 0; n < kIters; ++n) {
+        const std::string token = "stats036p";
+        CmmBuffer buf;
+        auto v = buf.Allocate(4096, CacheMode::kNonCached, token.c_str());
+        if (!v) continue;
+        v.Value().Reset();
+        (void)buf.Free();
+      }
+    });
+  }
+  for (auto& th : threads) th.join();
+
+  const CmmStatsSnapshot snap = CmmStats::Snapshot();
+  const CmmTokenStats* t = snap.Find("stats036p");
+  ASSERT_NE(t, nullptr);
+  EXPECT_EQ(t->allocs, static_cast<uint64_t>(kThreads * kIters));
+  EXPECT_EQ(t->frees, t->allocs);
+  EXPECT_EQ(t->live_bytes, 0u);
+  EXPECT_EQ(t->live_blocks, 0u);
+  EXPECT_GE(t->peak_bytes, 4096u);
+  EXPECT_LE(t->peak_bytes, 4096u * kThreads);
+}
+
+/**
+ * @brief Case036s: The periodic dump rejects a second start and zero.
+ *
+ * Steps:
+ * - Start a 20 ms periodic dump; start it again; stop it.
+ * - Start it with a zero interval.
+ * Expected:
+ * - Second start: kAlreadyInitialized; zero interval: kInvalidArgument.
+ */
+TEST(CmmStats, Case036s_PeriodicDumpStartChecks) {
+  FILE* f = tmpfile();
+  ASSERT_NE(f, nullptr);
+  ASSERT_TRUE(CmmStats::StartPeriodicDump(20, f));
+  auto again = CmmStats::StartPeriodicDump(20, f);
+  EXPECT_EQ(again.Code(), ErrorCode::kAlreadyInitialized);
+  CmmStats::StopPeriodicDump();
+  auto zero = CmmStats::StartPeriodicDump(0, f);
+  EXPECT_EQ(zero.Code(), ErrorCode::kInvalidArgument);
+  fclose(f);
+}
+
+/**
+ * @brief Case036t: The periodic dump writes a table every interval.
+ *
+ * Steps:
+ * - Allocate 4 KiB under "stats036t".
+ * - Run a 20 ms periodic dump into a temporary file for 60 ms; stop it.
+ * Expected:
+ * - The file has at least two tables naming the token.
+ */
+TEST(CmmStats, Case036t_PeriodicDumpWrites) {
+  CmmBuffer buf;
+  ASSERT_TRUE(buf.Allocate(4096, CacheMode::kNonCached, "stats036t"));
+
+  FILE* f = tmpfile();
+  ASSERT_NE(f, nullptr);
+  ASSERT_TRUE(CmmStats::StartPeriodicDump(20, f));
+  std::this_thread::sleep_for(std::chrono::milliseconds(60));
+  CmmStats::StopPeriodicDump();
+
+  const std::string text = ReadAll(f);
+  fclose(f);
+  const size_t first = text.find("[CmmStats]");
+  ASSERT_NE(first, std::string::npos);
+  EXPECT_NE(text.find("[CmmStats]", first + 1), std::string::npos);
+  EXPECT_NE(text.find("stats036t"), std::string::npos);
+}
+
+}  // namespace
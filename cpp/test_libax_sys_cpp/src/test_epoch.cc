@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "axsys/cmm_stats.hpp"
+#include "axsys/epoch.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::CmmStats;
+using axsys::CmmView;
+using axsys::EpochDomain;
+using axsys::EpochGuard;
+using axsys::EpochOptions;
+using axsys::ErrorCode;
+
+uint64_t LiveBlocks(const char* token) {
+  const axsys::CmmStatsSnapshot snap = CmmStats::Snapshot();
+  const axsys::CmmTokenStats* t = snap.Find(token);
+  return t ? t->live_blocks : 0;
+}
+
+EpochOptions Unbatched() {
+  EpochOptions opt;
+  opt.batch = 0;
+  return opt;
+}
+
+/**
+ * @brief Case049: Nested sections hold back reclamation.
+ *
+ * Steps:
+ * - Domain with batch 0. Enter twice (nested), retire a callback, Reclaim;
+ *   exit the inner guard, Reclaim; exit the outer guard, Reclaim.
+ * Expected:
+ * - The callback runs only on the last Reclaim.
+ */
+TEST(Epoch, Case049_NestedSectionsHoldReclaim) {
+  EpochDomain domain(Unbatched());
+  int released = 0;
+  {
+    EpochGuard outer = domain.Enter();
+    EpochGuard inner = domain.Enter();
+    domain.Retire([&released] { ++released; });
+    EXPECT_EQ(domain.Reclaim(), 0u);
+    inner.Exit();
+    EXPECT_FALSE(inner);
+    EXPECT_EQ(domain.Reclaim(), 0u);
+    EXPECT_TRUE(outer);
+  }
+  EXPECT_EQ(domain.Reclaim(), 1u);
+  EXPECT_EQ(released, 1);
+}
+
+/**
+ * @brief Case049r: CmmBuffer::Retire() defers the free to the domain.
+ *
+ * Steps:
+ * - Enter and leave a section; allocate a CMM buffer, map a second view,
+ *   Retire() the buffer with its base view; Reclaim; Drain(20); reset
+ *   the second view.
+ * Expected:
+ * - The buffer is empty at once; Reclaim releases the view and the
+ *   buffer (nothing pending, Drain succeeds) but the block stays live
+ *   until the second view is gone, then is freed.
+ */
+TEST(Epoch, Case049r_RetireBufferDefersFree) {
+  EpochDomain domain(Unbatched());
+  domain.Enter().Exit();
+  CmmBuffer buf;
+  auto v = buf.Allocate(8192, CacheMode::kCached, "epoch049r");
+  ASSERT_TRUE(v);
+  CmmView base = v.MoveValue();
+  auto second = buf.MapView(4096, 4096, CacheMode::kNonCached);
+  ASSERT_TRUE(second);
+  CmmView extra = second.MoveValue();
+  ASSERT_TRUE(buf.Retire(&domain, std::move(base)));
+  EXPECT_FALSE(base);
+  EXPECT_EQ(buf.Size(), 0u);
+  EXPECT_EQ(domain.Reclaim(), 2u);  // the base view and the buffer
+  EXPECT_EQ(domain.Stats().pending, 0u);
+  EXPECT_TRUE(domain.Drain(20));
+  EXPECT_EQ(LiveBlocks("epoch049r"), 1u);
+  uint8_t* p = static_cast<uint8_t*>(extra.Data());
+  ASSERT_NE(p, nullptr);
+  p[0] = 0x49;  // still mapped
+  EXPECT_EQ(p[0], 0x49);
+  extra.Reset();
+  EXPECT_EQ(LiveBlocks("epoch049r"), 0u);
+  const axsys::EpochStats s = domain.Stats();
+  EXPECT_EQ(s.retired, 2u);
+  EXPECT_EQ(s.reclaimed, 2u);
+  EXPECT_EQ(s.pending, 0u);
+  EXPECT_EQ(s.threads, 1u);
+}
+
+/**
+ * @brief Case049e: Retire() argument checks leave the buffer reusable.
+ *
+ * Steps:
+ * - Retire() into a null domain and from an empty buffer; allocate it,
+ *   Retire() it and Drain().
+ * Expected:
+ * - kInvalidArgument, kNoAllocation; the buffer is reusable and its
+ *   block is freed by the drain.
+ */
+TEST(Epoch, Case049e_RetireChecks) {
+  EpochDomain domain(Unbatched());
+  CmmBuffer buf;
+  EXPECT_EQ(buf.Retire(nullptr).Code(), ErrorCode::kInvalidArgument);
+  EXPECT_EQ(buf.Retire(&domain).Code(), ErrorCode::kNoAllocation);
+  auto again = buf.Allocate(4096, CacheMode::kCached, "epoch049e");
+  ASSERT_TRUE(again);
+  CmmView again_view = again.MoveValue();
+  ASSERT_TRUE(buf.Retire(&domain, std::move(again_view)));
+  EXPECT_TRUE(domain.Drain(1000));
+  EXPECT_EQ(LiveBlocks("epoch049e"), 0u);
+}
+
+/**
+ * @brief Case049d: Drain() inside a section is refused.
+ *
+ * Steps:
+ * - Drain() while the calling thread holds a guard.
+ * Expected:
+ * - kInvalidArgument.
+ */
+TEST(Epoch, Case049d_DrainInsideSection) {
+  EpochDomain domain(Unbatched());
+  EpochGuard g = domain.Enter();
+  EXPECT_EQ(domain.Drain().Code(), ErrorCode::kInvalidArgument);
+}
+
+/**
+ * @brief Case049t: Drain() waits for readers still inside a section.
+ *
+ * Steps:
+ * - Another thread enters and stays; retire a callback; Drain(20); let
+ *   the thread leave; Drain(1000).
+ * Expected:
+ * - kTimeout with the callback not run, then Ok with it run.
+ */
+TEST(Epoch, Case049t_DrainWaitsForReaders) {
+  EpochDomain domain(Unbatched());
+  int released = 0;
+  std::atomic<bool> entered{false};
+  std::atomic<bool> leave{false};
+  std::thread reader([&] {
+    EpochGuard g = domain.Enter();
+    entered.store(true);
+    while (!leave.load()) std::this_thread::yield();
+  });
+  while (!entered.load()) std::this_thread::yield();
+  domain.Retire([&released] { ++released; });
+  EXPECT_EQ(domain.Drain(20).Code(), ErrorCode::kTimeout);
+  EXPECT_EQ(released, 0);
+  leave.store(true);
+  reader.join();
+  EXPECT_TRUE(domain.Drain(1000));
+  EXPECT_EQ(released, 1);
+}
+
+struct Published {
+  CmmBuffer buf;
+  CmmView view;
+  const uint8_t* data;  // stays valid while the view is mapped
+  uint8_t seq;
+};
+
+constexpr size_t kPublishedBytes = 4096;
+
+/**
+ * @brief Case049p: Readers never see a released buffer under churn.
+ *
+ * Steps:
+ * - Domain with batch 16. Four reader threads loop: Enter, load the
+ *   published buffer, check that every 64th byte equals its sequence
+ *   number (twice, with a yield between), leave.
+ * - The writer publishes 1500 freshly allocated 4 KiB CMM buffers filled
+ *   with their sequence number; each replaced one is retired with
+ *   CmmBuffer::Retire() plus a callback deleting its holder.
+ * - Stop the readers, retire the last buffer, Drain().
+ * Expected:
+ * - No reader saw a mismatch; readers completed reads.
+ * - Objects were reclaimed while the readers ran (before Drain()).
+ * - retired == reclaimed, nothing pending, no live CMM blocks left.
+ */
+TEST(Epoch, Case049p_StressHandoff) {
+  EpochOptions opt;
+  opt.batch = 16;
+  EpochDomain domain(opt);
+  auto make = [](uint8_t seq) {
+    Published* p = new Published();
+    auto v = p->buf.Allocate(kPublishedBytes, CacheMode::kCached,
+                             "epoch049p");
+    if (!v) {
+      delete p;
+      return static_cast<Published*>(nullptr);
+    }
+    p->view = v.MoveValue();
+    memset(p->view.Data(), seq, kPublishedBytes);
+    p->data = static_cast<const uint8_t*>(p->view.Data());
+    p->seq = seq;
+    return p;
+  };
+  auto retire = [&domain](Published* p) {
+    (void)p->buf.Retire(&domain, std::move(p->view));
+    domain.Retire([p] { delete p; });
+  };
+
+  std::atomic<Published*> current{make(0)};
+  ASSERT_NE(current.load(), nullptr);
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> mismatches{0};
+  std::atomic<uint64_t> reads{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        EpochGuard g = domain.Enter();
+        const Published* p = current.load(std::memory_order_acquire);
+        for (int pass = 0; pass < 2; ++pass) {
+          for (size_t i = 0; i < kPublishedBytes; i += 64) {
+            if (p->data[i] != p->seq) mismatches.fetch_add(1);
+          }
+          std::this_thread::yield();
+        }
+        reads.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (int i = 1; i <= 1500; ++i) {
+    Published* next = make(static_cast<uint8_t>(i));
+    ASSERT_NE(next, nullptr);
+    retire(current.exchange(next, std::memory_order_acq_rel));
+  }
+  const uint64_t reclaimed_while_running = domain.Stats().reclaimed;
+  stop.store(true);
+  for (auto& r : readers) r.join();
+  retire(current.exchange(nullptr));
+  ASSERT_TRUE(domain.Drain(5000));
+
+  EXPECT_EQ(mismatches.load(), 0u);
+  EXPECT_GT(reads.load(), 0u);
+  EXPECT_GT(reclaimed_while_running, 0u);
+  const axsys::EpochStats s = domain.Stats();
+  EXPECT_EQ(s.retired, s.reclaimed);
+  EXPECT_EQ(s.pending, 0u);
+  EXPECT_EQ(LiveBlocks("epoch049p"), 0u);
+}
+
+}  // namespace
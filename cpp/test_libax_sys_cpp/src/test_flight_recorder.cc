@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "axsys/flight_recorder.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::flight::Entry;
+using axsys::flight::Op;
+
+/** Sequence number after which new operations will be recorded. */
+uint64_t Mark() {
+  const std::vector<Entry> all = axsys::flight::Snapshot();
+  return all.empty() ? 0 : all.back().seq + 1;
+}
+
+/** Entries of the calling thread recorded at or after @p mark. */
+std::vector<Entry> MineSince(uint64_t mark) {
+  const uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+  std::vector<Entry> out;
+  for (const Entry& e : axsys::flight::Snapshot()) {
+    if (e.seq >= mark && e.tid == tid) out.push_back(e);
+  }
+  return out;
+}
+
+std::string DumpToString() {
+  int fds[2];
+  if (pipe(fds) != 0) return std::string();
+  axsys::flight::Dump(fds[1]);
+  close(fds[1]);
+  std::string text;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+    text.append(buf, static_cast<size_t>(n));
+  }
+  close(fds[0]);
+  return text;
+}
+
+/**
+ * @brief Case035: CMM operations are recorded in order and dumped.
+ *
+ * Steps:
+ * - Allocate a 64 KiB cached buffer, map a non-cached sub-view at 4 KiB,
+ *   release it, flush and invalidate the base view, release it, free.
+ * Expected:
+ * - This thread's entries are allocate, map, map, unmap, flush,
+ *   invalidate, unmap, free with the buffer's physical address, sizes and
+ *   cache modes, ret 0 and increasing seq.
+ */
+TEST(FlightRecorder, Case035_RecordCmmOps) {
+  constexpr size_t kSize = 64 * 1024;
+  const uint64_t mark = Mark();
+  uint64_t phys = 0;
+  {
+    CmmBuffer buf;
+    auto base = buf.Allocate(kSize, CacheMode::kCached, "flight_test");
+    ASSERT_TRUE(base);
+    phys = buf.Phys();
+    {
+      auto sub = buf.MapView(4096, 8192, CacheMode::kNonCached);
+      ASSERT_TRUE(sub);
+    }
+    ASSERT_TRUE(base.Value().Flush());
+    ASSERT_TRUE(base.Value().Invalidate());
+    base.Value().Reset();
+    ASSERT_TRUE(buf.Free());
+  }
+
+  const std::vector<Entry> ops = MineSince(mark);
+  const Op kExpected[] = {Op::kAllocate, Op::kMap,        Op::kMap,
+                          Op::kUnmap,    Op::kFlush,      Op::kInvalidate,
+                          Op::kUnmap,    Op::kFree};
+  ASSERT_EQ(ops.size(), sizeof(kExpected) / sizeof(kExpected[0]));
+  for (size_t i = 0; i < ops.size(); ++i) {
+    EXPECT_EQ(ops[i].op, kExpected[i]) << "entry " << i;
+    EXPECT_EQ(ops[i].ret, 0) << "entry " << i;
+    if (i > 0) {
+      EXPECT_GT(ops[i].seq, ops[i - 1].seq);
+    }
+  }
+  EXPECT_EQ(ops[0].phys, phys);
+  EXPECT_EQ(ops[0].size, kSize);
+  EXPECT_EQ(ops[0].mode, CacheMode::kCached);
+  EXPECT_EQ(ops[2].phys, phys + 4096);
+  EXPECT_EQ(ops[2].size, 8192u);
+  EXPECT_EQ(ops[2].mode, CacheMode::kNonCached);
+  EXPECT_EQ(ops[3].virt, ops[2].virt);
+  EXPECT_EQ(ops[4].phys, phys);
+  EXPECT_EQ(ops[4].size, kSize);
+  EXPECT_EQ(ops[7].phys, phys);
+  EXPECT_GE(ops[7].time_ns, ops[0].time_ns);
+}
+
+/**
+ * @brief Case035d: The ring dumps as one text line per operation.
+ *
+ * Steps:
+ * - Allocate a 64 KiB cached buffer, invalidate it and free it.
+ * - Dump the ring into a pipe.
+ * Expected:
+ * - The dump starts with the header line and has allocate and invalidate
+ *   lines with the size and cache mode.
+ */
+TEST(FlightRecorder, Case035d_DumpText) {
+  {
+    CmmBuffer buf;
+    auto base = buf.Allocate(64 * 1024, CacheMode::kCached, "flight_test");
+    ASSERT_TRUE(base);
+    ASSERT_TRUE(base.Value().Invalidate());
+    base.Value().Reset();
+    ASSERT_TRUE(buf.Free());
+  }
+
+  const std::string text = DumpToString();
+  EXPECT_EQ(text.find("axsys flight recorder: last "), 0u);
+  EXPECT_NE(text.find(" allocate   phys 0x"), std::string::npos);
+  EXPECT_NE(text.find(" invalidate phys 0x"), std::string::npos);
+  EXPECT_NE(text.find("size 0x10000 cached ret 0\n"), std::string::npos);
+}
+
+/**
+ * @brief Case035w: After wrapping only the newest kEntries remain.
+ *
+ * Steps:
+ * - Record kEntries + 5 operations.
+ * Expected:
+ * - The snapshot holds kEntries entries, oldest first, starting with the
+ *   sixth recorded one.
+ */
+TEST(FlightRecorder, Case035w_WrapKeepsNewest) {
+  const uint64_t wrap_mark = Mark();
+  for (uintptr_t i = 0; i < axsys::flight::kEntries + 5; ++i) {
+    axsys::flight::Record(Op::kFlush, i, reinterpret_cast<void*>(i), 64,
+                          CacheMode::kCached, 0);
+  }
+  const std::vector<Entry> wrapped = axsys::flight::Snapshot();
+  ASSERT_EQ(wrapped.size(), axsys::flight::kEntries);
+  EXPECT_EQ(wrapped.front().seq, wrap_mark + 5);
+  EXPECT_EQ(wrapped.front().phys, 5u);
+  EXPECT_EQ(wrapped.back().phys, axsys::flight::kEntries + 4u);
+}
+
+/**
+ * @brief Case035p: Recording is cheap.
+ *
+ * Steps:
+ * - Time 1,000,000 Record() calls (best of five).
+ * Expected:
+ * - Under 100 ns per operation (one atomic increment, one counter read
+ *   and a few stores). Virtualised hosts measure about 40 ns, most of
+ *   it the clock read; the fixed bound leaves room for them.
+ */
+TEST(FlightRecorder, Case035p_RecordCost) {
+  constexpr int kCalls = 1000000;
+  double best = 1e30;
+  for (int rep = 0; rep < 5; ++rep) {
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < kCalls; ++i) {
+      axsys::flight::Record(Op::kMap, static_cast<uint64_t>(i), nullptr, 64,
+                            CacheMode::kNonCached, 0);
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    best = std::min(
+        best,
+        std::chrono::duration<double, std::nano>(t1 - t0).count() / kCalls);
+  }
+  EXPECT_LT(best, 100.0) << best << " ns per Record()";
+}
+
+/**
+ * @brief Case035c: The crash handler dumps the ring to stderr.
+ *
+ * Steps:
+ * - In a death test, install the crash handler, allocate and free a
+ *   buffer, then abort().
+ * Expected:
+ * - The dying process prints the flight recorder with the allocate and
+ *   free entries to stderr.
+ */
+TEST(FlightRecorder, Case035c_CrashHandlerDumps) {
+  GTEST_FLAG_SET(death_test_style, "threadsafe");
+  EXPECT_DEATH(
+      {
+        (void)axsys::flight::InstallCrashHandler();
+        CmmBuffer buf;
+        if (buf.Allocate(4096, CacheMode::kNonCached, "flight_crash")) {
+          (void)buf.Free();
+        }
+        abort();
+      },
+      "axsys flight recorder: last .* allocate .* free ");
+}
+
+}  // namespace
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "axsys/frame_map_cache.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+
+/**
+ * @brief Case026: Repeated lookups of one block map it exactly once.
+ *
+ * Purpose:
+ * - Verify FrameMapCache turns the per-frame Mmap/Munmap pair into a single
+ *   persistent mapping per physical block.
+ * Steps:
+ * - Allocate 1MiB non-cached; fill with a pattern via the base view.
+ * - Call cache.Map(phys, size) 100 times; compare contents each time.
+ * - Invalidate(); check counters.
+ * Expected:
+ * - Same pointer every time; map_calls == 1, hits == 99; after Invalidate
+ *   entries == 0 and unmap_calls == 1.
+ */
+TEST(FrameMapCache, Case026_SingleMapPerBlock) {
+  constexpr uint32_t kLen = 1 * 1024 * 1024;
+  axsys::CmmBuffer buf;
+  auto r = buf.Allocate(kLen, CacheMode::kNonCached, "gtest_026");
+  ASSERT_TRUE(r) << r.Message();
+  axsys::CmmView v = r.MoveValue();
+  memset(v.Data(), 0x5a, kLen);
+
+  axsys::FrameMapCache cache(CacheMode::kNonCached);
+  void* first = nullptr;
+  for (int i = 0; i < 100; ++i) {
+    auto m = cache.Map(buf.Phys(), kLen);
+    ASSERT_TRUE(m) << m.Message();
+    if (i == 0) first = m.Value();
+    EXPECT_EQ(m.Value(), first);
+    EXPECT_EQ(memcmp(m.Value(), v.Data(), kLen), 0);
+  }
+  axsys::FrameMapCache::Stats st = cache.GetStats();
+  EXPECT_EQ(st.map_calls, 1u);
+  EXPECT_EQ(st.hits, 99u);
+  EXPECT_EQ(st.misses, 1u);
+  EXPECT_EQ(st.entries, 1u);
+
+  cache.Invalidate();
+  st = cache.GetStats();
+  EXPECT_EQ(st.entries, 0u);
+  EXPECT_EQ(st.unmap_calls, 1u);
+  EXPECT_EQ(st.invalidations, 1u);
+}
+
+/**
+ * @brief Case026c: Exceeding capacity drops all mappings.
+ *
+ * Purpose:
+ * - A new block beyond capacity signals a pool layout change; the cache
+ *   must drop existing mappings rather than grow without bound.
+ * Steps:
+ * - Allocate 64KiB; use capacity 2; Map three distinct 4KiB sub-blocks.
+ * Expected:
+ * - invalidations == 1, entries == 1, map_calls == 3, unmap_calls == 2.
+ */
+TEST(FrameMapCache, Case026c_CapacityResets) {
+  constexpr uint32_t kLen = 64 * 1024;
+  axsys::CmmBuffer buf;
+  auto r = buf.Allocate(kLen, CacheMode::kNonCached, "gtest_026c");
+  ASSERT_TRUE(r) << r.Message();
+
+  axsys::FrameMapCache cache(CacheMode::kNonCached, 2);
+  for (uint64_t i = 0; i < 3; ++i) {
+    auto m = cache.Map(buf.Phys() + i * 0x1000, 0x1000);
+    ASSERT_TRUE(m) << m.Message();
+  }
+  const axsys::FrameMapCache::Stats st = cache.GetStats();
+  EXPECT_EQ(st.invalidations, 1u);
+  EXPECT_EQ(st.entries, 1u);
+  EXPECT_EQ(st.map_calls, 3u);
+  EXPECT_EQ(st.unmap_calls, 2u);
+}
+
+}  // namespace
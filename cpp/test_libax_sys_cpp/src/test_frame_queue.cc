@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "axsys/frame_queue.hpp"
+
+namespace {
+
+using axsys::ErrorCode;
+using axsys::FrameQueue;
+using axsys::QueueKind;
+
+/**
+ * @brief Case027: SPSC preserves order across threads.
+ *
+ * Purpose:
+ * - One producer and one consumer exchange 1M sequence numbers through a
+ *   small SPSC queue using the non-blocking API.
+ * Expected:
+ * - Consumer observes 0..N-1 in order.
+ */
+TEST(FrameQueue, Case027_SpscOrder) {
+  constexpr uint64_t kCount = 1000000;
+  FrameQueue<uint64_t, QueueKind::kSpsc> q(64);
+  std::thread producer([&] {
+    for (uint64_t i = 0; i < kCount;) {
+      uint64_t v = i;
+      if (q.TryPush(std::move(v))) {
+        ++i;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  uint64_t expect = 0;
+  while (expect < kCount) {
+    uint64_t v = 0;
+    if (q.TryPop(&v)) {
+      ASSERT_EQ(v, expect);
+      ++expect;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  EXPECT_EQ(q.SizeApprox(), 0u);
+}
+
+/**
+ * @brief Case027m: MPMC delivers every element exactly once.
+ *
+ * Purpose:
+ * - Four producers and four consumers use blocking Push/Pop; Close() ends
+ *   the consumers after draining.
+ * Expected:
+ * - Sum and count of popped values equal what was pushed.
+ */
+TEST(FrameQueue, Case027m_MpmcExactlyOnce) {
+  constexpr uint64_t kPerProducer = 200000;
+  constexpr int kProducers = 4;
+  constexpr int kConsumers = 4;
+  FrameQueue<uint64_t> q(128);
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> count{0};
+
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < kConsumers; ++c) {
+    consumers.emplace_back([&] {
+      uint64_t v = 0;
+      while (q.Pop(&v)) {
+        sum.fetch_add(v, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&q, p] {
+      for (uint64_t i = 1; i <= kPerProducer; ++i) {
+        uint64_t v = i + static_cast<uint64_t>(p) * kPerProducer;
+        ASSERT_TRUE(q.Push(std::move(v)));
+      }
+    });
+  }
+  for (auto& t : producers) t.join();
+  q.Close();
+  for (auto& t : consumers) t.join();
+
+  const uint64_t n = kPerProducer * kProducers;
+  EXPECT_EQ(count.load(), n);
+  EXPECT_EQ(sum.load(), n * (n + 1) / 2);
+}
+
+/**
+ * @brief Case027b: Bounds, timeout and close semantics.
+ *
+ * Steps:
+ * - Capacity 3 rounds up to 4; fill it and expect TryPush to fail without
+ *   consuming the move-only argument.
+ * - Pop with a 20 ms timeout on an empty queue.
+ * - Block a consumer in Pop(), then Close() from another thread.
+ * Expected:
+ * - Full TryPush returns false and leaves the value intact.
+ * - Empty Pop returns kTimeout after roughly the timeout.
+ * - Close() wakes the blocked consumer with kClosed.
+ */
+TEST(FrameQueue, Case027b_BoundsTimeoutClose) {
+  FrameQueue<std::unique_ptr<int>, QueueKind::kSpsc> q(3);
+  EXPECT_EQ(q.Capacity(), 4u);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(q.TryPush(std::unique_ptr<int>(new int(i))));
+  }
+  std::unique_ptr<int> extra(new int(42));
+  EXPECT_FALSE(q.TryPush(std::move(extra)));
+  ASSERT_NE(extra, nullptr);
+  EXPECT_EQ(*extra, 42);
+
+  std::unique_ptr<int> out;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(q.TryPop(&out));
+    EXPECT_EQ(*out, i);
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  auto r = q.Pop(&out, 20);
+  auto waited = std::chrono::steady_clock::now() - t0;
+  EXPECT_EQ(r.Code(), ErrorCode::kTimeout);
+  EXPECT_GE(waited, std::chrono::milliseconds(15));
+
+  std::atomic<int> code{-1};
+  std::thread consumer([&] {
+    std::unique_ptr<int> v;
+    code.store(static_cast<int>(q.Pop(&v).Code()));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  q.Close();
+  consumer.join();
+  EXPECT_EQ(code.load(), static_cast<int>(ErrorCode::kClosed));
+  EXPECT_FALSE(q.TryPush(std::unique_ptr<int>(new int(1))));
+}
+
+/**
+ * @brief Case027d: Elements left in the queue are destroyed with it.
+ *
+ * Expected:
+ * - shared_ptr use counts drop back to 1 after the queue goes away.
+ */
+TEST(FrameQueue, Case027d_DestroysRemaining) {
+  auto token = std::make_shared<int>(7);
+  {
+    FrameQueue<std::shared_ptr<int>> mq(8);
+    FrameQueue<std::shared_ptr<int>, QueueKind::kSpsc> sq(8);
+    for (int i = 0; i < 3; ++i) {
+      std::shared_ptr<int> a = token;
+      std::shared_ptr<int> b = token;
+      ASSERT_TRUE(mq.TryPush(std::move(a)));
+      ASSERT_TRUE(sq.TryPush(std::move(b)));
+    }
+    EXPECT_EQ(token.use_count(), 7);
+  }
+  EXPECT_EQ(token.use_count(), 1);
+}
+
+}  // namespace
@@ -0,0 +1,259 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "axsys/image_view.hpp"
+#include "axsys/sys.hpp"
+#include "axsys/trace.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::ErrorCode;
+using axsys::Image;
+using axsys::ImagePlane;
+using axsys::ImageRect;
+using axsys::ImageSpan;
+using axsys::ImageView;
+using axsys::PixelFormat;
+using axsys::trace::Call;
+using axsys::trace::Event;
+
+std::vector<Event> EventsOf(Call call) {
+  std::vector<Event> out;
+  for (const Event& e : axsys::trace::Snapshot()) {
+    if (e.call == call) out.push_back(e);
+  }
+  return out;
+}
+
+/**
+ * @brief Case047: NV12 planes share one block with aligned rows.
+ *
+ * Steps:
+ * - Allocate a 100x50 NV12 image (64-byte rows, 4 KiB planes).
+ * Expected:
+ * - Strides 128, chroma plane at 8192 with 25 rows, Size() 11392.
+ * - Phys() of each plane is the block address plus its offset.
+ */
+TEST(ImageView, Case047_Nv12Layout) {
+  Image img;
+  ASSERT_TRUE(img.Allocate(100, 50, PixelFormat::kNv12, CacheMode::kCached,
+                           "image047"));
+  const ImageView full = img.View();
+  ASSERT_TRUE(full);
+  EXPECT_EQ(full.Planes(), 2u);
+  EXPECT_EQ(full.Stride(0), 128u);
+  EXPECT_EQ(full.Stride(1), 128u);
+  EXPECT_EQ(full.PlaneRows(1), 25u);
+  EXPECT_EQ(full.RowBytes(1), 100u);
+  EXPECT_EQ(full.Plane(1).offset, 8192u);
+  EXPECT_EQ(img.Size(), 8192u + 25 * 128);
+  EXPECT_EQ(full.Phys(0), img.Phys());
+  EXPECT_EQ(full.Phys(1), img.Phys() + 8192);
+}
+
+/**
+ * @brief Case047c: Crop() views the parent's pixels.
+ *
+ * Steps:
+ * - Allocate a 100x50 NV12 image; crop (10, 4, 20, 6) and write through
+ *   the crop.
+ * - Crop at odd x and past the right edge.
+ * Expected:
+ * - The crop's rows and Phys() point into the parent's planes (chroma at
+ *   row 2); the write shows in the parent.
+ * - kInvalidArgument; kOutOfRange.
+ */
+TEST(ImageView, Case047c_CropSharesParent) {
+  Image img;
+  ASSERT_TRUE(img.Allocate(100, 50, PixelFormat::kNv12, CacheMode::kCached,
+                           "image047"));
+  const ImageView full = img.View();
+  auto crop = full.Crop(ImageRect{10, 4, 20, 6});
+  ASSERT_TRUE(crop);
+  const ImageView roi = crop.Value();
+  EXPECT_EQ(roi.Width(), 20u);
+  EXPECT_EQ(roi.PlaneRows(1), 3u);
+  EXPECT_EQ(roi.Row(0, 0), full.Row(0, 4) + 10);
+  EXPECT_EQ(roi.Row(1, 1), full.Row(1, 3) + 10);
+  EXPECT_EQ(roi.Phys(0), full.Phys(0) + 4 * 128 + 10);
+  roi.Row(0, 5)[19] = 0x47;
+  EXPECT_EQ(full.Row(0, 9)[29], 0x47);
+  EXPECT_EQ(full.Crop(ImageRect{11, 4, 20, 6}).Code(),
+            ErrorCode::kInvalidArgument);
+  EXPECT_EQ(full.Crop(ImageRect{90, 0, 20, 6}).Code(), ErrorCode::kOutOfRange);
+}
+
+/**
+ * @brief Case047s: Full-width bands merge into one span per plane.
+ *
+ * Steps:
+ * - Allocate a 100x50 NV12 image; Spans() of rows 10..14 over the full
+ *   width for both planes, and of rows past the bottom.
+ * Expected:
+ * - One span per plane (row padding merged); no span past the bottom.
+ */
+TEST(ImageView, Case047s_FullWidthSpans) {
+  Image img;
+  ASSERT_TRUE(img.Allocate(100, 50, PixelFormat::kNv12, CacheMode::kCached,
+                           "image047"));
+  const ImageView full = img.View();
+  std::vector<ImageSpan> y = full.Spans(0, ImageRect{0, 10, 100, 5});
+  ASSERT_EQ(y.size(), 1u);
+  EXPECT_EQ(y[0].offset, 10u * 128);
+  EXPECT_EQ(y[0].size, 4u * 128 + 100);
+  std::vector<ImageSpan> uv = full.Spans(1, ImageRect{0, 10, 100, 5});
+  ASSERT_EQ(uv.size(), 1u);
+  EXPECT_EQ(uv[0].offset, 8192u + 5 * 128);
+  EXPECT_EQ(uv[0].size, 2u * 128 + 100);
+  EXPECT_TRUE(full.Spans(0, ImageRect{0, 45, 100, 6}).empty());
+}
+
+/**
+ * @brief Case047r: Column spans cover each row's bytes only.
+ *
+ * Steps:
+ * - Spans() of a 64-pixel column in a 1920-wide RAW16 image.
+ * - Spans() of pixels 1..2 of a RAW10 row; crop a RAW10 image at x = 2.
+ * Expected:
+ * - One 128-byte span per RAW16 row.
+ * - RAW10 rows are 80 bytes; the pixels cover bytes [1, 4); a crop that
+ *   splits a 4-pixel group is kInvalidArgument.
+ */
+TEST(ImageView, Case047r_ColumnSpans) {
+  Image raw;
+  ASSERT_TRUE(raw.Allocate(1920, 8, PixelFormat::kRaw16, CacheMode::kCached,
+                           "image047"));
+  std::vector<ImageSpan> col = raw.View().Spans(0, ImageRect{100, 0, 64, 4});
+  ASSERT_EQ(col.size(), 4u);
+  for (size_t r = 0; r < col.size(); ++r) {
+    EXPECT_EQ(col[r].offset, r * 3840 + 200);
+    EXPECT_EQ(col[r].size, 128u);
+  }
+
+  Image raw10;
+  ASSERT_TRUE(raw10.Allocate(64, 2, PixelFormat::kRaw10Packed,
+                             CacheMode::kCached, "image047"));
+  EXPECT_EQ(raw10.View().RowBytes(0), 80u);
+  std::vector<ImageSpan> px = raw10.View().Spans(0, ImageRect{1, 0, 2, 1});
+  ASSERT_EQ(px.size(), 1u);
+  EXPECT_EQ(px[0].offset, 1u);
+  EXPECT_EQ(px[0].size, 3u);
+  EXPECT_EQ(raw10.View().Crop(ImageRect{2, 0, 8, 1}).Code(),
+            ErrorCode::kInvalidArgument);
+}
+
+/**
+ * @brief Case047p: Cache maintenance covers only the rows asked for.
+ *
+ * Steps:
+ * - With tracing on, FlushRows(100, 16) of a cached 1920x1080 RAW16
+ *   image, then InvalidateRect() of a 32x8 ROI; FlushRows() of a
+ *   non-cached image.
+ * Expected:
+ * - One AX_SYS_MflushCache of 16 * 3840 bytes; eight
+ *   AX_SYS_MinvalidateCache calls of 64 bytes; no call for the non-cached
+ *   image.
+ */
+TEST(ImageView, Case047p_MaintenanceCalls) {
+#if !AXSYS_TRACE
+  GTEST_SKIP() << "built with AXSYS_TRACE=0";
+#endif
+  Image img;
+  ASSERT_TRUE(img.Allocate(1920, 1080, PixelFormat::kRaw16,
+                           CacheMode::kCached, "image047p"));
+  Image nc;
+  ASSERT_TRUE(nc.Allocate(64, 64, PixelFormat::kGray8, CacheMode::kNonCached,
+                          "image047p"));
+  const ImageView v = img.View();
+
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+  ASSERT_TRUE(v.FlushRows(100, 16));
+  ASSERT_TRUE(v.InvalidateRect(ImageRect{64, 200, 32, 8}));
+  ASSERT_TRUE(nc.View().FlushRows(0, 64));
+  axsys::trace::SetEnabled(false);
+  const std::vector<Event> flush = EventsOf(Call::kMflushCache);
+  ASSERT_EQ(flush.size(), 1u);
+  EXPECT_EQ(flush[0].bytes, 16u * 3840);
+  const std::vector<Event> inval = EventsOf(Call::kMinvalidateCache);
+  ASSERT_EQ(inval.size(), 8u);
+  for (const Event& e : inval) EXPECT_EQ(e.bytes, 64u);
+  axsys::trace::Clear();
+}
+
+/**
+ * @brief Case047o: Maintenance past the bottom row is rejected.
+ *
+ * Steps:
+ * - FlushRows(1070, 11) of a 1080-row image.
+ * Expected:
+ * - kOutOfRange.
+ */
+TEST(ImageView, Case047o_FlushPastBottom) {
+  Image img;
+  ASSERT_TRUE(img.Allocate(1920, 1080, PixelFormat::kRaw16,
+                           CacheMode::kCached, "image047o"));
+  EXPECT_EQ(img.View().FlushRows(1070, 11).Code(), ErrorCode::kOutOfRange);
+}
+
+/**
+ * @brief Case047w: Wrap() checks the plane against the geometry.
+ *
+ * Steps:
+ * - Wrap() a second view over an image's mapping with a short stride,
+ *   past the end of the view, with too few planes, and correctly.
+ * Expected:
+ * - kInvalidArgument, kOutOfRange, kInvalidArgument, then a view whose
+ *   rows match.
+ */
+TEST(ImageView, Case047w_Wrap) {
+  Image img;
+  ASSERT_TRUE(img.Allocate(1920, 1080, PixelFormat::kRaw16,
+                           CacheMode::kCached, "image047w"));
+  const ImageView v = img.View();
+  ImagePlane p = v.Plane(0);
+  p.stride = 3000;
+  EXPECT_EQ(ImageView::Wrap(1920, 1080, PixelFormat::kRaw16, &p, 1).Code(),
+            ErrorCode::kInvalidArgument);
+  p.stride = 3840;
+  EXPECT_EQ(ImageView::Wrap(1920, 1081, PixelFormat::kRaw16, &p, 1).Code(),
+            ErrorCode::kOutOfRange);
+  EXPECT_EQ(ImageView::Wrap(1920, 1080, PixelFormat::kNv12, &p, 1).Code(),
+            ErrorCode::kInvalidArgument);
+  auto w = ImageView::Wrap(1920, 1080, PixelFormat::kRaw16, &p, 1);
+  ASSERT_TRUE(w);
+  EXPECT_EQ(w.Value().Row(0, 1079), v.Row(0, 1079));
+}
+
+/**
+ * @brief Case047a: Allocate() checks its state and layout options.
+ *
+ * Steps:
+ * - Allocate() twice; Allocate() with a non-power-of-two alignment;
+ *   Free() and take a view.
+ * Expected:
+ * - kAlreadyInitialized, kInvalidArgument; an empty view after Free().
+ */
+TEST(ImageView, Case047a_AllocateChecks) {
+  Image img;
+  ASSERT_TRUE(img.Allocate(64, 64, PixelFormat::kGray8, CacheMode::kCached,
+                           "image047a"));
+  EXPECT_EQ(img.Allocate(16, 16, PixelFormat::kGray8, CacheMode::kCached,
+                         "image047a")
+                .Code(),
+            ErrorCode::kAlreadyInitialized);
+  Image bad;
+  axsys::ImageLayoutOptions opt;
+  opt.stride_align = 48;
+  EXPECT_EQ(bad.Allocate(16, 16, PixelFormat::kGray8, CacheMode::kCached,
+                         "image047a", opt)
+                .Code(),
+            ErrorCode::kInvalidArgument);
+  ASSERT_TRUE(img.Free());
+  EXPECT_FALSE(img.View());
+}
+
+}  // namespace
@@ -0,0 +1,308 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "axsys/cmm_stats.hpp"
+#include "axsys/kv_cache.hpp"
+#include "axsys/sys.hpp"
+#include "axsys/trace.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmStats;
+using axsys::ErrorCode;
+using axsys::KvCache;
+using axsys::KvCacheConfig;
+using axsys::KvCacheStats;
+
+KvCacheConfig SmallConfig(uint32_t pages, const char* token) {
+  KvCacheConfig cfg;
+  cfg.num_pages = pages;
+  cfg.tokens_per_page = 4;
+  cfg.bytes_per_token = 24;  // page stride rounds 96 up to 128
+  cfg.token = token;
+  return cfg;
+}
+
+bool AppendValue(KvCache* kv, uint32_t seq, uint8_t value) {
+  auto slot = kv->AppendToken(seq);
+  if (!slot) return false;
+  memset(slot.Value(), value, 24);
+  return true;
+}
+
+uint8_t TokenValue(const KvCache& kv, uint32_t seq, uint32_t pos) {
+  const void* p = kv.TokenData(seq, pos);
+  return p ? *static_cast<const uint8_t*>(p) : 0;
+}
+
+/** Creates a sequence holding tokens with values 1..@p n. */
+uint32_t Prompt(KvCache* kv, uint8_t n) {
+  auto seq = kv->CreateSequence();
+  if (!seq) return UINT32_MAX;
+  for (uint8_t v = 1; v <= n; ++v) {
+    if (!AppendValue(kv, seq.Value(), v)) return UINT32_MAX;
+  }
+  return seq.Value();
+}
+
+/**
+ * @brief Case043: A sequence's page table lists its physical pages.
+ *
+ * Steps:
+ * - Init 8 pages of 4 tokens x 24 bytes (token "kv043").
+ * - Append 6 tokens to a sequence; read PageTable(); Close().
+ * Expected:
+ * - The reservation is 8 * 128 bytes of 96-byte pages.
+ * - The sequence uses 2 pages whose PageTable() entries are PagePhys()
+ *   of them; Close() releases the reservation.
+ */
+TEST(KvCache, Case043_PageTable) {
+  KvCache kv;
+  ASSERT_TRUE(kv.Init(SmallConfig(8, "kv043")));
+  EXPECT_EQ(CmmStats::Snapshot().Find("kv043")->live_bytes, 8u * 128);
+  EXPECT_EQ(kv.PageBytes(), 96u);
+
+  const uint32_t p = Prompt(&kv, 6);
+  ASSERT_NE(p, UINT32_MAX);
+  auto table = kv.PageTable(p);
+  ASSERT_TRUE(table);
+  ASSERT_EQ(table.Value().size(), 2u);
+  EXPECT_EQ(table.Value()[0], kv.PagePhys(0));
+  EXPECT_EQ(table.Value()[1], kv.PagePhys(1));
+  ASSERT_TRUE(kv.Close());
+  EXPECT_EQ(CmmStats::Snapshot().Find("kv043")->live_bytes, 0u);
+}
+
+/**
+ * @brief Case043f: Forks share the prefix and copy the page they write.
+ *
+ * Steps:
+ * - Append 6 tokens (values 1..6) to a prompt sequence; fork two
+ *   sequences from it; append 7 to the first fork and 8 to the second.
+ * - Free the prompt and the first fork.
+ * Expected:
+ * - After forking, both pages have 3 references. Each fork's append
+ *   copies the shared half-full page: each fork reads 1..6 then its own
+ *   value, and the full first page stays shared by all three sequences.
+ * - Stats: 4 pages used, 1 shared, 20 tokens over 6 logical pages.
+ * - Freeing two sequences drops their references: 6 pages free.
+ */
+TEST(KvCache, Case043f_ForkCopiesOnWrite) {
+  KvCache kv;
+  ASSERT_TRUE(kv.Init(SmallConfig(8, "kv043f")));
+  const uint32_t p = Prompt(&kv, 6);
+  ASSERT_NE(p, UINT32_MAX);
+
+  auto a = kv.ForkSequence(p);
+  auto b = kv.ForkSequence(p);
+  ASSERT_TRUE(a && b);
+  EXPECT_EQ(kv.PageRefs(0), 3u);
+  EXPECT_EQ(kv.PageRefs(1), 3u);
+  ASSERT_TRUE(AppendValue(&kv, a.Value(), 7));
+  ASSERT_TRUE(AppendValue(&kv, b.Value(), 8));
+  for (uint32_t pos = 0; pos < 6; ++pos) {
+    EXPECT_EQ(TokenValue(kv, a.Value(), pos), pos + 1);
+    EXPECT_EQ(TokenValue(kv, b.Value(), pos), pos + 1);
+  }
+  EXPECT_EQ(TokenValue(kv, a.Value(), 6), 7);
+  EXPECT_EQ(TokenValue(kv, b.Value(), 6), 8);
+  EXPECT_EQ(kv.Length(p), 6u);
+  EXPECT_EQ(kv.PageRefs(0), 3u);
+  EXPECT_EQ(kv.PageRefs(1), 1u);
+
+  KvCacheStats st = kv.Stats();
+  EXPECT_EQ(st.pages_free, 4u);
+  EXPECT_EQ(st.pages_shared, 1u);
+  EXPECT_EQ(st.sequences, 3u);
+  EXPECT_EQ(st.tokens, 20u);
+  EXPECT_EQ(st.logical_pages, 6u);
+  EXPECT_DOUBLE_EQ(st.occupancy, 0.5);
+  // Fill 4 + 2 + 3 + 3 of 16 slots.
+  EXPECT_DOUBLE_EQ(st.fragmentation, 4.0 / 16.0);
+
+  ASSERT_TRUE(kv.FreeSequence(p));
+  ASSERT_TRUE(kv.FreeSequence(a.Value()));
+  EXPECT_EQ(kv.PageRefs(0), 1u);
+  EXPECT_EQ(kv.Stats().pages_free, 6u);
+}
+
+/**
+ * @brief Case043c: A copy-on-write into a cached reservation is flushed.
+ *
+ * Steps:
+ * - Init a cached reservation; append 2 tokens to a prompt and fork it.
+ * - With tracing, append one token to the fork.
+ * Expected:
+ * - One MflushCache call covering the 2 copied tokens (48 bytes).
+ */
+TEST(KvCache, Case043c_CachedCopyIsFlushed) {
+#if !AXSYS_TRACE
+  GTEST_SKIP() << "built with AXSYS_TRACE=0";
+#else
+  KvCacheConfig cfg = SmallConfig(8, "kv043c");
+  cfg.mode = CacheMode::kCached;
+  KvCache kv;
+  ASSERT_TRUE(kv.Init(cfg));
+  const uint32_t p = Prompt(&kv, 2);
+  ASSERT_NE(p, UINT32_MAX);
+  auto fork = kv.ForkSequence(p);
+  ASSERT_TRUE(fork);
+
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+  auto slot = kv.AppendToken(fork.Value());
+  axsys::trace::SetEnabled(false);
+  ASSERT_TRUE(slot);
+  size_t flushes = 0;
+  uint64_t flushed = 0;
+  for (const auto& e : axsys::trace::Snapshot()) {
+    if (e.call != axsys::trace::Call::kMflushCache) continue;
+    ++flushes;
+    flushed += e.bytes;
+  }
+  axsys::trace::Clear();
+  EXPECT_EQ(flushes, 1u);
+  EXPECT_EQ(flushed, 48u);
+#endif
+}
+
+/**
+ * @brief Case043x: Appending past the last page fails.
+ *
+ * Steps:
+ * - Init 8 pages; append 6 tokens to a sequence, then append until it
+ *   fails.
+ * Expected:
+ * - The rest of page 2 and the 6 free pages fill (26 tokens), then
+ *   kAllocationFailed with no page left.
+ */
+TEST(KvCache, Case043x_AppendUntilExhausted) {
+  KvCache kv;
+  ASSERT_TRUE(kv.Init(SmallConfig(8, "kv043x")));
+  const uint32_t p = Prompt(&kv, 6);
+  ASSERT_NE(p, UINT32_MAX);
+  uint32_t appended = 0;
+  for (;;) {
+    auto slot = kv.AppendToken(p);
+    if (!slot) {
+      EXPECT_EQ(slot.Code(), ErrorCode::kAllocationFailed);
+      break;
+    }
+    ++appended;
+  }
+  EXPECT_EQ(appended, 2u + 6 * 4);  // rest of page 2, then 6 free pages
+  EXPECT_EQ(kv.Stats().pages_free, 0u);
+}
+
+/**
+ * @brief Case043u: Unknown sequences and positions are out of range.
+ *
+ * Steps:
+ * - Append to a freed sequence; fork sequence 99; read a position past
+ *   the end of a live sequence.
+ * Expected:
+ * - kOutOfRange, kOutOfRange and nullptr.
+ */
+TEST(KvCache, Case043u_UnknownSequence) {
+  KvCache kv;
+  ASSERT_TRUE(kv.Init(SmallConfig(8, "kv043u")));
+  const uint32_t p = Prompt(&kv, 2);
+  ASSERT_NE(p, UINT32_MAX);
+  auto gone = kv.CreateSequence();
+  ASSERT_TRUE(gone);
+  ASSERT_TRUE(kv.FreeSequence(gone.Value()));
+
+  EXPECT_EQ(kv.AppendToken(gone.Value()).Code(), ErrorCode::kOutOfRange);
+  EXPECT_EQ(kv.ForkSequence(99).Code(), ErrorCode::kOutOfRange);
+  EXPECT_EQ(kv.TokenData(p, 1000), nullptr);
+}
+
+/**
+ * @brief Case043p: Lock-free page allocation from several threads.
+ *
+ * Steps:
+ * - Init 256 pages; four threads each take and return pages 20000 times,
+ *   holding up to 32 at once and tagging each page they hold.
+ * Expected:
+ * - No thread sees its tag overwritten (no page handed out twice) and all
+ *   256 pages are free afterwards.
+ */
+TEST(KvCache, Case043p_ConcurrentPages) {
+  KvCache kv;
+  ASSERT_TRUE(kv.Init(SmallConfig(256, "kv043p")));
+
+  std::vector<int> errors(4, 0);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&kv, &errors, t] {
+      std::vector<uint32_t> held;
+      uint32_t x = static_cast<uint32_t>(t) + 1;
+      for (int i = 0; i < 20000; ++i) {
+        x = x * 1664525u + 1013904223u;
+        if (held.size() < 32 && (x >> 31) != 0) {
+          const uint32_t page = kv.AllocPage();
+          if (page == axsys::kNoKvPage) continue;
+          memset(kv.PageData(page), static_cast<int>(t), kv.PageBytes());
+          held.push_back(page);
+        } else if (!held.empty()) {
+          const uint32_t page = held.back();
+          held.pop_back();
+          const uint8_t* d = static_cast<const uint8_t*>(kv.PageData(page));
+          if (d[0] != t || d[kv.PageBytes() - 1] != t) ++errors[t];
+          kv.ReleasePage(page);
+        }
+      }
+      for (uint32_t page : held) kv.ReleasePage(page);
+    });
+  }
+  for (auto& th : threads) th.join();
+  for (size_t t = 0; t < 4; ++t) EXPECT_EQ(errors[t], 0) << "thread " << t;
+  EXPECT_EQ(kv.Stats().pages_free, 256u);
+}
+
+/**
+ * @brief Case043a: Every page can be taken exactly once.
+ *
+ * Steps:
+ * - Init 256 pages and take every page from one thread, then one more.
+ * Expected:
+ * - 256 distinct pages, then kNoKvPage; occupancy 1.
+ */
+TEST(KvCache, Case043a_AllocEveryPage) {
+  KvCache kv;
+  ASSERT_TRUE(kv.Init(SmallConfig(256, "kv043a")));
+  std::set<uint32_t> pages;
+  for (uint32_t i = 0; i < 256; ++i) pages.insert(kv.AllocPage());
+  EXPECT_EQ(pages.size(), 256u);
+  EXPECT_EQ(pages.count(axsys::kNoKvPage), 0u);
+  EXPECT_EQ(kv.AllocPage(), axsys::kNoKvPage);
+  EXPECT_DOUBLE_EQ(kv.Stats().occupancy, 1.0);
+}
+
+/**
+ * @brief Case043i: Init() checks its state and configuration.
+ *
+ * Steps:
+ * - Init a second time; Init with zero pages on a fresh cache and create
+ *   a sequence on it.
+ * Expected:
+ * - kAlreadyInitialized, kInvalidArgument and kNotInitialized.
+ */
+TEST(KvCache, Case043i_InitChecks) {
+  KvCache kv;
+  KvCacheConfig cfg = SmallConfig(8, "kv043i");
+  ASSERT_TRUE(kv.Init(cfg));
+  EXPECT_EQ(kv.Init(cfg).Code(), ErrorCode::kAlreadyInitialized);
+  KvCache empty;
+  cfg.num_pages = 0;
+  EXPECT_EQ(empty.Init(cfg).Code(), ErrorCode::kInvalidArgument);
+  EXPECT_EQ(empty.CreateSequence().Code(), ErrorCode::kNotInitialized);
+}
+
+}  // namespace
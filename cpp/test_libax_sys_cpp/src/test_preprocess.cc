@@ -0,0 +1,445 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "axsys/preprocess.hpp"
+#include "axsys/sys.hpp"
+#include "axsys/trace.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::ChannelOrder;
+using axsys::ErrorCode;
+using axsys::Image;
+using axsys::ImageRect;
+using axsys::ImageView;
+using axsys::PixelFormat;
+using axsys::QuantParams;
+using axsys::ResizeFilter;
+using axsys::TensorLayout;
+using axsys::TensorType;
+using axsys::TensorView;
+
+int Clamp(int v) { return std::min(255, std::max(0, v)); }
+
+void FillRandom(const ImageView& v, std::mt19937* rng) {
+  for (uint32_t p = 0; p < v.Planes(); ++p) {
+    for (uint32_t y = 0; y < v.PlaneRows(p); ++y) {
+      uint8_t* row = v.Row(p, y);
+      for (size_t x = 0; x < v.RowBytes(p); ++x) {
+        row[x] = static_cast<uint8_t>((*rng)());
+      }
+    }
+  }
+  ASSERT_TRUE(v.FlushRows(0, v.Height()));  // kernels invalidate sources
+}
+
+// Float bilinear with pixel centres aligned, the reference for Resize().
+float RefBilinear(const ImageView& s, uint32_t ch, uint32_t c, double sx,
+                  double sy) {
+  sx = std::max(0.0, sx);
+  sy = std::max(0.0, sy);
+  const uint32_t x0 = std::min(static_cast<uint32_t>(sx), s.Width() - 1);
+  const uint32_t y0 = std::min(static_cast<uint32_t>(sy), s.Height() - 1);
+  const uint32_t x1 = std::min(x0 + 1, s.Width() - 1);
+  const uint32_t y1 = std::min(y0 + 1, s.Height() - 1);
+  const double fx = x1 == x0 ? 0.0 : sx - x0;
+  const double fy = y1 == y0 ? 0.0 : sy - y0;
+  auto at = [&](uint32_t x, uint32_t y) {
+    return static_cast<double>(s.Row(0, y)[x * ch + c]);
+  };
+  const double top = at(x0, y0) * (1 - fx) + at(x1, y0) * fx;
+  const double bottom = at(x0, y1) * (1 - fx) + at(x1, y1) * fx;
+  return static_cast<float>(top * (1 - fy) + bottom * fy);
+}
+
+/**
+ * @brief Case048: NV12/NV21 to RGB/BGR matches integer BT.601.
+ *
+ * Steps:
+ * - Convert random 37x6 NV12 and NV21 images to RGB and BGR.
+ * Expected:
+ * - Every channel within 1 of integer BT.601 (298/409/100/208/516 >> 8);
+ *   NV21 and BGR swap the expected components.
+ */
+TEST(Preprocess, Case048_Nv12ToRgb) {
+  std::mt19937 rng(48);
+  for (PixelFormat fmt : {PixelFormat::kNv12, PixelFormat::kNv21}) {
+    for (ChannelOrder order : {ChannelOrder::kRgb, ChannelOrder::kBgr}) {
+      Image nv, rgb;
+      ASSERT_TRUE(nv.Allocate(37, 6, fmt, CacheMode::kCached, "pre048"));
+      ASSERT_TRUE(rgb.Allocate(37, 6, PixelFormat::kRgb888,
+                               CacheMode::kCached, "pre048"));
+      FillRandom(nv.View(), &rng);
+      ASSERT_TRUE(axsys::Nv12ToRgb(nv.View(), rgb.View(), order));
+      int worst = 0;
+      for (uint32_t y = 0; y < 6; ++y) {
+        for (uint32_t x = 0; x < 37; ++x) {
+          const uint8_t* uv = nv.View().Row(1, y / 2) + (x & ~1u);
+          const int c = nv.View().Row(0, y)[x] - 16;
+          int d = uv[0] - 128;
+          int e = uv[1] - 128;
+          if (fmt == PixelFormat::kNv21) std::swap(d, e);
+          const int r = Clamp((298 * c + 409 * e + 128) >> 8);
+          const int g = Clamp((298 * c - 100 * d - 208 * e + 128) >> 8);
+          const int b = Clamp((298 * c + 516 * d + 128) >> 8);
+          const uint8_t* o = rgb.View().Row(0, y) + x * 3;
+          const int first = order == ChannelOrder::kRgb ? r : b;
+          const int last = order == ChannelOrder::kRgb ? b : r;
+          worst = std::max({worst, abs(o[0] - first), abs(o[1] - g),
+                            abs(o[2] - last)});
+        }
+      }
+      EXPECT_LE(worst, 1) << "format " << static_cast<int>(fmt) << " order "
+                          << static_cast<int>(order);
+    }
+  }
+}
+
+/**
+ * @brief Case048b: Bilinear resize matches the float reference.
+ *
+ * Steps:
+ * - Bilinear resize of a random 50x30 RGB image to 23x47.
+ * Expected:
+ * - Every channel within 2 of the float reference.
+ */
+TEST(Preprocess, Case048b_BilinearResize) {
+  std::mt19937 rng(481);
+  Image src, bil;
+  ASSERT_TRUE(
+      src.Allocate(50, 30, PixelFormat::kRgb888, CacheMode::kCached, "pre048"));
+  ASSERT_TRUE(
+      bil.Allocate(23, 47, PixelFormat::kRgb888, CacheMode::kCached, "pre048"));
+  FillRandom(src.View(), &rng);
+  const ImageView s = src.View();
+  ASSERT_TRUE(axsys::Resize(s, bil.View(), ResizeFilter::kBilinear));
+  float worst = 0;
+  for (uint32_t y = 0; y < 47; ++y) {
+    for (uint32_t x = 0; x < 23; ++x) {
+      const double sx = (x + 0.5) * 50 / 23 - 0.5;
+      const double sy = (y + 0.5) * 30 / 47 - 0.5;
+      for (uint32_t c = 0; c < 3; ++c) {
+        const float ref = RefBilinear(s, 3, c, sx, sy);
+        const float got = bil.View().Row(0, y)[x * 3 + c];
+        worst = std::max(worst, fabsf(got - ref));
+      }
+    }
+  }
+  EXPECT_LE(worst, 2.0f);
+}
+
+/**
+ * @brief Case048n: Nearest resize picks the centre-aligned source pixel.
+ *
+ * Steps:
+ * - Nearest resize of a random 50x30 RGB image to 23x47.
+ * Expected:
+ * - Every pixel equals the source pixel under its centre, exactly.
+ */
+TEST(Preprocess, Case048n_NearestResize) {
+  std::mt19937 rng(482);
+  Image src, near;
+  ASSERT_TRUE(
+      src.Allocate(50, 30, PixelFormat::kRgb888, CacheMode::kCached, "pre048"));
+  ASSERT_TRUE(near.Allocate(23, 47, PixelFormat::kRgb888, CacheMode::kCached,
+                            "pre048"));
+  FillRandom(src.View(), &rng);
+  const ImageView s = src.View();
+  ASSERT_TRUE(axsys::Resize(s, near.View(), ResizeFilter::kNearest));
+  size_t near_bad = 0;
+  for (uint32_t y = 0; y < 47; ++y) {
+    for (uint32_t x = 0; x < 23; ++x) {
+      const uint32_t nx = (2 * x + 1) * 50 / 46;
+      const uint32_t ny = (2 * y + 1) * 30 / 94;
+      for (uint32_t c = 0; c < 3; ++c) {
+        if (near.View().Row(0, y)[x * 3 + c] != s.Row(0, ny)[nx * 3 + c]) {
+          ++near_bad;
+        }
+      }
+    }
+  }
+  EXPECT_EQ(near_bad, 0u);
+}
+
+/**
+ * @brief Case048s: A same-size resize is an exact copy.
+ *
+ * Steps:
+ * - Bilinear resize of a random 50x30 RGB image to 50x30.
+ * Expected:
+ * - Every row equals the source row.
+ */
+TEST(Preprocess, Case048s_SameSizeCopies) {
+  std::mt19937 rng(483);
+  Image src, same;
+  ASSERT_TRUE(
+      src.Allocate(50, 30, PixelFormat::kRgb888, CacheMode::kCached, "pre048"));
+  ASSERT_TRUE(same.Allocate(50, 30, PixelFormat::kRgb888, CacheMode::kCached,
+                            "pre048"));
+  FillRandom(src.View(), &rng);
+  const ImageView s = src.View();
+  ASSERT_TRUE(axsys::Resize(s, same.View(), ResizeFilter::kBilinear));
+  for (uint32_t y = 0; y < 30; ++y) {
+    ASSERT_EQ(memcmp(same.View().Row(0, y), s.Row(0, y), 150), 0) << y;
+  }
+}
+
+/**
+ * @brief Case048l: Letterbox scales to fit and pads the rest.
+ *
+ * Steps:
+ * - Letterbox a uniform 200x100 image into 64x64 with pad 114.
+ * Expected:
+ * - Scale 0.32, content (0, 16, 64, 32), pad rows and the content edge.
+ */
+TEST(Preprocess, Case048l_Letterbox) {
+  Image wide, box;
+  ASSERT_TRUE(wide.Allocate(200, 100, PixelFormat::kRgb888, CacheMode::kCached,
+                            "pre048"));
+  ASSERT_TRUE(
+      box.Allocate(64, 64, PixelFormat::kRgb888, CacheMode::kCached, "pre048"));
+  for (uint32_t y = 0; y < 100; ++y) memset(wide.View().Row(0, y), 7, 600);
+  ASSERT_TRUE(wide.View().FlushRows(0, 100));
+  auto info = axsys::Letterbox(wide.View(), box.View());
+  ASSERT_TRUE(info) << info.Message();
+  EXPECT_FLOAT_EQ(info.Value().scale, 0.32f);
+  EXPECT_EQ(info.Value().content.x, 0u);
+  EXPECT_EQ(info.Value().content.y, 16u);
+  EXPECT_EQ(info.Value().content.width, 64u);
+  EXPECT_EQ(info.Value().content.height, 32u);
+  EXPECT_EQ(box.View().Row(0, 15)[0], 114);
+  EXPECT_EQ(box.View().Row(0, 16)[0], 7);
+  EXPECT_EQ(box.View().Row(0, 47)[191], 7);
+  EXPECT_EQ(box.View().Row(0, 48)[191], 114);
+}
+
+/**
+ * @brief Case048f: Mismatched formats and sizes are rejected.
+ *
+ * Steps:
+ * - Resize Gray8 into RGB888; convert NV12 into a smaller RGB image.
+ * Expected:
+ * - kInvalidArgument for both.
+ */
+TEST(Preprocess, Case048f_FormatMismatch) {
+  Image box, gray, nv;
+  ASSERT_TRUE(
+      box.Allocate(64, 64, PixelFormat::kRgb888, CacheMode::kCached, "pre048"));
+  ASSERT_TRUE(
+      gray.Allocate(16, 16, PixelFormat::kGray8, CacheMode::kCached, "pre048"));
+  EXPECT_EQ(axsys::Resize(gray.View(), box.View()).Code(),
+            ErrorCode::kInvalidArgument);
+  ASSERT_TRUE(nv.Allocate(64, 32, PixelFormat::kNv12, CacheMode::kCached,
+                          "pre048"));
+  EXPECT_EQ(axsys::Nv12ToRgb(nv.View(), box.View()).Code(),
+            ErrorCode::kInvalidArgument);
+}
+
+/**
+ * @brief Case048p: ToTensor() quantizes per channel in both layouts.
+ *
+ * Steps:
+ * - ToTensor() a random 35x9 RGB image into HWC u8 (default params), CHW
+ *   i8 with zero_point -128, and CHW u8 with mean/scale per channel.
+ * - ToTensor() a 35x9 gray image into an i8 tensor.
+ * Expected:
+ * - Every element equals clamp(round((x - mean) * scale) + zero_point).
+ */
+TEST(Preprocess, Case048p_ToTensor) {
+  std::mt19937 rng(480);
+  Image img;
+  ASSERT_TRUE(
+      img.Allocate(35, 9, PixelFormat::kRgb888, CacheMode::kCached, "pre048p"));
+  FillRandom(img.View(), &rng);
+  const ImageView v = img.View();
+  axsys::CmmBuffer tbuf;
+  auto tv = tbuf.Allocate(4096, CacheMode::kCached, "pre048p");
+  ASSERT_TRUE(tv);
+  axsys::CmmView tview = tv.MoveValue();
+
+  QuantParams norm;
+  norm.mean[0] = 123.7f;
+  norm.mean[1] = 116.3f;
+  norm.mean[2] = 103.5f;
+  norm.scale[0] = 0.5f;
+  norm.scale[1] = 0.25f;
+  norm.scale[2] = 2.0f;
+  norm.zero_point = 10;
+  QuantParams to_i8;
+  to_i8.zero_point = -128;
+  struct Case {
+    TensorLayout layout;
+    TensorType type;
+    QuantParams q;
+  };
+  for (const Case& k : {Case{TensorLayout::kHwc, TensorType::kU8, {}},
+                        Case{TensorLayout::kChw, TensorType::kI8, to_i8},
+                        Case{TensorLayout::kChw, TensorType::kU8, norm}}) {
+    TensorView t{&tview, 64, 35, 9, 3, k.layout, k.type};
+    ASSERT_TRUE(axsys::ToTensor(v, t, k.q));
+    const uint8_t* out = static_cast<const uint8_t*>(tview.Data()) + 64;
+    const long lo = k.type == TensorType::kU8 ? 0 : -128;
+    const long hi = k.type == TensorType::kU8 ? 255 : 127;
+    size_t bad = 0;
+    for (uint32_t y = 0; y < 9; ++y) {
+      for (uint32_t x = 0; x < 35; ++x) {
+        for (uint32_t c = 0; c < 3; ++c) {
+          const float in = v.Row(0, y)[x * 3 + c];
+          long ref = lroundf((in - k.q.mean[c]) * k.q.scale[c]) +
+                     k.q.zero_point;
+          ref = std::min(hi, std::max(lo, ref));
+          const size_t i = k.layout == TensorLayout::kHwc
+                               ? (y * 35 + x) * 3 + c
+                               : c * 35 * 9 + y * 35 + x;
+          if (out[i] != static_cast<uint8_t>(ref & 0xff)) ++bad;
+        }
+      }
+    }
+    EXPECT_EQ(bad, 0u) << static_cast<int>(k.layout) << "/"
+                       << static_cast<int>(k.type);
+  }
+  Image gray;
+  ASSERT_TRUE(
+      gray.Allocate(35, 9, PixelFormat::kGray8, CacheMode::kCached, "pre048p"));
+  FillRandom(gray.View(), &rng);
+  TensorView gt{&tview, 0, 35, 9, 1, TensorLayout::kChw, TensorType::kI8};
+  ASSERT_TRUE(axsys::ToTensor(gray.View(), gt, to_i8));
+  EXPECT_EQ(static_cast<const uint8_t*>(tview.Data())[35 * 8 + 34],
+            static_cast<uint8_t>(gray.View().Row(0, 8)[34] - 128));
+}
+
+/**
+ * @brief Case048t: Thread counts give identical output.
+ *
+ * Steps:
+ * - Nv12ToRgb and bilinear Resize of a random 300x200 image with 1 and 4
+ *   threads.
+ * Expected:
+ * - Byte-identical results for both thread counts.
+ */
+TEST(Preprocess, Case048t_ThreadCountsMatch) {
+  std::mt19937 rng(484);
+  Image nv, rgb1, rgb4, small1, small4;
+  ASSERT_TRUE(
+      nv.Allocate(300, 200, PixelFormat::kNv12, CacheMode::kCached, "pre048p"));
+  for (Image* i : {&rgb1, &rgb4}) {
+    ASSERT_TRUE(i->Allocate(300, 200, PixelFormat::kRgb888, CacheMode::kCached,
+                            "pre048p"));
+  }
+  for (Image* i : {&small1, &small4}) {
+    ASSERT_TRUE(i->Allocate(97, 61, PixelFormat::kRgb888, CacheMode::kCached,
+                            "pre048p"));
+  }
+  FillRandom(nv.View(), &rng);
+  ASSERT_TRUE(axsys::Nv12ToRgb(nv.View(), rgb1.View(), ChannelOrder::kRgb, 1));
+  ASSERT_TRUE(axsys::Nv12ToRgb(nv.View(), rgb4.View(), ChannelOrder::kRgb, 4));
+  ASSERT_TRUE(axsys::Resize(rgb1.View(), small1.View(),
+                            ResizeFilter::kBilinear, 1));
+  ASSERT_TRUE(axsys::Resize(rgb1.View(), small4.View(),
+                            ResizeFilter::kBilinear, 4));
+  for (uint32_t y = 0; y < 200; ++y) {
+    ASSERT_EQ(memcmp(rgb1.View().Row(0, y), rgb4.View().Row(0, y), 900), 0);
+  }
+  for (uint32_t y = 0; y < 61; ++y) {
+    ASSERT_EQ(memcmp(small1.View().Row(0, y), small4.View().Row(0, y), 291),
+              0);
+  }
+}
+
+/**
+ * @brief Case048c: CropImage() copies both NV12 planes of the rectangle.
+ *
+ * Steps:
+ * - CropImage() rect (10, 4, 20, 6) of a random 300x200 NV12 image with
+ *   2 threads.
+ * Expected:
+ * - Luma and chroma rows of the crop equal the source rectangle.
+ */
+TEST(Preprocess, Case048c_CropImage) {
+  std::mt19937 rng(485);
+  Image nv, crop;
+  ASSERT_TRUE(
+      nv.Allocate(300, 200, PixelFormat::kNv12, CacheMode::kCached, "pre048p"));
+  ASSERT_TRUE(
+      crop.Allocate(20, 6, PixelFormat::kNv12, CacheMode::kCached, "pre048p"));
+  FillRandom(nv.View(), &rng);
+  ASSERT_TRUE(axsys::CropImage(nv.View(), ImageRect{10, 4, 20, 6},
+                               crop.View(), 2));
+  for (uint32_t y = 0; y < 6; ++y) {
+    ASSERT_EQ(memcmp(crop.View().Row(0, y), nv.View().Row(0, 4 + y) + 10, 20),
+              0);
+  }
+  for (uint32_t y = 0; y < 3; ++y) {
+    ASSERT_EQ(memcmp(crop.View().Row(1, y), nv.View().Row(1, 2 + y) + 10, 20),
+              0);
+  }
+}
+
+/**
+ * @brief Case048w: Only the rows written are flushed.
+ *
+ * Steps:
+ * - With tracing, Resize() a 97x61 RGB image into the (8, 8, 16, 4)
+ *   rectangle of a cached 256x64 RGB image.
+ * Expected:
+ * - Four AX_SYS_MflushCache calls of 48 bytes.
+ */
+TEST(Preprocess, Case048w_FlushWrittenRowsOnly) {
+#if !AXSYS_TRACE
+  GTEST_SKIP() << "built with AXSYS_TRACE=0";
+#else
+  std::mt19937 rng(486);
+  Image small, canvas;
+  ASSERT_TRUE(small.Allocate(97, 61, PixelFormat::kRgb888, CacheMode::kCached,
+                             "pre048p"));
+  ASSERT_TRUE(canvas.Allocate(256, 64, PixelFormat::kRgb888,
+                              CacheMode::kCached, "pre048p"));
+  FillRandom(small.View(), &rng);
+  const ImageView roi = canvas.View().Crop(ImageRect{8, 8, 16, 4}).Value();
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+  ASSERT_TRUE(axsys::Resize(small.View(), roi));
+  axsys::trace::SetEnabled(false);
+  size_t flushes = 0;
+  for (const auto& e : axsys::trace::Snapshot()) {
+    if (e.call != axsys::trace::Call::kMflushCache) continue;
+    ++flushes;
+    EXPECT_EQ(e.bytes, 48u);
+  }
+  EXPECT_EQ(flushes, 4u);
+  axsys::trace::Clear();
+#endif
+}
+
+/**
+ * @brief Case048o: A tensor past the end of its view is rejected.
+ *
+ * Steps:
+ * - ToTensor() with a 35x9x3 tensor at offset 4000 of a 4 KiB view.
+ * Expected:
+ * - kInvalidArgument; a kernel name is reported.
+ */
+TEST(Preprocess, Case048o_TensorPastView) {
+  Image img;
+  ASSERT_TRUE(
+      img.Allocate(35, 9, PixelFormat::kRgb888, CacheMode::kCached, "pre048p"));
+  axsys::CmmBuffer tbuf;
+  auto tv = tbuf.Allocate(4096, CacheMode::kCached, "pre048p");
+  ASSERT_TRUE(tv);
+  axsys::CmmView tview = tv.MoveValue();
+  TensorView past{&tview, 4000, 35, 9, 3, TensorLayout::kHwc,
+                  TensorType::kU8};
+  EXPECT_EQ(axsys::ToTensor(img.View(), past).Code(),
+            ErrorCode::kInvalidArgument);
+  EXPECT_NE(axsys::PreprocessKernelName(), nullptr);
+}
+
+}  // namespace
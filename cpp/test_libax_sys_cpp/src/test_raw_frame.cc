@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "axsys/frame_queue.hpp"
+#include "axsys/raw_frame.hpp"
+#include "axsys/raw_pack.hpp"
+#include "axsys/replay_frame_source.hpp"
+#include "axsys/sys.hpp"
+#include "axsys/vin_raw_frame.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::ErrorCode;
+using axsys::PoolGauge;
+using axsys::RawFrame;
+
+RawFrame::Info MakeInfo(uint64_t phys, uint32_t size, uint64_t seq) {
+  RawFrame::Info info{};
+  info.width = 64;
+  info.height = size / 64;
+  info.seq = seq;
+  info.plane_count = 1;
+  info.planes[0].phys = phys;
+  info.planes[0].stride = 64;
+  info.planes[0].size = size;
+  return info;
+}
+
+/**
+ * @brief Case028: A frame is released exactly once, on the consuming thread.
+ *
+ * Purpose:
+ * - Model the capture -> worker handoff: frames are moved through a
+ *   FrameQueue and dropped by the worker.
+ * Steps:
+ * - Create 100 frames with a counting releaser and push them to a queue;
+ *   a second thread pops and destroys them.
+ * Expected:
+ * - Each frame's releaser runs once, on the worker thread.
+ * - The pushed handles are empty; the gauge returns to zero held after
+ *   100 acquisitions.
+ */
+TEST(RawFrame, Case028_ReleaseOnceAcrossThreads) {
+  constexpr int kFrames = 100;
+  PoolGauge gauge(4);
+  std::vector<std::atomic<int>> released(kFrames);
+  std::atomic<int> foreign_thread{0};
+  for (auto& r : released) r.store(0);
+
+  axsys::FrameQueue<RawFrame, axsys::QueueKind::kSpsc> q(4);
+  const std::thread::id producer_id = std::this_thread::get_id();
+  std::thread worker([&] {
+    RawFrame f;
+    while (q.Pop(&f)) f.Release();
+  });
+  for (int i = 0; i < kFrames; ++i) {
+    RawFrame f(MakeInfo(0x1000, 64, static_cast<uint64_t>(i)),
+               [&released, &foreign_thread, producer_id, i] {
+                 released[static_cast<size_t>(i)].fetch_add(1);
+                 if (std::this_thread::get_id() != producer_id) {
+                   foreign_thread.fetch_add(1);
+                 }
+               },
+               &gauge);
+    ASSERT_TRUE(q.Push(std::move(f)));
+    EXPECT_FALSE(f);
+  }
+  q.Close();
+  worker.join();
+  for (auto& r : released) EXPECT_EQ(r.load(), 1);
+  EXPECT_EQ(foreign_thread.load(), kFrames);
+
+  const PoolGauge::Snapshot s = gauge.Read();
+  EXPECT_EQ(s.held, 0u);
+  EXPECT_EQ(s.acquired, static_cast<uint64_t>(kFrames));
+  EXPECT_EQ(s.released, s.acquired);
+}
+
+/**
+ * @brief Case028m: Moves transfer the release; Release() is idempotent.
+ *
+ * Steps:
+ * - Move-construct b from a; move-assign b over a live frame c.
+ * - Release() c twice, then let all three go out of scope.
+ * Expected:
+ * - The assignment releases c's original frame; the two Release() calls
+ *   release the moved frame once; moved-from handles release nothing.
+ * - Gauge: 2 acquisitions, 2 releases, none held.
+ */
+TEST(RawFrame, Case028m_MoveAndRepeatedRelease) {
+  PoolGauge gauge(4);
+  int count = 0;
+  {
+    RawFrame a(MakeInfo(0x1000, 64, 0), [&count] { ++count; }, &gauge);
+    RawFrame b(std::move(a));
+    RawFrame c(MakeInfo(0x2000, 64, 1), [&count] { ++count; }, &gauge);
+    c = std::move(b);  // releases c's original frame
+    EXPECT_EQ(count, 1);
+    c.Release();
+    c.Release();
+    EXPECT_EQ(count, 2);
+  }
+  EXPECT_EQ(count, 2);
+
+  const PoolGauge::Snapshot s = gauge.Read();
+  EXPECT_EQ(s.held, 0u);
+  EXPECT_EQ(s.acquired, 2u);
+  EXPECT_EQ(s.released, 2u);
+}
+
+/**
+ * @brief Case028p: Planes are mapped lazily, once.
+ *
+ * Steps:
+ * - Allocate 64KiB, fill a pattern; wrap it as a one-plane frame.
+ * - Call Plane(0) twice, Plane(1) once; Release() and call Plane(0).
+ * Expected:
+ * - Plane(0) maps once and returns the same view with matching bytes.
+ * - Plane(1) is kOutOfRange; Plane() after Release() is kNoAllocation.
+ */
+TEST(RawFrame, Case028p_LazyPlaneMapping) {
+  constexpr uint32_t kLen = 64 * 1024;
+  axsys::CmmBuffer buf;
+  auto r = buf.Allocate(kLen, CacheMode::kNonCached, "gtest_028p");
+  ASSERT_TRUE(r) << r.Message();
+  axsys::CmmView base = r.MoveValue();
+  memset(base.Data(), 0xa5, kLen);
+
+  RawFrame frame(MakeInfo(buf.Phys(), kLen, 0), nullptr, nullptr);
+  auto p = frame.Plane(0);
+  ASSERT_TRUE(p) << p.Message();
+  ASSERT_EQ(p.Value()->Size(), kLen);
+  EXPECT_EQ(memcmp(p.Value()->Data(), base.Data(), kLen), 0);
+  auto again = frame.Plane(0);
+  ASSERT_TRUE(again);
+  EXPECT_EQ(again.Value(), p.Value());
+  EXPECT_EQ(frame.Plane(1).Code(), ErrorCode::kOutOfRange);
+  frame.Release();
+  EXPECT_EQ(frame.Plane(0).Code(), ErrorCode::kNoAllocation);
+}
+
+/**
+ * @brief Case028g: The gauge tracks held frames and exhaustion.
+ *
+ * Steps:
+ * - Hold four frames against a gauge of capacity 4, then drop them.
+ * Expected:
+ * - While held: held == 4, peak == 4, exhausted == 1.
+ * - Afterwards held == 0.
+ */
+TEST(RawFrame, Case028g_GaugeTracksExhaustion) {
+  PoolGauge gauge(4);
+  {
+    std::vector<RawFrame> held;
+    for (uint64_t i = 0; i < 4; ++i) {
+      held.emplace_back(MakeInfo(0x1000 + i * 0x1000, 4096, i), nullptr,
+                        &gauge);
+    }
+    const PoolGauge::Snapshot s = gauge.Read();
+    EXPECT_EQ(s.held, 4u);
+    EXPECT_EQ(s.peak, 4u);
+    EXPECT_EQ(s.exhausted, 1u);
+  }
+  EXPECT_EQ(gauge.Read().held, 0u);
+}
+
+/**
+ * @brief Case028s: VIN and replayed frames report the stride in bytes.
+ *
+ * Steps:
+ * - Describe a 64x4 RAW10 packed VIN frame with a 64-pixel stride.
+ * - Record one frame of the same geometry with a Raw10RowBytes(64)
+ *   stride and replay it.
+ * Expected:
+ * - Both frames report an 80-byte stride and a 320-byte plane.
+ */
+TEST(RawFrame, Case028s_StrideInBytesAcrossSources) {
+  AX_VIDEO_FRAME_T vf{};
+  vf.u32Width = 64;
+  vf.u32Height = 4;
+  vf.enImgFormat = AX_FORMAT_BAYER_RAW_10BPP_PACKED;
+  vf.u32PicStride[0] = 64;
+  const RawFrame::Info vin = axsys::VinRawFrameInfo(vf);
+  EXPECT_EQ(vin.planes[0].stride, 80u);
+  EXPECT_EQ(vin.planes[0].size, 320u);
+
+  const std::string path =
+      testing::TempDir() + "axcap_028s_" + std::to_string(getpid());
+  const uint32_t row = static_cast<uint32_t>(axsys::Raw10RowBytes(64));
+  const axsys::CaptureStreamInfo si = {
+      64, 4, row, AX_FORMAT_BAYER_RAW_10BPP_PACKED, 10, 1, 30000};
+  {
+    axsys::CaptureWriter w;
+    ASSERT_TRUE(w.Open(path.c_str(), si));
+    std::vector<uint8_t> d(row * 4u, 0x28);
+    ASSERT_TRUE(w.Append(d.data(), d.size(), 1, 0));
+    ASSERT_TRUE(w.Close());
+  }
+  axsys::ReplayFrameSource src;
+  ASSERT_TRUE(src.Open(path.c_str(), axsys::ReplayFrameSource::Options()));
+  auto f = src.Next(100);
+  ASSERT_TRUE(f) << f.Message();
+  EXPECT_EQ(f.Value().GetInfo().planes[0].stride, vin.planes[0].stride);
+  EXPECT_EQ(f.Value().GetInfo().planes[0].size, vin.planes[0].size);
+  f.Value().Release();
+  src.Close();
+  unlink(path.c_str());
+}
+
+}  // namespace
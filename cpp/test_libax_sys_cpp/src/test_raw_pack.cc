@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "axsys/raw_pack.hpp"
+#include "axsys/sys.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::ErrorCode;
+
+// Bit-by-bit reference: pixel i occupies bits [10i, 10i+10) of the row,
+// LSB first.
+uint16_t RefGet(const uint8_t* row, uint32_t i) {
+  uint16_t v = 0;
+  for (uint32_t b = 0; b < 10; ++b) {
+    const size_t bit = static_cast<size_t>(i) * 10 + b;
+    if (row[bit / 8] >> (bit % 8) & 1) v = static_cast<uint16_t>(v | 1u << b);
+  }
+  return v;
+}
+
+void RefPut(uint8_t* row, uint32_t i, uint16_t v) {
+  for (uint32_t b = 0; b < 10; ++b) {
+    const size_t bit = static_cast<size_t>(i) * 10 + b;
+    const uint8_t m = static_cast<uint8_t>(1u << (bit % 8));
+    row[bit / 8] = static_cast<uint8_t>(
+        (v >> b & 1) ? (row[bit / 8] | m) : (row[bit / 8] & ~m));
+  }
+}
+
+/**
+ * @brief Case029: Unpack matches the bit-level reference for every width.
+ *
+ * Purpose:
+ * - Cover SIMD bodies and scalar tails, including partial 4-pixel groups.
+ * Steps:
+ * - For widths 1..80 and 3 rows with padded strides, unpack random packed
+ *   rows.
+ * Expected:
+ * - Every sample equals the reference; stride padding is left untouched.
+ */
+TEST(RawPack, Case029_UnpackMatchesReference) {
+  std::mt19937 rng(29);
+  constexpr uint32_t kRows = 3;
+  constexpr uint8_t kPad = 0xcd;
+  for (uint32_t width = 1; width <= 80; ++width) {
+    const size_t pstride = axsys::Raw10RowBytes(width) + 7;
+    const size_t ustride = width * 2 + 6;
+
+    std::vector<uint8_t> packed(pstride * kRows);
+    for (auto& b : packed) b = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> unpacked(ustride * kRows, kPad);
+    axsys::UnpackRaw10Rows(packed.data(), pstride,
+                           reinterpret_cast<uint16_t*>(unpacked.data()),
+                           ustride, width, kRows);
+    for (uint32_t y = 0; y < kRows; ++y) {
+      const uint16_t* u =
+          reinterpret_cast<const uint16_t*>(&unpacked[y * ustride]);
+      for (uint32_t x = 0; x < width; ++x) {
+        ASSERT_EQ(u[x], RefGet(&packed[y * pstride], x))
+            << "unpack width=" << width << " y=" << y << " x=" << x;
+      }
+      for (size_t p = width * 2; p < ustride; ++p) {
+        ASSERT_EQ(unpacked[y * ustride + p], kPad);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Case029k: Pack matches the bit-level reference for every width.
+ *
+ * Steps:
+ * - For widths 1..80 and 3 rows with padded strides, pack random 16-bit
+ *   rows (upper 6 bits set at random).
+ * Expected:
+ * - Every row equals the reference packing of the low 10 bits; stride
+ *   padding is left untouched.
+ */
+TEST(RawPack, Case029k_PackMatchesReference) {
+  std::mt19937 rng(290);
+  constexpr uint32_t kRows = 3;
+  constexpr uint8_t kPad = 0xcd;
+  for (uint32_t width = 1; width <= 80; ++width) {
+    const size_t row_bytes = axsys::Raw10RowBytes(width);
+    const size_t pstride = row_bytes + 7;
+    const size_t ustride = width * 2 + 6;
+
+    std::vector<uint8_t> unpacked(ustride * kRows);
+    for (auto& b : unpacked) b = static_cast<uint8_t>(rng());
+    std::vector<uint8_t> repacked(pstride * kRows, kPad);
+    axsys::PackRaw10Rows(reinterpret_cast<const uint16_t*>(unpacked.data()),
+                         ustride, repacked.data(), pstride, width, kRows);
+    for (uint32_t y = 0; y < kRows; ++y) {
+      std::vector<uint8_t> ref(row_bytes, 0);
+      const uint16_t* u =
+          reinterpret_cast<const uint16_t*>(&unpacked[y * ustride]);
+      for (uint32_t x = 0; x < width; ++x) {
+        RefPut(ref.data(), x, static_cast<uint16_t>(u[x] & 0x3ff));
+      }
+      ASSERT_EQ(memcmp(&repacked[y * pstride], ref.data(), row_bytes), 0)
+          << "pack width=" << width << " y=" << y;
+      for (size_t p = row_bytes; p < pstride; ++p) {
+        ASSERT_EQ(repacked[y * pstride + p], kPad);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Case029v: CmmView entry points round-trip a 4K frame on threads.
+ *
+ * Steps:
+ * - Allocate cached RAW10 and RAW16 buffers for 3840x64 and fill the
+ *   RAW16 one with random 10-bit samples.
+ * - PackRaw10 then UnpackRaw10 with 1 and 3 threads.
+ * Expected:
+ * - Round trip reproduces the input; a kernel name is reported.
+ */
+TEST(RawPack, Case029v_ViewRoundTrip) {
+  axsys::RawGeometry g;
+  g.width = 3840;
+  g.height = 64;
+  g.packed_stride = axsys::Raw10RowBytes(g.width);
+  g.unpacked_stride = g.width * 2;
+  const size_t plen = g.packed_stride * g.height;
+  const size_t ulen = g.unpacked_stride * g.height;
+
+  axsys::CmmBuffer pbuf, ubuf, obuf;
+  auto pr = pbuf.Allocate(plen, CacheMode::kCached, "gtest_029p");
+  ASSERT_TRUE(pr) << pr.Message();
+  auto ur = ubuf.Allocate(ulen, CacheMode::kCached, "gtest_029u");
+  ASSERT_TRUE(ur) << ur.Message();
+  auto orr = obuf.Allocate(ulen, CacheMode::kCached, "gtest_029o");
+  ASSERT_TRUE(orr) << orr.Message();
+  axsys::CmmView pv = pr.MoveValue();
+  axsys::CmmView uv = ur.MoveValue();
+  axsys::CmmView ov = orr.MoveValue();
+
+  std::mt19937 rng(290);
+  uint16_t* in = static_cast<uint16_t*>(uv.Data());
+  for (size_t i = 0; i < ulen / 2; ++i) {
+    in[i] = static_cast<uint16_t>(rng() & 0x3ff);
+  }
+  ASSERT_TRUE(uv.Flush());
+
+  for (unsigned threads : {1u, 3u}) {
+    memset(ov.Data(), 0, ulen);
+    ASSERT_TRUE(ov.Flush());
+    auto r = axsys::PackRaw10(&uv, &pv, g, threads);
+    ASSERT_TRUE(r) << r.Message();
+    r = axsys::UnpackRaw10(&pv, &ov, g, threads);
+    ASSERT_TRUE(r) << r.Message();
+    EXPECT_EQ(memcmp(ov.Data(), uv.Data(), ulen), 0) << "threads=" << threads;
+  }
+  EXPECT_NE(axsys::Raw10KernelName(), nullptr);
+}
+
+/**
+ * @brief Case029s: A view smaller than the geometry is rejected.
+ *
+ * Steps:
+ * - Allocate RAW10 and RAW16 buffers for 3840x64.
+ * - UnpackRaw10 with a geometry one row taller.
+ * Expected:
+ * - kInvalidArgument.
+ */
+TEST(RawPack, Case029s_ShortViewRejected) {
+  axsys::RawGeometry g;
+  g.width = 3840;
+  g.height = 64;
+  g.packed_stride = axsys::Raw10RowBytes(g.width);
+  g.unpacked_stride = g.width * 2;
+
+  axsys::CmmBuffer pbuf, obuf;
+  auto pr = pbuf.Allocate(g.packed_stride * g.height, CacheMode::kCached,
+                          "gtest_029s");
+  ASSERT_TRUE(pr) << pr.Message();
+  auto orr = obuf.Allocate(g.unpacked_stride * g.height, CacheMode::kCached,
+                           "gtest_029t");
+  ASSERT_TRUE(orr) << orr.Message();
+  axsys::CmmView pv = pr.MoveValue();
+  axsys::CmmView ov = orr.MoveValue();
+
+  axsys::RawGeometry big = g;
+  big.height = g.height + 1;
+  EXPECT_EQ(axsys::UnpackRaw10(&pv, &ov, big).Code(),
+            ErrorCode::kInvalidArgument);
+}
+
+}  // namespace
@@ -0,0 +1,276 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "axsys/replay_frame_source.hpp"
+
+namespace {
+
+using axsys::CaptureStreamInfo;
+using axsys::CaptureWriter;
+using axsys::ErrorCode;
+using axsys::PoolGauge;
+using axsys::RawFrame;
+using axsys::ReplayFrameSource;
+
+std::string TempPath(const char* name) {
+  return testing::TempDir() + name + std::to_string(getpid());
+}
+
+std::vector<uint8_t> Pattern(size_t size, uint8_t seed) {
+  std::vector<uint8_t> v(size);
+  for (size_t i = 0; i < size; ++i) {
+    v[i] = static_cast<uint8_t>(seed + i * 13);
+  }
+  return v;
+}
+
+constexpr size_t kFrameBytes = 64 * 48 * 2;
+
+/** Writes @p count frames with seq 10.. and PTS 33333 us apart. */
+void WriteStream(const std::string& path, size_t count, uint32_t fps_x1000) {
+  const CaptureStreamInfo si = {64, 48, 128, 0x7b, 16, 0, fps_x1000};
+  CaptureWriter w;
+  ASSERT_TRUE(w.Open(path.c_str(), si));
+  for (size_t i = 0; i < count; ++i) {
+    std::vector<uint8_t> d = Pattern(kFrameBytes, static_cast<uint8_t>(i));
+    ASSERT_TRUE(w.Append(d.data(), d.size(), 10 + i, 33333 * i));
+  }
+  ASSERT_TRUE(w.Close());
+}
+
+/**
+ * @brief Case032: Replay blocks once every pool block is held.
+ *
+ * Steps:
+ * - Record 5 frames; open an unpaced replay with depth 2 and a gauge.
+ * - Take two frames without releasing, then call Next(0).
+ * - Release one and call Next() again.
+ * Expected:
+ * - The third Next() is kTimeout while both blocks are held; the gauge
+ *   shows 2 held.
+ * - A released block is reused; the gauge is back to 0 held at the end.
+ */
+TEST(ReplayFrameSource, Case032_DepthBoundsHeldFrames) {
+  const std::string path = TempPath("axcap_032_");
+  WriteStream(path, 5, 30000);
+
+  ReplayFrameSource::Options opt;
+  opt.depth = 2;
+  PoolGauge gauge(opt.depth);
+  {
+    ReplayFrameSource src;
+    auto r = src.Open(path.c_str(), opt, &gauge);
+    ASSERT_TRUE(r) << r.Message();
+    EXPECT_EQ(src.FrameCount(), 5u);
+    EXPECT_EQ(src.StreamInfo().stride, 128u);
+
+    auto a = src.Next(100);
+    ASSERT_TRUE(a) << a.Message();
+    auto b = src.Next(100);
+    ASSERT_TRUE(b) << b.Message();
+    auto c = src.Next(0);
+    EXPECT_EQ(c.Code(), ErrorCode::kTimeout);
+    EXPECT_EQ(gauge.Read().held, 2u);
+
+    b.Value().Release();
+    auto d = src.Next(100);
+    ASSERT_TRUE(d) << d.Message();
+    EXPECT_EQ(d.Value().GetInfo().seq, 12u);
+  }
+  EXPECT_EQ(gauge.Read().held, 0u);
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case032c: Replay returns the recorded content, then kClosed.
+ *
+ * Steps:
+ * - Record 5 frames; open an unpaced replay with depth 2.
+ * - Read every frame through Plane(0), releasing each, then call Next()
+ *   past the end.
+ * Expected:
+ * - Plane contents, seq, stride and geometry match the recording.
+ * - After the last frame Next() is kClosed; 5 delivered, 0 dropped.
+ */
+TEST(ReplayFrameSource, Case032c_ContentThenClosed) {
+  const std::string path = TempPath("axcap_032c_");
+  WriteStream(path, 5, 30000);
+
+  ReplayFrameSource::Options opt;
+  opt.depth = 2;
+  ReplayFrameSource src;
+  auto r = src.Open(path.c_str(), opt);
+  ASSERT_TRUE(r) << r.Message();
+
+  uint64_t expected_seq = 10;
+  for (;;) {
+    auto n = src.Next(100);
+    if (n.Code() == ErrorCode::kClosed) break;
+    ASSERT_TRUE(n) << n.Message();
+    RawFrame f = n.MoveValue();
+    const RawFrame::Info& info = f.GetInfo();
+    EXPECT_EQ(info.seq, expected_seq++);
+    EXPECT_EQ(info.width, 64u);
+    EXPECT_EQ(info.height, 48u);
+    EXPECT_EQ(info.format, 0x7b);
+    EXPECT_EQ(info.planes[0].stride, 128u);
+    ASSERT_EQ(info.planes[0].size, kFrameBytes);
+    auto p = f.Plane(0);
+    ASSERT_TRUE(p) << p.Message();
+    const size_t i = info.seq - 10;
+    std::vector<uint8_t> d = Pattern(kFrameBytes, static_cast<uint8_t>(i));
+    EXPECT_EQ(memcmp(p.Value()->Data(), d.data(), d.size()), 0)
+        << "frame " << i;
+  }
+  EXPECT_EQ(expected_seq, 15u);
+  EXPECT_EQ(src.GetStats().delivered, 5u);
+  EXPECT_EQ(src.GetStats().dropped, 0u);
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case032f: A frame stays readable after the source is closed.
+ *
+ * Steps:
+ * - Record 5 frames; replay with a gauge and keep the first frame.
+ * - Close() the source, then read the kept frame through Plane(0).
+ * Expected:
+ * - The kept frame still holds recorded frame 0.
+ * - Its block is freed on release: the gauge ends at 0 held.
+ */
+TEST(ReplayFrameSource, Case032f_FrameOutlivesClose) {
+  const std::string path = TempPath("axcap_032f_");
+  WriteStream(path, 5, 30000);
+
+  ReplayFrameSource::Options opt;
+  opt.depth = 2;
+  PoolGauge gauge(opt.depth);
+  {
+    RawFrame kept;
+    {
+      ReplayFrameSource src;
+      auto r = src.Open(path.c_str(), opt, &gauge);
+      ASSERT_TRUE(r) << r.Message();
+      auto a = src.Next(100);
+      ASSERT_TRUE(a) << a.Message();
+      kept = a.MoveValue();
+      src.Close();
+    }
+    EXPECT_EQ(kept.GetInfo().seq, 10u);
+    auto p = kept.Plane(0);
+    ASSERT_TRUE(p) << p.Message();
+    std::vector<uint8_t> d = Pattern(kFrameBytes, 0);
+    EXPECT_EQ(memcmp(p.Value()->Data(), d.data(), d.size()), 0);
+  }
+  EXPECT_EQ(gauge.Read().held, 0u);
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case032l: Looping keeps seq and PTS increasing across the wrap.
+ *
+ * Steps:
+ * - Record 5 frames; open an unpaced replay with loop = true.
+ * - Read 7 frames.
+ * Expected:
+ * - seq increases by 1 and PTS by one period per frame; one pass done.
+ */
+TEST(ReplayFrameSource, Case032l_LoopContinuesTimeline) {
+  const std::string path = TempPath("axcap_032l_");
+  WriteStream(path, 5, 30000);
+
+  ReplayFrameSource::Options opt;
+  opt.depth = 2;
+  opt.loop = true;
+  ReplayFrameSource src;
+  ASSERT_TRUE(src.Open(path.c_str(), opt));
+  uint64_t last_seq = 0;
+  uint64_t last_pts = 0;
+  for (int i = 0; i < 7; ++i) {
+    auto n = src.Next(100);
+    ASSERT_TRUE(n) << n.Message();
+    const RawFrame::Info& info = n.Value().GetInfo();
+    if (i > 0) {
+      EXPECT_EQ(info.seq, last_seq + 1);
+      EXPECT_EQ(info.pts, last_pts + 33333);
+    }
+    last_seq = info.seq;
+    last_pts = info.pts;
+  }
+  EXPECT_EQ(src.GetStats().passes, 1u);
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case032p: Paced replay keeps the recorded rate.
+ *
+ * Steps:
+ * - Record 40 frames at 100 fps; replay at the recorded rate.
+ * - Read 5 frames promptly, measuring elapsed time.
+ * Expected:
+ * - The 5 prompt frames take at least 4 periods (40 ms); none dropped.
+ */
+TEST(ReplayFrameSource, Case032p_PacedAtRecordedRate) {
+  const std::string path = TempPath("axcap_032p_");
+  WriteStream(path, 40, 100000);
+
+  ReplayFrameSource::Options opt;
+  opt.fps_x1000 = ReplayFrameSource::kRecordedRate;
+  ReplayFrameSource src;
+  ASSERT_TRUE(src.Open(path.c_str(), opt));
+
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; ++i) {
+    auto n = src.Next(1000);
+    ASSERT_TRUE(n) << n.Message();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - t0;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(40));
+  EXPECT_EQ(src.GetStats().delivered, 5u);
+  unlink(path.c_str());
+}
+
+/**
+ * @brief Case032d: A slow reader gets the current frame, not a backlog.
+ *
+ * Steps:
+ * - Record 40 frames at 100 fps; replay at the recorded rate.
+ * - Read one frame, sleep 100 ms holding nothing, then read one frame.
+ * Expected:
+ * - The frame after the stall skips ahead: its seq jumps by more than
+ *   one, and delivered + dropped covers every frame up to it.
+ */
+TEST(ReplayFrameSource, Case032d_SlowReaderDropsLate) {
+  const std::string path = TempPath("axcap_032d_");
+  WriteStream(path, 40, 100000);
+
+  ReplayFrameSource::Options opt;
+  opt.fps_x1000 = ReplayFrameSource::kRecordedRate;
+  ReplayFrameSource src;
+  ASSERT_TRUE(src.Open(path.c_str(), opt));
+
+  auto first = src.Next(1000);
+  ASSERT_TRUE(first) << first.Message();
+  const uint64_t seq = first.Value().GetInfo().seq;
+  first.Value().Release();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  auto n = src.Next(1000);
+  ASSERT_TRUE(n) << n.Message();
+  const uint64_t jumped = n.Value().GetInfo().seq;
+  EXPECT_GT(jumped, seq + 1);
+  // Every recorded frame up to the one returned was delivered or dropped.
+  const ReplayFrameSource::Stats st = src.GetStats();
+  EXPECT_EQ(st.delivered, 2u);
+  EXPECT_EQ(st.delivered + st.dropped, jumped - 10 + 1);
+  unlink(path.c_str());
+}
+
+}  // namespace
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "axsys/cmm_stats.hpp"
+#include "axsys/sys.hpp"
+#include "axsys/tensor_arena.hpp"
+
+namespace {
+
+using axsys::ArenaPlan;
+using axsys::ArenaStrategy;
+using axsys::CacheMode;
+using axsys::CmmStats;
+using axsys::ErrorCode;
+using axsys::TensorArena;
+using axsys::TensorSpec;
+
+const ArenaStrategy kStrategies[] = {ArenaStrategy::kGreedyBySize,
+                                     ArenaStrategy::kBestFit};
+
+/**
+ * Synthetic graph: @p n tensors over @p steps steps, each live for 1..8
+ * steps, 1 KiB..1 MiB, alignments 1/16/64/4096. Deterministic per @p seed.
+ */
+std::vector<TensorSpec> RandomGraph(uint32_t seed, size_t n, uint32_t steps) {
+  uint32_t x = seed;
+  auto next = [&x] {
+    x = x * 1664525u + 1013904223u;
+    return x >> 8;
+  };
+  const uint64_t aligns[] = {0, 16, 64, 4096};
+  std::vector<TensorSpec> g;
+  for (size_t i = 0; i < n; ++i) {
+    TensorSpec t;
+    t.name = "t" + std::to_string(i);
+    t.size = 1024 + uint64_t{next() % (1u << 20)};
+    t.alignment = aligns[next() % 4];
+    t.first_use = next() % steps;
+    t.last_use = t.first_use + next() % 8;
+    g.push_back(t);
+  }
+  return g;
+}
+
+/** A diamond a -> (b, c) -> d with a 12 KiB scratch tensor at the end. */
+std::vector<TensorSpec> Diamond() {
+  return {{"a", 65536, 64, 0, 1},
+          {"b", 32768, 64, 1, 2},
+          {"c", 32768, 64, 1, 3},
+          {"d", 65536, 64, 3, 4},
+          {"scratch", 12288, 4096, 4, 4}};
+}
+
+/**
+ * @brief Case042: A chain of short-lived tensors reaches the lower bound.
+ *
+ * Steps:
+ * - A chain of 20 tensors of 64 KiB, tensor i used at steps i and i + 1;
+ *   plan it with both strategies.
+ * Expected:
+ * - Both strategies need 128 KiB (the lower bound) instead of 1280 KiB.
+ */
+TEST(TensorArena, Case042_ChainReachesLowerBound) {
+  std::vector<TensorSpec> chain;
+  for (uint32_t i = 0; i < 20; ++i) {
+    chain.push_back(TensorSpec{"c" + std::to_string(i), 65536, 64, i, i + 1});
+  }
+  for (ArenaStrategy s : kStrategies) {
+    auto r = axsys::PlanTensorArena(chain, s);
+    ASSERT_TRUE(r) << r.Message();
+    EXPECT_TRUE(axsys::CheckTensorArena(chain, r.Value()));
+    EXPECT_EQ(r.Value().arena_size, 2u * 65536);
+    EXPECT_EQ(r.Value().lower_bound, 2u * 65536);
+    EXPECT_EQ(r.Value().naive_size, 20u * 65536);
+  }
+}
+
+/**
+ * @brief Case042r: Plans of random graphs are valid and compact.
+ *
+ * Steps:
+ * - Five random graphs of 300 tensors over 100 steps; plan each with both
+ *   strategies.
+ * Expected:
+ * - Every plan passes CheckTensorArena(), lies between the lower bound
+ *   and the naive sum, and greedy-by-size stays within 25% of the lower
+ *   bound. Planned peak vs naive sum is printed.
+ */
+TEST(TensorArena, Case042r_RandomGraphs) {
+  for (uint32_t seed = 1; seed <= 5; ++seed) {
+    const std::vector<TensorSpec> g = RandomGraph(seed, 300, 100);
+    for (ArenaStrategy s : kStrategies) {
+      auto r = axsys::PlanTensorArena(g, s);
+      ASSERT_TRUE(r) << r.Message();
+      const ArenaPlan& p = r.Value();
+      EXPECT_TRUE(axsys::CheckTensorArena(g, p)) << "seed " << seed;
+      EXPECT_GE(p.arena_size, p.lower_bound);
+      EXPECT_LE(p.arena_size, p.naive_size);
+      if (s == ArenaStrategy::kGreedyBySize) {
+        EXPECT_LE(p.arena_size, p.lower_bound + p.lower_bound / 4)
+            << "seed " << seed;
+      }
+      printf("[TensorArena] seed %u %s: planned %.1f MiB, naive %.1f MiB, "
+             "lower bound %.1f MiB\n",
+             seed, s == ArenaStrategy::kGreedyBySize ? "greedy" : "bestfit",
+             static_cast<double>(p.arena_size) / 1048576.0,
+             static_cast<double>(p.naive_size) / 1048576.0,
+             static_cast<double>(p.lower_bound) / 1048576.0);
+    }
+  }
+}
+
+/**
+ * @brief Case042i: Invalid tensor specs are rejected.
+ *
+ * Steps:
+ * - Plan specs with size 0, last_use < first_use, alignment 3 and 8192.
+ * Expected:
+ * - kInvalidArgument for each.
+ */
+TEST(TensorArena, Case042i_InvalidSpecs) {
+  const TensorSpec bad[] = {{"zero", 0, 0, 0, 0},
+                            {"backwards", 16, 0, 2, 1},
+                            {"align3", 16, 3, 0, 0},
+                            {"align8k", 16, 8192, 0, 0}};
+  for (const TensorSpec& t : bad) {
+    auto r = axsys::PlanTensorArena({t}, ArenaStrategy::kBestFit);
+    EXPECT_EQ(r.Code(), ErrorCode::kInvalidArgument) << t.name;
+  }
+}
+
+/**
+ * @brief Case042p: The arena allocates exactly the planned size.
+ *
+ * Steps:
+ * - Allocate a non-cached arena (token "arena042") for the diamond graph;
+ *   Free() it.
+ * Expected:
+ * - The token's live bytes equal the planned arena size, which is below
+ *   the naive sum; after Free() no live bytes.
+ */
+TEST(TensorArena, Case042p_ArenaMatchesPlan) {
+  const std::vector<TensorSpec> g = Diamond();
+  TensorArena arena;
+  ASSERT_TRUE(arena.Allocate(g, ArenaStrategy::kGreedyBySize,
+                             CacheMode::kNonCached, "arena042"));
+  const ArenaPlan& p = arena.Plan();
+  EXPECT_TRUE(axsys::CheckTensorArena(g, p));
+  EXPECT_LT(p.arena_size, p.naive_size);
+  EXPECT_EQ(CmmStats::Snapshot().Find("arena042")->live_bytes, p.arena_size);
+  ASSERT_EQ(arena.Count(), g.size());
+  ASSERT_TRUE(arena.Free());
+  EXPECT_EQ(CmmStats::Snapshot().Find("arena042")->live_bytes, 0u);
+}
+
+/**
+ * @brief Case042v: Tensors overlapping in time have their own bytes.
+ *
+ * Steps:
+ * - Allocate the diamond arena; fill b and c (live together at steps
+ *   1-2) with their index through Data(); map each with View().
+ * Expected:
+ * - Each view reads its own tensor's bytes, sits at the planned offset
+ *   and has the physical address Phys(i); scratch is 4 KiB aligned.
+ */
+TEST(TensorArena, Case042v_TensorViews) {
+  const std::vector<TensorSpec> g = Diamond();
+  TensorArena arena;
+  ASSERT_TRUE(arena.Allocate(g, ArenaStrategy::kGreedyBySize,
+                             CacheMode::kNonCached, "arena042v"));
+  const ArenaPlan& p = arena.Plan();
+  for (size_t i = 1; i <= 2; ++i) {
+    memset(arena.Data(i), static_cast<int>(i), g[i].size);
+  }
+  for (size_t i = 1; i <= 2; ++i) {
+    auto v = arena.View(i, CacheMode::kNonCached);
+    ASSERT_TRUE(v) << v.Message();
+    const uint8_t* b = static_cast<const uint8_t*>(v.Value().Data());
+    EXPECT_EQ(b[0], i);
+    EXPECT_EQ(b[g[i].size - 1], i);
+    EXPECT_EQ(v.Value().Offset(), p.offsets[i]);
+    EXPECT_EQ(arena.Phys(i), v.Value().Phys());
+  }
+  EXPECT_EQ(arena.Phys(4) % 4096, 0u);
+}
+
+/**
+ * @brief Case042e: A second Allocate() and bad indices are rejected.
+ *
+ * Steps:
+ * - Allocate the diamond arena, then Allocate() again.
+ * - View() and Data() one past the last tensor.
+ * Expected:
+ * - kAlreadyInitialized; kOutOfRange and nullptr.
+ */
+TEST(TensorArena, Case042e_MisuseRejected) {
+  const std::vector<TensorSpec> g = Diamond();
+  TensorArena arena;
+  ASSERT_TRUE(arena.Allocate(g, ArenaStrategy::kGreedyBySize,
+                             CacheMode::kNonCached, "arena042e"));
+  auto again = arena.Allocate(g, ArenaStrategy::kBestFit,
+                              CacheMode::kNonCached, "arena042e");
+  EXPECT_EQ(again.Code(), ErrorCode::kAlreadyInitialized);
+  EXPECT_EQ(arena.View(g.size(), CacheMode::kNonCached).Code(),
+            ErrorCode::kOutOfRange);
+  EXPECT_EQ(arena.Data(g.size()), nullptr);
+}
+
+}  // namespace
@@ -0,0 +1,286 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "axsys/sys.hpp"
+#include "axsys/trace.hpp"
+
+namespace {
+
+using axsys::CacheMode;
+using axsys::CmmBuffer;
+using axsys::trace::Call;
+using axsys::trace::Event;
+
+std::vector<Event> EventsOf(const std::vector<Event>& all, Call call) {
+  std::vector<Event> out;
+  for (const Event& e : all) {
+    if (e.call == call) out.push_back(e);
+  }
+  return out;
+}
+
+/** Allocates, flushes and frees a cached buffer of @p size bytes. */
+void AllocFlushFree(size_t size) {
+  CmmBuffer buf;
+  auto view = buf.Allocate(size, CacheMode::kCached, "trace_test");
+  ASSERT_TRUE(view);
+  ASSERT_TRUE(view.Value().Flush());
+  view.Value().Reset();
+  ASSERT_TRUE(buf.Free());
+}
+
+/**
+ * @brief Case034: CMM calls are recorded with sizes, in order.
+ *
+ * Steps:
+ * - Enable tracing, allocate a 64 KiB cached buffer, flush it, free it,
+ *   then disable tracing and allocate once more.
+ * Expected:
+ * - One AX_SYS_MemAllocCached event with bytes 65536 and ret 0, followed
+ *   by AX_SYS_MflushCache, AX_SYS_Munmap and AX_SYS_MemFree events from
+ *   this thread.
+ * - The allocation made while disabled is not recorded.
+ */
+TEST(Trace, Case034_RecordCmmCalls) {
+#if !AXSYS_TRACE
+  GTEST_SKIP() << "built with AXSYS_TRACE=0";
+#endif
+  constexpr size_t kSize = 64 * 1024;
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+  AllocFlushFree(kSize);
+  axsys::trace::SetEnabled(false);
+  {
+    CmmBuffer buf;
+    ASSERT_TRUE(buf.Allocate(kSize, CacheMode::kCached, "trace_test"));
+  }
+
+  const std::vector<Event> all = axsys::trace::Snapshot();
+  const uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+  const std::vector<Event> alloc = EventsOf(all, Call::kMemAllocCached);
+  ASSERT_EQ(alloc.size(), 1u);
+  EXPECT_EQ(alloc[0].bytes, kSize);
+  EXPECT_EQ(alloc[0].ret, 0);
+  EXPECT_EQ(alloc[0].tid, tid);
+
+  const std::vector<Event> flush = EventsOf(all, Call::kMflushCache);
+  ASSERT_FALSE(flush.empty());
+  EXPECT_GT(flush[0].bytes, 0u);
+  EXPECT_GE(flush[0].start_ns, alloc[0].start_ns + alloc[0].duration_ns);
+  EXPECT_FALSE(EventsOf(all, Call::kMunmap).empty());
+  const std::vector<Event> free_ev = EventsOf(all, Call::kMemFree);
+  ASSERT_EQ(free_ev.size(), 1u);
+  EXPECT_GE(free_ev[0].start_ns, flush.back().start_ns);
+  axsys::trace::Clear();
+}
+
+/**
+ * @brief Case034e: A snapshot exports as Chrome trace JSON.
+ *
+ * Steps:
+ * - Trace a 64 KiB cached allocate/flush/free and export it to a file.
+ * Expected:
+ * - The file is one Chrome trace JSON object naming the calls and
+ *   carrying the allocation size.
+ */
+TEST(Trace, Case034e_ExportChromeJson) {
+#if !AXSYS_TRACE
+  GTEST_SKIP() << "built with AXSYS_TRACE=0";
+#endif
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+  AllocFlushFree(64 * 1024);
+  axsys::trace::SetEnabled(false);
+
+  const std::string path =
+      testing::TempDir() + "axsys_trace" + std::to_string(getpid()) + ".json";
+  ASSERT_TRUE(axsys::trace::ExportChromeJson(path.c_str()));
+  std::ifstream in(path);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  const std::string json = ss.str();
+  remove(path.c_str());
+  EXPECT_EQ(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), 0u);
+  EXPECT_NE(json.find("\"name\":\"AX_SYS_MemAllocCached\""), std::string::npos);
+  EXPECT_NE(json.find("\"bytes\":65536"), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"AX_SYS_MflushCache\""), std::string::npos);
+  EXPECT_EQ(json.compare(json.size() - 3, 3, "]}\n"), 0);
+  axsys::trace::Clear();
+}
+
+#if AXSYS_TRACE
+__attribute__((noinline)) int32_t NoopCall(volatile int32_t* sink) {
+  *sink = *sink + 1;
+  return 0;
+}
+
+/** Nanoseconds per iteration of a loop of @p n trace points. */
+double NsPerTracePoint(int n) {
+  volatile int32_t sink = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; ++i) {
+    if (AXSYS_TRACED(kMemQueryStatus, 0, NoopCall(&sink)) != 0) break;
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+}
+
+/** Nanoseconds for the two counter reads of one event. */
+double NsPerTickPair(int n) {
+  uint64_t sum = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < n; ++i) {
+    sum += axsys::trace::detail::Ticks();
+    sum += axsys::trace::detail::Ticks();
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  return sum != 0
+             ? std::chrono::duration<double, std::nano>(t1 - t0).count() / n
+             : 0.0;
+}
+#endif  // AXSYS_TRACE
+
+/**
+ * @brief Case034p: An enabled trace point costs under 50 ns per event.
+ *
+ * Steps:
+ * - Time a loop of traced no-op calls with tracing disabled, then enabled,
+ *   then the two counter reads alone; best of nine interleaved rounds
+ *   (the ring wraps many times).
+ * Expected:
+ * - Enabled minus disabled is below 50 ns per call, counter reads
+ *   included; their cost is reported on failure.
+ * - The ring holds exactly kRingEvents after wrapping.
+ */
+TEST(Trace, Case034p_EnabledOverhead) {
+#if !AXSYS_TRACE
+  GTEST_SKIP() << "built with AXSYS_TRACE=0";
+#else
+  constexpr int kCalls = 50000;
+  axsys::trace::Clear();
+  // Rounds interleave the three loops so a burst of host noise inflates
+  // one round of each, not a whole measurement; the best round counts.
+  double off_ns = 1e30;
+  double on_ns = 1e30;
+  double ticks_ns = 1e30;
+  for (int round = 0; round < 9; ++round) {
+    off_ns = std::min(off_ns, NsPerTracePoint(kCalls));
+    axsys::trace::SetEnabled(true);
+    on_ns = std::min(on_ns, NsPerTracePoint(kCalls));
+    axsys::trace::SetEnabled(false);
+    ticks_ns = std::min(ticks_ns, NsPerTickPair(kCalls));
+  }
+  EXPECT_LT(on_ns - off_ns, 50.0)
+      << "disabled " << off_ns << " ns, enabled " << on_ns
+      << " ns, counter reads " << ticks_ns << " ns";
+  EXPECT_EQ(axsys::trace::Snapshot().size(), axsys::trace::kRingEvents);
+  axsys::trace::Clear();
+#endif
+}
+
+/**
+ * @brief Case034t: Each thread's events carry its own thread id.
+ *
+ * Steps:
+ * - Record one event from a second thread, then one from this thread.
+ * Expected:
+ * - The snapshot holds both, in order, with their thread ids and sizes.
+ */
+TEST(Trace, Case034t_EventsCarryThreadId) {
+#if !AXSYS_TRACE
+  GTEST_SKIP() << "built with AXSYS_TRACE=0";
+#else
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+  uint32_t other_tid = 0;
+  std::thread th([&other_tid] {
+    other_tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    volatile int32_t sink = 0;
+    (void)AXSYS_TRACED(kMemQueryStatus, 7, NoopCall(&sink));
+  });
+  th.join();
+  volatile int32_t sink = 0;
+  (void)AXSYS_TRACED(kMemQueryStatus, 9, NoopCall(&sink));
+  axsys::trace::SetEnabled(false);
+
+  const std::vector<Event> all = axsys::trace::Snapshot();
+  ASSERT_EQ(all.size(), 2u);
+  EXPECT_EQ(all[0].tid, other_tid);
+  EXPECT_EQ(all[0].bytes, 7u);
+  EXPECT_EQ(all[1].tid, static_cast<uint32_t>(syscall(SYS_gettid)));
+  EXPECT_EQ(all[1].bytes, 9u);
+  axsys::trace::Clear();
+#endif
+}
+
+/**
+ * @brief Case034c: Snapshot() never returns an event being overwritten.
+ *
+ * Steps:
+ * - A second thread records events as fast as it can, each with bytes
+ *   and ret set to its sequence number k, so its ring wraps constantly.
+ * - Meanwhile take snapshots for 300 ms.
+ * Expected:
+ * - Every event of the writer has bytes == ret, and the writer's events
+ *   in one snapshot have strictly increasing k.
+ */
+TEST(Trace, Case034c_SnapshotDuringWrites) {
+#if !AXSYS_TRACE
+  GTEST_SKIP() << "built with AXSYS_TRACE=0";
+#else
+  axsys::trace::Clear();
+  axsys::trace::SetEnabled(true);
+  std::atomic<bool> stop{false};
+  std::atomic<uint32_t> writer_tid{0};
+  std::thread writer([&stop, &writer_tid] {
+    writer_tid.store(static_cast<uint32_t>(syscall(SYS_gettid)));
+    for (uint32_t k = 1; !stop.load(std::memory_order_relaxed); ++k) {
+      const uint64_t t = axsys::trace::detail::Ticks();
+      axsys::trace::detail::Record(Call::kMemQueryStatus, t, t + (k & 0xff),
+                                   k, static_cast<int32_t>(k & 0x7fffffff));
+    }
+  });
+  while (writer_tid.load() == 0) std::this_thread::yield();
+
+  size_t snapshots = 0;
+  size_t checked = 0;
+  size_t torn = 0;
+  size_t out_of_order = 0;
+  const auto until =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+  while (std::chrono::steady_clock::now() < until) {
+    uint64_t last = 0;
+    for (const Event& e : axsys::trace::Snapshot()) {
+      if (e.tid != writer_tid.load()) continue;
+      ++checked;
+      if (e.bytes != static_cast<uint64_t>(e.ret)) ++torn;
+      if (e.bytes <= last) ++out_of_order;
+      last = e.bytes;
+    }
+    ++snapshots;
+  }
+  stop.store(true);
+  writer.join();
+  axsys::trace::SetEnabled(false);
+  EXPECT_GT(snapshots, 0u);
+  EXPECT_GT(checked, 0u);
+  EXPECT_EQ(torn, 0u) << "of " << checked << " events in " << snapshots
+                      << " snapshots";
+  EXPECT_EQ(out_of_order, 0u);
+  axsys::trace::Clear();
+#endif
+}
+
+}  // namespace
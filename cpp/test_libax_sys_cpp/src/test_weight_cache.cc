@@ -0,0 +1,317 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "axsys/cmm_stats.hpp"
+#include "axsys/sys.hpp"
+#include "axsys/weight_cache.hpp"
+
+namespace {
+
+using axsys::CmmImportedBuffer;
+using axsys::CmmImporter;
+using axsys::CmmStats;
+using axsys::ErrorCode;
+using axsys::WeightBlob;
+using axsys::WeightCache;
+
+std::string TempPath(const char* tag) {
+  return "/tmp/axsys_" + std::string(tag) + "_" + std::to_string(getpid());
+}
+
+/** Write @p size bytes of a pattern seeded by @p seed to @p path. */
+bool WriteWeights(const std::string& path, size_t size, uint8_t seed) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<uint8_t>(i * 7 + seed);
+  }
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) return false;
+  const bool ok = fwrite(data.data(), 1, size, f) == size;
+  return fclose(f) == 0 && ok;
+}
+
+uint64_t LiveBytes(const char* token) {
+  auto snap = CmmStats::Snapshot();
+  const auto* t = snap.Find(token);
+  return t ? t->live_bytes : 0;
+}
+
+uint64_t Allocs(const char* token) {
+  auto snap = CmmStats::Snapshot();
+  const auto* t = snap.Find(token);
+  return t ? t->allocs : 0;
+}
+
+/**
+ * @brief Case040: The content hash does not depend on chunking.
+ *
+ * Steps:
+ * - Hash 1000 bytes whole and in 1/3/7/33-byte chunks; hash a copy with
+ *   one bit flipped.
+ * Expected:
+ * - Chunking does not change the digest; the flipped bit does.
+ * - Keys are 17 characters.
+ */
+TEST(WeightCache, Case040_HashIgnoresChunking) {
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i * 13);
+  }
+  const uint64_t whole = axsys::HashWeights(data.data(), data.size());
+  for (size_t chunk : {1u, 3u, 7u, 33u}) {
+    axsys::WeightHasher h;
+    for (size_t off = 0; off < data.size(); off += chunk) {
+      h.Update(data.data() + off, std::min(chunk, data.size() - off));
+    }
+    EXPECT_EQ(h.Digest(), whole) << "chunk " << chunk;
+  }
+  data[500] ^= 1;
+  EXPECT_NE(axsys::HashWeights(data.data(), data.size()), whole);
+  EXPECT_EQ(axsys::WeightKey(0x1234).size(), 17u);
+}
+
+/**
+ * @brief Case040d: Files with the same contents share one buffer.
+ *
+ * Steps:
+ * - Write files a and b with identical 96 KiB contents and c with other
+ *   contents; Load a, b and c; WeightKeyOfFile(a); Close().
+ * Expected:
+ * - a and b share a key and one buffer (192 KiB of "weights" live, not
+ *   288 KiB); WeightKeyOfFile matches Load.
+ * - Close() frees every buffer.
+ */
+TEST(WeightCache, Case040d_SameContentSharesBuffer) {
+  const std::string a = TempPath("040a");
+  const std::string b = TempPath("040b");
+  const std::string c = TempPath("040c");
+  ASSERT_TRUE(WriteWeights(a, 98304, 1));
+  ASSERT_TRUE(WriteWeights(b, 98304, 1));
+  ASSERT_TRUE(WriteWeights(c, 98304, 2));
+
+  const uint64_t live_before = LiveBytes("weights");
+  WeightCache cache;
+  auto ka = cache.Load(a.c_str());
+  auto kb = cache.Load(b.c_str());
+  auto kc = cache.Load(c.c_str());
+  ASSERT_TRUE(ka) << ka.Message();
+  ASSERT_TRUE(kb);
+  ASSERT_TRUE(kc);
+  EXPECT_EQ(ka.Value(), kb.Value());
+  EXPECT_NE(ka.Value(), kc.Value());
+  EXPECT_EQ(LiveBytes("weights") - live_before, 2u * 98304);
+  auto kf = axsys::WeightKeyOfFile(a.c_str());
+  ASSERT_TRUE(kf);
+  EXPECT_EQ(kf.Value(), ka.Value());
+  cache.Close();
+  EXPECT_EQ(LiveBytes("weights"), live_before);
+  for (const std::string& f : {a, b, c}) unlink(f.c_str());
+}
+
+/**
+ * @brief Case040i: A client imports the weights by key.
+ *
+ * Steps:
+ * - Load 96 KiB files a and c; import a's key from a client and compare
+ *   its bytes with the file.
+ * Expected:
+ * - The import sees the file's bytes; Blobs() counts one importer and
+ *   one import for a's key and none for c's.
+ */
+TEST(WeightCache, Case040i_ImportByKey) {
+  const std::string a = TempPath("040ia");
+  const std::string c = TempPath("040ic");
+  ASSERT_TRUE(WriteWeights(a, 98304, 1));
+  ASSERT_TRUE(WriteWeights(c, 98304, 2));
+
+  const std::string sock = TempPath("040i") + ".sock";
+  WeightCache cache;
+  ASSERT_TRUE(cache.Listen(sock.c_str()));
+  auto ka = cache.Load(a.c_str());
+  ASSERT_TRUE(ka) << ka.Message();
+  ASSERT_TRUE(cache.Load(c.c_str()));
+
+  CmmImporter importer;
+  ASSERT_TRUE(importer.Connect(sock.c_str()));
+  auto imp = importer.Import(ka.Value().c_str());
+  ASSERT_TRUE(imp) << imp.Message();
+  CmmImportedBuffer w = imp.MoveValue();
+  ASSERT_EQ(w.Descriptor().size, 98304u);
+  const uint8_t* p = static_cast<const uint8_t*>(w.View().Data());
+  ASSERT_NE(p, nullptr);
+  bool same = true;
+  for (size_t i = 0; i < 98304 && same; ++i) {
+    same = p[i] == static_cast<uint8_t>(i * 7 + 1);
+  }
+  EXPECT_TRUE(same);
+  const std::vector<WeightBlob> blobs = cache.Blobs();
+  ASSERT_EQ(blobs.size(), 2u);
+  EXPECT_EQ(blobs[0].key, ka.Value());
+  EXPECT_EQ(blobs[0].path, a);
+  EXPECT_EQ(blobs[0].importers, 1u);
+  EXPECT_EQ(blobs[0].imports, 1u);
+  EXPECT_EQ(blobs[1].importers, 0u);
+  w.Release();
+  cache.Close();
+  for (const std::string& f : {a, c}) unlink(f.c_str());
+}
+
+/**
+ * @brief Case040e: Empty and missing files are rejected.
+ *
+ * Steps:
+ * - Load an empty file and a missing file.
+ * Expected:
+ * - Empty: kInvalidArgument; missing: kSystemCallFailed.
+ */
+TEST(WeightCache, Case040e_EmptyOrMissingFile) {
+  const std::string empty = TempPath("040e");
+  ASSERT_TRUE(WriteWeights(empty, 0, 0));
+  WeightCache cache;
+  EXPECT_EQ(cache.Load(empty.c_str()).Code(), ErrorCode::kInvalidArgument);
+  const std::string missing = TempPath("040-missing");
+  EXPECT_EQ(cache.Load(missing.c_str()).Code(),
+            ErrorCode::kSystemCallFailed);
+  unlink(empty.c_str());
+}
+
+/**
+ * @brief Case040r: A resident file is not loaded again.
+ *
+ * Steps:
+ * - Write files a and b with identical 64 KiB contents; Load a.
+ * - Load a again, then b.
+ * Expected:
+ * - Both later loads return a's key without allocating "weights" CMM.
+ */
+TEST(WeightCache, Case040r_ResidentFileNotReloaded) {
+  const std::string a = TempPath("040ra");
+  const std::string b = TempPath("040rb");
+  ASSERT_TRUE(WriteWeights(a, 65536, 3));
+  ASSERT_TRUE(WriteWeights(b, 65536, 3));
+  WeightCache cache;
+  auto ka = cache.Load(a.c_str());
+  ASSERT_TRUE(ka) << ka.Message();
+  const uint64_t allocs = Allocs("weights");
+
+  auto again = cache.Load(a.c_str());
+  auto kb = cache.Load(b.c_str());
+  ASSERT_TRUE(again);
+  ASSERT_TRUE(kb);
+  EXPECT_EQ(again.Value(), ka.Value());
+  EXPECT_EQ(kb.Value(), ka.Value());
+  EXPECT_EQ(Allocs("weights"), allocs);
+  cache.Close();
+  for (const std::string& f : {a, b}) unlink(f.c_str());
+}
+
+/**
+ * @brief Case040m: A file rewritten under a loaded path is loaded again.
+ *
+ * Steps:
+ * - Write 64 KiB file a and Load it; rewrite a with 96 KiB of other
+ *   contents and Load it again.
+ * Expected:
+ * - The second load returns a new key and allocates "weights" CMM.
+ */
+TEST(WeightCache, Case040m_RewrittenFileReloaded) {
+  const std::string a = TempPath("040ma");
+  ASSERT_TRUE(WriteWeights(a, 65536, 4));
+  WeightCache cache;
+  auto k1 = cache.Load(a.c_str());
+  ASSERT_TRUE(k1) << k1.Message();
+  const uint64_t allocs = Allocs("weights");
+
+  ASSERT_TRUE(WriteWeights(a, 98304, 5));
+  auto k2 = cache.Load(a.c_str());
+  ASSERT_TRUE(k2) << k2.Message();
+  EXPECT_NE(k2.Value(), k1.Value());
+  EXPECT_EQ(Allocs("weights"), allocs + 1);
+  cache.Close();
+  unlink(a.c_str());
+}
+
+/**
+ * @brief Case040p: LRU eviction under memory pressure.
+ *
+ * Steps:
+ * - Load three 64 KiB blobs x, y, z in that order; import z then x, and
+ *   keep the import of x.
+ * - EvictUnderPressure(UINT64_MAX, 1) twice, then with no limit.
+ * Expected:
+ * - y (never imported) goes first, then z (imported before x); the held
+ *   x is never evicted, so the last call evicts nothing.
+ * - x stays readable through the import.
+ */
+TEST(WeightCache, Case040p_LruEviction) {
+  const std::string sock = TempPath("040p") + ".sock";
+  WeightCache cache;
+  ASSERT_TRUE(cache.Listen(sock.c_str()));
+  std::vector<std::string> keys;
+  for (uint8_t seed = 10; seed < 13; ++seed) {
+    const std::string path = TempPath("040p") + std::to_string(seed);
+    ASSERT_TRUE(WriteWeights(path, 65536, seed));
+    auto k = cache.Load(path.c_str());
+    unlink(path.c_str());
+    ASSERT_TRUE(k) << k.Message();
+    keys.push_back(k.Value());
+  }
+  CmmImporter importer;
+  ASSERT_TRUE(importer.Connect(sock.c_str()));
+  {
+    auto z = importer.Import(keys[2].c_str());
+    ASSERT_TRUE(z);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  auto x = importer.Import(keys[0].c_str());
+  ASSERT_TRUE(x);
+  // The release of z reaches the cache asynchronously.
+  for (int i = 0; i < 2000 && cache.Blobs()[2].importers != 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(cache.Blobs()[2].importers, 0u);
+
+  EXPECT_EQ(cache.EvictUnderPressure(UINT64_MAX, 1), 1u);
+  std::vector<WeightBlob> blobs = cache.Blobs();
+  ASSERT_EQ(blobs.size(), 2u);
+  EXPECT_EQ(blobs[0].key, keys[0]);
+  EXPECT_EQ(blobs[1].key, keys[2]);
+  EXPECT_EQ(cache.EvictUnderPressure(UINT64_MAX, 1), 1u);
+  blobs = cache.Blobs();
+  ASSERT_EQ(blobs.size(), 1u);
+  EXPECT_EQ(blobs[0].key, keys[0]);
+  EXPECT_EQ(cache.EvictUnderPressure(UINT64_MAX), 0u);
+  EXPECT_EQ(static_cast<const uint8_t*>(x.Value().View().Data())[1], 17);
+  auto gone = importer.Import(keys[1].c_str());
+  EXPECT_EQ(gone.Code(), ErrorCode::kInvalidArgument);
+}
+
+/**
+ * @brief Case040t: Nothing is evicted while free CMM is plentiful.
+ *
+ * Steps:
+ * - Load a 64 KiB blob; EvictUnderPressure() with a threshold below the
+ *   free CMM.
+ * Expected:
+ * - No eviction; the blob stays resident.
+ */
+TEST(WeightCache, Case040t_NoEvictionAboveThreshold) {
+  const std::string path = TempPath("040t");
+  ASSERT_TRUE(WriteWeights(path, 65536, 4));
+  WeightCache cache;
+  auto k = cache.Load(path.c_str());
+  unlink(path.c_str());
+  ASSERT_TRUE(k) << k.Message();
+  EXPECT_EQ(cache.EvictUnderPressure(4096), 0u);
+  EXPECT_EQ(cache.Blobs().size(), 1u);
+}
+
+}  // namespace
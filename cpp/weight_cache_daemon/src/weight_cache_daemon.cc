@@ -0,0 +1,133 @@
+// Keeps model weight files resident in CMM and shares them with LLM
+// processes by content hash (see axsys/weight_cache.hpp). Clients import
+// the printed key over the socket instead of reading the file; blobs
+// nobody holds are evicted, least recently used first, when free CMM
+// drops below the -m threshold.
+
+// C system headers
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// C++ headers
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// libax_sys_cpp
+#include "axsys/sys.hpp"
+#include "axsys/weight_cache.hpp"
+
+namespace {
+
+struct Options {
+  const char* socket = "/tmp/axsys_weights.sock";
+  uint64_t min_free_mb = 64;
+  unsigned interval_ms = 1000;
+  std::vector<const char*> files;
+};
+
+std::atomic<bool> g_keep_running{true};
+
+void SignalHandler(int) { g_keep_running.store(false); }
+
+void PrintUsage(const char* argv0) {
+  fprintf(stderr,
+          "Usage: %s [-s socket] [-m min_free_mb] [-i interval_ms] "
+          "file...\n"
+          "\n"
+          "Options:\n"
+          "  -s PATH  Socket clients import from "
+          "(default /tmp/axsys_weights.sock)\n"
+          "  -m N     Evict idle blobs while free CMM is below N MiB "
+          "(default 64)\n"
+          "  -i N     Pressure check period in ms (default 1000)\n",
+          argv0);
+}
+
+bool ParseOptions(int argc, char* argv[], Options* o) {
+  int c = 0;
+  while ((c = getopt(argc, argv, "s:m:i:h")) != -1) {
+    switch (c) {
+      case 's':
+        o->socket = optarg;
+        break;
+      case 'm':
+        o->min_free_mb = strtoull(optarg, nullptr, 10);
+        break;
+      case 'i':
+        o->interval_ms = static_cast<unsigned>(strtoul(optarg, nullptr, 10));
+        break;
+      default:
+        return false;
+    }
+  }
+  for (int i = optind; i < argc; ++i) o->files.push_back(argv[i]);
+  if (o->interval_ms == 0) o->interval_ms = 1;
+  return !o->files.empty();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options opt;
+  if (!ParseOptions(argc, argv, &opt)) {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+  axsys::System sys;
+  if (!sys.Ok()) {
+    fprintf(stderr, "AX_SYS_Init failed\n");
+    return -1;
+  }
+
+  axsys::WeightCache cache;
+  for (const char* file : opt.files) {
+    const auto t0 = std::chrono::steady_clock::now();
+    auto key = cache.Load(file);
+    if (!key) {
+      fprintf(stderr, "%s: %s\n", file, key.Message().c_str());
+      return -1;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - t0)
+                          .count();
+    printf("%s %s (%.3f s)\n", key.Value().c_str(), file, ms / 1000.0);
+  }
+  for (const axsys::WeightBlob& b : cache.Blobs()) {
+    printf("resident %s %" PRIu64 " bytes %s\n", b.key.c_str(), b.size,
+           b.path.c_str());
+  }
+  auto l = cache.Listen(opt.socket);
+  if (!l) {
+    fprintf(stderr, "%s: %s\n", opt.socket, l.Message().c_str());
+    return -1;
+  }
+  printf("serving on %s\n", opt.socket);
+  fflush(stdout);
+
+  struct sigaction sa;
+  sa.sa_handler = SignalHandler;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = 0;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  const uint64_t min_free = opt.min_free_mb << 20;
+  while (g_keep_running.load()) {
+    const size_t before = cache.Blobs().size();
+    const size_t evicted = cache.EvictUnderPressure(min_free);
+    if (evicted > 0) {
+      printf("evicted %zu of %zu blobs (free CMM below %" PRIu64 " MiB)\n",
+             evicted, before, opt.min_free_mb);
+      fflush(stdout);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(opt.interval_ms));
+  }
+  cache.Close();
+  return 0;
+}